@@ -0,0 +1,44 @@
+#!/bin/sh
+# 依次运行三个程序的基准脚本，报告写入当前目录；*_uniform_bench.json 为 --no-stream（逐个 glUniform）的对照，
+# *_many_bench.json / *_many_immediate_bench.json 为多物体场景下渲染队列与 --immediate（立即绘制）的对照，
+# *_budget_bench.json 为显存预算下的降级（各程序另写 <app>_memory.json），*_capture_bench.json 为开启帧捕获时的开销，
+# blackhole_no_tonemap_bench.json 为关闭自动曝光与色调映射的对照，blackhole_bloom_bench.json 为开启 Bloom 与横向光芒的开销
+# 设置 SKINNED_MODEL（带骨骼动画的模型文件）时另跑 model_viewer_skinned_bench.json：16×16 份蒙皮角色
+# model_viewer_ooc_bench.json 为核外模式（32 MB 缓冲池、16 MB 读入上限），OOC_MODEL 可指定大模型（首次运行时离线分页）
+# 设置 BATCH_MODELS（模型库目录或清单）时另跑批量缩略图：thumbs_1/ 为 1 个导入线程，thumbs/ 为默认线程数，比较两者 index.json 的 models_per_minute
+# 用法：BLACKHOLE=./Final SOLAR=./HW02 VIEWER=./HW03 [SKINNED_MODEL=角色.fbx] [OOC_MODEL=扫描.ply] [BATCH_MODELS=模型库] sh run_all.sh
+# 无 GPU 的机器可加 LIBGL_ALWAYS_SOFTWARE=1 走 llvmpipe，或只跑黑洞的 --cpu 参考路径
+DIR=$(dirname "$0")
+BLACKHOLE=${BLACKHOLE:-./Final}
+SOLAR=${SOLAR:-./HW02}
+VIEWER=${VIEWER:-./HW03}
+
+"$BLACKHOLE" --skip-test || exit 1
+"$BLACKHOLE" --tier-test || exit 1
+"$BLACKHOLE" --bench "$DIR/blackhole_orbit.txt" --out blackhole_bench.json --image blackhole_last.ppm || exit 1
+"$BLACKHOLE" --bench "$DIR/blackhole_orbit.txt" --no-stream --out blackhole_uniform_bench.json || exit 1
+"$BLACKHOLE" --bench "$DIR/blackhole_orbit.txt" --no-tonemap --out blackhole_no_tonemap_bench.json --image blackhole_no_tonemap_last.ppm || exit 1
+"$BLACKHOLE" --bench "$DIR/blackhole_orbit.txt" --bloom medium --streak --out blackhole_bloom_bench.json --image blackhole_bloom_last.ppm || exit 1
+"$BLACKHOLE" --bench "$DIR/blackhole_orbit.txt" --compute --out blackhole_compute_bench.json --image blackhole_compute_last.ppm || exit 1
+"$BLACKHOLE" --bench "$DIR/blackhole_orbit.txt" --vram-budget 32 --out blackhole_budget_bench.json || exit 1
+"$BLACKHOLE" --bench "$DIR/blackhole_orbit.txt" --capture blackhole_capture.y4m --out blackhole_capture_bench.json || exit 1
+"$BLACKHOLE" --bench "$DIR/blackhole_orbit.txt" --cpu --frames 60 --warmup 2 --out blackhole_cpu_bench.json --image blackhole_cpu_last.ppm || exit 1
+"$SOLAR" --bench "$DIR/solar_flyby.txt" --out solar_system_bench.json || exit 1
+"$SOLAR" --bench "$DIR/solar_flyby.txt" --no-stream --out solar_system_uniform_bench.json || exit 1
+"$SOLAR" --bench "$DIR/earth_skim.txt" --out solar_system_skim_bench.json || exit 1
+"$SOLAR" --bench "$DIR/solar_flyby.txt" --asteroids 500 --out solar_system_many_bench.json || exit 1
+"$SOLAR" --bench "$DIR/solar_flyby.txt" --asteroids 500 --immediate --out solar_system_many_immediate_bench.json || exit 1
+"$SOLAR" --bench "$DIR/earth_skim.txt" --vram-budget 48 --out solar_system_budget_bench.json || exit 1
+"$SOLAR" --bench "$DIR/solar_flyby.txt" --capture "solar_capture/frame_%05d.png" --out solar_system_capture_bench.json || exit 1
+"$VIEWER" --bench "$DIR/model_turntable.txt" --out model_viewer_bench.json || exit 1
+"$VIEWER" --bench "$DIR/model_turntable.txt" --no-stream --out model_viewer_uniform_bench.json || exit 1
+"$VIEWER" --bench "$DIR/model_turntable.txt" --grid 16 --out model_viewer_many_bench.json || exit 1
+"$VIEWER" --bench "$DIR/model_turntable.txt" --grid 16 --immediate --out model_viewer_many_immediate_bench.json || exit 1
+"$VIEWER" --bench "$DIR/model_turntable.txt" --out-of-core --ooc-gpu-mb 32 --ooc-host-mb 16 ${OOC_MODEL:+--model "$OOC_MODEL"} --out model_viewer_ooc_bench.json || exit 1
+if [ -n "$SKINNED_MODEL" ]; then
+    "$VIEWER" --bench "$DIR/model_turntable.txt" --model "$SKINNED_MODEL" --grid 16 --out model_viewer_skinned_bench.json || exit 1
+fi
+if [ -n "$BATCH_MODELS" ]; then
+    "$VIEWER" --batch "$BATCH_MODELS" --batch-threads 1 --batch-out thumbs_1 || exit 1
+    "$VIEWER" --batch "$BATCH_MODELS" --batch-out thumbs || exit 1
+fi
@@ -0,0 +1,209 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// ================= 命令行 =================
+bool parseBenchmarkArgs(int argc, char** argv, const char* app, BenchmarkConfig& config) {
+    config.app = app;
+    bool bench = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--bench" && hasValue) { config.script = argv[++i]; bench = true; }
+        else if (arg == "--frames" && hasValue) config.frames = std::atoi(argv[++i]);
+        else if (arg == "--warmup" && hasValue) config.warmup = std::atoi(argv[++i]);
+        else if (arg == "--out" && hasValue) config.output = argv[++i];
+        else if (arg == "--image" && hasValue) config.image = argv[++i];
+        else if (arg == "--size" && hasValue) std::sscanf(argv[++i], "%dx%d", &config.width, &config.height);
+        else if (arg == "--cpu") config.cpu = true;
+    }
+    if (config.output.empty()) config.output = config.app + "_bench.json";
+    return bench;
+}
+
+// ================= 统计 =================
+// 最近秩百分位：不插值，结果总是某一帧的真实耗时
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = (size_t)std::ceil(p * sorted.size());
+    if (rank == 0) rank = 1;
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+FrameStats computeFrameStats(std::vector<double> samples) {
+    FrameStats stats;
+    if (samples.empty()) return stats;
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0.0;
+    for (double s : samples) sum += s;
+    stats.minMs = samples.front();
+    stats.maxMs = samples.back();
+    stats.medianMs = percentile(samples, 0.50);
+    stats.p95Ms = percentile(samples, 0.95);
+    stats.p99Ms = percentile(samples, 0.99);
+    stats.meanMs = sum / samples.size();
+    return stats;
+}
+
+// ================= 离屏渲染目标 =================
+bool OffscreenTarget::create(int w, int h) {
+    width = w;
+    height = h;
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+    bool ok = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!ok) std::cout << "离屏帧缓冲不完整" << std::endl;
+    glViewport(0, 0, w, h);
+    return ok;
+}
+
+void OffscreenTarget::destroy() {
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &color);
+    glDeleteRenderbuffers(1, &depth);
+    fbo = color = depth = 0;
+}
+
+void OffscreenTarget::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+}
+
+std::vector<unsigned char> OffscreenTarget::readPixels() const {
+    std::vector<unsigned char> pixels((size_t)width * height * 3);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+// ================= 基准运行 =================
+void BenchmarkRun::begin(const BenchmarkConfig& cfg, int w, int h, const std::string& rendererName) {
+    config = cfg;
+    width = w;
+    height = h;
+    renderer = rendererName;
+    frameMs.clear();
+    frameIndex = 0;
+    runBegin = std::chrono::steady_clock::now();
+    std::cout << "[bench] " << config.app << " | " << renderer << " | " << w << "x" << h << " | 脚本 " << config.script << std::endl;
+}
+
+void BenchmarkRun::frameStart() {
+    frameBegin = std::chrono::steady_clock::now();
+}
+
+void BenchmarkRun::frameEnd(bool finishGL) {
+    if (finishGL) glFinish();
+    auto now = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - frameBegin).count();
+    if (frameIndex++ >= config.warmup) frameMs.push_back(ms);
+    totalSeconds = std::chrono::duration<double>(now - runBegin).count();
+}
+
+void BenchmarkRun::setMetric(const std::string& name, double value) {
+    for (auto& m : metrics) {
+        if (m.first == name) { m.second = value; return; }
+    }
+    metrics.push_back({ name, value });
+}
+
+bool BenchmarkRun::writeReport() const {
+    FrameStats stats = computeFrameStats(frameMs);
+    double measured = 0.0;
+    for (double ms : frameMs) measured += ms;
+    double fps = measured > 0.0 ? frameMs.size() * 1000.0 / measured : 0.0;
+
+    std::ofstream f(config.output);
+    if (!f) {
+        std::cout << "[bench] 无法写入报告 " << config.output << std::endl;
+        return false;
+    }
+
+    char buf[256];
+    f << "{\n";
+    f << "  \"app\": ";
+    writeJsonString(f, config.app);
+    f << ",\n  \"script\": ";
+    writeJsonString(f, config.script);
+    f << ",\n  \"renderer\": ";
+    writeJsonString(f, renderer);
+    f << ",\n";
+    f << "  \"build\": \"" << __DATE__ << " " << __TIME__ << "\",\n";
+    f << "  \"width\": " << width << ",\n";
+    f << "  \"height\": " << height << ",\n";
+    f << "  \"warmup_frames\": " << config.warmup << ",\n";
+    f << "  \"frames\": " << frameMs.size() << ",\n";
+    snprintf(buf, sizeof(buf),
+        "  \"frame_ms\": { \"min\": %.4f, \"median\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"mean\": %.4f, \"max\": %.4f },\n",
+        stats.minMs, stats.medianMs, stats.p95Ms, stats.p99Ms, stats.meanMs, stats.maxMs);
+    f << buf;
+    snprintf(buf, sizeof(buf), "  \"throughput_fps\": %.3f,\n", fps);
+    f << buf;
+    snprintf(buf, sizeof(buf), "  \"throughput_mpix_per_s\": %.3f,\n", fps * width * height / 1.0e6);
+    f << buf;
+    snprintf(buf, sizeof(buf), "  \"wall_seconds\": %.3f,\n", totalSeconds);
+    f << buf;
+    f << "  \"metrics\": {";
+    for (size_t i = 0; i < metrics.size(); i++) {
+        f << (i ? ",\n    " : "\n    ");
+        writeJsonString(f, metrics[i].first);
+        snprintf(buf, sizeof(buf), ": %.6g", metrics[i].second);
+        f << buf;
+    }
+    f << (metrics.empty() ? "},\n" : "\n  },\n");
+    f << "  \"frame_samples_ms\": [";
+    for (size_t i = 0; i < frameMs.size(); i++) {
+        snprintf(buf, sizeof(buf), "%s%.4f", i ? ", " : "", frameMs[i]);
+        f << buf;
+    }
+    f << "]\n}\n";
+
+    std::cout << "[bench] " << frameMs.size() << " 帧：min " << stats.minMs << " / median " << stats.medianMs
+              << " / p95 " << stats.p95Ms << " / p99 " << stats.p99Ms << " ms，" << fps << " FPS -> " << config.output << std::endl;
+    return true;
+}
+
+void writeJsonString(std::ostream& f, const std::string& s) {
+    f << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') f << '\\' << c;
+        else if ((unsigned char)c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", (unsigned char)c);
+            f << esc;
+        }
+        else f << c;
+    }
+    f << '"';
+}
+
+// ================= 图像输出 =================
+bool writeImagePPM(const std::string& path, int width, int height, const unsigned char* rgb, bool flipY) {
+    std::ofstream f(path, std::ios::binary);
+    if (!f) return false;
+    f << "P6\n" << width << " " << height << "\n255\n";
+    for (int y = 0; y < height; y++) {
+        int row = flipY ? height - 1 - y : y;
+        f.write((const char*)rgb + (size_t)row * width * 3, (size_t)width * 3);
+    }
+    return (bool)f;
+}
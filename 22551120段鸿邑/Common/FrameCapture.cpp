@@ -0,0 +1,619 @@
+#include "framecapture.h"
+#include "benchmark.h"
+#include "memoryregistry.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+FrameCapture gCapture;
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+static const char* PIPE_MODE = "wb";
+#else
+static const char* PIPE_MODE = "w";   // glibc 的 popen 不接受 "b"
+#endif
+
+// ================= 扩展入口 =================
+// 与 StreamBuffer 相同：glBufferStorage 在 3.3 上下文里需要自行获取
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void (APIENTRYP BufferStorageFn)(GLenum, GLsizeiptr, const void*, GLbitfield);
+
+static BufferStorageFn loadBufferStorage() {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool core = major > 4 || (major == 4 && minor >= 4);
+    if (!core && !glfwExtensionSupported("GL_ARB_buffer_storage")) return nullptr;
+    return (BufferStorageFn)glfwGetProcAddress("glBufferStorage");
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// ================= PNG 编码 =================
+// 没有引入 zlib / stb_image_write，这里用一个只输出定长 Huffman 块的 deflate：
+// 贪心 LZ77（每个位置查一次哈希），配合 Up 滤波后大片为 0 的行，压缩率够用，速度远快于 zlib 的默认级别
+static uint32_t crcTable[256];
+static uint16_t lengthSymbol[259];   // 匹配长度 -> 长度码序号（0..28）
+
+static const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                         35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+                                       1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static void initPngTables() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            crcTable[n] = c;
+        }
+        int code = 0;
+        for (int len = 3; len <= 258; len++) {
+            while (code < 28 && LENGTH_BASE[code + 1] <= len) code++;
+            lengthSymbol[len] = (uint16_t)code;
+        }
+    });
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t n) {
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static uint32_t adler32(const uint8_t* data, size_t n) {
+    uint32_t a = 1, b = 0;
+    while (n > 0) {
+        size_t block = std::min<size_t>(n, 5552);   // 5552 字节内 b 不会溢出
+        n -= block;
+        while (block--) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+struct BitWriter {
+    std::vector<uint8_t>& out;
+    uint32_t bits = 0;
+    int count = 0;
+
+    void put(uint32_t value, int n) {
+        bits |= value << count;
+        count += n;
+        while (count >= 8) {
+            out.push_back((uint8_t)bits);
+            bits >>= 8;
+            count -= 8;
+        }
+    }
+    // Huffman 码从高位开始写
+    void putCode(uint32_t code, int n) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < n; i++) reversed |= ((code >> i) & 1) << (n - 1 - i);
+        put(reversed, n);
+    }
+    void flush() {
+        if (count > 0) out.push_back((uint8_t)bits);
+        bits = 0;
+        count = 0;
+    }
+};
+
+static void putSymbol(BitWriter& w, int symbol) {
+    if (symbol < 144) w.putCode(0x30 + symbol, 8);
+    else if (symbol < 256) w.putCode(0x190 + symbol - 144, 9);
+    else if (symbol < 280) w.putCode(symbol - 256, 7);
+    else w.putCode(0xC0 + symbol - 280, 8);
+}
+
+static void deflateFixed(const uint8_t* data, size_t n, std::vector<uint8_t>& out) {
+    const int HASH_BITS = 15;
+    const size_t WINDOW = 32768;
+    std::vector<int32_t> head((size_t)1 << HASH_BITS, -1);
+    BitWriter w{out};
+    w.put(1, 1);   // BFINAL
+    w.put(1, 2);   // BTYPE = 01，定长 Huffman
+
+    size_t i = 0;
+    while (i < n) {
+        size_t matchLen = 0, matchDist = 0;
+        if (i + 3 <= n) {
+            uint32_t key = (uint32_t)data[i] << 16 | (uint32_t)data[i + 1] << 8 | data[i + 2];
+            uint32_t h = (key * 2654435761u) >> (32 - HASH_BITS);
+            int32_t candidate = head[h];
+            head[h] = (int32_t)i;
+            if (candidate >= 0 && i - (size_t)candidate <= WINDOW) {
+                size_t maxLen = std::min<size_t>(258, n - i);
+                const uint8_t* a = data + candidate;
+                const uint8_t* b = data + i;
+                size_t len = 0;
+                while (len < maxLen && a[len] == b[len]) len++;
+                if (len >= 3) {
+                    matchLen = len;
+                    matchDist = i - (size_t)candidate;
+                }
+            }
+        }
+        if (matchLen == 0) {
+            putSymbol(w, data[i]);
+            i++;
+            continue;
+        }
+        int lc = lengthSymbol[matchLen];
+        putSymbol(w, 257 + lc);
+        if (LENGTH_EXTRA[lc]) w.put((uint32_t)(matchLen - LENGTH_BASE[lc]), LENGTH_EXTRA[lc]);
+        int dc = 29;
+        while (DIST_BASE[dc] > matchDist) dc--;
+        w.putCode(dc, 5);
+        if (DIST_EXTRA[dc]) w.put((uint32_t)(matchDist - DIST_BASE[dc]), DIST_EXTRA[dc]);
+        i += matchLen;
+    }
+    putSymbol(w, 256);
+    w.flush();
+}
+
+static void putBigEndian(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back((uint8_t)(v >> 24));
+    out.push_back((uint8_t)(v >> 16));
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)v);
+}
+
+static void putChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t n) {
+    putBigEndian(out, (uint32_t)n);
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (n) out.insert(out.end(), data, data + n);
+    putBigEndian(out, crc32(0, out.data() + start, n + 4));
+}
+
+// rgba 自下而上（glReadPixels 的行序），输出自上而下的 RGB PNG；返回写出的字节数，失败为 0
+static size_t writeImagePNG(const std::string& path, int width, int height, const uint8_t* rgba) {
+    initPngTables();
+    size_t stride = (size_t)width * 3 + 1;
+    std::vector<uint8_t> raw(stride * height);
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = rgba + (size_t)(height - 1 - y) * width * 4;
+        const uint8_t* above = y > 0 ? src + (size_t)width * 4 : nullptr;
+        uint8_t* dst = raw.data() + stride * y;
+        *dst++ = above ? 2 : 0;   // 第一行不滤波，其余 Up
+        for (int x = 0; x < width; x++, src += 4, dst += 3) {
+            if (above) {
+                dst[0] = (uint8_t)(src[0] - above[0]);
+                dst[1] = (uint8_t)(src[1] - above[1]);
+                dst[2] = (uint8_t)(src[2] - above[2]);
+                above += 4;
+            }
+            else {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+            }
+        }
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    zlib.reserve(raw.size() / 2);
+    deflateFixed(raw.data(), raw.size(), zlib);
+    putBigEndian(zlib, adler32(raw.data(), raw.size()));
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+    uint8_t ihdr[13] = {};
+    std::vector<uint8_t> header;
+    putBigEndian(header, (uint32_t)width);
+    putBigEndian(header, (uint32_t)height);
+    std::memcpy(ihdr, header.data(), 8);
+    ihdr[8] = 8;    // 位深
+    ihdr[9] = 2;    // RGB
+    putChunk(png, "IHDR", ihdr, sizeof(ihdr));
+    putChunk(png, "IDAT", zlib.data(), zlib.size());
+    putChunk(png, "IEND", nullptr, 0);
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return 0;
+    size_t written = std::fwrite(png.data(), 1, png.size(), f);
+    std::fclose(f);
+    return written == png.size() ? written : 0;
+}
+
+// ================= Y4M =================
+// BT.709 有限范围，整数系数 ×256；色度取 2×2 平均（C420jpeg 的中心取样位置）
+static void convertY4M(const uint8_t* rgba, int width, int height, std::vector<uint8_t>& out) {
+    static const char FRAME_TAG[] = "FRAME\n";
+    int cw = (width + 1) / 2, ch = (height + 1) / 2;
+    size_t tag = sizeof(FRAME_TAG) - 1;
+    out.resize(tag + (size_t)width * height + (size_t)cw * ch * 2);
+    std::memcpy(out.data(), FRAME_TAG, tag);
+    uint8_t* yPlane = out.data() + tag;
+    uint8_t* uPlane = yPlane + (size_t)width * height;
+    uint8_t* vPlane = uPlane + (size_t)cw * ch;
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = rgba + (size_t)(height - 1 - y) * width * 4;
+        uint8_t* dst = yPlane + (size_t)y * width;
+        for (int x = 0; x < width; x++, src += 4)
+            dst[x] = (uint8_t)(((47 * src[0] + 157 * src[1] + 16 * src[2] + 128) >> 8) + 16);
+    }
+    for (int cy = 0; cy < ch; cy++) {
+        int y0 = cy * 2, y1 = std::min(y0 + 1, height - 1);
+        const uint8_t* row0 = rgba + (size_t)(height - 1 - y0) * width * 4;
+        const uint8_t* row1 = rgba + (size_t)(height - 1 - y1) * width * 4;
+        for (int cx = 0; cx < cw; cx++) {
+            int x0 = cx * 8, x1 = std::min(cx * 2 + 1, width - 1) * 4;
+            int r = row0[x0] + row0[x1] + row1[x0] + row1[x1];
+            int g = row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1];
+            int b = row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2];
+            // 四个像素之和，系数再除以 4；加 128 × 1024 使中间值非负
+            uPlane[(size_t)cy * cw + cx] = (uint8_t)((-26 * r - 87 * g + 112 * b + 131584) >> 10);
+            vPlane[(size_t)cy * cw + cx] = (uint8_t)((112 * r - 102 * g - 10 * b + 131584) >> 10);
+        }
+    }
+}
+
+// ================= 开始 / 结束 =================
+bool FrameCapture::start(const std::string& path, int w, int h, int rate, unsigned workerCount) {
+    if (running) stop();
+    if (path.empty() || w <= 0 || h <= 0) return false;
+
+    target = path;
+    width = w;
+    height = h;
+    fps = std::max(rate, 1);
+    pipe = path[0] == '|';
+    std::string ext = std::filesystem::path(path).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    if (pipe || ext == ".y4m") format = CAPTURE_Y4M;
+    else if (ext == ".ppm") format = CAPTURE_PPM;
+    else format = CAPTURE_PNG;
+
+    if (format != CAPTURE_Y4M && target.find('%') == std::string::npos) {
+        // 序列需要帧号，没有格式符时插在扩展名前
+        std::filesystem::path p(target);
+        target = (p.parent_path() / (p.stem().string() + "_%05d" + p.extension().string())).string();
+    }
+    if (!pipe) {
+        std::filesystem::path parent = std::filesystem::path(target).parent_path();
+        std::error_code ec;
+        if (!parent.empty()) std::filesystem::create_directories(parent, ec);
+    }
+    if (format == CAPTURE_Y4M) {
+        stream = pipe ? popen(target.c_str() + 1, PIPE_MODE) : std::fopen(target.c_str(), "wb");
+        if (!stream) {
+            std::cout << "[capture] 无法打开输出 " << target << std::endl;
+            return false;
+        }
+        std::fprintf(stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", width, height, fps);
+    }
+
+    // PBO 环
+    frameBytes = (size_t)width * height * 4;
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    BufferStorageFn bufferStorage = loadBufferStorage();
+    GLint previousPack = 0;
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &previousPack);
+    persistent = bufferStorage != nullptr;
+    {
+        MemoryAssetScope asset("frame_capture");
+        for (int i = 0; i < RING; i++) {
+            slots[i] = Slot();
+            mapped[i] = nullptr;
+            glGenBuffers(1, &slots[i].pbo);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].pbo);
+            if (persistent) {
+                bufferStorage(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)frameBytes, nullptr, flags);
+                gMemory.trackBufferStorage(slots[i].pbo, GL_PIXEL_PACK_BUFFER, (GLsizeiptr)frameBytes);
+                mapped[i] = (uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)frameBytes, flags);
+                if (!mapped[i]) persistent = false;
+            }
+        }
+        if (!persistent) {
+            // 任一槽映射失败就整体回退：不可变存储不能再 glBufferData，重新生成缓冲对象
+            for (int i = 0; i < RING; i++) {
+                if (mapped[i]) {
+                    glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].pbo);
+                    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                    mapped[i] = nullptr;
+                }
+                if (bufferStorage) {
+                    glDeleteBuffers(1, &slots[i].pbo);
+                    glGenBuffers(1, &slots[i].pbo);
+                }
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].pbo);
+                glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)frameBytes, nullptr, GL_STREAM_READ);
+            }
+        }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, (GLuint)previousPack);
+
+    // 工作线程：编码比读回慢得多，留一个核给渲染线程
+    if (workerCount == 0) workerCount = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+    if (format == CAPTURE_PPM) workerCount = std::min(workerCount, 2u);   // PPM 只受磁盘限制
+    stats = CaptureStats();
+    quit = false;
+    activeJobs = 0;
+    nextWrite = 0;
+    queue.clear();
+    reorder.clear();
+    for (unsigned i = 0; i < workerCount; i++) workers.emplace_back(&FrameCapture::workerMain, this);
+    running = true;
+
+    const char* formatName = format == CAPTURE_Y4M ? "Y4M" : format == CAPTURE_PPM ? "PPM 序列" : "PNG 序列";
+    std::cout << "[capture] 开始捕获 " << width << "×" << height << " " << formatName << " -> " << target << "，"
+              << RING << " 个 PBO（" << (persistent ? "持久映射" : "map + memcpy") << "），" << workerCount << " 个编码线程" << std::endl;
+    return true;
+}
+
+void FrameCapture::stop() {
+    if (!running) return;
+
+    // 取回还在环里的帧（按帧序）
+    GLint previousPack = 0;
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &previousPack);
+    uint64_t next = stats.frames;
+    for (int i = 0; i < RING; i++) {
+        int index = (int)((next + i) % RING);
+        if (slots[index].pending) collect(slots[index], index);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+
+    for (int i = 0; i < RING; i++) {
+        if (mapped[i]) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].pbo);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            mapped[i] = nullptr;
+        }
+        if (slots[i].fence) glDeleteSync(slots[i].fence);
+        if (slots[i].pbo) glDeleteBuffers(1, &slots[i].pbo);
+        slots[i] = Slot();
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, (GLuint)previousPack);
+
+    if (stream) {
+        if (pipe) pclose(stream);
+        else std::fclose(stream);
+        stream = nullptr;
+    }
+    bufferPool.clear();
+    reorder.clear();
+    running = false;
+    std::cout << "[capture] 停止捕获 -> " << target << std::endl;
+}
+
+// ================= 每帧 =================
+void FrameCapture::capture(GLuint fbo) {
+    if (!running) return;
+    PROFILE_SCOPE("capture");
+
+    GLint previousRead = 0, previousPack = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousRead);
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &previousPack);
+
+    // 取回 LATENCY 帧之前发起的读回，从最旧的槽开始，保证按帧序入队
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t frame = stats.frames;
+    for (int i = 1; i <= RING; i++) {
+        int index = (int)((frame + i) % RING);
+        Slot& slot = slots[index];
+        if (slot.pending && frame - slot.frame >= LATENCY) collect(slot, index);
+    }
+    stats.collectMs += elapsedMs(t0);
+
+    int index = (int)(frame % RING);
+    Slot& slot = slots[index];
+    if (slot.pending) collect(slot, index);   // LATENCY < RING 时不会发生
+    if (persistent) {
+        // 工作线程还在从这个槽拷贝上一轮的数据
+        std::unique_lock<std::mutex> lock(mutex);
+        if (slot.busy) {
+            auto tw = std::chrono::steady_clock::now();
+            progress.wait(lock, [&] { return !slot.busy; });
+            stats.stallMs += elapsedMs(tw);
+        }
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = frame;
+    slot.pending = true;
+    stats.frames++;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, (GLuint)previousPack);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)previousRead);
+    stats.issueMs += elapsedMs(t1);
+}
+
+void FrameCapture::collect(Slot& slot, int index) {
+    if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        // 读回还没完成（GPU 落后超过 LATENCY 帧）：只能等
+        auto t0 = std::chrono::steady_clock::now();
+        GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        GLenum status;
+        do {
+            status = glClientWaitSync(slot.fence, waitFlags, 1000000);
+            waitFlags = 0;
+        } while (status == GL_TIMEOUT_EXPIRED);
+        stats.fenceWaits++;
+        stats.fenceWaitMs += elapsedMs(t0);
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    slot.pending = false;
+
+    Job job{slot.frame, -1, {}};
+    if (persistent) {
+        job.slot = index;
+    }
+    else {
+        job.pixels = takeBuffer();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)frameBytes, GL_MAP_READ_BIT);
+        if (data) std::memcpy(job.pixels.data(), data, frameBytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if ((int)queue.size() >= MAX_QUEUED) {
+        auto t0 = std::chrono::steady_clock::now();
+        progress.wait(lock, [&] { return (int)queue.size() < MAX_QUEUED; });
+        stats.stallMs += elapsedMs(t0);
+    }
+    if (persistent) slot.busy = true;
+    queue.push_back(std::move(job));
+    lock.unlock();
+    wake.notify_one();
+}
+
+std::vector<uint8_t> FrameCapture::takeBuffer() {
+    std::vector<uint8_t> buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!bufferPool.empty()) {
+            buffer = std::move(bufferPool.back());
+            bufferPool.pop_back();
+        }
+    }
+    buffer.resize(frameBytes);
+    return buffer;
+}
+
+// ================= 工作线程 =================
+void FrameCapture::workerMain() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || !queue.empty(); });
+            if (queue.empty()) return;   // quit 且已排空
+            job = std::move(queue.front());
+            queue.erase(queue.begin());
+            activeJobs++;
+        }
+        progress.notify_all();
+
+        if (job.slot >= 0) {
+            // 持久映射：围栏已完成，直接从映射里拷出，尽早把槽还给主线程
+            job.pixels = takeBuffer();
+            std::memcpy(job.pixels.data(), mapped[job.slot], frameBytes);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                slots[job.slot].busy = false;
+            }
+            progress.notify_all();
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        encode(job);
+        double ms = elapsedMs(t0);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.encodeMs += ms;
+            stats.written++;
+            bufferPool.push_back(std::move(job.pixels));
+            activeJobs--;
+        }
+        progress.notify_all();
+    }
+}
+
+void FrameCapture::encode(Job& job) {
+    uint64_t bytes = 0;
+    if (format == CAPTURE_Y4M) {
+        std::vector<uint8_t> data;
+        convertY4M(job.pixels.data(), width, height, data);
+        bytes = data.size();
+        writeOrdered(job.frame, data);
+    }
+    else {
+        char path[1024];
+        std::snprintf(path, sizeof(path), target.c_str(), (int)job.frame);
+        if (format == CAPTURE_PNG) {
+            bytes = writeImagePNG(path, width, height, job.pixels.data());
+        }
+        else {
+            std::vector<uint8_t> rgb((size_t)width * height * 3);
+            for (size_t i = 0, n = (size_t)width * height; i < n; i++) std::memcpy(&rgb[i * 3], &job.pixels[i * 4], 3);
+            if (writeImagePPM(path, width, height, rgb.data(), true)) bytes = rgb.size();
+        }
+        if (bytes == 0) std::cout << "[capture] 写入失败：" << path << std::endl;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.bytesWritten += bytes;
+}
+
+void FrameCapture::writeOrdered(uint64_t frame, std::vector<uint8_t>& data) {
+    std::lock_guard<std::mutex> lock(streamMutex);
+    reorder[frame] = std::move(data);
+    for (auto it = reorder.find(nextWrite); it != reorder.end(); it = reorder.find(nextWrite)) {
+        std::fwrite(it->second.data(), 1, it->second.size(), stream);
+        reorder.erase(it);
+        nextWrite++;
+    }
+}
+
+// ================= 热键与统计 =================
+void FrameCapture::handleHotkey(GLFWwindow* window, const char* app, const std::string& path) {
+    bool down = glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS;
+    if (down && !hotkeyDown) {
+        if (running) {
+            stop();
+            printStats(app);
+        }
+        else {
+            int w = 0, h = 0;
+            glfwGetFramebufferSize(window, &w, &h);
+            start(path.empty() ? std::string(app) + "_capture.y4m" : path, w, h, fps);
+        }
+    }
+    hotkeyDown = down;
+}
+
+void FrameCapture::printStats(const char* app) const {
+    if (stats.frames == 0) return;
+    double frames = (double)stats.frames;
+    std::cout << "[capture] " << app << "：" << stats.frames << " 帧，写出 " << stats.written << " 帧 / " << stats.bytesWritten / (1024.0 * 1024.0)
+              << " MB；主线程每帧 " << (stats.issueMs + stats.collectMs) / frames << " ms（发起 " << stats.issueMs / frames << "，取回 "
+              << stats.collectMs / frames << "），围栏等待 " << stats.fenceWaits << " 次共 " << stats.fenceWaitMs << " ms，编码阻塞 "
+              << stats.stallMs << " ms；编码每帧 " << stats.encodeMs / std::max<double>((double)stats.written, 1.0) << " ms" << std::endl;
+}
+
+void addCaptureMetrics(BenchmarkRun& run, const FrameCapture& capture) {
+    double frames = (double)std::max<uint64_t>(capture.stats.frames, 1);
+    run.setMetric("capture_frames", (double)capture.stats.frames);
+    run.setMetric("capture_cpu_ms", (capture.stats.issueMs + capture.stats.collectMs) / frames);
+    run.setMetric("capture_fence_wait_ms", capture.stats.fenceWaitMs / frames);
+    run.setMetric("capture_stall_ms", capture.stats.stallMs / frames);
+    run.setMetric("capture_encode_ms", capture.stats.encodeMs / (double)std::max<uint64_t>(capture.stats.written, 1));
+    run.setMetric("capture_mb", capture.stats.bytesWritten / (1024.0 * 1024.0));
+}
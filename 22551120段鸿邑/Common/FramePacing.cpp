@@ -0,0 +1,229 @@
+#include "framepacing.h"
+#include "benchmark.h"
+#include "replay.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+FramePacer gPacer;
+
+static constexpr uint64_t FENCE_TIMEOUT_NS = 1000000000ull;
+static constexpr int CALIBRATE_FRAMES = 120;     // GPU 与 CPU 时钟每隔多少帧重新对齐一次
+static constexpr size_t REPORT_SAMPLES = 600;    // 测量模式每攒够多少帧输出一次
+
+// ================= 参数 =================
+void parsePacingArgs(int argc, char** argv, PacingConfig& config) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-pacing") == 0) config.enabled = false;
+        if (strcmp(argv[i], "--latency") == 0) config.measure = true;
+        if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) config.framesInFlight = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--swap-interval") == 0 && i + 1 < argc) config.swapInterval = std::max(0, atoi(argv[i + 1]));
+    }
+}
+
+// ================= 初始化 =================
+void FramePacer::init(GLFWwindow* window, const PacingConfig& config) {
+    if (!config.enabled) return;
+    maxInFlight = std::clamp(config.framesInFlight, 1, MAX_IN_FLIGHT);
+    measure = config.measure;
+    int swapInterval = config.swapInterval;
+    epoch = std::chrono::steady_clock::now();
+    stats = PacingStats();
+    frameIndex = 0;
+    reported = 0;
+    pendingInputUs = -1.0;
+    for (Frame& frame : frames) frame = Frame();
+    glfwSwapInterval(swapInterval);
+
+    // 显示延迟按窗口所在显示器（窗口模式取主显示器）的刷新率估计
+    GLFWmonitor* monitor = glfwGetWindowMonitor(window);
+    if (!monitor) monitor = glfwGetPrimaryMonitor();
+    const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+    int refresh = mode && mode->refreshRate > 0 ? mode->refreshRate : 60;
+    displayUs = (swapInterval > 0 ? 1.0e6 : 0.5e6) / refresh;
+    if (measure) calibrate();
+    enabled = true;
+
+    std::cout << "[pacing] 最多 " << maxInFlight << " 帧在途，交换间隔 " << swapInterval << "，刷新率 " << refresh << " Hz"
+              << (measure ? "，测量输入到上屏的延迟" : "") << std::endl;
+}
+
+void FramePacer::shutdown() {
+    if (!enabled) return;
+    if (inputRunning) {
+        quit = true;
+        inputThread.join();
+        inputRunning = false;
+    }
+    for (Frame& frame : frames) {
+        if (frame.fence) glDeleteSync(frame.fence);
+        if (frame.query) glDeleteQueries(1, &frame.query);
+        frame = Frame();
+    }
+    enabled = false;
+}
+
+double FramePacer::nowUs() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+// GL_TIMESTAMP 的当前值与 CPU 时钟同时读取，得到两者的差；查询结果减去这个差即为 CPU 时钟上的时刻
+void FramePacer::calibrate() {
+    GLint64 gpuNs = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNs);
+    gpuOffsetNs = (int64_t)gpuNs - (int64_t)(nowUs() * 1000.0);
+}
+
+// ================= 输入线程 =================
+void FramePacer::startInput(const std::vector<int>& keyList, std::function<void(float dt)> step) {
+    if (!enabled || inputRunning) return;
+    watched.clear();
+    for (int key : keyList) {
+        if (key >= 0 && key <= GLFW_KEY_LAST) watched.push_back(key);
+    }
+    integrate = std::move(step);
+    lastStep = std::chrono::steady_clock::now();
+    quit = false;
+    inputRunning = true;
+    inputThread = std::thread(&FramePacer::inputMain, this);
+}
+
+// 固定节拍积分；睡过头时按实际间隔积分，不追赶错过的步
+void FramePacer::inputMain() {
+    const auto period = std::chrono::microseconds(1000000 / RATE_HZ);
+    auto next = std::chrono::steady_clock::now() + period;
+    while (!quit) {
+        std::this_thread::sleep_until(next);
+        auto now = std::chrono::steady_clock::now();
+        next = std::max(next + period, now);
+        std::lock_guard<std::mutex> lock(mutex);
+        float dt = std::min(std::chrono::duration<float>(now - lastStep).count(), 0.05f);
+        lastStep = now;
+        if (dt > 0.0f) integrate(dt);
+        inputSteps++;
+    }
+}
+
+void FramePacer::sampleInput(GLFWwindow* window) {
+    if (!inputRunning) return;
+    bool changed = false;
+    for (int key : watched) {
+        bool down = glfwGetKey(window, key) == GLFW_PRESS;
+        if (keys[key].exchange(down) != down) changed = true;
+    }
+    if (changed) noteInput();
+}
+
+bool FramePacer::keyDown(GLFWwindow* window, int key) const {
+    if (inputRunning) return key >= 0 && key <= GLFW_KEY_LAST && keys[key].load();
+    return inputKeyDown(window, key);
+}
+
+void FramePacer::noteInput() {
+    if (measure && pendingInputUs < 0.0) pendingInputUs = nowUs();
+}
+
+// ================= 每帧 =================
+void FramePacer::beginFrame() {
+    if (!enabled) return;
+    if (frameIndex >= (uint64_t)maxInFlight) {
+        Frame& frame = frames[(frameIndex - maxInFlight) % RING];
+        if (frame.fence) {
+            if (glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+                auto start = std::chrono::steady_clock::now();
+                while (glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS) == GL_TIMEOUT_EXPIRED) {}
+                stats.fenceWaits++;
+                stats.fenceWaitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+            glDeleteSync(frame.fence);
+            frame.fence = nullptr;
+            resolve(frame);
+        }
+    }
+    if (measure && frameIndex % CALIBRATE_FRAMES == 0) calibrate();
+}
+
+void FramePacer::latch(GLFWwindow* window, const std::function<void()>& copy) {
+    if (!enabled) {
+        copy();
+        return;
+    }
+    glfwPollEvents();
+    sampleInput(window);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (inputRunning) {
+            auto now = std::chrono::steady_clock::now();
+            float dt = std::min(std::chrono::duration<float>(now - lastStep).count(), 0.05f);
+            lastStep = now;
+            if (dt > 0.0f) integrate(dt);
+        }
+        copy();
+    }
+    Frame& frame = frames[frameIndex % RING];
+    frame.latchUs = nowUs();
+    frame.inputUs = pendingInputUs;
+    pendingInputUs = -1.0;
+}
+
+void FramePacer::endFrame() {
+    if (!enabled) return;
+    Frame& frame = frames[frameIndex % RING];
+    if (frame.latchUs < 0.0) frame.latchUs = nowUs();   // 本帧没有锁存（程序没有可动的相机）
+    if (measure) {
+        if (!frame.query) glGenQueries(1, &frame.query);
+        glQueryCounter(frame.query, GL_TIMESTAMP);
+        frame.pending = true;
+    }
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frameIndex++;
+    stats.frames++;
+
+    if (measure && stats.latchToPhotonMs.size() >= reported + REPORT_SAMPLES) {
+        report(reported, "最近");
+        reported = stats.latchToPhotonMs.size();
+    }
+}
+
+// 围栏已完成，查询结果一定可用：GPU 画完的时刻 + 显示延迟即为估计的上屏时刻
+void FramePacer::resolve(Frame& frame) {
+    if (frame.pending) {
+        GLuint64 gpuNs = 0;
+        glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &gpuNs);
+        double photonUs = ((int64_t)gpuNs - gpuOffsetNs) / 1000.0 + displayUs;
+        stats.latchToPhotonMs.push_back((photonUs - frame.latchUs) / 1000.0);
+        if (frame.inputUs >= 0.0) {
+            stats.inputToPhotonMs.push_back((photonUs - frame.inputUs) / 1000.0);
+            stats.inputToLatchMs.push_back((frame.latchUs - frame.inputUs) / 1000.0);
+        }
+        frame.pending = false;
+    }
+    frame.latchUs = -1.0;
+    frame.inputUs = -1.0;
+}
+
+// ================= 统计 =================
+void FramePacer::report(size_t from, const char* label) const {
+    std::vector<double> latch(stats.latchToPhotonMs.begin() + std::min(from, stats.latchToPhotonMs.size()), stats.latchToPhotonMs.end());
+    if (latch.empty()) return;
+    FrameStats l = computeFrameStats(latch);
+    std::cout << "[latency] " << label << " " << latch.size() << " 帧：锁存→上屏 中位数 " << l.medianMs << " / p95 " << l.p95Ms << " ms";
+    if (!stats.inputToPhotonMs.empty()) {
+        FrameStats i = computeFrameStats(stats.inputToPhotonMs);
+        FrameStats w = computeFrameStats(stats.inputToLatchMs);
+        std::cout << "；输入→上屏 中位数 " << i.medianMs << " / p95 " << i.p95Ms << " ms（累计 " << stats.inputToPhotonMs.size()
+                  << " 次输入，其中等待锁存 中位数 " << w.medianMs << " ms）";
+    }
+    std::cout << std::endl;
+}
+
+void FramePacer::printStats(const char* app) const {
+    if (stats.frames == 0) return;
+    std::cout << "[pacing] " << app << "：" << stats.frames << " 帧，最多 " << maxInFlight << " 帧在途，等待围栏 " << stats.fenceWaits
+              << " 次、平均每帧 " << stats.fenceWaitMs / stats.frames << " ms";
+    uint64_t steps = inputSteps;
+    if (steps) std::cout << "；输入线程 " << steps << " 步（" << steps / std::max(nowUs() / 1.0e6, 1e-3) << " Hz）";
+    std::cout << std::endl;
+    if (measure) report(0, app);
+}
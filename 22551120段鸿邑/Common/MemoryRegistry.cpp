@@ -0,0 +1,704 @@
+#include "memoryregistry.h"
+#include "benchmark.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+MemoryRegistry gMemory;
+
+enum { KIND_BUFFER, KIND_TEXTURE, KIND_RENDERBUFFER, KIND_PROGRAM };
+
+static const char* UNTAGGED = "未标记";
+static thread_local std::string tlsAsset;
+
+// ================= 扩展常量 =================
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_TEXTURE_IMMUTABLE_FORMAT
+#define GL_TEXTURE_IMMUTABLE_FORMAT 0x912F
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_SHADER_STORAGE_BUFFER_BINDING 0x90D3
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#define GL_DRAW_INDIRECT_BUFFER_BINDING 0x8F43
+#endif
+// 驱动报告的剩余显存（KB），只用于报告，登记表自己的统计不依赖它
+#define GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#define TEXTURE_FREE_MEMORY_ATI 0x87FC
+
+static const char* CATEGORY_NAMES[MEM_CATEGORY_COUNT] = {
+    "vertex_buffer", "index_buffer", "uniform_buffer", "pixel_buffer", "other_buffer",
+    "texture_2d", "texture_3d", "texture_cube", "renderbuffer", "program", "host",
+};
+
+const char* memoryCategoryName(MemoryCategory category) {
+    return CATEGORY_NAMES[category];
+}
+
+// ================= 尺寸估算 =================
+static uint32_t internalFormatBytes(GLenum internal, GLenum format, GLenum type) {
+    switch (internal) {
+    case GL_R8: case GL_R8I: case GL_R8UI: case GL_RED:
+        return type == GL_FLOAT ? 4 : 1;
+    case GL_RG8: case GL_R16: case GL_R16F: case GL_R16I: case GL_R16UI: case GL_DEPTH_COMPONENT16: case GL_RG:
+        return internal == GL_RG && type == GL_FLOAT ? 8 : 2;
+    case GL_RGB8: case GL_SRGB8: case GL_RGBA8: case GL_SRGB8_ALPHA8: case GL_RGBA8I: case GL_RGBA8UI:
+    case GL_RG16: case GL_RG16F: case GL_R32F: case GL_R32I: case GL_R32UI: case GL_RGB10_A2:
+    case GL_R11F_G11F_B10F: case GL_RGB9_E5: case GL_DEPTH_COMPONENT24: case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH_COMPONENT32F: case GL_DEPTH_COMPONENT:
+        return 4;
+    case GL_RGB: case GL_RGBA:
+        return type == GL_FLOAT ? 16 : 4;   // 未指定大小的 RGB 按 4 通道对齐计
+    case GL_RGB16: case GL_RGBA16: case GL_RGB16F: case GL_RGBA16F: case GL_RGBA16I: case GL_RGBA16UI:
+    case GL_RG32F: case GL_RG32I: case GL_RG32UI: case GL_DEPTH32F_STENCIL8:
+        return 8;
+    case GL_RGB32F: case GL_RGBA32F: case GL_RGB32I: case GL_RGB32UI: case GL_RGBA32I: case GL_RGBA32UI:
+        return 16;
+    default:
+        (void)format;
+        return 4;
+    }
+}
+
+static GLenum bufferBinding(GLenum target, MemoryCategory& category) {
+    switch (target) {
+    case GL_ARRAY_BUFFER: category = MEM_VERTEX_BUFFER; return GL_ARRAY_BUFFER_BINDING;
+    case GL_ELEMENT_ARRAY_BUFFER: category = MEM_INDEX_BUFFER; return GL_ELEMENT_ARRAY_BUFFER_BINDING;
+    case GL_UNIFORM_BUFFER: category = MEM_UNIFORM_BUFFER; return GL_UNIFORM_BUFFER_BINDING;
+    case GL_PIXEL_PACK_BUFFER: category = MEM_PIXEL_BUFFER; return GL_PIXEL_PACK_BUFFER_BINDING;
+    case GL_PIXEL_UNPACK_BUFFER: category = MEM_PIXEL_BUFFER; return GL_PIXEL_UNPACK_BUFFER_BINDING;
+    case GL_COPY_READ_BUFFER: case GL_COPY_WRITE_BUFFER: category = MEM_OTHER_BUFFER; return target;
+    case GL_SHADER_STORAGE_BUFFER: category = MEM_OTHER_BUFFER; return GL_SHADER_STORAGE_BUFFER_BINDING;
+    case GL_DRAW_INDIRECT_BUFFER: category = MEM_OTHER_BUFFER; return GL_DRAW_INDIRECT_BUFFER_BINDING;
+    default: return 0;
+    }
+}
+
+static GLenum textureBinding(GLenum target, MemoryCategory& category, uint32_t& face) {
+    face = 0;
+    if (target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z) {
+        face = target - GL_TEXTURE_CUBE_MAP_POSITIVE_X;
+        category = MEM_TEXTURE_CUBE;
+        return GL_TEXTURE_BINDING_CUBE_MAP;
+    }
+    switch (target) {
+    case GL_TEXTURE_2D: category = MEM_TEXTURE_2D; return GL_TEXTURE_BINDING_2D;
+    case GL_TEXTURE_RECTANGLE: category = MEM_TEXTURE_2D; return GL_TEXTURE_BINDING_RECTANGLE;
+    case GL_TEXTURE_CUBE_MAP: category = MEM_TEXTURE_CUBE; return GL_TEXTURE_BINDING_CUBE_MAP;
+    case GL_TEXTURE_3D: category = MEM_TEXTURE_3D; return GL_TEXTURE_BINDING_3D;
+    case GL_TEXTURE_2D_ARRAY: category = MEM_TEXTURE_3D; return GL_TEXTURE_BINDING_2D_ARRAY;
+    default: return 0;   // 代理纹理等不分配存储
+    }
+}
+
+static GLuint boundName(GLenum binding) {
+    GLint name = 0;
+    glGetIntegerv(binding, &name);
+    return (GLuint)name;
+}
+
+// ================= GL 函数钩子 =================
+// 与分析器的计数钩子相同，替换 glad 的函数指针；两者都安装时按安装顺序串联
+static decltype(glad_glGenBuffers) mem_orig_glGenBuffers = nullptr;
+static void APIENTRY mem_hook_glGenBuffers(GLsizei n, GLuint* names) {
+    mem_orig_glGenBuffers(n, names);
+    gMemory.onCreate(KIND_BUFFER, n, names);
+}
+static decltype(glad_glDeleteBuffers) mem_orig_glDeleteBuffers = nullptr;
+static void APIENTRY mem_hook_glDeleteBuffers(GLsizei n, const GLuint* names) {
+    gMemory.onDelete(KIND_BUFFER, n, names);
+    mem_orig_glDeleteBuffers(n, names);
+}
+static decltype(glad_glBufferData) mem_orig_glBufferData = nullptr;
+static void APIENTRY mem_hook_glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    mem_orig_glBufferData(target, size, data, usage);
+    gMemory.onBufferData(target, size);
+}
+static decltype(glad_glGenTextures) mem_orig_glGenTextures = nullptr;
+static void APIENTRY mem_hook_glGenTextures(GLsizei n, GLuint* names) {
+    mem_orig_glGenTextures(n, names);
+    gMemory.onCreate(KIND_TEXTURE, n, names);
+}
+static decltype(glad_glDeleteTextures) mem_orig_glDeleteTextures = nullptr;
+static void APIENTRY mem_hook_glDeleteTextures(GLsizei n, const GLuint* names) {
+    gMemory.onDelete(KIND_TEXTURE, n, names);
+    mem_orig_glDeleteTextures(n, names);
+}
+static decltype(glad_glTexImage2D) mem_orig_glTexImage2D = nullptr;
+static void APIENTRY mem_hook_glTexImage2D(GLenum target, GLint level, GLint internal, GLsizei w, GLsizei h, GLint border,
+                                           GLenum format, GLenum type, const void* data) {
+    mem_orig_glTexImage2D(target, level, internal, w, h, border, format, type, data);
+    gMemory.onTexImage(target, level, (GLenum)internal, w, h, 1, format, type);
+}
+static decltype(glad_glTexImage3D) mem_orig_glTexImage3D = nullptr;
+static void APIENTRY mem_hook_glTexImage3D(GLenum target, GLint level, GLint internal, GLsizei w, GLsizei h, GLsizei d,
+                                           GLint border, GLenum format, GLenum type, const void* data) {
+    mem_orig_glTexImage3D(target, level, internal, w, h, d, border, format, type, data);
+    gMemory.onTexImage(target, level, (GLenum)internal, w, h, d, format, type);
+}
+// 不可变存储一次分配全部级别（立方体贴图为全部面）
+static decltype(glad_glTexStorage2D) mem_orig_glTexStorage2D = nullptr;
+static void APIENTRY mem_hook_glTexStorage2D(GLenum target, GLsizei levels, GLenum internal, GLsizei w, GLsizei h) {
+    mem_orig_glTexStorage2D(target, levels, internal, w, h);
+    int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    for (GLsizei level = 0; level < levels; level++) {
+        for (int face = 0; face < faces; face++) {
+            GLenum imageTarget = faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+            gMemory.onTexImage(imageTarget, level, internal, std::max(w >> level, 1), std::max(h >> level, 1), 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        }
+    }
+}
+static decltype(glad_glGenerateMipmap) mem_orig_glGenerateMipmap = nullptr;
+static void APIENTRY mem_hook_glGenerateMipmap(GLenum target) {
+    mem_orig_glGenerateMipmap(target);
+    gMemory.onGenerateMipmap(target);
+}
+static decltype(glad_glGenRenderbuffers) mem_orig_glGenRenderbuffers = nullptr;
+static void APIENTRY mem_hook_glGenRenderbuffers(GLsizei n, GLuint* names) {
+    mem_orig_glGenRenderbuffers(n, names);
+    gMemory.onCreate(KIND_RENDERBUFFER, n, names);
+}
+static decltype(glad_glDeleteRenderbuffers) mem_orig_glDeleteRenderbuffers = nullptr;
+static void APIENTRY mem_hook_glDeleteRenderbuffers(GLsizei n, const GLuint* names) {
+    gMemory.onDelete(KIND_RENDERBUFFER, n, names);
+    mem_orig_glDeleteRenderbuffers(n, names);
+}
+static decltype(glad_glRenderbufferStorage) mem_orig_glRenderbufferStorage = nullptr;
+static void APIENTRY mem_hook_glRenderbufferStorage(GLenum target, GLenum internal, GLsizei w, GLsizei h) {
+    mem_orig_glRenderbufferStorage(target, internal, w, h);
+    gMemory.onRenderbufferStorage(1, internal, w, h);
+}
+static decltype(glad_glRenderbufferStorageMultisample) mem_orig_glRenderbufferStorageMultisample = nullptr;
+static void APIENTRY mem_hook_glRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internal, GLsizei w, GLsizei h) {
+    mem_orig_glRenderbufferStorageMultisample(target, samples, internal, w, h);
+    gMemory.onRenderbufferStorage(std::max(samples, 1), internal, w, h);
+}
+static decltype(glad_glCreateProgram) mem_orig_glCreateProgram = nullptr;
+static GLuint APIENTRY mem_hook_glCreateProgram() {
+    GLuint program = mem_orig_glCreateProgram();
+    gMemory.onCreateProgram(program);
+    return program;
+}
+static decltype(glad_glDeleteProgram) mem_orig_glDeleteProgram = nullptr;
+static void APIENTRY mem_hook_glDeleteProgram(GLuint program) {
+    gMemory.onDelete(KIND_PROGRAM, 1, &program);
+    mem_orig_glDeleteProgram(program);
+}
+static decltype(glad_glLinkProgram) mem_orig_glLinkProgram = nullptr;
+static void APIENTRY mem_hook_glLinkProgram(GLuint program) {
+    mem_orig_glLinkProgram(program);
+    gMemory.onLinkProgram(program);
+}
+
+#define MEM_INSTALL(name) \
+    if (glad_##name && glad_##name != mem_hook_##name) { mem_orig_##name = glad_##name; glad_##name = mem_hook_##name; }
+
+static void installMemoryHooks() {
+    MEM_INSTALL(glGenBuffers)
+    MEM_INSTALL(glDeleteBuffers)
+    MEM_INSTALL(glBufferData)
+    MEM_INSTALL(glGenTextures)
+    MEM_INSTALL(glDeleteTextures)
+    MEM_INSTALL(glTexImage2D)
+    MEM_INSTALL(glTexImage3D)
+    MEM_INSTALL(glTexStorage2D)
+    MEM_INSTALL(glGenerateMipmap)
+    MEM_INSTALL(glGenRenderbuffers)
+    MEM_INSTALL(glDeleteRenderbuffers)
+    MEM_INSTALL(glRenderbufferStorage)
+    MEM_INSTALL(glRenderbufferStorageMultisample)
+    MEM_INSTALL(glCreateProgram)
+    MEM_INSTALL(glDeleteProgram)
+    MEM_INSTALL(glLinkProgram)
+}
+
+// ================= 内置降级：纹理 mip =================
+// 每次去掉最大的一张带 mip 链的 2D 纹理的顶层 mip；某张纹理不能再降时跳到下一张
+static bool dropLargestTextureMip(void*) {
+    return gMemory.dropTopMip(0);
+}
+
+static int memoryOverlayPanel(int x, int y) {
+    return gMemory.drawOverlay(x, y);
+}
+
+// ================= 生命周期 =================
+void MemoryRegistry::init(const char* appName) {
+    app = appName;
+    if (!enabled) return;
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    programBinaryLength = major > 4 || (major == 4 && minor >= 1) || glfwExtensionSupported("GL_ARB_get_program_binary");
+    installMemoryHooks();
+    addDowngrade("texture_mips", dropLargestTextureMip);
+    gProfiler.addOverlayPanel(memoryOverlayPanel);
+    initialized = true;
+}
+
+int MemoryRegistry::shutdown() {
+    if (!initialized) return 0;
+    printSummary();
+
+    // 泄漏检查：按资产汇总仍未释放的 GL 对象
+    struct Leak { int objects = 0; uint64_t bytes = 0; };
+    std::map<std::string, Leak> byAsset;
+    static const char* KIND_NAMES[4] = { "缓冲", "纹理", "渲染缓冲", "程序" };
+    leaks = 0;
+    for (int kind = 0; kind < 4; kind++) {
+        for (const auto& entry : tables[kind]) {
+            Leak& leak = byAsset[entry.second.asset + " / " + KIND_NAMES[kind]];
+            leak.objects++;
+            leak.bytes += entry.second.bytes;
+            leaks++;
+        }
+    }
+    if (leaks == 0) std::cout << "[memory] " << app << "：退出时没有未释放的 GL 对象" << std::endl;
+    else {
+        std::cout << "[memory] " << app << "：退出时仍有 " << leaks << " 个 GL 对象未释放" << std::endl;
+        for (const auto& entry : byAsset) {
+            std::cout << "[memory]   " << entry.first << "：" << entry.second.objects << " 个，"
+                      << entry.second.bytes / (1024.0 * 1024.0) << " MB" << std::endl;
+        }
+    }
+    initialized = false;
+    return leaks;
+}
+
+// ================= 登记 =================
+void MemoryRegistry::setBytes(Object& object, uint64_t bytes) {
+    totals[object.category] -= object.bytes;
+    object.bytes = bytes;
+    totals[object.category] += bytes;
+}
+
+void MemoryRegistry::release(Object& object) {
+    totals[object.category] -= object.bytes;
+    object.bytes = 0;
+}
+
+void MemoryRegistry::onCreate(int kind, GLsizei n, const GLuint* names) {
+    static const MemoryCategory DEFAULT_CATEGORY[4] = { MEM_OTHER_BUFFER, MEM_TEXTURE_2D, MEM_RENDERBUFFER, MEM_PROGRAM };
+    for (GLsizei i = 0; i < n; i++) {
+        if (!names[i]) continue;
+        Object& object = tables[kind][names[i]];
+        release(object);
+        object = Object();
+        object.category = DEFAULT_CATEGORY[kind];
+        object.asset = tlsAsset.empty() ? UNTAGGED : tlsAsset;
+        object.frame = frame;
+    }
+}
+
+void MemoryRegistry::onDelete(int kind, GLsizei n, const GLuint* names) {
+    for (GLsizei i = 0; i < n; i++) {
+        auto it = tables[kind].find(names[i]);
+        if (it == tables[kind].end()) continue;   // 0 或 init 之前创建的对象
+        release(it->second);
+        tables[kind].erase(it);
+    }
+}
+
+void MemoryRegistry::onBufferData(GLenum target, GLsizeiptr size) {
+    MemoryCategory category = MEM_OTHER_BUFFER;
+    GLenum binding = bufferBinding(target, category);
+    if (!binding) return;
+    auto it = tables[KIND_BUFFER].find(boundName(binding));
+    if (it == tables[KIND_BUFFER].end()) return;
+    release(it->second);
+    it->second.category = category;
+    setBytes(it->second, (uint64_t)size);
+}
+
+void MemoryRegistry::trackBufferStorage(GLuint buffer, GLenum target, GLsizeiptr bytes) {
+    auto it = tables[KIND_BUFFER].find(buffer);
+    if (it == tables[KIND_BUFFER].end()) return;
+    MemoryCategory category = MEM_OTHER_BUFFER;
+    bufferBinding(target, category);
+    release(it->second);
+    it->second.category = category;
+    setBytes(it->second, (uint64_t)bytes);
+}
+
+void MemoryRegistry::onTexImage(GLenum target, GLint level, GLenum internalFormat, GLsizei w, GLsizei h, GLsizei d,
+                                GLenum format, GLenum type) {
+    MemoryCategory category = MEM_TEXTURE_2D;
+    uint32_t face = 0;
+    GLenum binding = textureBinding(target, category, face);
+    if (!binding) return;
+    auto it = tables[KIND_TEXTURE].find(boundName(binding));
+    if (it == tables[KIND_TEXTURE].end()) return;
+    Object& object = it->second;
+    if (object.category != category) {
+        release(object);
+        object.category = category;
+        object.images.clear();
+    }
+    uint64_t bytes = (uint64_t)w * h * d * internalFormatBytes(internalFormat, format, type);
+    uint64_t& image = object.images[face * 32 + (uint32_t)level];
+    uint64_t total = object.bytes - image + bytes;
+    image = bytes;
+    setBytes(object, total);
+}
+
+void MemoryRegistry::onGenerateMipmap(GLenum target) {
+    MemoryCategory category = MEM_TEXTURE_2D;
+    uint32_t face = 0;
+    GLenum binding = textureBinding(target, category, face);
+    if (!binding) return;
+    auto it = tables[KIND_TEXTURE].find(boundName(binding));
+    if (it == tables[KIND_TEXTURE].end()) return;
+    Object& object = it->second;
+
+    GLenum levelTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+    GLint w = 0, h = 0, d = 1, internal = 0;
+    glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_WIDTH, &w);
+    glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_HEIGHT, &h);
+    glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_DEPTH, &d);
+    glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_INTERNAL_FORMAT, &internal);
+    uint32_t texel = internalFormatBytes((GLenum)internal, GL_RGBA, GL_UNSIGNED_BYTE);
+    int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    bool shrinkDepth = target == GL_TEXTURE_3D;
+
+    uint64_t total = object.bytes;
+    for (uint32_t level = 1; level < 32 && (w > 1 || h > 1 || (shrinkDepth && d > 1)); level++) {
+        w = std::max(w / 2, 1);
+        h = std::max(h / 2, 1);
+        if (shrinkDepth) d = std::max(d / 2, 1);
+        for (int f = 0; f < faces; f++) {
+            uint64_t& image = object.images[(uint32_t)f * 32 + level];
+            uint64_t bytes = (uint64_t)w * h * std::max(d, 1) * texel;
+            total = total - image + bytes;
+            image = bytes;
+        }
+    }
+    setBytes(object, total);
+}
+
+void MemoryRegistry::onRenderbufferStorage(GLsizei samples, GLenum internalFormat, GLsizei w, GLsizei h) {
+    auto it = tables[KIND_RENDERBUFFER].find(boundName(GL_RENDERBUFFER_BINDING));
+    if (it == tables[KIND_RENDERBUFFER].end()) return;
+    setBytes(it->second, (uint64_t)w * h * samples * internalFormatBytes(internalFormat, GL_RGBA, GL_UNSIGNED_BYTE));
+}
+
+void MemoryRegistry::onCreateProgram(GLuint program) {
+    onCreate(KIND_PROGRAM, 1, &program);
+    pendingPrograms = true;
+}
+
+void MemoryRegistry::onLinkProgram(GLuint program) {
+    auto it = tables[KIND_PROGRAM].find(program);
+    if (it == tables[KIND_PROGRAM].end()) return;
+    it->second.sizeKnown = false;
+    pendingPrograms = true;
+}
+
+// 程序的大小取驱动给出的二进制长度；链接可能在驱动线程上并行进行，留到帧末再查询，避免在创建处等待
+void MemoryRegistry::updateProgramSizes() {
+    if (!pendingPrograms) return;
+    pendingPrograms = false;
+    for (auto& entry : tables[KIND_PROGRAM]) {
+        Object& object = entry.second;
+        if (object.sizeKnown) continue;
+        object.sizeKnown = true;
+        GLint linked = GL_FALSE, length = 0;
+        glGetProgramiv(entry.first, GL_LINK_STATUS, &linked);
+        if (linked && programBinaryLength) glGetProgramiv(entry.first, GL_PROGRAM_BINARY_LENGTH, &length);
+        setBytes(object, (uint64_t)std::max(length, 0));
+    }
+}
+
+void MemoryRegistry::trackHost(const char* asset, int64_t deltaBytes) {
+    std::lock_guard<std::mutex> lock(hostMutex);
+    int64_t& bytes = hostAssets[asset];
+    bytes = std::max<int64_t>(bytes + deltaBytes, 0);
+}
+
+uint64_t MemoryRegistry::gpuBytes() const {
+    uint64_t sum = 0;
+    for (int i = 0; i < MEM_HOST; i++) sum += totals[i];
+    return sum;
+}
+
+uint64_t MemoryRegistry::hostBytes() const {
+    std::lock_guard<std::mutex> lock(hostMutex);
+    uint64_t sum = 0;
+    for (const auto& entry : hostAssets) sum += (uint64_t)entry.second;
+    return sum;
+}
+
+// ================= 预算与降级 =================
+void MemoryRegistry::addDowngrade(const char* name, MemoryDowngradeFn fn, void* user) {
+    // 内置的纹理 mip 降级始终排在最后：应用的回调（降 LOD 等）代价更小，先用
+    auto pos = initialized ? downgrades.end() - 1 : downgrades.end();
+    downgrades.insert(pos, { name, fn, user, false });
+}
+
+bool MemoryRegistry::dropTopMip(GLuint texture) {
+    // texture 为 0 时挑最大的候选：2D、有 1 级 mip
+    if (texture == 0) {
+        std::vector<std::pair<uint64_t, GLuint>> candidates;
+        for (const auto& entry : tables[KIND_TEXTURE]) {
+            const Object& object = entry.second;
+            if (object.category == MEM_TEXTURE_2D && !object.pinned && object.images.count(1))
+                candidates.push_back({ object.bytes, entry.first });
+        }
+        std::sort(candidates.rbegin(), candidates.rend());
+        for (const auto& candidate : candidates) {
+            if (dropTopMip(candidate.second)) return true;
+            tables[KIND_TEXTURE][candidate.second].pinned = true;   // 不能再降，之后跳过
+        }
+        return false;
+    }
+
+    GLuint previous = boundName(GL_TEXTURE_BINDING_2D);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    GLint w = 0, h = 0, internal = 0, immutable = GL_FALSE;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internal);
+    int levels = 0;
+    for (GLint lw = w; levels < 32; levels++) {
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, levels, GL_TEXTURE_WIDTH, &lw);
+        if (lw <= 0) break;
+    }
+
+    // 只处理能按 RGBA 读回的归一化 / 浮点格式；glTexStorage 的不可变纹理不能重新指定
+    bool floatFormat = false, supported = true;
+    switch (internal) {
+    case GL_R8: case GL_RG8: case GL_RGB8: case GL_RGBA8: case GL_SRGB8: case GL_SRGB8_ALPHA8:
+    case GL_RED: case GL_RG: case GL_RGB: case GL_RGBA:
+        break;
+    case GL_R16F: case GL_RG16F: case GL_RGB16F: case GL_RGBA16F: case GL_R32F: case GL_RG32F: case GL_RGB32F: case GL_RGBA32F:
+    case GL_R11F_G11F_B10F:
+        floatFormat = true;
+        break;
+    default:
+        supported = false;
+    }
+    if (!supported || immutable || levels < 2 || std::max(w, h) <= MIN_DOWNGRADE_SIZE) {
+        glBindTexture(GL_TEXTURE_2D, previous);
+        return false;
+    }
+
+    // 逐级读回第 l 级、写到第 l - 1 级，最后一级置为 0×0 释放
+    // 经客户端内存中转，先解绑可能绑着的 PBO（虚拟纹理的上传路径会用到）
+    GLuint packBuffer = boundName(GL_PIXEL_PACK_BUFFER_BINDING), unpackBuffer = boundName(GL_PIXEL_UNPACK_BUFFER_BINDING);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    GLenum type = floatFormat ? GL_FLOAT : GL_UNSIGNED_BYTE;
+    size_t texel = floatFormat ? 16 : 4;
+    std::vector<unsigned char> pixels;
+    for (int level = 1; level < levels; level++) {
+        GLint lw = 0, lh = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &lw);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &lh);
+        pixels.resize((size_t)lw * lh * texel);
+        glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, type, pixels.data());
+        glTexImage2D(GL_TEXTURE_2D, level - 1, internal, lw, lh, 0, GL_RGBA, type, pixels.data());
+    }
+    glTexImage2D(GL_TEXTURE_2D, levels - 1, internal, 0, 0, 0, GL_RGBA, type, nullptr);
+    glBindTexture(GL_TEXTURE_2D, previous);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffer);
+
+    // 各级的字节数已由 glTexImage2D 钩子随之更新
+    auto it = tables[KIND_TEXTURE].find(texture);
+    if (it != tables[KIND_TEXTURE].end()) {
+        std::cout << "[memory] 纹理 " << it->second.asset << "（" << texture << "）去掉顶层 mip：" << w << "×" << h << " -> "
+                  << std::max(w / 2, 1) << "×" << std::max(h / 2, 1) << std::endl;
+    }
+    return true;
+}
+
+void MemoryRegistry::checkBudget() {
+    uint64_t gpu = gpuBytes(), host = hostBytes();
+    peakGpuBytes = std::max(peakGpuBytes, gpu);
+    peakHostBytes = std::max(peakHostBytes, host);
+
+    bool over = (budget.gpuBytes && gpu > budget.gpuBytes) || (budget.hostBytes && host > budget.hostBytes);
+    if (!over || (downgradeTried && frame - lastDowngradeFrame < (uint64_t)DOWNGRADE_COOLDOWN)) return;
+    downgradeTried = true;
+    lastDowngradeFrame = frame;   // 全部失败时也按冷却间隔重试，避免每帧遍历
+    for (Downgrade& d : downgrades) {
+        if (d.fn(d.user)) {
+            d.exhausted = false;
+            downgradeCount++;
+            char line[160];
+            snprintf(line, sizeof(line), "frame %llu: %s (gpu %.1f MB, host %.1f MB)", (unsigned long long)frame, d.name,
+                     gpu / (1024.0 * 1024.0), host / (1024.0 * 1024.0));
+            downgradeLog.push_back(line);
+            std::cout << "[memory] 超出预算，降级 " << d.name << "（显存 " << gpu / (1024.0 * 1024.0) << " MB，主机 "
+                      << host / (1024.0 * 1024.0) << " MB）" << std::endl;
+            return;
+        }
+        if (!d.exhausted) std::cout << "[memory] " << d.name << " 已无法再降" << std::endl;
+        d.exhausted = true;
+    }
+}
+
+void MemoryRegistry::endFrame(GLFWwindow* window) {
+    if (!initialized) return;
+    updateProgramSizes();
+    checkBudget();
+    if (window) {
+        bool f4 = glfwGetKey(window, GLFW_KEY_F4) == GLFW_PRESS;
+        if (f4 && !f4Down) writeJson(app + "_memory.json");
+        f4Down = f4;
+    }
+    frame++;
+}
+
+// ================= 报告 =================
+static std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if ((unsigned char)c >= 0x20) out += c;
+    }
+    return out;
+}
+
+bool MemoryRegistry::writeJson(const std::string& path) const {
+    std::ofstream f(path);
+    if (!f) {
+        std::cout << "[memory] 无法写入 " << path << std::endl;
+        return false;
+    }
+
+    // 按（资产, 分类）汇总
+    struct Entry { int objects = 0; uint64_t bytes = 0; };
+    std::map<std::pair<std::string, int>, Entry> assets;
+    int objectCounts[MEM_CATEGORY_COUNT] = {};
+    for (int kind = 0; kind < 4; kind++) {
+        for (const auto& entry : tables[kind]) {
+            Entry& e = assets[{ entry.second.asset, entry.second.category }];
+            e.objects++;
+            e.bytes += entry.second.bytes;
+            objectCounts[entry.second.category]++;
+        }
+    }
+    uint64_t host = 0;
+    {
+        std::lock_guard<std::mutex> lock(hostMutex);
+        for (const auto& entry : hostAssets) {
+            if (entry.second <= 0) continue;
+            Entry& e = assets[{ entry.first, MEM_HOST }];
+            e.objects++;
+            e.bytes += (uint64_t)entry.second;
+            objectCounts[MEM_HOST]++;
+            host += (uint64_t)entry.second;
+        }
+    }
+    std::vector<std::pair<std::pair<std::string, int>, Entry>> sorted(assets.begin(), assets.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.bytes > b.second.bytes; });
+
+    f << "{\n";
+    f << "  \"app\": \"" << app << "\",\n";
+    f << "  \"frame\": " << frame << ",\n";
+    f << "  \"gpu_bytes\": " << gpuBytes() << ",\n";
+    f << "  \"host_bytes\": " << host << ",\n";
+    f << "  \"peak_gpu_bytes\": " << peakGpuBytes << ",\n";
+    f << "  \"peak_host_bytes\": " << peakHostBytes << ",\n";
+    f << "  \"budget\": { \"gpu_bytes\": " << budget.gpuBytes << ", \"host_bytes\": " << budget.hostBytes << " },\n";
+    f << "  \"categories\": {";
+    for (int i = 0; i < MEM_CATEGORY_COUNT; i++) {
+        uint64_t bytes = i == MEM_HOST ? host : totals[i];
+        f << (i ? "," : "") << "\n    \"" << CATEGORY_NAMES[i] << "\": { \"objects\": " << objectCounts[i] << ", \"bytes\": " << bytes << " }";
+    }
+    f << "\n  },\n";
+    f << "  \"assets\": [";
+    for (size_t i = 0; i < sorted.size(); i++) {
+        f << (i ? "," : "") << "\n    { \"asset\": \"" << jsonEscape(sorted[i].first.first) << "\", \"category\": \""
+          << CATEGORY_NAMES[sorted[i].first.second] << "\", \"objects\": " << sorted[i].second.objects
+          << ", \"bytes\": " << sorted[i].second.bytes << " }";
+    }
+    f << (sorted.empty() ? "],\n" : "\n  ],\n");
+    f << "  \"downgrades\": [";
+    for (size_t i = 0; i < downgradeLog.size(); i++) f << (i ? ", " : "") << "\"" << downgradeLog[i] << "\"";
+    f << "]\n}\n";
+
+    std::cout << "[memory] 资源登记表 -> " << path << std::endl;
+    return true;
+}
+
+void MemoryRegistry::printSummary() const {
+    const double MB = 1024.0 * 1024.0;
+    uint64_t buffers = 0, textures = 0;
+    for (int i = MEM_VERTEX_BUFFER; i <= MEM_OTHER_BUFFER; i++) buffers += totals[i];
+    for (int i = MEM_TEXTURE_2D; i <= MEM_RENDERBUFFER; i++) textures += totals[i];
+    std::cout << "[memory] " << app << "：显存 " << gpuBytes() / MB << " MB（峰值 " << peakGpuBytes / MB << " MB";
+    if (budget.gpuBytes) std::cout << "，预算 " << budget.gpuBytes / MB << " MB";
+    std::cout << "；纹理 " << textures / MB << " / 缓冲 " << buffers / MB << " / 程序 " << totals[MEM_PROGRAM] / MB
+              << " MB），主机 " << hostBytes() / MB << " MB（峰值 " << peakHostBytes / MB << " MB";
+    if (budget.hostBytes) std::cout << "，预算 " << budget.hostBytes / MB << " MB";
+    std::cout << "），降级 " << downgradeCount << " 次";
+
+    // 驱动报告的剩余显存（NVX_gpu_memory_info / ATI_meminfo），便于与登记表的估算对照
+    GLint freeKB[4] = {};
+    if (glfwExtensionSupported("GL_NVX_gpu_memory_info")) glGetIntegerv(GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, freeKB);
+    else if (glfwExtensionSupported("GL_ATI_meminfo")) glGetIntegerv(TEXTURE_FREE_MEMORY_ATI, freeKB);
+    if (freeKB[0] > 0) std::cout << "，驱动报告剩余显存 " << freeKB[0] / 1024.0 << " MB";
+    std::cout << std::endl;
+}
+
+// ================= 叠加层 =================
+// 两行分类条：上为显存，下为主机内存；白线为预算，超出预算时底色变红
+static const float CATEGORY_COLORS[MEM_CATEGORY_COUNT][3] = {
+    { 0.30f, 0.60f, 0.95f }, { 0.20f, 0.45f, 0.80f }, { 0.45f, 0.75f, 1.00f }, { 0.15f, 0.35f, 0.65f }, { 0.55f, 0.55f, 0.80f },
+    { 0.95f, 0.75f, 0.25f }, { 0.90f, 0.55f, 0.20f }, { 0.95f, 0.90f, 0.45f }, { 0.75f, 0.45f, 0.90f }, { 0.55f, 0.85f, 0.40f },
+    { 0.70f, 0.70f, 0.70f },
+};
+
+int MemoryRegistry::drawOverlay(int x, int y) {
+    const int width = 360, rowH = 10;
+    uint64_t gpu = gpuBytes(), host = hostBytes();
+    uint64_t rows[2][2] = { { gpu, budget.gpuBytes }, { host, budget.hostBytes } };
+    for (int row = 0; row < 2; row++) {
+        uint64_t used = rows[row][0], limit = rows[row][1];
+        double scale = (double)std::max<uint64_t>({ limit, used + used / 8, 1 << 20 });
+        int ry = y + (1 - row) * (rowH + 4);
+        bool over = limit && used > limit;
+        fillOverlayRect(x - 2, ry - 2, width + 4, rowH + 4, over ? 0.5f : 0.05f, 0.05f, 0.05f);
+        int cx = x;
+        if (row == 0) {
+            for (int i = 0; i < MEM_HOST; i++) {
+                int w = (int)(totals[i] / scale * width);
+                fillOverlayRect(cx, ry, w, rowH, CATEGORY_COLORS[i][0], CATEGORY_COLORS[i][1], CATEGORY_COLORS[i][2]);
+                cx += w;
+            }
+        }
+        else {
+            const float* c = CATEGORY_COLORS[MEM_HOST];
+            fillOverlayRect(cx, ry, (int)(used / scale * width), rowH, c[0], c[1], c[2]);
+        }
+        if (limit) fillOverlayRect(x + (int)(limit / scale * width), ry - 2, 1, rowH + 4, 1.0f, 1.0f, 1.0f);
+    }
+    return 2 * rowH + 6;
+}
+
+// ================= 资产作用域 =================
+MemoryAssetScope::MemoryAssetScope(const std::string& asset) : previous(tlsAsset) {
+    tlsAsset = asset;
+}
+
+MemoryAssetScope::~MemoryAssetScope() {
+    tlsAsset = previous;
+}
+
+void addMemoryMetrics(BenchmarkRun& run, const MemoryRegistry& memory) {
+    const double MB = 1024.0 * 1024.0;
+    run.setMetric("gpu_memory_mb", memory.gpuBytes() / MB);
+    run.setMetric("gpu_memory_peak_mb", memory.peakGpuBytes / MB);
+    run.setMetric("host_memory_peak_mb", memory.peakHostBytes / MB);
+    run.setMetric("memory_downgrades", (double)memory.downgradeCount);
+    run.setMetric("memory_budget_mb", memory.budget.gpuBytes / MB);
+}
@@ -0,0 +1,452 @@
+#include "profiler.h"
+#include "benchmark.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+Profiler gProfiler;
+
+// ================= GL 函数钩子 =================
+// glad 以函数指针形式暴露 GL 入口（glDrawArrays 即 glad_glDrawArrays），
+// 替换指针即可统计所有调用点，而不必改动各个渲染循环
+static FrameCounters* hookCounters = nullptr;
+static bool hooksPaused = false;
+
+static uint32_t componentCount(GLenum format) {
+    switch (format) {
+    case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: return 1;
+    case GL_RG: case GL_RG_INTEGER: return 2;
+    case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: return 3;
+    default: return 4;
+    }
+}
+
+static uint32_t typeSize(GLenum type) {
+    switch (type) {
+    case GL_UNSIGNED_BYTE: case GL_BYTE: return 1;
+    case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: return 2;
+    default: return 4;
+    }
+}
+
+static uint64_t imageBytes(GLsizei w, GLsizei h, GLsizei d, GLenum format, GLenum type) {
+    return (uint64_t)w * h * d * componentCount(format) * typeSize(type);
+}
+
+#define GL_HOOK(name, count, params, args) \
+    static decltype(glad_##name) orig_##name = nullptr; \
+    static void APIENTRY hook_##name params { \
+        if (hookCounters && !hooksPaused) { count; } \
+        orig_##name args; \
+    }
+
+// 绘制
+GL_HOOK(glDrawArrays, hookCounters->drawCalls++, (GLenum m, GLint f, GLsizei c), (m, f, c))
+GL_HOOK(glDrawElements, hookCounters->drawCalls++, (GLenum m, GLsizei c, GLenum t, const void* i), (m, c, t, i))
+GL_HOOK(glDrawArraysInstanced, hookCounters->drawCalls++, (GLenum m, GLint f, GLsizei c, GLsizei n), (m, f, c, n))
+GL_HOOK(glDrawElementsInstanced, hookCounters->drawCalls++, (GLenum m, GLsizei c, GLenum t, const void* i, GLsizei n), (m, c, t, i, n))
+GL_HOOK(glDrawElementsBaseVertex, hookCounters->drawCalls++, (GLenum m, GLsizei c, GLenum t, const void* i, GLint b), (m, c, t, i, b))
+GL_HOOK(glDispatchCompute, hookCounters->dispatches++, (GLuint x, GLuint y, GLuint z), (x, y, z))
+// 状态切换
+GL_HOOK(glUseProgram, hookCounters->stateChanges++, (GLuint p), (p))
+GL_HOOK(glBindVertexArray, hookCounters->stateChanges++, (GLuint v), (v))
+GL_HOOK(glBindTexture, hookCounters->stateChanges++, (GLenum t, GLuint x), (t, x))
+GL_HOOK(glActiveTexture, hookCounters->stateChanges++, (GLenum t), (t))
+GL_HOOK(glBindBuffer, hookCounters->stateChanges++, (GLenum t, GLuint b), (t, b))
+GL_HOOK(glBindBufferBase, hookCounters->stateChanges++, (GLenum t, GLuint i, GLuint b), (t, i, b))
+GL_HOOK(glBindBufferRange, hookCounters->stateChanges++, (GLenum t, GLuint i, GLuint b, GLintptr o, GLsizeiptr s), (t, i, b, o, s))
+GL_HOOK(glBindFramebuffer, hookCounters->stateChanges++, (GLenum t, GLuint f), (t, f))
+GL_HOOK(glEnable, hookCounters->stateChanges++, (GLenum c), (c))
+GL_HOOK(glDisable, hookCounters->stateChanges++, (GLenum c), (c))
+GL_HOOK(glViewport, hookCounters->stateChanges++, (GLint x, GLint y, GLsizei w, GLsizei h), (x, y, w, h))
+// uniform
+GL_HOOK(glUniform1i, hookCounters->uniformUpdates++, (GLint l, GLint v), (l, v))
+GL_HOOK(glUniform1f, hookCounters->uniformUpdates++, (GLint l, GLfloat v), (l, v))
+GL_HOOK(glUniform2f, hookCounters->uniformUpdates++, (GLint l, GLfloat a, GLfloat b), (l, a, b))
+GL_HOOK(glUniform3f, hookCounters->uniformUpdates++, (GLint l, GLfloat a, GLfloat b, GLfloat c), (l, a, b, c))
+GL_HOOK(glUniform4f, hookCounters->uniformUpdates++, (GLint l, GLfloat a, GLfloat b, GLfloat c, GLfloat d), (l, a, b, c, d))
+GL_HOOK(glUniform1fv, hookCounters->uniformUpdates++, (GLint l, GLsizei n, const GLfloat* v), (l, n, v))
+GL_HOOK(glUniform2fv, hookCounters->uniformUpdates++, (GLint l, GLsizei n, const GLfloat* v), (l, n, v))
+GL_HOOK(glUniform3fv, hookCounters->uniformUpdates++, (GLint l, GLsizei n, const GLfloat* v), (l, n, v))
+GL_HOOK(glUniform4fv, hookCounters->uniformUpdates++, (GLint l, GLsizei n, const GLfloat* v), (l, n, v))
+GL_HOOK(glUniformMatrix3fv, hookCounters->uniformUpdates++, (GLint l, GLsizei n, GLboolean t, const GLfloat* v), (l, n, t, v))
+GL_HOOK(glUniformMatrix4fv, hookCounters->uniformUpdates++, (GLint l, GLsizei n, GLboolean t, const GLfloat* v), (l, n, t, v))
+// 上传
+GL_HOOK(glBufferData, hookCounters->bytesUploaded += (data ? size : 0),
+    (GLenum target, GLsizeiptr size, const void* data, GLenum usage), (target, size, data, usage))
+GL_HOOK(glBufferSubData, hookCounters->bytesUploaded += size,
+    (GLenum target, GLintptr offset, GLsizeiptr size, const void* data), (target, offset, size, data))
+GL_HOOK(glTexImage2D, hookCounters->bytesUploaded += (data ? imageBytes(w, h, 1, format, type) : 0),
+    (GLenum target, GLint level, GLint internal, GLsizei w, GLsizei h, GLint border, GLenum format, GLenum type, const void* data),
+    (target, level, internal, w, h, border, format, type, data))
+GL_HOOK(glTexSubImage2D, hookCounters->bytesUploaded += imageBytes(w, h, 1, format, type),
+    (GLenum target, GLint level, GLint x, GLint y, GLsizei w, GLsizei h, GLenum format, GLenum type, const void* data),
+    (target, level, x, y, w, h, format, type, data))
+
+#define GL_INSTALL(name) \
+    if (glad_##name && glad_##name != hook_##name) { orig_##name = glad_##name; glad_##name = hook_##name; }
+
+void installGLHooks(FrameCounters* counters) {
+    hookCounters = counters;
+    GL_INSTALL(glDrawArrays)
+    GL_INSTALL(glDrawElements)
+    GL_INSTALL(glDrawArraysInstanced)
+    GL_INSTALL(glDrawElementsInstanced)
+    GL_INSTALL(glDrawElementsBaseVertex)
+    GL_INSTALL(glDispatchCompute)
+    GL_INSTALL(glUseProgram)
+    GL_INSTALL(glBindVertexArray)
+    GL_INSTALL(glBindTexture)
+    GL_INSTALL(glActiveTexture)
+    GL_INSTALL(glBindBuffer)
+    GL_INSTALL(glBindBufferBase)
+    GL_INSTALL(glBindBufferRange)
+    GL_INSTALL(glBindFramebuffer)
+    GL_INSTALL(glEnable)
+    GL_INSTALL(glDisable)
+    GL_INSTALL(glViewport)
+    GL_INSTALL(glUniform1i)
+    GL_INSTALL(glUniform1f)
+    GL_INSTALL(glUniform2f)
+    GL_INSTALL(glUniform3f)
+    GL_INSTALL(glUniform4f)
+    GL_INSTALL(glUniform1fv)
+    GL_INSTALL(glUniform2fv)
+    GL_INSTALL(glUniform3fv)
+    GL_INSTALL(glUniform4fv)
+    GL_INSTALL(glUniformMatrix3fv)
+    GL_INSTALL(glUniformMatrix4fv)
+    GL_INSTALL(glBufferData)
+    GL_INSTALL(glBufferSubData)
+    GL_INSTALL(glTexImage2D)
+    GL_INSTALL(glTexSubImage2D)
+}
+
+void setGLHooksPaused(bool paused) {
+    hooksPaused = paused;
+}
+
+// ================= 线程相关 =================
+struct OpenScope {
+    const char* name;
+    double startUs;
+};
+
+static std::atomic<uint32_t> nextThreadId(0);
+static thread_local uint32_t tlsThreadId = UINT32_MAX;
+static thread_local std::vector<OpenScope> tlsStack;
+
+static uint32_t currentThreadId() {
+    if (tlsThreadId == UINT32_MAX) tlsThreadId = nextThreadId++;
+    return tlsThreadId;
+}
+
+// ================= 生命周期 =================
+void Profiler::init(const char* appName) {
+    app = appName;
+    epoch = std::chrono::steady_clock::now();
+    currentThreadId(); // 初始化线程记为 0 号（主线程）
+    installGLHooks(&current);
+    for (auto& pass : gpuPasses) {
+        glGenQueries(GPU_RING, pass.queries);
+    }
+    initialized = true;
+}
+
+void Profiler::shutdown() {
+    if (!initialized) return;
+    if (traceFramesLeft > 0) writeChromeTrace(app + "_trace.json");
+    for (auto& pass : gpuPasses) {
+        glDeleteQueries(GPU_RING, pass.queries);
+    }
+    if (totalFrames > 0) {
+        double avg = totalFrameMs / totalFrames;
+        std::cout << "[profiler] " << app << ": " << totalFrames << " 帧，平均 " << avg << " ms（" << 1000.0 / avg << " FPS）" << std::endl;
+        for (int i = 0; i < gpuPassCount; i++) {
+            std::cout << "[profiler]   GPU " << gpuPasses[i].name << ": " << gpuPasses[i].lastMs << " ms" << std::endl;
+        }
+    }
+    initialized = false;
+}
+
+double Profiler::nowUs() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+// ================= 帧边界 =================
+void Profiler::beginFrame() {
+    frameStartUs = nowUs();
+    frameCpuEvents.clear();
+}
+
+void Profiler::endFrame(GLFWwindow* window) {
+    double endUs = nowUs();
+    frameMs = (endUs - frameStartUs) / 1000.0;
+    totalFrameMs += frameMs;
+    totalFrames++;
+
+    collectGpuResults();
+
+    frameHistory[historyPos] = (float)frameMs;
+    gpuHistory[historyPos] = (float)gpuTotalMs;
+    historyPos = (historyPos + 1) % HISTORY;
+
+    if (traceFramesLeft > 0) {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        traceEvents.push_back({ "frame", frameStartUs, endUs - frameStartUs, 0, 0, frame });
+        traceCounters.push_back({ frameStartUs, current });
+    }
+
+    last = current;
+    current = FrameCounters();
+    lastCpuEvents.swap(frameCpuEvents);
+
+    if (window) {
+        handleHotkeys(window);
+        if (frame % 15 == 0) updateTitle(window);
+    }
+
+    if (traceFramesLeft > 0 && --traceFramesLeft == 0) {
+        writeChromeTrace(app + "_trace.json");
+    }
+    frame++;
+}
+
+// ================= CPU 计时 =================
+void Profiler::beginCpu(const char* name) {
+    tlsStack.push_back({ name, nowUs() });
+}
+
+void Profiler::endCpu() {
+    if (tlsStack.empty()) return;
+    OpenScope scope = tlsStack.back();
+    tlsStack.pop_back();
+
+    ProfileEvent e{ scope.name, scope.startUs, nowUs() - scope.startUs, currentThreadId(), (uint32_t)tlsStack.size(), frame };
+    if (e.thread == 0 && e.depth == 0) frameCpuEvents.push_back(e);
+    recordEvent(e);
+}
+
+void Profiler::recordEvent(const ProfileEvent& e) {
+    if (traceFramesLeft <= 0) return;
+    std::lock_guard<std::mutex> lock(traceMutex);
+    traceEvents.push_back(e);
+}
+
+// ================= GPU 计时 =================
+Profiler::GpuPass* Profiler::findOrCreatePass(const char* name) {
+    for (int i = 0; i < gpuPassCount; i++) {
+        if (gpuPasses[i].name == name || std::string(gpuPasses[i].name) == name) return &gpuPasses[i];
+    }
+    if (gpuPassCount == MAX_GPU_PASSES) return nullptr;
+    gpuPasses[gpuPassCount].name = name;
+    return &gpuPasses[gpuPassCount++];
+}
+
+void Profiler::beginGpu(const char* name) {
+    // GL_TIME_ELAPSED 查询不能嵌套，嵌套的 GPU 作用域只做 CPU 计时
+    if (!initialized || activeGpuPass >= 0) return;
+    GpuPass* pass = findOrCreatePass(name);
+    if (!pass) return;
+
+    int slot = (int)(frame % GPU_RING);
+    glBeginQuery(GL_TIME_ELAPSED, pass->queries[slot]);
+    pass->issued[slot] = true;
+    pass->issueUs[slot] = nowUs();
+    pass->issueFrame[slot] = frame;
+    activeGpuPass = (int)(pass - gpuPasses);
+}
+
+void Profiler::endGpu() {
+    if (activeGpuPass < 0) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    activeGpuPass = -1;
+}
+
+void Profiler::collectGpuResults() {
+    double total = 0.0;
+    for (int i = 0; i < gpuPassCount; i++) {
+        GpuPass& pass = gpuPasses[i];
+        for (int slot = 0; slot < GPU_RING; slot++) {
+            if (!pass.issued[slot]) continue;
+            // 只读取已就绪的结果，未就绪则留到后续帧
+            GLint available = 0;
+            glGetQueryObjectiv(pass.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) continue;
+
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(pass.queries[slot], GL_QUERY_RESULT, &ns);
+            pass.issued[slot] = false;
+            pass.lastMs = ns / 1.0e6;
+            recordEvent({ pass.name, pass.issueUs[slot], ns / 1000.0, GPU_THREAD, 0, pass.issueFrame[slot] });
+        }
+        total += pass.lastMs;
+    }
+    gpuTotalMs = total;
+}
+
+double Profiler::gpuPassMs(const char* name) const {
+    for (int i = 0; i < gpuPassCount; i++) {
+        if (std::string(gpuPasses[i].name) == name) return gpuPasses[i].lastMs;
+    }
+    return -1.0;
+}
+
+// ================= 快捷键与标题 =================
+void Profiler::handleHotkeys(GLFWwindow* window) {
+    bool f1 = glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS;
+    bool f2 = glfwGetKey(window, GLFW_KEY_F2) == GLFW_PRESS;
+    if (f1 && !f1Down) overlayEnabled = !overlayEnabled;
+    if (f2 && !f2Down) startTrace();
+    f1Down = f1;
+    f2Down = f2;
+}
+
+void Profiler::updateTitle(GLFWwindow* window) {
+    char buf[512];
+    int n = snprintf(buf, sizeof(buf), "%s | %.2f ms (%.1f FPS) | GPU %.2f ms",
+        app.c_str(), frameMs, frameMs > 0.0 ? 1000.0 / frameMs : 0.0, gpuTotalMs);
+    for (int i = 0; i < gpuPassCount && n < (int)sizeof(buf); i++) {
+        n += snprintf(buf + n, sizeof(buf) - n, " [%s %.2f]", gpuPasses[i].name, gpuPasses[i].lastMs);
+    }
+    if (n < (int)sizeof(buf)) {
+        n += snprintf(buf + n, sizeof(buf) - n, " | draw %u state %u uniform %u upload %.1f KB",
+            last.drawCalls + last.dispatches, last.stateChanges, last.uniformUpdates, last.bytesUploaded / 1024.0);
+    }
+    if (traceFramesLeft > 0 && n < (int)sizeof(buf)) {
+        snprintf(buf + n, sizeof(buf) - n, " | TRACE %d", traceFramesLeft.load());
+    }
+    glfwSetWindowTitle(window, buf);
+}
+
+// ================= 叠加层 =================
+// 用 glScissor + glClear 画色块，不依赖着色器/VAO，也不会干扰应用的管线状态
+void fillOverlayRect(int x, int y, int w, int h, float r, float g, float b) {
+    if (w <= 0 || h <= 0) return;
+    glScissor(x, y, w, h);
+    glClearColor(r, g, b, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+static const float PASS_COLORS[][3] = {
+    { 0.90f, 0.35f, 0.30f }, { 0.30f, 0.60f, 0.95f }, { 0.95f, 0.75f, 0.25f }, { 0.55f, 0.85f, 0.40f },
+    { 0.75f, 0.45f, 0.90f }, { 0.30f, 0.85f, 0.85f }, { 0.95f, 0.55f, 0.75f }, { 0.70f, 0.70f, 0.70f },
+};
+
+void Profiler::drawOverlay() {
+    if (!overlayEnabled || !initialized) return;
+    setGLHooksPaused(true);
+
+    // 保存会被修改的状态
+    GLint prevFbo = 0, prevScissor[4], viewport[4];
+    GLfloat prevClear[4];
+    GLboolean scissorOn = glIsEnabled(GL_SCISSOR_TEST);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFbo);
+    glGetIntegerv(GL_SCISSOR_BOX, prevScissor);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, prevClear);
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glEnable(GL_SCISSOR_TEST);
+
+    const int x0 = viewport[0] + 8;
+    const int y0 = viewport[1] + 8;
+    const float pxPerMs = 4.0f;
+    const int graphH = (int)(33.3f * pxPerMs);
+
+    // 帧时间历史：绿 ≤16.7ms，黄 ≤33.3ms，红 更慢；蓝色为 GPU 时间
+    fillOverlayRect(x0 - 2, y0 - 2, HISTORY * 3 + 4, graphH + 4 + 24, 0.05f, 0.05f, 0.05f);
+    for (int i = 0; i < HISTORY; i++) {
+        int idx = (historyPos + i) % HISTORY;
+        float ms = frameHistory[idx];
+        int h = std::min(graphH, (int)(ms * pxPerMs));
+        if (ms <= 16.7f) fillOverlayRect(x0 + i * 3, y0 + 24, 2, h, 0.3f, 0.85f, 0.3f);
+        else if (ms <= 33.3f) fillOverlayRect(x0 + i * 3, y0 + 24, 2, h, 0.95f, 0.8f, 0.2f);
+        else fillOverlayRect(x0 + i * 3, y0 + 24, 2, h, 0.95f, 0.25f, 0.2f);
+        int gh = std::min(graphH, (int)(gpuHistory[idx] * pxPerMs));
+        fillOverlayRect(x0 + i * 3, y0 + 24, 1, gh, 0.3f, 0.5f, 1.0f);
+    }
+    // 16.7ms 预算线
+    fillOverlayRect(x0, y0 + 24 + (int)(16.7f * pxPerMs), HISTORY * 3, 1, 1.0f, 1.0f, 1.0f);
+
+    // 本帧分解：上行为 GPU 通道，下行为主线程顶层 CPU 作用域
+    const float barPxPerMs = HISTORY * 3 / 33.3f;
+    int x = x0;
+    for (int i = 0; i < gpuPassCount; i++) {
+        int w = (int)(gpuPasses[i].lastMs * barPxPerMs);
+        const float* c = PASS_COLORS[i % 8];
+        fillOverlayRect(x, y0 + 12, w, 10, c[0], c[1], c[2]);
+        x += w;
+    }
+    x = x0;
+    for (size_t i = 0; i < lastCpuEvents.size(); i++) {
+        int w = (int)(lastCpuEvents[i].durUs / 1000.0 * barPxPerMs);
+        const float* c = PASS_COLORS[(i + 4) % 8];
+        fillOverlayRect(x, y0, w, 10, c[0], c[1], c[2]);
+        x += w;
+    }
+
+    // 其他模块的面板
+    int panelY = y0 + graphH + 32;
+    for (OverlayPanelFn panel : overlayPanels) panelY += panel(x0, panelY) + 6;
+
+    // 恢复状态
+    glScissor(prevScissor[0], prevScissor[1], prevScissor[2], prevScissor[3]);
+    glClearColor(prevClear[0], prevClear[1], prevClear[2], prevClear[3]);
+    if (!scissorOn) glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prevFbo);
+
+    setGLHooksPaused(false);
+}
+
+// ================= Chrome-trace / Perfetto 导出 =================
+void Profiler::startTrace(int frames) {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    traceEvents.clear();
+    traceCounters.clear();
+    traceFramesLeft = frames;
+    std::cout << "[profiler] 开始录制 " << frames << " 帧" << std::endl;
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    traceFramesLeft = 0;
+
+    std::ofstream f(path);
+    if (!f) {
+        std::cout << "[profiler] 无法写入 " << path << std::endl;
+        return false;
+    }
+
+    f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    f << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":";
+    writeJsonString(f, app);
+    f << "}},\n";
+    f << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"main\"}},\n";
+    f << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_THREAD << ",\"args\":{\"name\":\"GPU\"}}";
+
+    char num[64];
+    for (const auto& e : traceEvents) {
+        f << ",\n{\"name\":";
+        writeJsonString(f, e.name);
+        snprintf(num, sizeof(num), "%.3f", e.startUs);
+        f << ",\"cat\":\"" << (e.thread == GPU_THREAD ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"ts\":" << num;
+        snprintf(num, sizeof(num), "%.3f", e.durUs);
+        f << ",\"dur\":" << num << ",\"pid\":1,\"tid\":" << e.thread << ",\"args\":{\"frame\":" << e.frame << "}}";
+    }
+    for (const auto& c : traceCounters) {
+        snprintf(num, sizeof(num), "%.3f", c.first);
+        f << ",\n{\"name\":\"counters\",\"ph\":\"C\",\"ts\":" << num << ",\"pid\":1,\"args\":{"
+          << "\"drawCalls\":" << c.second.drawCalls << ",\"dispatches\":" << c.second.dispatches
+          << ",\"stateChanges\":" << c.second.stateChanges << ",\"uniforms\":" << c.second.uniformUpdates
+          << ",\"bytesUploaded\":" << c.second.bytesUploaded << "}}";
+    }
+    f << "\n]}\n";
+
+    std::cout << "[profiler] 已导出 " << traceEvents.size() << " 个事件到 " << path << std::endl;
+    traceEvents.clear();
+    traceCounters.clear();
+    return true;
+}
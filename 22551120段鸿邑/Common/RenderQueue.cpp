@@ -0,0 +1,186 @@
+#include "renderqueue.h"
+#include "benchmark.h"
+#include "profiler.h"
+#include "streambuffer.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+RenderQueue gRenderQueue;
+
+static constexpr GLuint UNKNOWN = ~0u;
+static constexpr GLintptr UNKNOWN_RANGE = -2;
+
+// ================= 影子状态 =================
+void RenderQueue::ShadowState::reset() {
+    program = UNKNOWN;
+    vao = UNKNOWN;
+    activeUnit = UNKNOWN;
+    std::fill(textures, textures + MAX_TEXTURE_UNITS, UNKNOWN);
+    drawConstants = UNKNOWN_RANGE;
+    depthWrite = true;
+    depthWriteKnown = false;
+}
+
+// ================= 提交 =================
+uint16_t RenderQueue::addMaterial(const RenderMaterial& material) {
+    materials.push_back(material);
+    return (uint16_t)(materials.size() - 1);
+}
+
+uint32_t RenderQueue::compactId(std::unordered_map<GLuint, uint32_t>& ids, GLuint name) {
+    // 按首次出现的顺序编号；表在 execute 后清空，实例化较少的场景里一批也可能有上千个 VAO，用哈希表避免逐个线性查找
+    return ids.emplace(name, (uint32_t)ids.size()).first->second;
+}
+
+void RenderQueue::submit(const DrawPacket& packet, int pass, float depth, float far, bool translucent) {
+    const uint64_t depthMax = (1ull << DEPTH_BITS) - 1;
+    float t = far > 0.0f ? std::min(std::max(depth / far, 0.0f), 1.0f) : 0.0f;
+    uint64_t depthKey = (uint64_t)(t * (float)depthMax);
+    if (translucent) depthKey = depthMax - depthKey;
+
+    uint64_t programId = compactId(programIds, packet.program) & ((1ull << PROGRAM_BITS) - 1);
+    uint64_t materialId = packet.material & ((1ull << MATERIAL_BITS) - 1);
+    uint64_t vaoId = compactId(vaoIds, packet.vao) & ((1ull << VAO_BITS) - 1);
+
+    DrawPacket p = packet;
+    p.key = ((uint64_t)pass << (64 - PASS_BITS))
+          | (programId << (MATERIAL_BITS + VAO_BITS + DEPTH_BITS))
+          | (materialId << (VAO_BITS + DEPTH_BITS))
+          | (vaoId << DEPTH_BITS)
+          | depthKey;
+    items.push_back({ p.key, (uint32_t)packets.size() });
+    packets.push_back(p);
+}
+
+// ================= 排序 =================
+void RenderQueue::sortPackets() {
+    scratch.resize(items.size());
+    for (int shift = 0; shift < 64; shift += 8) {
+        uint32_t count[257] = {};
+        for (const SortItem& item : items) count[((item.key >> shift) & 0xFF) + 1]++;
+        // 所有键在这一字节上相同（常见于高位的 pass、程序），这一趟不改变顺序，跳过
+        if (count[((items[0].key >> shift) & 0xFF) + 1] == items.size()) continue;
+        for (int i = 0; i < 256; ++i) count[i + 1] += count[i];
+        for (const SortItem& item : items) scratch[count[(item.key >> shift) & 0xFF]++] = item;
+        items.swap(scratch);
+    }
+}
+
+// ================= 执行 =================
+void RenderQueue::bindTexture(const TextureBinding& binding) {
+    if (binding.unit < MAX_TEXTURE_UNITS && shadow.textures[binding.unit] == binding.texture) {
+        stats.redundantSkipped++;
+        return;
+    }
+    GLenum unit = GL_TEXTURE0 + binding.unit;
+    if (shadow.activeUnit != unit) {
+        glActiveTexture(unit);
+        shadow.activeUnit = unit;
+    }
+    glBindTexture(binding.target, binding.texture);
+    if (binding.unit < MAX_TEXTURE_UNITS) shadow.textures[binding.unit] = binding.texture;
+    stats.textureBinds++;
+}
+
+void RenderQueue::execute() {
+    if (packets.empty()) return;
+    auto t0 = std::chrono::steady_clock::now();
+    sortPackets();
+    auto t1 = std::chrono::steady_clock::now();
+
+    shadow.reset();
+    uint32_t currentMaterial = UNKNOWN;
+    for (const SortItem& item : items) {
+        const DrawPacket& p = packets[item.index];
+
+        bool programChanged = p.program != shadow.program;
+        if (programChanged) {
+            glUseProgram(p.program);
+            shadow.program = p.program;
+            stats.programBinds++;
+        }
+        else stats.redundantSkipped++;
+
+        // 材质回调会设置程序的 uniform，换了程序即使材质相同也要重新应用
+        if (programChanged || p.material != currentMaterial) {
+            const RenderMaterial& m = materials[p.material < materials.size() ? p.material : 0];
+            for (int i = 0; i < m.textureCount; ++i) bindTexture(m.textures[i]);
+            if (m.apply) {
+                m.apply(p.program, m.user);
+                stats.materialApplies++;
+                shadow.activeUnit = UNKNOWN;
+                std::fill(shadow.textures, shadow.textures + MAX_TEXTURE_UNITS, UNKNOWN);
+            }
+            currentMaterial = p.material;
+        }
+
+        if (p.drawConstants >= 0) {
+            if (p.drawConstants != shadow.drawConstants) {
+                gStream.bindRange(StreamBuffer::DRAW_BINDING, p.drawConstants, (size_t)p.drawConstantsSize);
+                shadow.drawConstants = p.drawConstants;
+                stats.constantBinds++;
+            }
+            else stats.redundantSkipped++;
+        }
+
+        if (!shadow.depthWriteKnown || shadow.depthWrite != p.depthWrite) {
+            glDepthMask(p.depthWrite ? GL_TRUE : GL_FALSE);
+            shadow.depthWrite = p.depthWrite;
+            shadow.depthWriteKnown = true;
+        }
+
+        if (p.vao != shadow.vao) {
+            glBindVertexArray(p.vao);
+            shadow.vao = p.vao;
+            stats.vaoBinds++;
+        }
+        else stats.redundantSkipped++;
+
+        if (p.indexType && p.baseVertex) glDrawElementsBaseVertex(p.mode, p.count, p.indexType, (const void*)p.first, p.baseVertex);
+        else if (p.indexType) glDrawElements(p.mode, p.count, p.indexType, (const void*)p.first);
+        else glDrawArrays(p.mode, (GLint)p.first, p.count);
+    }
+
+    // 只恢复会影响后续代码的状态：VAO（见头文件说明）和深度写入（glClear 受 glDepthMask 影响）
+    if (shadow.vao != 0) glBindVertexArray(0);
+    if (shadow.depthWriteKnown && !shadow.depthWrite) glDepthMask(GL_TRUE);
+
+    stats.packets += packets.size();
+    packets.clear();
+    items.clear();
+    programIds.clear();
+    vaoIds.clear();
+    auto t2 = std::chrono::steady_clock::now();
+    stats.sortMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+    stats.executeMs += std::chrono::duration<double, std::milli>(t2 - t0).count();
+}
+
+void RenderQueue::endFrame() {
+    stats.frames++;
+    stats.stateChanges += gProfiler.counters().stateChanges;
+}
+
+// ================= 统计 =================
+void RenderQueue::printStats(const char* app) const {
+    if (stats.frames == 0) return;
+    double frames = (double)stats.frames;
+    std::cout << "[queue] " << app << "：" << (enabled ? "状态排序渲染队列" : "关闭，立即绘制")
+              << "，每帧状态切换 " << stats.stateChanges / frames << " 次";
+    if (enabled) {
+        std::cout << "，绘制包 " << stats.packets / frames << " 个，绑定 程序 " << stats.programBinds / frames
+                  << " / 纹理 " << stats.textureBinds / frames << " / VAO " << stats.vaoBinds / frames
+                  << " / 常量 " << stats.constantBinds / frames << "，省掉冗余绑定 " << stats.redundantSkipped / frames
+                  << " 次，排序 " << stats.sortMs / frames << " ms，排序 + 执行 " << stats.executeMs / frames << " ms";
+    }
+    std::cout << std::endl;
+}
+
+void addRenderQueueMetrics(BenchmarkRun& run, const RenderQueue& queue) {
+    double frames = (double)std::max<uint64_t>(queue.stats.frames, 1);
+    run.setMetric("render_queue_enabled", queue.enabled ? 1.0 : 0.0);
+    run.setMetric("state_changes_per_frame", queue.stats.stateChanges / frames);
+    run.setMetric("queue_packets_per_frame", queue.stats.packets / frames);
+    run.setMetric("queue_skipped_per_frame", queue.stats.redundantSkipped / frames);
+    run.setMetric("queue_cpu_ms", queue.stats.executeMs / frames);
+}
@@ -0,0 +1,186 @@
+#include "replay.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+InputReplay gReplay;
+InputRecorder gRecorder;
+
+// ================= 键名映射 =================
+struct KeyName {
+    const char* name;
+    int key;
+};
+
+static const KeyName KEY_NAMES[] = {
+    { "W", GLFW_KEY_W }, { "A", GLFW_KEY_A }, { "S", GLFW_KEY_S }, { "D", GLFW_KEY_D },
+    { "C", GLFW_KEY_C }, { "B", GLFW_KEY_B }, { "SPACE", GLFW_KEY_SPACE },
+    { "LEFT_SHIFT", GLFW_KEY_LEFT_SHIFT }, { "ESCAPE", GLFW_KEY_ESCAPE }, { "M", GLFW_KEY_M },
+    { "1", GLFW_KEY_1 }, { "2", GLFW_KEY_2 }, { "3", GLFW_KEY_3 },
+};
+
+static int parseKey(const std::string& name) {
+    for (const auto& k : KEY_NAMES) {
+        if (name == k.name) return k.key;
+    }
+    return std::atoi(name.c_str());
+}
+
+static std::string keyToName(int key) {
+    for (const auto& k : KEY_NAMES) {
+        if (key == k.key) return k.name;
+    }
+    return std::to_string(key);
+}
+
+// ================= 回放 =================
+bool InputReplay::load(const std::string& path) {
+    std::ifstream f(path);
+    if (!f) {
+        std::cout << "无法打开输入脚本：" << path << std::endl;
+        return false;
+    }
+
+    events.clear();
+    uint32_t lastFrame = 0;
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(f, line)) {
+        lineNo++;
+        std::istringstream ss(line);
+        std::string first;
+        if (!(ss >> first) || first[0] == '#') continue;
+
+        if (first == "dt") { ss >> dt; continue; }
+        if (first == "frames") { ss >> frames; continue; }
+
+        InputEvent e = {};
+        e.frame = (uint32_t)std::atoi(first.c_str());
+        std::string type;
+        ss >> type;
+        if (type == "key") {
+            std::string name, state;
+            ss >> name >> state;
+            e.type = InputEvent::KEY;
+            e.key = parseKey(name);
+            e.down = (state == "down");
+            if (e.key < 0 || e.key > GLFW_KEY_LAST) continue;
+        }
+        else if (type == "mouse") { e.type = InputEvent::MOUSE; ss >> e.v[0] >> e.v[1]; }
+        else if (type == "scroll") { e.type = InputEvent::SCROLL; ss >> e.v[0]; }
+        else if (type == "click") { e.type = InputEvent::CLICK; ss >> e.v[0] >> e.v[1]; }
+        else if (type == "camera") {
+            e.type = InputEvent::CAMERA;
+            for (int i = 0; i < 6; i++) ss >> e.v[i];
+        }
+        else {
+            std::cout << path << ":" << lineNo << " 未知事件类型 " << type << std::endl;
+            continue;
+        }
+        events.push_back(e);
+        lastFrame = std::max(lastFrame, e.frame);
+    }
+
+    // 同一帧内保持脚本中的先后顺序
+    std::stable_sort(events.begin(), events.end(),
+        [](const InputEvent& a, const InputEvent& b) { return a.frame < b.frame; });
+    if (frames == 0) frames = lastFrame + 1;
+
+    frame = 0;
+    cursor = 0;
+    std::fill(std::begin(keys), std::end(keys), false);
+    active = true;
+    return true;
+}
+
+void InputReplay::advance() {
+    while (cursor < events.size() && events[cursor].frame <= frame) {
+        const InputEvent& e = events[cursor++];
+        switch (e.type) {
+        case InputEvent::KEY: keys[e.key] = e.down; break;
+        case InputEvent::MOUSE: if (onMouse) onMouse(e.v[0], e.v[1]); break;
+        case InputEvent::SCROLL: if (onScroll) onScroll(e.v[0]); break;
+        case InputEvent::CLICK: if (onClick) onClick(e.v[0], e.v[1]); break;
+        case InputEvent::CAMERA: if (onCamera) onCamera(e.v); break;
+        }
+    }
+    frame++;
+}
+
+bool InputReplay::keyDown(int key) const {
+    return key >= 0 && key <= GLFW_KEY_LAST && keys[key];
+}
+
+bool inputKeyDown(GLFWwindow* window, int key) {
+    if (gReplay.active) return gReplay.keyDown(key);
+    return glfwGetKey(window, key) == GLFW_PRESS;
+}
+
+// ================= 录制 =================
+static const int RECORDED_KEYS[] = {
+    GLFW_KEY_W, GLFW_KEY_A, GLFW_KEY_S, GLFW_KEY_D, GLFW_KEY_C, GLFW_KEY_B, GLFW_KEY_SPACE, GLFW_KEY_LEFT_SHIFT,
+    GLFW_KEY_M, GLFW_KEY_1, GLFW_KEY_2, GLFW_KEY_3,
+};
+
+void InputRecorder::toggle(const std::string& outPath) {
+    if (active) {
+        flush();
+        active = false;
+        std::cout << "输入录制结束：" << path << "（" << frame << " 帧）" << std::endl;
+        return;
+    }
+    path = outPath;
+    frame = 0;
+    lines.clear();
+    std::fill(std::begin(keys), std::end(keys), false);
+    active = true;
+    std::cout << "开始录制输入：" << path << std::endl;
+}
+
+void InputRecorder::update(GLFWwindow* window, const char* appName) {
+    bool f3 = glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS;
+    if (f3 && !f3Down) toggle(std::string(appName) + "_input.txt");
+    f3Down = f3;
+    if (!active) return;
+
+    for (int key : RECORDED_KEYS) {
+        bool down = glfwGetKey(window, key) == GLFW_PRESS;
+        if (down != keys[key]) {
+            lines.push_back(std::to_string(frame) + " key " + keyToName(key) + (down ? " down" : " up"));
+            keys[key] = down;
+        }
+    }
+    frame++;
+}
+
+void InputRecorder::mouse(float dx, float dy) {
+    if (!active) return;
+    char buf[96];
+    snprintf(buf, sizeof(buf), "%u mouse %.3f %.3f", frame, dx, dy);
+    lines.push_back(buf);
+}
+
+void InputRecorder::scroll(float dy) {
+    if (!active) return;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%u scroll %.3f", frame, dy);
+    lines.push_back(buf);
+}
+
+void InputRecorder::click(float x, float y) {
+    if (!active) return;
+    char buf[96];
+    snprintf(buf, sizeof(buf), "%u click %.1f %.1f", frame, x, y);
+    lines.push_back(buf);
+}
+
+void InputRecorder::flush() {
+    std::ofstream f(path);
+    f << "# 由 F3 录制生成\n";
+    f << "dt " << 1.0 / 60.0 << "\n";
+    f << "frames " << frame << "\n";
+    for (const auto& l : lines) f << l << "\n";
+}
@@ -0,0 +1,298 @@
+#include "shadermanager.h"
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+ShaderManager gShaders;
+
+// 静态初始化发生在 main 之前，用作“进程启动”时刻
+static const auto PROCESS_START = std::chrono::steady_clock::now();
+
+// ================= 扩展入口 =================
+// 程序二进制是 GL 4.1 / ARB_get_program_binary 的功能，3.3 上下文的 glad 不一定加载，这里自行获取
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void (APIENTRYP GetProgramBinaryFn)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+typedef void (APIENTRYP ProgramBinaryFn)(GLuint, GLenum, const void*, GLsizei);
+typedef void (APIENTRYP ProgramParameteriFn)(GLuint, GLenum, GLint);
+typedef void (APIENTRYP MaxShaderCompilerThreadsFn)(GLuint);
+
+static GetProgramBinaryFn pGetProgramBinary = nullptr;
+static ProgramBinaryFn pProgramBinary = nullptr;
+static ProgramParameteriFn pProgramParameteri = nullptr;
+
+static const uint32_t BINARY_MAGIC = 0x4E494253; // "SBIN"
+static const uint32_t BINARY_VERSION = 1;
+
+// ================= 工具函数 =================
+static void hashBytes(uint64_t& h, const void* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+}
+
+static void hashString(uint64_t& h, const std::string& s) {
+    hashBytes(h, s.data(), s.size());
+    hashBytes(h, "\0", 1); // 分隔符，避免 "ab"+"c" 与 "a"+"bc" 相同
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+std::string loadShaderSource(const char* path) {
+    std::ifstream f(path);
+    if (!f) {
+        std::cout << "无法读取着色器文件：" << path << std::endl;
+        return std::string();
+    }
+    std::stringstream ss;
+    ss << f.rdbuf();
+    return ss.str();
+}
+
+std::string injectDefines(const std::string& source, const ShaderDefines& defines) {
+    if (defines.empty()) return source;
+
+    std::string block;
+    for (const auto& d : defines) block += "#define " + d.first + " " + d.second + "\n";
+
+    size_t version = source.find("#version");
+    if (version == std::string::npos) return block + source;
+    size_t eol = source.find('\n', version);
+    if (eol == std::string::npos) return source + "\n" + block;
+    // #line 让编译错误的行号仍对应原始文件
+    return source.substr(0, eol + 1) + block + "#line 2\n" + source.substr(eol + 1);
+}
+
+static bool checkShader(GLuint shader, const std::string& name, const char* stage) {
+    GLint ok = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (ok) return true;
+    char log[1024];
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    std::cout << "[shader] " << name << " " << stage << " 编译失败：\n" << log << std::endl;
+    return false;
+}
+
+static bool checkProgram(GLuint program, const std::string& name) {
+    GLint ok = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (ok) return true;
+    char log[1024];
+    glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+    std::cout << "[shader] " << name << " 链接失败：\n" << log << std::endl;
+    return false;
+}
+
+// ================= 初始化 =================
+void ShaderManager::init(const std::string& dir) {
+    cacheDir = dir;
+
+    const char* vendor = (const char*)glGetString(GL_VENDOR);
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    const char* version = (const char*)glGetString(GL_VERSION);
+    driverId = std::string(vendor ? vendor : "") + "|" + (renderer ? renderer : "") + "|" + (version ? version : "");
+
+    pGetProgramBinary = (GetProgramBinaryFn)glfwGetProcAddress("glGetProgramBinary");
+    pProgramBinary = (ProgramBinaryFn)glfwGetProcAddress("glProgramBinary");
+    pProgramParameteri = (ProgramParameteriFn)glfwGetProcAddress("glProgramParameteri");
+    GLint formats = 0;
+    if (pGetProgramBinary && pProgramBinary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    binarySupported = formats > 0;
+
+    // 允许驱动使用全部后台线程编译
+    if (glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        auto maxThreads = (MaxShaderCompilerThreadsFn)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        if (maxThreads) {
+            maxThreads(0xFFFFFFFFu);
+            parallelCompile = true;
+        }
+    }
+
+    if (binarySupported && cacheEnabled) {
+        std::error_code ec;
+        std::filesystem::create_directories(cacheDir, ec);
+    }
+    std::cout << "[shader] 程序二进制缓存：" << (binarySupported ? "可用" : "驱动不支持")
+              << "，并行编译：" << (parallelCompile ? "KHR_parallel_shader_compile" : "由驱动决定") << std::endl;
+}
+
+// ================= 程序二进制缓存 =================
+uint64_t ShaderManager::cacheKey(const ShaderDesc& desc) const {
+    uint64_t h = 1469598103934665603ull;
+    hashBytes(h, &BINARY_VERSION, sizeof(BINARY_VERSION));
+    hashString(h, driverId);
+    hashString(h, desc.vertexSource);
+    hashString(h, desc.fragmentSource);
+    hashString(h, desc.computeSource);
+    for (const auto& d : desc.defines) {
+        hashString(h, d.first);
+        hashString(h, d.second);
+    }
+    return h;
+}
+
+std::string ShaderManager::cachePath(const ShaderDesc& desc, uint64_t key) const {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)key);
+    return cacheDir + "/" + desc.name + "_" + hex + ".bin";
+}
+
+GLuint ShaderManager::loadBinary(const ShaderDesc& desc, uint64_t key) const {
+    std::ifstream f(cachePath(desc, key), std::ios::binary);
+    if (!f) return 0;
+
+    uint32_t magic = 0, version = 0;
+    uint64_t storedKey = 0;
+    GLenum format = 0;
+    uint32_t length = 0;
+    f.read((char*)&magic, sizeof(magic));
+    f.read((char*)&version, sizeof(version));
+    f.read((char*)&storedKey, sizeof(storedKey));
+    f.read((char*)&format, sizeof(format));
+    f.read((char*)&length, sizeof(length));
+    if (!f || magic != BINARY_MAGIC || version != BINARY_VERSION || storedKey != key || length == 0) return 0;
+
+    std::vector<char> data(length);
+    if (!f.read(data.data(), length)) return 0;
+
+    GLuint program = glCreateProgram();
+    pProgramBinary(program, format, data.data(), (GLsizei)length);
+    GLint ok = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        // 驱动拒绝（通常是驱动更新后格式不兼容），回退到源码编译
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void ShaderManager::saveBinary(GLuint program, const ShaderDesc& desc, uint64_t key) const {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> data(length);
+    GLenum format = 0;
+    pGetProgramBinary(program, length, nullptr, &format, data.data());
+
+    std::ofstream f(cachePath(desc, key), std::ios::binary);
+    if (!f) return;
+    uint32_t len = (uint32_t)length;
+    f.write((const char*)&BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    f.write((const char*)&BINARY_VERSION, sizeof(BINARY_VERSION));
+    f.write((const char*)&key, sizeof(key));
+    f.write((const char*)&format, sizeof(format));
+    f.write((const char*)&len, sizeof(len));
+    f.write(data.data(), length);
+}
+
+// ================= 构建 =================
+GLuint ShaderManager::build(const ShaderDesc& desc) {
+    return buildAll({ desc })[0];
+}
+
+std::vector<GLuint> ShaderManager::buildAll(const std::vector<ShaderDesc>& descs) {
+    auto begin = std::chrono::steady_clock::now();
+    bool useCache = binarySupported && cacheEnabled;
+
+    struct Pending {
+        size_t index;
+        uint64_t key;
+        GLuint program;
+        GLuint shaders[2];
+        int shaderCount;
+    };
+    std::vector<GLuint> programs(descs.size(), 0);
+    std::vector<Pending> pending;
+    int hits = 0;
+
+    // 1. 先尝试缓存，未命中的变体提交编译与链接，但不查询状态
+    for (size_t i = 0; i < descs.size(); i++) {
+        const ShaderDesc& d = descs[i];
+        uint64_t key = cacheKey(d);
+        if (useCache && (programs[i] = loadBinary(d, key)) != 0) {
+            hits++;
+            continue;
+        }
+
+        std::vector<std::pair<GLenum, std::string>> stages;
+        if (!d.computeSource.empty()) {
+            stages.push_back({ GL_COMPUTE_SHADER, injectDefines(d.computeSource, d.defines) });
+        }
+        else {
+            stages.push_back({ GL_VERTEX_SHADER, injectDefines(d.vertexSource, d.defines) });
+            stages.push_back({ GL_FRAGMENT_SHADER, injectDefines(d.fragmentSource, d.defines) });
+        }
+
+        Pending p = { i, key, glCreateProgram(), { 0, 0 }, (int)stages.size() };
+        for (int s = 0; s < p.shaderCount; s++) {
+            const char* src = stages[s].second.c_str();
+            p.shaders[s] = glCreateShader(stages[s].first);
+            glShaderSource(p.shaders[s], 1, &src, nullptr);
+            glCompileShader(p.shaders[s]);
+            glAttachShader(p.program, p.shaders[s]);
+        }
+        if (useCache && pProgramParameteri) pProgramParameteri(p.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(p.program);
+        pending.push_back(p);
+    }
+
+    // 2. 全部提交后再逐个检查结果，第一次查询才会等待对应的编译完成
+    int failed = 0;
+    for (const Pending& p : pending) {
+        const ShaderDesc& d = descs[p.index];
+        bool ok = checkProgram(p.program, d.name);
+        static const char* STAGE_NAMES[2][2] = { { "compute", "" }, { "vertex", "fragment" } };
+        for (int s = 0; s < p.shaderCount; s++) {
+            if (!ok) checkShader(p.shaders[s], d.name, STAGE_NAMES[p.shaderCount - 1][s]);
+            glDetachShader(p.program, p.shaders[s]);
+            glDeleteShader(p.shaders[s]);
+        }
+
+        if (!ok) {
+            glDeleteProgram(p.program);
+            failed++;
+            continue;
+        }
+        if (useCache) saveBinary(p.program, d, p.key);
+        programs[p.index] = p.program;
+    }
+
+    double ms = elapsedMs(begin);
+    totals.programs += (int)descs.size();
+    totals.cacheHits += hits;
+    totals.compiled += (int)pending.size() - failed;
+    totals.failed += failed;
+    totals.ms += ms;
+
+    char buf[160];
+    snprintf(buf, sizeof(buf), "[shader] %zu 个程序：缓存命中 %d，编译 %d，失败 %d，耗时 %.1f ms",
+        descs.size(), hits, (int)pending.size() - failed, failed, ms);
+    std::cout << buf << std::endl;
+    return programs;
+}
+
+void ShaderManager::reportStartup(const char* app) const {
+    const char* kind = totals.compiled + totals.failed == 0 ? "热启动" : "冷启动";
+    char buf[192];
+    snprintf(buf, sizeof(buf), "[startup] %s %s：%.1f ms 到首帧（着色器 %.1f ms，缓存命中 %d/%d）",
+        app, kind, elapsedMs(PROCESS_START), totals.ms, totals.cacheHits, totals.programs);
+    std::cout << buf << std::endl;
+}
@@ -0,0 +1,189 @@
+#include "streambuffer.h"
+#include "benchmark.h"
+#include "memoryregistry.h"
+#include "profiler.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+StreamBuffer gStream;
+
+// ================= 扩展入口 =================
+// glBufferStorage 是 GL 4.4 / ARB_buffer_storage 的功能，3.3 上下文的 glad 不一定加载，这里自行获取
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void (APIENTRYP BufferStorageFn)(GLenum, GLsizeiptr, const void*, GLbitfield);
+
+static BufferStorageFn loadBufferStorage() {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool core = major > 4 || (major == 4 && minor >= 4);
+    if (!core && !glfwExtensionSupported("GL_ARB_buffer_storage")) return nullptr;
+    return (BufferStorageFn)glfwGetProcAddress("glBufferStorage");
+}
+
+// ================= 初始化 =================
+bool StreamBuffer::init(size_t bytesPerFrame) {
+    if (!enabled) return false;
+
+    GLint align = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+    alignment = std::max<GLintptr>(align, 16);
+    segmentSize = (GLsizeiptr)((bytesPerFrame + alignment - 1) / alignment * alignment);
+    GLsizeiptr total = segmentSize * FRAMES;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    BufferStorageFn bufferStorage = loadBufferStorage();
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    if (bufferStorage) {
+        bufferStorage(GL_UNIFORM_BUFFER, total, nullptr, flags);
+        gMemory.trackBufferStorage(buffer, GL_UNIFORM_BUFFER, total);
+        mapped = (uint8_t*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, total, flags);
+        if (!mapped) {
+            // 不可变存储不能再 glBufferData，换一个缓冲对象走回退路径
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        }
+    }
+    if (!mapped) glBufferData(GL_UNIFORM_BUFFER, total, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    persistent = mapped != nullptr;
+
+    segment = FRAMES - 1;
+    head = 0;
+    std::cout << "[stream] 常量环形缓冲 " << FRAMES << " × " << segmentSize / 1024.0 << " KB，对齐 " << alignment << " 字节，"
+              << (persistent ? "持久映射" : "不支持 ARB_buffer_storage，回退到 glBufferSubData") << std::endl;
+    return true;
+}
+
+void StreamBuffer::shutdown() {
+    for (GLsync& fence : fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (buffer) {
+        if (mapped) {
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    mapped = nullptr;
+}
+
+// ================= 帧边界 =================
+void StreamBuffer::beginFrame() {
+    if (!buffer) return;
+    segment = (segment + 1) % FRAMES;
+    head = 0;
+
+    GLsync& fence = fences[segment];
+    if (!fence) return;
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        // GPU 落后了 FRAMES 帧：等这一段的读取结束（第一次等待时刷新命令，保证围栏能被执行到）
+        auto t0 = std::chrono::steady_clock::now();
+        GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        GLenum status;
+        do {
+            status = glClientWaitSync(fence, waitFlags, 1000000);
+            waitFlags = 0;
+        } while (status == GL_TIMEOUT_EXPIRED);
+        stats.fenceWaits++;
+        stats.fenceWaitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamBuffer::endFrame() {
+    stats.frames++;
+    stats.uniformCalls += gProfiler.counters().uniformUpdates;
+    if (!buffer) return;
+    stats.peakFrameBytes = std::max(stats.peakFrameBytes, (uint32_t)head);
+    fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+// ================= 写入 =================
+GLintptr StreamBuffer::write(const void* data, size_t size) {
+    if (!buffer) return -1;
+    GLintptr offset = (head + alignment - 1) / alignment * alignment;
+    if (offset + (GLintptr)size > segmentSize) {
+        stats.overflows++;
+        if (!overflowWarned) {
+            std::cout << "[stream] 本帧常量超过 " << segmentSize << " 字节，之后的写入被丢弃（调大 init 的参数）" << std::endl;
+            overflowWarned = true;
+        }
+        return -1;
+    }
+
+    GLintptr position = segment * segmentSize + offset;
+    if (mapped) {
+        std::memcpy(mapped + position, data, size);
+        gProfiler.counters().bytesUploaded += size;   // 映射写入不经过 GL 钩子，手动计入上传量
+    }
+    else {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, position, (GLsizeiptr)size, data);
+    }
+
+    stats.bytes += (uint64_t)(offset + size - head);
+    head = offset + (GLintptr)size;
+    return position;
+}
+
+void StreamBuffer::bindRange(GLuint binding, GLintptr position, size_t size) {
+    if (!buffer || position < 0) return;
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, position, (GLsizeiptr)size);
+    stats.pushes++;
+}
+
+GLintptr StreamBuffer::pushUniform(GLuint binding, const void* data, size_t size) {
+    GLintptr position = write(data, size);
+    bindRange(binding, position, size);
+    return position;
+}
+
+void StreamBuffer::bindBlocks(GLuint program) {
+    GLuint frameBlock = glGetUniformBlockIndex(program, "FrameBlock");
+    if (frameBlock != GL_INVALID_INDEX) glUniformBlockBinding(program, frameBlock, FRAME_BINDING);
+    GLuint drawBlock = glGetUniformBlockIndex(program, "DrawBlock");
+    if (drawBlock != GL_INVALID_INDEX) glUniformBlockBinding(program, drawBlock, DRAW_BINDING);
+}
+
+// ================= 统计 =================
+void StreamBuffer::printStats(const char* app) const {
+    if (stats.frames == 0) return;
+    double frames = (double)stats.frames;
+    std::cout << "[stream] " << app << "：" << (buffer ? (persistent ? "持久映射环形缓冲" : "环形缓冲（glBufferSubData）") : "关闭，逐个 glUniform")
+              << "，每帧 glUniform " << stats.uniformCalls / frames << " 次，设置常量 CPU " << stats.constantsMs / frames << " ms";
+    if (buffer) {
+        std::cout << "，写入 " << stats.bytes / frames << " 字节 / " << stats.pushes / frames << " 次绑定（峰值 " << stats.peakFrameBytes
+                  << " 字节），围栏等待 " << stats.fenceWaits << " 次共 " << stats.fenceWaitMs << " ms";
+        if (stats.overflows) std::cout << "，溢出 " << stats.overflows << " 次";
+    }
+    std::cout << std::endl;
+}
+
+StreamConstantsScope::~StreamConstantsScope() {
+    gStream.stats.constantsMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void addStreamMetrics(BenchmarkRun& run, const StreamBuffer& stream) {
+    double frames = (double)std::max<uint64_t>(stream.stats.frames, 1);
+    run.setMetric("stream_enabled", stream.enabled ? 1.0 : 0.0);
+    run.setMetric("uniform_calls_per_frame", stream.stats.uniformCalls / frames);
+    run.setMetric("constants_cpu_ms", stream.stats.constantsMs / frames);
+    run.setMetric("stream_bytes_per_frame", stream.stats.bytes / frames);
+    run.setMetric("stream_fence_wait_ms", stream.stats.fenceWaitMs);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <glad/glad.h>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// ================= 基准测试参数 =================
+// 命令行：--bench <脚本> [--frames N] [--warmup N] [--size WxH] [--out 报告.json] [--cpu] [--image 输出.ppm]
+struct BenchmarkConfig {
+    std::string app;
+    std::string script;
+    std::string output;      // 为空时写入 <app>_bench.json
+    std::string image;       // 非空时保存最后一帧，便于比对画面
+    int width = 0;           // 0 表示使用程序默认分辨率
+    int height = 0;
+    int frames = 0;          // 0 表示使用脚本中的帧数
+    int warmup = 10;         // 预热帧不计入统计
+    bool cpu = false;        // 使用 CPU 参考渲染路径（无需 GL）
+};
+
+// 返回 true 表示命令行请求了基准模式
+bool parseBenchmarkArgs(int argc, char** argv, const char* app, BenchmarkConfig& config);
+
+// ================= 统计 =================
+struct FrameStats {
+    double minMs = 0.0;
+    double medianMs = 0.0;
+    double p95Ms = 0.0;
+    double p99Ms = 0.0;
+    double meanMs = 0.0;
+    double maxMs = 0.0;
+};
+
+FrameStats computeFrameStats(std::vector<double> samples);
+
+// ================= 离屏渲染目标 =================
+// 隐藏窗口的默认帧缓冲内容未定义，基准模式统一渲染到 FBO（llvmpipe 同样支持）
+class OffscreenTarget {
+public:
+    bool create(int width, int height);
+    void destroy();
+    void bind() const;
+    // 读回 RGB8 像素（自下而上）
+    std::vector<unsigned char> readPixels() const;
+
+    GLuint fbo = 0;
+    int width = 0;
+    int height = 0;
+
+private:
+    GLuint color = 0;
+    GLuint depth = 0;
+};
+
+// ================= 基准运行 =================
+class BenchmarkRun {
+public:
+    void begin(const BenchmarkConfig& config, int width, int height, const std::string& renderer);
+    void frameStart();
+    // GL 路径传 true：在计时结束前 glFinish，保证统计包含 GPU 执行时间
+    void frameEnd(bool finishGL);
+    bool writeReport() const;
+    int recordedFrames() const { return (int)frameMs.size(); }
+    // 附加指标（如占用率、步数统计），写入报告的 "metrics" 对象；同名覆盖
+    void setMetric(const std::string& name, double value);
+
+private:
+    BenchmarkConfig config;
+    int width = 0;
+    int height = 0;
+    std::string renderer;
+    std::vector<double> frameMs;
+    std::vector<std::pair<std::string, double>> metrics;
+    int frameIndex = 0;
+    std::chrono::steady_clock::time_point frameBegin;
+    std::chrono::steady_clock::time_point runBegin;
+    double totalSeconds = 0.0;
+};
+
+bool writeImagePPM(const std::string& path, int width, int height, const unsigned char* rgb, bool flipY);
+
+// 带引号写出 JSON 字符串：转义引号、反斜杠（Windows 路径）与控制字符
+void writeJsonString(std::ostream& f, const std::string& s);
@@ -0,0 +1,121 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class BenchmarkRun;
+
+// ================= 捕获统计 =================
+struct CaptureStats {
+    uint64_t frames = 0;         // 已发起读回的帧
+    uint64_t written = 0;        // 已编码写出的帧
+    double issueMs = 0.0;        // 主线程：发起 glReadPixels + 围栏
+    double collectMs = 0.0;      // 主线程：取回就绪的帧（无持久映射时含 map + memcpy）
+    uint64_t fenceWaits = 0;     // 取回时围栏尚未完成、需要等待的次数
+    double fenceWaitMs = 0.0;
+    double stallMs = 0.0;        // 编码跟不上、队列满时主线程的等待
+    double encodeMs = 0.0;       // 工作线程：转换 + 编码 + 写出，累计
+    uint64_t bytesWritten = 0;
+};
+
+enum CaptureFormat {
+    CAPTURE_PNG,                 // 图像序列，文件名为 printf 模式（如 shots/frame_%05d.png）
+    CAPTURE_PPM,
+    CAPTURE_Y4M,                 // 未压缩 YUV 4:2:0 视频，写文件或经管道交给本地编码器
+};
+
+// ================= 非阻塞帧捕获 =================
+// 原来录演示只能录屏，而 glReadPixels 读默认帧缓冲要等 GPU 画完整帧，渲染循环随之停顿。这里改为：
+//   - 每帧把画面 glReadPixels 到 RING 个像素缓冲（PBO）中的一个并插入围栏，立即返回；
+//     第 N 帧的数据在渲染第 N + LATENCY 帧时才取回，读回与之后两帧的渲染重叠，正常情况下围栏早已完成
+//   - 有 GL 4.4 / ARB_buffer_storage 时 PBO 以 GL_MAP_READ_BIT | PERSISTENT | COHERENT 映射一次，
+//     取回只是把槽号交给工作线程，拷贝也在工作线程里做；否则主线程 map + memcpy 到缓冲池再交出
+//   - 颜色转换、编码与写盘在工作线程上进行：PNG（自带的定长 Huffman deflate，逐行 Up 滤波）、PPM，
+//     或 Y4M（BT.709 有限范围 4:2:0）；Y4M 是一条流，各线程转换完后按帧序写出
+//   - 目标以 '|' 开头时作为命令行启动并把 Y4M 写进它的标准输入，例如 "|ffmpeg -y -i - -c:v libx264 out.mp4"
+//   - 编码跟不上时（队列超过 MAX_QUEUED 帧）主线程等待而不丢帧，等待时间单独计入统计
+// 捕获的是 fbo（0 为默认帧缓冲的后缓冲）左下角 width × height 的区域，应在叠加层之前、交换缓冲之前调用。
+// 用法：
+//   gCapture.start("demo.y4m", width, height, 60);     // 或交互运行时按 F5 开始/停止
+//   每帧：gCapture.capture(fbo);                        // 渲染完、drawOverlay 之前
+//   gCapture.stop();                                    // 取回剩余的帧、等编码完成、关闭输出
+class FrameCapture {
+public:
+    static constexpr int RING = 4;
+    static constexpr int LATENCY = 2;
+    static constexpr int MAX_QUEUED = 6;
+
+    // target 的扩展名决定格式：.png / .ppm 为序列（需含 %d 类的格式符），.y4m 或以 '|' 开头为 Y4M；workers 为 0 时按硬件线程数
+    bool start(const std::string& target, int width, int height, int fps = 60, unsigned workers = 0);
+    void capture(GLuint fbo);
+    void stop();
+    bool active() const { return running; }
+
+    // F5 开始/停止；target 为空时写 <app>_capture.y4m
+    void handleHotkey(GLFWwindow* window, const char* app, const std::string& target = std::string());
+
+    void printStats(const char* app) const;
+
+    CaptureStats stats;
+
+private:
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        uint64_t frame = 0;
+        bool pending = false;    // 已发起读回、尚未取回
+        bool busy = false;       // 持久映射路径：工作线程还在拷贝
+    };
+    struct Job {
+        uint64_t frame;
+        int slot;                        // 持久映射路径：从 mapped[slot] 拷贝；否则为 -1
+        std::vector<uint8_t> pixels;     // RGBA，自下而上
+    };
+
+    void collect(Slot& slot, int index);
+    void workerMain();
+    void encode(Job& job);
+    void writeOrdered(uint64_t frame, std::vector<uint8_t>& data);
+    std::vector<uint8_t> takeBuffer();
+
+    CaptureFormat format = CAPTURE_PNG;
+    std::string target;
+    int width = 0;
+    int height = 0;
+    int fps = 60;
+    bool running = false;
+    bool persistent = false;
+    bool pipe = false;
+    bool hotkeyDown = false;
+    size_t frameBytes = 0;
+    Slot slots[RING];
+    uint8_t* mapped[RING] = {};
+
+    // 工作线程
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;        // 有新任务 / 退出
+    std::condition_variable progress;    // 有任务完成 / 槽释放
+    std::vector<Job> queue;
+    std::vector<std::vector<uint8_t>> bufferPool;
+    int activeJobs = 0;
+    bool quit = false;
+
+    // Y4M 按帧序写出
+    FILE* stream = nullptr;
+    std::mutex streamMutex;
+    std::map<uint64_t, std::vector<uint8_t>> reorder;
+    uint64_t nextWrite = 0;
+};
+
+extern FrameCapture gCapture;
+
+// 基准报告指标：capture_frames、capture_cpu_ms、capture_fence_wait_ms、capture_stall_ms、capture_encode_ms、capture_mb
+void addCaptureMetrics(BenchmarkRun& run, const FrameCapture& capture);
@@ -0,0 +1,128 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ================= 帧节奏参数 =================
+// 命令行：[--no-pacing] [--frames-in-flight N] [--swap-interval N] [--latency]
+struct PacingConfig {
+    bool enabled = true;         // --no-pacing 回到原来的循环（开头取输入、交换缓冲时由驱动限流）
+    int framesInFlight = 2;
+    int swapInterval = 1;        // 0 关闭垂直同步
+    bool measure = false;        // --latency 测量模式
+};
+
+void parsePacingArgs(int argc, char** argv, PacingConfig& config);
+
+// ================= 帧节奏统计 =================
+struct PacingStats {
+    uint64_t frames = 0;
+    uint64_t fenceWaits = 0;         // 帧开始时 GPU 仍落后 maxInFlight 帧、需要等围栏的次数
+    double fenceWaitMs = 0.0;
+    // 测量模式（--latency）的逐帧样本（毫秒）
+    std::vector<double> inputToPhotonMs;   // 有新输入的帧：最早的未锁存输入 → 估计的上屏时刻
+    std::vector<double> latchToPhotonMs;   // 每帧：锁存相机 → 估计的上屏时刻
+    std::vector<double> inputToLatchMs;    // 有新输入的帧：输入在锁存前等待的时间
+};
+
+// ================= 低延迟帧节奏 =================
+// 原来每帧在循环开头取输入、更新相机，然后渲染、glfwSwapBuffers；驱动会让 CPU 领先 GPU 两三帧，
+// 取到的输入要等前面排队的帧都画完才上屏，按下键到画面变化有一到两帧以上的延迟。这里改为：
+//   - 围栏限制在途帧数：每帧最后一次绘制之后插入围栏，下一帧开始前等 maxInFlight 帧之前的围栏（--frames-in-flight，默认 2）。
+//     CPU 不再提前排队，阻塞发生在取输入之前，而不是取完输入之后的 glfwSwapBuffers 里
+//   - 输入线程：按 RATE_HZ 调用程序给的积分函数（相机的键盘移动），在 cameraMutex 下修改相机。
+//     GLFW 的事件与按键查询只能在主线程调用，所以主线程 glfwPollEvents 之后把受监视按键的状态写成快照，
+//     输入线程只读快照；鼠标回调（主线程）加锁后直接转动相机
+//   - 晚锁存：latch() 在写相机常量之前再 glfwPollEvents 一次，然后在锁内把相机积分到当前时刻（补上输入线程
+//     上一步之后的时间，Windows 默认的计时器精度下线程实际达不到 RATE_HZ）并拷出相机状态，
+//     帧开始时的围栏等待与之前的 CPU 工作期间到达的输入都赶得上本帧
+//   - 测量模式（--latency）：每帧交换前插入 GL_TIMESTAMP 查询，换算到 CPU 时钟得到 GPU 画完的时刻，
+//     再加显示延迟的估计（垂直同步时一个刷新周期：平均等半个周期到 vblank + 扫描到屏幕中部半个周期；否则半个周期）。
+//     不含操作系统与 USB 的输入延迟，也不含显示器自身的处理延迟
+// 基准模式（固定步长回放、每帧 glFinish）不启用：调用 init 之前 enabled 为 false，所有函数退化为原来的行为。
+// 用法：
+//   gPacer.init(window, pacingConfig);                  // gladLoadGL 之后，交互模式且未指定 --no-pacing 时
+//   gPacer.startInput({ GLFW_KEY_W, ... }, [](float dt) { 按 gPacer.keyDown 移动相机 });
+//   鼠标回调：std::lock_guard<std::mutex> lock(gPacer.cameraMutex()); 转动相机; gPacer.noteInput();
+//   while (...) {
+//       gPacer.beginFrame();                             // gProfiler.beginFrame 之后、取输入之前
+//       ...
+//       gPacer.latch(window, [&] { 拷出相机状态 });       // 写相机常量之前
+//       ...
+//       gPacer.endFrame();                               // 最后一次绘制之后、glfwSwapBuffers 之前
+//       glfwSwapBuffers(window); glfwPollEvents(); gPacer.sampleInput(window);
+//   }
+//   gPacer.shutdown();
+class FramePacer {
+public:
+    static constexpr int MAX_IN_FLIGHT = 3;      // 不超过流式常量缓冲的段数（StreamBuffer::FRAMES）
+    static constexpr int RATE_HZ = 1000;
+
+    void init(GLFWwindow* window, const PacingConfig& config);
+    void shutdown();
+
+    // 输入线程：keys 为受监视的按键，integrate 在输入线程上以 RATE_HZ 调用（已持有 cameraMutex）
+    void startInput(const std::vector<int>& keys, std::function<void(float dt)> integrate);
+    bool inputThreadRunning() const { return inputRunning; }
+
+    void beginFrame();
+    // 主线程：glfwPollEvents 之后把受监视按键写成快照；状态有变化时记为一次输入
+    void sampleInput(GLFWwindow* window);
+    // 输入线程运行时读快照，否则同 inputKeyDown（回放时为脚本状态）
+    bool keyDown(GLFWwindow* window, int key) const;
+    // 回调中的鼠标、滚轮、点击：记下时刻，用于测量输入到上屏的延迟
+    void noteInput();
+    std::mutex& cameraMutex() { return mutex; }
+    // 再取一次事件，在 cameraMutex 下调用 copy 拷出相机状态，并记下锁存时刻
+    void latch(GLFWwindow* window, const std::function<void()>& copy);
+    void endFrame();
+
+    void printStats(const char* app) const;
+
+    bool enabled = false;
+    bool measure = false;
+    int maxInFlight = 2;
+    PacingStats stats;
+
+private:
+    struct Frame {
+        GLsync fence = nullptr;
+        GLuint query = 0;
+        bool pending = false;
+        double latchUs = -1.0;
+        double inputUs = -1.0;
+    };
+    static constexpr int RING = MAX_IN_FLIGHT + 1;
+    Frame frames[RING];
+    uint64_t frameIndex = 0;
+    std::chrono::steady_clock::time_point epoch;
+    double displayUs = 0.0;          // 上屏时刻的估计：GPU 画完之后的显示延迟
+    int64_t gpuOffsetNs = 0;         // GPU 时间戳 - CPU 时钟，定期校准
+    size_t reported = 0;             // 测量模式已输出过的样本数
+
+    // 输入：lastStep 与相机状态一样受 mutex 保护
+    std::mutex mutex;
+    std::thread inputThread;
+    std::atomic<bool> inputRunning{ false };
+    std::atomic<bool> quit{ false };
+    std::atomic<uint64_t> inputSteps{ 0 };   // 输入线程的积分步数（不含锁存时的补步）
+    std::function<void(float)> integrate;
+    std::chrono::steady_clock::time_point lastStep;
+    std::vector<int> watched;
+    std::atomic<bool> keys[GLFW_KEY_LAST + 1] = {};
+    double pendingInputUs = -1.0;    // 上次锁存之后最早的输入（只在主线程读写），-1 表示没有
+
+    double nowUs() const;
+    void calibrate();
+    void resolve(Frame& frame);
+    void report(size_t from, const char* label) const;
+    void inputMain();
+};
+
+extern FramePacer gPacer;
@@ -0,0 +1,154 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class BenchmarkRun;
+
+// ================= 分类 =================
+enum MemoryCategory {
+    MEM_VERTEX_BUFFER,
+    MEM_INDEX_BUFFER,
+    MEM_UNIFORM_BUFFER,
+    MEM_PIXEL_BUFFER,
+    MEM_OTHER_BUFFER,
+    MEM_TEXTURE_2D,
+    MEM_TEXTURE_3D,
+    MEM_TEXTURE_CUBE,
+    MEM_RENDERBUFFER,
+    MEM_PROGRAM,
+    MEM_HOST,
+    MEM_CATEGORY_COUNT
+};
+
+const char* memoryCategoryName(MemoryCategory category);
+
+// ================= 预算 =================
+// 0 表示不限制；由 --vram-budget / --host-budget（MB）设置
+struct MemoryBudget {
+    uint64_t gpuBytes = 0;
+    uint64_t hostBytes = 0;
+};
+
+// 超出预算时调用的降级回调，返回 false 表示已无法再降（之后不再调用）
+typedef bool (*MemoryDowngradeFn)(void* user);
+
+// ================= 资源登记表 =================
+// 几个程序的显存都没有统计：loadTexture 的贴图、黑洞的 GL_RGB16F 星空、每个 Mesh 的 VBO/EBO 都是直接分配的，
+// 在共用的机器上常常意外 OOM。这里登记每一个缓冲、纹理、渲染缓冲和程序的创建与释放：
+//   - 与分析器相同，替换 glad 的函数指针（glGen*/glDelete*、glBufferData、glTexImage2D/3D、glTexStorage2D、glGenerateMipmap、
+//     glRenderbufferStorage*、glCreateProgram/glLinkProgram），所有调用点自动计入，按分类与资产累计字节数。
+//     尺寸按内部格式估算（RGB8 按 4 字节计，与多数 GPU 的实际对齐一致），程序取驱动给出的二进制长度
+//   - 资产名来自创建时所在的 MemoryAssetScope，之后分配的存储都记到该资产下；不在作用域内创建的记为“未标记”
+//   - 主机内存由调用方用 trackHost 登记（常驻的顶点数组、CPU 侧的查找表等），可在任意线程调用
+//   - 显存或主机内存超出预算时，每隔 DOWNGRADE_COOLDOWN 帧按注册顺序调用一次降级回调，内置的回调排在最后：
+//     每次把最大的一张带 mip 链的 2D 纹理去掉顶层 mip（同一纹理名原地重新指定，引用处不用改）。
+//     回调返回 false 只表示当时无法再降，冷却后仍会重试（之后创建的资源可能又能降了），提示只打印一次
+//   - 叠加层（随分析器 F1 显示）画出显存与主机内存的分类条和预算线；F4 写出 <app>_memory.json
+//   - shutdown 时列出仍未释放的对象，按资产汇总，即泄漏检查（应在应用释放完资源之后、销毁上下文之前调用）
+// glBufferStorage 等不经过 glad 的入口需调用方用 trackBufferStorage 补登。
+// 用法：
+//   gMemory.init("solar_system");                      // gladLoadGL 之后、创建任何资源之前
+//   { MemoryAssetScope asset("earth_normal"); tex = loadTexture(...); }
+//   gMemory.addDowngrade("planet_lod", fn);
+//   每帧：gMemory.endFrame(window);                     // gProfiler.endFrame 之前
+//   gMemory.shutdown();
+class MemoryRegistry {
+public:
+    static constexpr int DOWNGRADE_COOLDOWN = 30;   // 两次降级之间的帧数，让释放生效、统计回落
+    static constexpr int MIN_DOWNGRADE_SIZE = 256;  // 纹理降到这个边长后不再降
+
+    void init(const char* appName);
+    // 返回泄漏的对象数
+    int shutdown();
+    void endFrame(GLFWwindow* window);
+
+    void trackHost(const char* asset, int64_t deltaBytes);
+    void trackBufferStorage(GLuint buffer, GLenum target, GLsizeiptr bytes);
+
+    void addDowngrade(const char* name, MemoryDowngradeFn fn, void* user = nullptr);
+    // 去掉 2D 纹理的顶层 mip，其余各级上移一级；没有 mip 链、整数格式、不可变存储或已到 MIN_DOWNGRADE_SIZE 时返回 false
+    bool dropTopMip(GLuint texture);
+
+    uint64_t gpuBytes() const;
+    uint64_t hostBytes() const;
+    uint64_t categoryBytes(MemoryCategory category) const { return totals[category]; }
+
+    bool writeJson(const std::string& path) const;
+    void printSummary() const;
+    // 叠加层面板，返回占用的高度
+    int drawOverlay(int x, int y);
+
+    bool enabled = true;
+    MemoryBudget budget;
+    uint64_t peakGpuBytes = 0;
+    uint64_t peakHostBytes = 0;
+    int downgradeCount = 0;
+    int leaks = 0;
+
+private:
+    struct Object {
+        MemoryCategory category = MEM_OTHER_BUFFER;
+        std::string asset;
+        uint64_t bytes = 0;
+        uint64_t frame = 0;                                // 创建时的帧号
+        std::unordered_map<uint32_t, uint64_t> images;     // 纹理：面 * 32 + 级别 -> 字节数
+        bool sizeKnown = false;                            // 程序：是否已取得二进制长度
+        bool pinned = false;                               // 纹理：已无法再去掉 mip
+    };
+    struct Downgrade {
+        const char* name;
+        MemoryDowngradeFn fn;
+        void* user;
+        bool exhausted;   // 上次尝试失败且已提示过；再次成功时清除
+    };
+
+public:
+    // 以下由 GL 钩子调用
+    void onCreate(int kind, GLsizei n, const GLuint* names);
+    void onDelete(int kind, GLsizei n, const GLuint* names);
+    void onBufferData(GLenum target, GLsizeiptr size);
+    void onTexImage(GLenum target, GLint level, GLenum internalFormat, GLsizei w, GLsizei h, GLsizei d, GLenum format, GLenum type);
+    void onGenerateMipmap(GLenum target);
+    void onRenderbufferStorage(GLsizei samples, GLenum internalFormat, GLsizei w, GLsizei h);
+    void onCreateProgram(GLuint program);
+    void onLinkProgram(GLuint program);
+
+private:
+    void setBytes(Object& object, uint64_t bytes);
+    void release(Object& object);
+    void updateProgramSizes();
+    void checkBudget();
+
+    std::string app;
+    std::unordered_map<GLuint, Object> tables[4];   // 缓冲、纹理、渲染缓冲、程序
+    uint64_t totals[MEM_CATEGORY_COUNT] = {};
+    std::unordered_map<std::string, int64_t> hostAssets;
+    mutable std::mutex hostMutex;
+    std::vector<Downgrade> downgrades;
+    std::vector<std::string> downgradeLog;
+    uint64_t frame = 0;
+    uint64_t lastDowngradeFrame = 0;
+    bool downgradeTried = false;   // 尝试过降级（无论成败），之后按冷却间隔重试
+    bool programBinaryLength = false;
+    bool pendingPrograms = false;
+    bool initialized = false;
+    bool f4Down = false;
+};
+
+extern MemoryRegistry gMemory;
+
+// ================= 资产作用域 =================
+// 作用域内创建的 GL 对象记到 asset 名下（按线程，可嵌套）
+struct MemoryAssetScope {
+    explicit MemoryAssetScope(const std::string& asset);
+    ~MemoryAssetScope();
+    std::string previous;
+};
+
+// 基准报告指标：gpu_memory_mb、gpu_memory_peak_mb、host_memory_peak_mb、memory_downgrades、memory_budget_mb
+void addMemoryMetrics(BenchmarkRun& run, const MemoryRegistry& memory);
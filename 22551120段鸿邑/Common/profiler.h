@@ -0,0 +1,159 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ================= 帧计数器 =================
+// 由 installGLHooks() 安装的 GL 函数钩子自动累加，无需在调用处手动统计
+struct FrameCounters {
+    uint32_t drawCalls = 0;      // glDraw*
+    uint32_t dispatches = 0;     // glDispatchCompute
+    uint32_t stateChanges = 0;   // 程序/纹理/VAO/缓冲/FBO 绑定与 glEnable/glDisable
+    uint32_t uniformUpdates = 0; // glUniform*
+    uint64_t bytesUploaded = 0;  // glBufferData/glBufferSubData/glTexImage2D/glTexSubImage2D
+};
+
+// ================= 计时事件 =================
+struct ProfileEvent {
+    const char* name;
+    double startUs;   // 相对 Profiler 初始化时刻（微秒）
+    double durUs;
+    uint32_t thread;  // 0 为主线程，GPU 事件使用 GPU_THREAD
+    uint32_t depth;
+    uint64_t frame;
+};
+
+// ================= 帧分析器 =================
+// 用法：
+//   gProfiler.init("blackhole");             // gladLoadGL 之后
+//   while (...) {
+//       gProfiler.beginFrame();
+//       { PROFILE_SCOPE("update"); ... }
+//       { PROFILE_GPU_SCOPE("march"); glDraw...; }
+//       gProfiler.drawOverlay();             // glfwSwapBuffers 之前
+//       glfwSwapBuffers(window);
+//       gProfiler.endFrame(window);
+//   }
+//   gProfiler.shutdown();
+// F1 切换叠加层，F2 录制接下来的 TRACE_FRAMES 帧并导出 Chrome-trace/Perfetto JSON
+class Profiler {
+public:
+    static constexpr uint32_t GPU_THREAD = 1000;
+    static constexpr int GPU_RING = 4;       // 查询环形缓冲深度：读取第 N-3 帧的结果，永不阻塞
+    static constexpr int MAX_GPU_PASSES = 16;
+    static constexpr int HISTORY = 120;
+    static constexpr int TRACE_FRAMES = 300;
+
+    void init(const char* appName);
+    void shutdown();
+
+    void beginFrame();
+    void endFrame(GLFWwindow* window);
+
+    // CPU 计时可在任意线程使用（每线程独立的作用域栈），叠加层只显示主线程的顶层作用域
+    void beginCpu(const char* name);
+    void endCpu();
+    void beginGpu(const char* name);
+    void endGpu();
+
+    void handleHotkeys(GLFWwindow* window);
+    void drawOverlay();
+    // 其他模块的叠加层面板（如显存统计），在叠加层的状态保存/恢复之间调用，依次堆在帧时间图上方；返回占用的高度
+    typedef int (*OverlayPanelFn)(int x, int y);
+    void addOverlayPanel(OverlayPanelFn panel) { overlayPanels.push_back(panel); }
+    void startTrace(int frames = TRACE_FRAMES);
+    bool writeChromeTrace(const std::string& path);
+
+    FrameCounters& counters() { return current; }
+    const FrameCounters& lastCounters() const { return last; }
+    double lastFrameMs() const { return frameMs; }
+    double lastGpuMs() const { return gpuTotalMs; }
+    // 指定 GPU 通道最近一次可用的耗时（毫秒），不存在返回 -1
+    double gpuPassMs(const char* name) const;
+    uint64_t frameIndex() const { return frame; }
+    double nowUs() const;
+
+    bool overlayEnabled = true;
+
+private:
+    struct GpuPass {
+        const char* name = nullptr;
+        GLuint queries[GPU_RING] = {};
+        bool issued[GPU_RING] = {};
+        double issueUs[GPU_RING] = {};
+        uint64_t issueFrame[GPU_RING] = {};
+        double lastMs = 0.0;
+    };
+    std::string app;
+    std::chrono::steady_clock::time_point epoch;
+    bool initialized = false;
+    uint64_t frame = 0;
+    double frameStartUs = 0.0;
+    double frameMs = 0.0;
+    double gpuTotalMs = 0.0;
+
+    FrameCounters current;
+    FrameCounters last;
+
+    std::vector<ProfileEvent> frameCpuEvents; // 当前帧顶层 CPU 事件（叠加层使用）
+    std::vector<ProfileEvent> lastCpuEvents;
+
+    GpuPass gpuPasses[MAX_GPU_PASSES];
+    int gpuPassCount = 0;
+    int activeGpuPass = -1;
+
+    float frameHistory[HISTORY] = {};
+    float gpuHistory[HISTORY] = {};
+    int historyPos = 0;
+
+    // 累计统计（关闭时输出）
+    double totalFrameMs = 0.0;
+    uint64_t totalFrames = 0;
+
+    // 跟踪录制
+    std::mutex traceMutex;
+    std::vector<ProfileEvent> traceEvents;
+    std::vector<std::pair<double, FrameCounters>> traceCounters;
+    std::atomic<int> traceFramesLeft{ 0 };   // 主线程写，工作线程的 PROFILE_SCOPE 也会读
+    bool f1Down = false;
+    bool f2Down = false;
+
+    GpuPass* findOrCreatePass(const char* name);
+    void collectGpuResults();
+    void recordEvent(const ProfileEvent& e);
+    void updateTitle(GLFWwindow* window);
+
+    std::vector<OverlayPanelFn> overlayPanels;
+};
+
+extern Profiler gProfiler;
+
+// 将 glad 的函数指针替换为计数包装（init 内部调用）
+void installGLHooks(FrameCounters* counters);
+// 叠加层等内部绘制期间暂停计数
+void setGLHooksPaused(bool paused);
+// 叠加层色块：glScissor + glClear，只能在叠加层面板内调用（依赖其保存/恢复的状态）
+void fillOverlayRect(int x, int y, int w, int h, float r, float g, float b);
+
+// ================= 作用域计时 =================
+struct ProfileScope {
+    explicit ProfileScope(const char* name, bool gpu = false) : gpu(gpu) {
+        gProfiler.beginCpu(name);
+        if (gpu) gProfiler.beginGpu(name);
+    }
+    ~ProfileScope() {
+        if (gpu) gProfiler.endGpu();
+        gProfiler.endCpu();
+    }
+    bool gpu;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
@@ -0,0 +1,131 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class BenchmarkRun;
+
+// ================= 渲染队列统计 =================
+struct RenderQueueStats {
+    uint64_t frames = 0;
+    uint64_t packets = 0;
+    uint64_t stateChanges = 0;   // 整帧的状态切换（来自分析器的 GL 钩子），与 --immediate 对比
+    uint64_t programBinds = 0;   // 以下为队列实际发出的绑定
+    uint64_t textureBinds = 0;
+    uint64_t vaoBinds = 0;
+    uint64_t constantBinds = 0;
+    uint64_t materialApplies = 0;
+    uint64_t redundantSkipped = 0;   // 影子状态判定为冗余而省掉的绑定
+    double sortMs = 0.0;
+    double executeMs = 0.0;      // 排序 + 执行的 CPU 耗时
+};
+
+// ================= 纹理绑定 / 材质 =================
+struct TextureBinding {
+    GLuint unit = 0;
+    GLenum target = GL_TEXTURE_2D;
+    GLuint texture = 0;
+};
+
+// 材质：一组纹理绑定，外加可选的回调，用于设置不能简单表示为纹理绑定的状态（如虚拟纹理、大气 LUT 的 bind）
+// 回调在切换到该材质（或切换程序）时调用一次；回调里改了哪些纹理单元队列无从得知，之后纹理影子状态全部作废
+struct RenderMaterial {
+    static constexpr int MAX_TEXTURES = 4;
+    TextureBinding textures[MAX_TEXTURES];
+    int textureCount = 0;
+    void (*apply)(GLuint program, void* user) = nullptr;
+    void* user = nullptr;
+};
+
+// ================= 绘制包 =================
+struct DrawPacket {
+    uint64_t key = 0;            // submit 时生成
+    GLuint program = 0;
+    GLuint vao = 0;
+    uint16_t material = 0;       // addMaterial 的返回值，0 为无材质
+    GLenum mode = GL_TRIANGLES;
+    GLsizei count = 0;
+    GLenum indexType = 0;        // 0 为 glDrawArrays
+    size_t first = 0;            // glDrawArrays 的起始顶点，或索引缓冲内的字节偏移
+    GLint baseVertex = 0;        // 非 0 时用 glDrawElementsBaseVertex（多份网格共用一个大缓冲时的顶点偏移）
+    GLintptr drawConstants = -1; // DrawBlock 在流式缓冲中的位置（gStream.write 的返回值），-1 表示不绑定
+    GLsizeiptr drawConstantsSize = 0;
+    bool depthWrite = true;
+};
+
+// ================= 状态排序渲染队列 =================
+// 原来的渲染循环按代码顺序立即绘制，每个物体各自切程序、绑纹理、绑 VAO，画完再解绑，
+// 同一个程序 / 网格在一帧里被反复绑定；物体一多，状态切换比绘制本身还多。
+// 这里改为先收集、再排序、最后统一执行：
+//   - 每个绘制包带一个 64 位排序键，从高到低为：
+//       pass (4) | 程序 (8) | 材质 (12) | VAO (16) | 深度 (24)
+//     同一 pass 内相同程序、材质、VAO 的绘制排在一起；深度在最低位，只在状态完全相同时决定先后
+//     （不透明 pass 由近到远，利于 early-z；translucent 的 pass 深度取反，由远到近）
+//   - 程序 / VAO 的 GL 名字先映射成紧凑的序号再放进键里，名字很大也不会互相截断；
+//     映射表每次 execute 后清空，序号只在一批绘制包内有效。一批里超过 2^8 个程序 / 2^16 个 VAO 时序号回绕，
+//     只会让少数不同状态的绘制包排在一起（多几次绑定），不影响正确性
+//   - 每帧用 8 位一趟的 LSD 基数排序（稳定，O(n)），某一字节所有键都相同时跳过这一趟
+//   - 执行时维护一份 GL 状态的影子副本（程序、VAO、各纹理单元、活动单元、DrawBlock 区间、深度写入），
+//     与影子相同的绑定直接跳过；执行结束只把 VAO 解绑（之后的代码绑定 GL_ELEMENT_ARRAY_BUFFER 会改到当前 VAO），
+//     其余状态保留，下一次 execute 开始时影子作废，首个绘制包重新设置全部状态
+// 每次绘制的常量依赖流式缓冲（gStream.write 先写，执行时按偏移绑定），因此 --no-stream 时调用方应改用原来的立即绘制。
+// 用法：
+//   uint16_t mat = gRenderQueue.addMaterial(material);       // 初始化时注册
+//   每帧：gRenderQueue.submit(packet, pass, depth) ... gRenderQueue.execute();
+//   gRenderQueue.endFrame();                                  // 本帧最后一次绘制之后、gProfiler.endFrame 之前（--immediate 时也调用，统计状态切换）
+class RenderQueue {
+public:
+    static constexpr int PASS_BITS = 4;
+    static constexpr int PROGRAM_BITS = 8;
+    static constexpr int MATERIAL_BITS = 12;
+    static constexpr int VAO_BITS = 16;
+    static constexpr int DEPTH_BITS = 24;
+    static constexpr int MAX_TEXTURE_UNITS = 16;
+
+    uint16_t addMaterial(const RenderMaterial& material);
+
+    // depth 为到相机的距离，far 为其上限（量化到 DEPTH_BITS 位）；translucent 为 true 时由远到近
+    void submit(const DrawPacket& packet, int pass, float depth, float far, bool translucent = false);
+    void execute();
+    void endFrame();
+
+    void printStats(const char* app) const;
+
+    bool enabled = true;
+    RenderQueueStats stats;
+
+private:
+    struct SortItem {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    // GL 状态的影子副本；~0u 表示未知（执行开始或材质回调之后）
+    struct ShadowState {
+        GLuint program;
+        GLuint vao;
+        GLenum activeUnit;
+        GLuint textures[MAX_TEXTURE_UNITS];
+        GLintptr drawConstants;
+        bool depthWrite;
+        bool depthWriteKnown;
+        void reset();
+    };
+
+    static uint32_t compactId(std::unordered_map<GLuint, uint32_t>& ids, GLuint name);
+    void sortPackets();
+    void bindTexture(const TextureBinding& binding);
+
+    std::vector<DrawPacket> packets;
+    std::vector<SortItem> items, scratch;
+    std::vector<RenderMaterial> materials = std::vector<RenderMaterial>(1);   // 0 号为空材质
+    std::unordered_map<GLuint, uint32_t> programIds, vaoIds;   // GL 名字 → 本批内的紧凑序号
+    ShadowState shadow;
+};
+
+extern RenderQueue gRenderQueue;
+
+// 基准报告指标：render_queue_enabled、state_changes_per_frame、queue_packets_per_frame、queue_skipped_per_frame、queue_cpu_ms
+void addRenderQueueMetrics(BenchmarkRun& run, const RenderQueue& queue);
@@ -0,0 +1,78 @@
+#pragma once
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ================= 输入脚本 =================
+// 文本格式，每行一个事件，# 开头为注释：
+//   dt 0.0166667                 固定时间步长（秒）
+//   frames 600                   脚本总帧数
+//   <帧号> key <键名> down|up     键盘状态（键名：W/A/S/D/C/B/M/1/2/3/SPACE/LEFT_SHIFT/ESCAPE 或 GLFW 键码）
+//   <帧号> mouse <dx> <dy>        鼠标相对位移（与鼠标回调中的偏移同号：dy 向上为正）
+//   <帧号> scroll <dy>            滚轮
+//   <帧号> click <x> <y>          左键点击（窗口像素坐标）
+//   <帧号> camera <px> <py> <pz> <tx> <ty> <tz>   直接设置相机位置与注视点
+struct InputEvent {
+    enum Type { KEY, MOUSE, SCROLL, CLICK, CAMERA };
+    uint32_t frame;
+    Type type;
+    int key;
+    bool down;
+    float v[6];
+};
+
+class InputReplay {
+public:
+    bool load(const std::string& path);
+    // 应用当前帧的事件（键盘状态更新、回调触发），然后帧号 +1
+    void advance();
+    bool finished() const { return frame >= frames; }
+    bool keyDown(int key) const;
+
+    bool active = false;
+    double dt = 1.0 / 60.0;
+    uint32_t frames = 0;
+    uint32_t frame = 0;
+    double time() const { return frame * dt; }
+
+    std::function<void(float dx, float dy)> onMouse;
+    std::function<void(float dy)> onScroll;
+    std::function<void(float x, float y)> onClick;
+    std::function<void(const float* posTarget)> onCamera;
+
+private:
+    std::vector<InputEvent> events;
+    size_t cursor = 0;
+    bool keys[GLFW_KEY_LAST + 1] = {};
+};
+
+// ================= 输入录制 =================
+// 交互运行时按 F3 开始/停止录制，生成的脚本可直接用于 --bench 回放
+class InputRecorder {
+public:
+    // 交互模式每帧调用一次：处理 F3 快捷键，并记录受监视按键的状态变化
+    void update(GLFWwindow* window, const char* appName);
+    void toggle(const std::string& path);
+    void mouse(float dx, float dy);
+    void scroll(float dy);
+    void click(float x, float y);
+    bool recording() const { return active; }
+
+private:
+    bool active = false;
+    std::string path;
+    uint32_t frame = 0;
+    std::vector<std::string> lines;
+    bool keys[GLFW_KEY_LAST + 1] = {};
+    bool f3Down = false;
+
+    void flush();
+};
+
+extern InputReplay gReplay;
+extern InputRecorder gRecorder;
+
+// 回放时返回脚本中的按键状态，否则查询 GLFW
+bool inputKeyDown(GLFWwindow* window, int key);
@@ -0,0 +1,68 @@
+#pragma once
+#include <glad/glad.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ================= 着色器变体 =================
+// defines 会以 "#define 名称 值" 的形式插入到 #version 之后，同一份源码可编译出多个变体
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+struct ShaderDesc {
+    std::string name;            // 日志与缓存文件名使用
+    std::string vertexSource;
+    std::string fragmentSource;
+    ShaderDefines defines;
+    std::string computeSource;   // 非空时构建计算着色器程序，忽略顶点/片段源码
+};
+
+// ================= 着色器管理器 =================
+// 用法：
+//   gShaders.init("shader_cache");                        // GL 上下文创建之后
+//   auto programs = gShaders.buildAll({ descA, descB });  // 失败的程序返回 0
+//   ...渲染第一帧后...
+//   gShaders.reportStartup("blackhole");
+//
+// 程序二进制缓存：以 源码 + 变体宏 + GL_VENDOR/GL_RENDERER/GL_VERSION 的哈希为键，
+// 命中时 glProgramBinary 直接加载；驱动升级后二进制被拒绝时自动回退到源码编译并覆盖缓存。
+// 并行编译：先提交全部 glCompileShader/glLinkProgram，最后才查询状态，
+// 支持 GL_KHR_parallel_shader_compile 的驱动会在后台线程同时编译所有变体。
+class ShaderManager {
+public:
+    struct Stats {
+        int programs = 0;
+        int cacheHits = 0;
+        int compiled = 0;
+        int failed = 0;
+        double ms = 0.0;         // 累计在 build/buildAll 中花费的时间
+    };
+
+    void init(const std::string& cacheDir);
+    GLuint build(const ShaderDesc& desc);
+    std::vector<GLuint> buildAll(const std::vector<ShaderDesc>& descs);
+
+    // 输出从进程启动到调用时刻的耗时，并注明本次是冷启动（有变体需要编译）还是热启动（全部命中缓存）
+    void reportStartup(const char* app) const;
+    const Stats& stats() const { return totals; }
+
+    bool cacheEnabled = true;
+
+private:
+    std::string cacheDir;
+    std::string driverId;
+    bool binarySupported = false;
+    bool parallelCompile = false;
+    Stats totals;
+
+    uint64_t cacheKey(const ShaderDesc& desc) const;
+    std::string cachePath(const ShaderDesc& desc, uint64_t key) const;
+    GLuint loadBinary(const ShaderDesc& desc, uint64_t key) const;
+    void saveBinary(GLuint program, const ShaderDesc& desc, uint64_t key) const;
+};
+
+extern ShaderManager gShaders;
+
+// 读取着色器源文件，失败时输出路径并返回空串
+std::string loadShaderSource(const char* path);
+// 在 #version 行之后插入宏定义（没有 #version 时插入到开头）
+std::string injectDefines(const std::string& source, const ShaderDefines& defines);
@@ -0,0 +1,96 @@
+#pragma once
+#include <glad/glad.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+class BenchmarkRun;
+
+// ================= 流式上传统计 =================
+struct StreamStats {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;          // 累计写入（含对齐填充）
+    uint64_t pushes = 0;         // 累计绑定次数
+    uint64_t uniformCalls = 0;   // 累计 glUniform*（来自分析器的 GL 钩子），与 --no-stream 对比
+    double constantsMs = 0.0;    // 设置常量的 CPU 耗时（StreamConstantsScope 内，两种路径都统计）
+    uint64_t fenceWaits = 0;     // 回到某一段时围栏尚未完成的次数
+    double fenceWaitMs = 0.0;
+    uint32_t peakFrameBytes = 0;
+    uint64_t overflows = 0;      // 一帧写满后被丢弃的写入
+};
+
+// ================= 流式上传环形缓冲 =================
+// 每帧、每次绘制的常量（相机、模型矩阵、光照参数）写入一块持久映射的缓冲，再按偏移绑定到 uniform 块，代替逐个 glUniform：
+// 每个 glUniform 都要查位置、校验类型并把程序状态标脏，而且只作用于当前程序，同一份相机矩阵要给每个程序各设一遍；
+// 写入映射内存只是一次 memcpy，一次 glBindBufferRange 对之后所有程序都有效。
+//   - 缓冲分成 FRAMES 段，每帧写一段；帧末插入围栏，FRAMES 帧后回到这一段时先等围栏（GPU 落后不到 FRAMES 帧时不阻塞）
+//   - GL 4.4 / ARB_buffer_storage 可用时以 GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT 映射一次、一直写；
+//     否则每次写入退回 glBufferSubData，偏移与绑定方式不变
+//   - 写入按 GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT 对齐；一帧写满时后续写入失败并计数，不会覆盖 GPU 可能还在读的段
+// 用法：
+//   gStream.init(64 * 1024);                           // gladLoadGL 之后，参数为每帧最多写入的字节数
+//   StreamBuffer::bindBlocks(program);                 // 链接后一次：FrameBlock -> FRAME_BINDING，DrawBlock -> DRAW_BINDING
+//   while (...) {
+//       gStream.beginFrame();
+//       { StreamConstantsScope scope; gStream.pushUniform(StreamBuffer::FRAME_BINDING, frameConstants); }
+//       ... gStream.pushUniform(StreamBuffer::DRAW_BINDING, drawConstants); glDraw...;
+//       gStream.endFrame();                            // 本帧最后一次绘制之后、gProfiler.endFrame 之前
+//   }
+//   gStream.shutdown();
+// enabled 为 false（--no-stream）时不创建缓冲，调用方走原来的 glUniform 路径，beginFrame/endFrame 只做统计。
+// 着色器以 STREAM_UNIFORMS 宏区分两种声明方式，成员按 std140 排列，宿主侧结构体需逐字节一致。
+class StreamBuffer {
+public:
+    static constexpr int FRAMES = 3;
+    static constexpr GLuint FRAME_BINDING = 0;
+    static constexpr GLuint DRAW_BINDING = 1;
+
+    bool init(size_t bytesPerFrame);
+    void shutdown();
+
+    void beginFrame();
+    void endFrame();
+
+    // 写入并绑定到 GL_UNIFORM_BUFFER 的 binding，返回缓冲内的偏移；本帧空间不足时返回 -1 且不绑定
+    GLintptr pushUniform(GLuint binding, const void* data, size_t size);
+    template <class T>
+    GLintptr pushUniform(GLuint binding, const T& value) { return pushUniform(binding, &value, sizeof(T)); }
+
+    // 拆开的两步：只写入、返回偏移（失败为 -1），之后在真正绘制时再绑定（渲染队列先收集、排序，执行时才绑定）
+    GLintptr write(const void* data, size_t size);
+    template <class T>
+    GLintptr write(const T& value) { return write(&value, sizeof(T)); }
+    void bindRange(GLuint binding, GLintptr position, size_t size);
+
+    // 程序中存在 FrameBlock / DrawBlock 时分别指定到 FRAME_BINDING / DRAW_BINDING（GLSL 330 不能在着色器里写 binding）
+    static void bindBlocks(GLuint program);
+
+    void printStats(const char* app) const;
+
+    bool enabled = true;
+    bool persistent = false;     // 持久映射是否可用
+    StreamStats stats;
+
+private:
+    GLuint buffer = 0;
+    uint8_t* mapped = nullptr;
+    GLsync fences[FRAMES] = {};
+    GLsizeiptr segmentSize = 0;
+    GLintptr alignment = 256;
+    GLintptr head = 0;           // 当前段内的写入位置
+    int segment = 0;
+    bool overflowWarned = false;
+};
+
+extern StreamBuffer gStream;
+
+// ================= 常量设置计时 =================
+// 包住设置每帧/每次绘制常量的代码（不含绘制），耗时累加到 gStream.stats.constantsMs
+struct StreamConstantsScope {
+    StreamConstantsScope() : start(std::chrono::steady_clock::now()) {}
+    ~StreamConstantsScope();
+    std::chrono::steady_clock::time_point start;
+};
+
+// 基准报告指标：stream_enabled、uniform_calls_per_frame、constants_cpu_ms、stream_bytes_per_frame、stream_fence_wait_ms
+void addStreamMetrics(BenchmarkRun& run, const StreamBuffer& stream);
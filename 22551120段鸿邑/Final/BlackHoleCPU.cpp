@@ -0,0 +1,241 @@
+#include "blackhole_cpu.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+// ================= 常量（与 blackhole.frag 一致） =================
+static const float Rs = 1.0f;
+// exp(-4.5·h) < 0.001 时密度必然低于采样阈值，即 |y| > ln(1000) / 4.5 ≈ 1.535
+static const float DISK_HALF_HEIGHT = 1.54f;
+// 空域大步长上限（相对 STEP 的倍数），以及按 (r / SKIP_LENS_RADIUS)² 放大步长的参考半径
+static const float SKIP_MAX = 8.0f;
+static const float SKIP_LENS_RADIUS = 4.0f;
+// 吸积盘发光与视界衰减的参考步长（medium 档位）：按 h / REF_STEP 归一化，步长不同时亮度一致
+static const float REF_STEP = 0.02f;
+
+// GLSL smoothstep 允许 edge0 > edge1，这里保持相同公式
+static float smoothstepf(float e0, float e1, float x) {
+    float t = std::min(std::max((x - e0) / (e1 - e0), 0.0f), 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+static float fractf(float x) {
+    return x - std::floor(x);
+}
+
+// ================= HDR 星空 =================
+glm::vec3 starfield(const glm::vec3& d) {
+    float n = fractf(std::sin(d.x * 12.9898f + d.y * 78.233f) * 43758.5453f);
+    float stars = smoothstepf(0.997f, 1.0f, n);
+    return glm::vec3(stars * 5.5f);
+}
+
+// ================= 体积吸积盘 =================
+float diskVolume(const glm::vec3& p) {
+    float r = std::sqrt(p.x * p.x + p.z * p.z);
+    float h = std::fabs(p.y);
+    if (r < 1.8f || r > 7.0f) return 0.0f;
+
+    float thickness = std::exp(-h * 4.5f);
+    float radial = smoothstepf(7.0f, 1.8f, r);
+    return thickness * radial;
+}
+
+// 到盘体包围区域（|y| < DISK_HALF_HEIGHT 且 1.8 < r_xz < 7 的环形平板）的距离下界，区域内为负
+// 平板与圆环两个约束各自的距离取最大值，保证按这个距离前进不会越过盘体
+float diskBoundDistance(const glm::vec3& p) {
+    float r = std::sqrt(p.x * p.x + p.z * p.z);
+    float dy = std::fabs(p.y) - DISK_HALF_HEIGHT;
+    float dr = std::max(r - 7.0f, 1.8f - r);
+    return std::max(dy, dr);
+}
+
+// ================= 电影级多普勒 =================
+static glm::vec3 cinematicDoppler(float v) {
+    float intensity = 1.0f + v * 0.35f;
+    float warmth = v * 0.05f;
+
+    glm::vec3 warmBase(1.4f, 1.25f, 0.9f);
+    glm::vec3 warmTint(1.05f, 1.0f, 0.95f);
+
+    glm::vec3 col = warmBase * glm::mix(glm::vec3(1.0f), warmTint, warmth);
+    return col * intensity;
+}
+
+glm::vec3 traceBlackHole(const BlackHoleParams& params, glm::vec2 uv, TraceInfo* info) {
+    glm::vec2 p = uv * 2.0f - 1.0f;
+    p.x *= 1.6f;
+
+    glm::vec3 dir = glm::normalize(params.camRot * glm::vec3(p.x, p.y, -1.9f));
+    glm::vec3 pos = params.camPos;
+
+    glm::vec3 color(0.0f);
+    float fade = 1.0f;
+    const float STEP = params.step;
+    const float MAX_DIST = params.maxSteps * STEP;
+    float travelled = 0.0f;
+    int diskSteps = 0;
+
+    int i = 0;
+    for (; i < params.maxSteps; i++) {
+        float r = glm::length(pos);
+
+        // 空域跳跃：视界区外且远离盘体时，按到盘体的距离下界取大步长，只做透镜偏折；
+        // 偏折随 1/r² 衰减，步长同时受 (r/SKIP_LENS_RADIUS)² 限制，使每步偏折角不超过 r = 4 处小步长的偏折
+        float h = STEP;
+        bool inVolume = true;
+        if (params.skipEmpty) {
+            float d = diskBoundDistance(pos);
+            inVolume = d <= 0.0f;
+            if (r > Rs * 2.2f && d > STEP) {
+                float lensLimit = STEP * std::min(SKIP_MAX, r * r / (SKIP_LENS_RADIUS * SKIP_LENS_RADIUS));
+                h = std::max(STEP, std::min({ d, lensLimit, r - Rs * 2.2f }));
+            }
+            h = std::min(h, MAX_DIST - travelled);
+        }
+
+        // 事件视界反转区
+        float horizonFade = smoothstepf(Rs * 0.9f, Rs * 2.2f, r);
+        fade *= std::pow(glm::mix(0.92f, 1.0f, horizonFade), h / REF_STEP);
+
+        if (r < Rs * 2.2f) {
+            glm::vec3 inward = glm::normalize(pos);
+            dir = glm::normalize(glm::mix(-inward, dir, horizonFade));
+
+            float photon = (1.0f - horizonFade) * 6.0f;
+            dir += -inward * photon * STEP;
+        }
+
+        // 体积吸积盘
+        float density = inVolume ? diskVolume(pos) : 0.0f;
+        if (density > 0.001f) {
+            diskSteps++;
+            glm::vec3 diskCol;
+            if (params.diskLUT) {
+                float rd = std::sqrt(pos.x * pos.x + pos.z * pos.z);
+                diskCol = params.diskLUT->sample(rd, diskRedshift(pos, dir));
+            }
+            else {
+                glm::vec3 diskVel = glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), pos));
+                diskCol = cinematicDoppler(glm::dot(diskVel, dir));
+            }
+            color += diskCol * density * 0.045f * fade * (h / REF_STEP);
+        }
+
+        // 强引力透镜
+        float lens = Rs / (r * r);
+        lens *= 1.0f + 3.8f * std::exp(-r);
+
+        glm::vec3 gravity = -glm::normalize(pos) * lens;
+        dir += gravity * h;
+
+        // Kerr 帧拖拽
+        glm::vec3 frameDrag = params.spin * glm::cross(glm::normalize(pos), glm::vec3(0.0f, 1.0f, 0.0f)) / (r * r);
+        dir += frameDrag * h;
+
+        dir = glm::normalize(dir);
+        pos += dir * h;
+        travelled += h;
+
+        if (fade < 0.002f) { i++; break; }
+        if (params.skipEmpty && travelled >= MAX_DIST) { i++; break; }
+    }
+
+    if (info) {
+        info->steps = i;
+        info->diskSteps = diskSteps;
+        info->emission = color;
+        info->finalDir = dir;
+        info->fade = fade;
+    }
+    color += starfield(dir) * fade;
+    return color;
+}
+
+void renderBlackHoleCPU(const BlackHoleParams& params, int width, int height,
+                        std::vector<glm::vec3>& out, unsigned threads, std::vector<TraceInfo>* info) {
+    out.resize((size_t)width * height);
+    if (info) info->resize(out.size());
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // 按行动态分发：吸积盘/光子环附近的行远比纯星空昂贵
+    std::atomic<int> nextRow(0);
+    auto worker = [&]() {
+        for (int y = nextRow++; y < height; y = nextRow++) {
+            for (int x = 0; x < width; x++) {
+                // 与光栅化一致，取像素中心
+                glm::vec2 uv((x + 0.5f) / width, (y + 0.5f) / height);
+                size_t idx = (size_t)y * width + x;
+                out[idx] = traceBlackHole(params, uv, info ? &(*info)[idx] : nullptr);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+void renderBlackHoleTile(const BlackHoleParams& params, int width, int height,
+                         int x0, int y0, int tileW, int tileH, std::vector<glm::vec3>& out) {
+    out.resize((size_t)tileW * tileH);
+    for (int y = 0; y < tileH; y++) {
+        for (int x = 0; x < tileW; x++) {
+            // uv 按整帧计算，与 renderBlackHoleCPU 逐像素相同
+            glm::vec2 uv((x0 + x + 0.5f) / width, (y0 + y + 0.5f) / height);
+            out[(size_t)y * tileW + x] = traceBlackHole(params, uv);
+        }
+    }
+}
+
+SkipEquivalence measureSkipEquivalence(BlackHoleParams params, int width, int height) {
+    std::vector<glm::vec3> image;
+    std::vector<TraceInfo> before, after;
+    params.skipEmpty = false;
+    renderBlackHoleCPU(params, width, height, image, 0, &before);
+    params.skipEmpty = true;
+    renderBlackHoleCPU(params, width, height, image, 0, &after);
+
+    SkipEquivalence eq;
+    uint64_t stepsA = 0, stepsB = 0, diskA = 0, diskB = 0, visible = 0;
+    double squared = 0.0, angle = 0.0;
+    for (size_t i = 0; i < before.size(); i++) {
+        const TraceInfo& a = before[i];
+        const TraceInfo& b = after[i];
+        stepsA += a.steps;
+        stepsB += b.steps;
+        diskA += a.diskSteps;
+        diskB += b.diskSteps;
+
+        glm::vec3 e = a.emission - b.emission;
+        eq.emissionMaxError = std::max(eq.emissionMaxError,
+            (double)std::max({ std::fabs(e.x), std::fabs(e.y), std::fabs(e.z) }));
+        glm::vec3 c = glm::clamp(a.emission, 0.0f, 1.0f) - glm::clamp(b.emission, 0.0f, 1.0f);
+        squared += (c.x * c.x + c.y * c.y + c.z * c.z) / 3.0;
+        if (glm::length(c) > 3.0f / 255.0f) visible++;
+        angle += std::acos(std::min(1.0f, glm::dot(a.finalDir, b.finalDir)));
+    }
+
+    double n = (double)before.size();
+    eq.meanStepsBefore = stepsA / n;
+    eq.meanStepsAfter = stepsB / n;
+    eq.diskFractionBefore = stepsA ? (double)diskA / stepsA : 0.0;
+    eq.diskFractionAfter = stepsB ? (double)diskB / stepsB : 0.0;
+    double mse = squared / n;
+    eq.emissionPSNR = mse > 0.0 ? 10.0 * std::log10(1.0 / mse) : 99.0;
+    eq.visibleFraction = visible / n;
+    eq.meanDirError = angle / n;
+    return eq;
+}
+
+void convertToRGB8(const std::vector<glm::vec3>& hdr, std::vector<unsigned char>& rgb) {
+    rgb.resize(hdr.size() * 3);
+    for (size_t i = 0; i < hdr.size(); i++) {
+        for (int c = 0; c < 3; c++) {
+            float v = std::min(std::max(hdr[i][c], 0.0f), 1.0f);
+            rgb[i * 3 + c] = (unsigned char)(v * 255.0f + 0.5f);
+        }
+    }
+}
@@ -0,0 +1,224 @@
+#include "blackhole_compute.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+// ================= 占用率统计 =================
+MarchOccupancy analyzeMarchOccupancy(const std::vector<uint32_t>& steps, int width, int height,
+                                     int waveSteps, int maxSteps, int laneWidth) {
+    MarchOccupancy occ;
+    if (steps.empty() || width <= 0 || height <= 0) return occ;
+
+    for (uint32_t s : steps) occ.raySteps += s;
+    occ.meanSteps = (double)occ.raySteps / steps.size();
+
+    // 全屏四边形：8×4 像素块内最慢的光线决定整块的执行时间
+    const int tileW = 8;
+    const int tileH = std::max(1, laneWidth / tileW);
+    double laneSteps = 0.0;
+    for (int ty = 0; ty < height; ty += tileH) {
+        for (int tx = 0; tx < width; tx += tileW) {
+            uint32_t maxS = 0;
+            int pixels = 0;
+            for (int y = ty; y < std::min(ty + tileH, height); y++) {
+                for (int x = tx; x < std::min(tx + tileW, width); x++) {
+                    maxS = std::max(maxS, steps[(size_t)y * width + x]);
+                    pixels++;
+                }
+            }
+            laneSteps += (double)maxS * pixels;
+        }
+    }
+    occ.fragmentLaneUtil = laneSteps > 0.0 ? occ.raySteps / laneSteps : 0.0;
+
+    // 波前：第 w 波开始时仍存活的光线是步数 > w×K 的光线，压缩后按 laneWidth 个一组执行 K 步
+    int waves = (maxSteps + waveSteps - 1) / waveSteps;
+    double waveLaneSteps = 0.0;
+    for (int w = 0; w < waves; w++) {
+        uint32_t begin = (uint32_t)(w * waveSteps);
+        uint64_t alive = 0;
+        for (uint32_t s : steps) alive += s > begin ? 1 : 0;
+        occ.waveAlive.push_back((uint32_t)alive);
+        if (alive == 0) continue;
+        occ.waves++;
+        uint64_t groups = (alive + laneWidth - 1) / laneWidth;
+        waveLaneSteps += (double)groups * laneWidth * waveSteps;
+    }
+    occ.computeLaneUtil = waveLaneSteps > 0.0 ? occ.raySteps / waveLaneSteps : 0.0;
+    return occ;
+}
+
+// ================= 初始化 =================
+bool BlackHoleCompute::supported() {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    return major > 4 || (major == 4 && minor >= 3);
+}
+
+bool BlackHoleCompute::init(const std::vector<ShaderDefines>& tierDefines, int k) {
+    waveSteps = std::max(1, k);
+    std::string source = loadShaderSource("Shaders/blackhole_march.comp");
+    if (source.empty()) return false;
+
+    std::vector<ShaderDesc> descs;
+    for (size_t t = 0; t < tierDefines.size(); t++) {
+        ShaderDefines defines = tierDefines[t];
+        defines.push_back({ "WAVE_STEPS", std::to_string(waveSteps) });
+        ShaderDefines raygen = defines;
+        raygen.push_back({ "RAYGEN", "1" });
+        descs.push_back({ "blackhole_raygen_" + std::to_string(t), "", "", raygen, source });
+        descs.push_back({ "blackhole_march_" + std::to_string(t), "", "", defines, source });
+    }
+    std::vector<GLuint> programs = gShaders.buildAll(descs);
+
+    tiers.clear();
+    int maxWaves = 0;
+    for (size_t t = 0; t < tierDefines.size(); t++) {
+        TierPrograms tp;
+        tp.raygen = programs[t * 2];
+        tp.march = programs[t * 2 + 1];
+        if (!tp.raygen || !tp.march) return false;
+        for (const auto& d : tierDefines[t]) {
+            if (d.first == "MAX_STEPS") tp.maxSteps = std::atoi(d.second.c_str());
+        }
+        if (tp.maxSteps <= 0) tp.maxSteps = 720;
+        tiers.push_back(tp);
+        maxWaves = std::max(maxWaves, waveCount((int)t));
+    }
+
+    // counters[0..3]：两个队列的长度与领取游标；之后为每波存活数
+    glGenBuffers(1, &counterBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (4 + maxWaves) * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+    glGenFramebuffers(1, &readFbo);
+    return true;
+}
+
+void BlackHoleCompute::destroy() {
+    for (const auto& t : tiers) {
+        glDeleteProgram(t.raygen);
+        glDeleteProgram(t.march);
+    }
+    tiers.clear();
+    glDeleteBuffers(1, &rayBuffer);
+    glDeleteBuffers(2, queues);
+    glDeleteBuffers(1, &counterBuffer);
+    glDeleteBuffers(1, &stepBuffer);
+    glDeleteBuffers(1, &diffBuffer);
+    glDeleteTextures(1, &image);
+    glDeleteFramebuffers(1, &readFbo);
+    rayBuffer = counterBuffer = stepBuffer = diffBuffer = image = readFbo = 0;
+    queues[0] = queues[1] = 0;
+    width = height = 0;
+}
+
+void BlackHoleCompute::resize(int w, int h) {
+    if (w == width && h == height) return;
+    width = w;
+    height = h;
+    size_t pixels = (size_t)w * h;
+
+    auto allocate = [](GLuint& buffer, size_t bytes) {
+        if (!buffer) glGenBuffers(1, &buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, nullptr, GL_DYNAMIC_COPY);
+    };
+    allocate(rayBuffer, pixels * sizeof(float) * 12);
+    allocate(queues[0], pixels * sizeof(GLuint));
+    allocate(queues[1], pixels * sizeof(GLuint));
+    allocate(stepBuffer, pixels * sizeof(GLuint));
+    if (skyCube) allocate(diffBuffer, pixels * sizeof(float) * 16);
+
+    if (image) glDeleteTextures(1, &image);
+    glGenTextures(1, &image);
+    glBindTexture(GL_TEXTURE_2D, image);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, w, h);
+
+    GLint drawFbo = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFbo);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, image, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFbo);
+}
+
+// ================= 渲染 =================
+void BlackHoleCompute::render(const glm::vec3& camPos, const glm::mat3& camRot, float spin, int tier, int w, int h) {
+    resize(w, h);
+    lastTier = tier;
+    const TierPrograms& tp = tiers[tier];
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, rayBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, queues[0]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, queues[1]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, counterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, stepBuffer);
+    if (diffBuffer) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, diffBuffer);
+    glBindImageTexture(0, image, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+    // 队列 A 初始长度为全部像素，其余计数清零
+    GLuint init[4] = { (GLuint)(w * h), 0, 0, 0 };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(init), init);
+
+    // 1. 生成光线
+    glUseProgram(tp.raygen);
+    glUniform2i(glGetUniformLocation(tp.raygen, "size"), w, h);
+    glUniform3fv(glGetUniformLocation(tp.raygen, "camPos"), 1, &camPos[0]);
+    glUniformMatrix3fv(glGetUniformLocation(tp.raygen, "camRot"), 1, GL_FALSE, &camRot[0][0]);
+    glDispatchCompute((w + 7) / 8, (h + 7) / 8, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // 2. 波前步进：每波读一个队列、写另一个队列
+    glUseProgram(tp.march);
+    glUniform2i(glGetUniformLocation(tp.march, "size"), w, h);
+    glUniform1f(glGetUniformLocation(tp.march, "spin"), spin);
+    if (diskLut) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, diskLut);
+        glActiveTexture(GL_TEXTURE0);
+        glUniform1i(glGetUniformLocation(tp.march, "diskLUT"), 1);
+    }
+    if (skyCube) {
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, skyCube);
+        glActiveTexture(GL_TEXTURE0);
+        glUniform1i(glGetUniformLocation(tp.march, "skyCube"), 2);
+        glUniform1f(glGetUniformLocation(tp.march, "skyTexelAngle"), skyTexelAngle);
+        glUniform1f(glGetUniformLocation(tp.march, "skyMaxLod"), skyMaxLod);
+    }
+    GLint inQueueLoc = glGetUniformLocation(tp.march, "inQueue");
+    GLint waveLoc = glGetUniformLocation(tp.march, "wave");
+    const GLuint zero[2] = { 0, 0 };
+    for (int wave = 0; wave < waveCount(tier); wave++) {
+        int in = wave & 1;
+        // 清空输出队列的长度与游标（上一波把它作为输入用过）
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, (1 - in) * 2 * sizeof(GLuint), sizeof(zero), zero);
+        glUniform1i(inQueueLoc, in);
+        glUniform1i(waveLoc, wave);
+        glDispatchCompute(PERSISTENT_GROUPS, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    }
+
+    // 3. 结果写到当前绘制帧缓冲
+    glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
+    glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+MarchOccupancy BlackHoleCompute::readOccupancy() const {
+    std::vector<uint32_t> steps((size_t)width * height);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stepBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, steps.size() * sizeof(uint32_t), steps.data());
+
+    MarchOccupancy occ = analyzeMarchOccupancy(steps, width, height, waveSteps, tiers[lastTier].maxSteps);
+
+    // 用 GPU 实际记录的每波存活数替换推算值，两者应一致
+    std::vector<uint32_t> alive(waveCount(lastTier));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 4 * sizeof(GLuint), alive.size() * sizeof(uint32_t), alive.data());
+    if (alive != occ.waveAlive) std::cout << "[compute] 警告：GPU 记录的存活数与步数推算不一致" << std::endl;
+    occ.waveAlive = alive;
+    return occ;
+}
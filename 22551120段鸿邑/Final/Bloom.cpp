@@ -0,0 +1,384 @@
+#include "bloom.h"
+#include "../Common/shadermanager.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+// 第 i 级（0 为 1/2）的尺寸，GPU 的分配尺寸与有效区域、CPU 的图像都按这个取整
+int levelSize(int size, int level) {
+    return std::max(1, size >> (level + 1));
+}
+
+int clampLevels(int levels) {
+    return std::min(std::max(levels, Bloom::MIN_LEVELS), Bloom::MAX_LEVELS);
+}
+
+// 源纹理的有效区域与 texel 尺寸；采样器固定在 0 号单元（init 中设置）
+void bindSource(GLuint program, GLuint texture, int allocW, int allocH, int validW, int validH) {
+    glUseProgram(program);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform2f(glGetUniformLocation(program, "sourceScale"), (float)validW / allocW, (float)validH / allocH);
+    glUniform2f(glGetUniformLocation(program, "texelSize"), 1.0f / allocW, 1.0f / allocH);
+}
+
+void drawInto(GLuint fbo, int w, int h) {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, w, h);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+} // namespace
+
+bool applyBloomTier(const char* name, BloomSettings& settings) {
+    // 级数决定光晕半径与通道数，光芒遍数决定拉丝长度（1/4 分辨率下约 4^遍数 个 texel）
+    static const struct { const char* name; int levels; int streakPasses; } TIERS[] = {
+        { "low", 2, 2 },
+        { "medium", 4, 3 },
+        { "high", 6, 4 },
+    };
+    for (const auto& t : TIERS) {
+        if (strcmp(name, t.name) != 0) continue;
+        settings.tier = t.name;
+        settings.levels = t.levels;
+        settings.streakPasses = t.streakPasses;
+        return true;
+    }
+    return false;
+}
+
+// ================= 初始化 =================
+bool Bloom::init(int w, int h, const BloomSettings& s) {
+    settings = s;
+    settings.levels = clampLevels(s.levels);
+    width = w;
+    height = h;
+
+    auto createLevel = [](Level& level, int lw, int lh) {
+        level.width = lw;
+        level.height = lh;
+        glGenTextures(1, &level.texture);
+        glBindTexture(GL_TEXTURE_2D, level.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, lw, lh, 0, GL_RGB, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glGenFramebuffers(1, &level.fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, level.fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, level.texture, 0);
+        return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    };
+    bool complete = true;
+    levels.resize(settings.levels);
+    for (int i = 0; i < settings.levels; i++) complete &= createLevel(levels[i], levelSize(width, i), levelSize(height, i));
+    if (settings.streak) {
+        const Level& source = levels[1];
+        for (Level& l : streak) complete &= createLevel(l, source.width, source.height);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        std::cout << "[bloom] 金字塔帧缓冲不完整\n";
+        return false;
+    }
+
+    std::string vs = loadShaderSource("Shaders/fullscreen.vert");
+    std::string down = loadShaderSource("Shaders/bloom_downsample.frag");
+    std::string up = loadShaderSource("Shaders/bloom_upsample.frag");
+    std::vector<GLuint> programs = gShaders.buildAll({
+        { "bloom_prefilter", vs, down, { { "PREFILTER", "1" } } },
+        { "bloom_downsample", vs, down, {} },
+        { "bloom_upsample", vs, up, {} },
+        { "bloom_composite", vs, up, { { "COMPOSITE", "1" } } },
+        { "bloom_streak", vs, loadShaderSource("Shaders/bloom_streak.frag"), {} } });
+    prefilterProgram = programs[0];
+    downsampleProgram = programs[1];
+    upsampleProgram = programs[2];
+    compositeProgram = programs[3];
+    streakProgram = programs[4];
+    for (GLuint p : programs) {
+        if (p == 0) return false;
+    }
+
+    // 采样器单元与设置项是程序状态，设置一次
+    for (GLuint p : programs) {
+        glUseProgram(p);
+        glUniform1i(glGetUniformLocation(p, "source"), 0);
+    }
+    glUseProgram(prefilterProgram);
+    glUniform1f(glGetUniformLocation(prefilterProgram, "threshold"), settings.threshold);
+    glUniform1f(glGetUniformLocation(prefilterProgram, "knee"), std::max(settings.knee, 1e-4f));
+    glUseProgram(compositeProgram);
+    glUniform1f(glGetUniformLocation(compositeProgram, "intensity"), settings.intensity / settings.levels);
+    glUniform1i(glGetUniformLocation(compositeProgram, "streakTex"), 1);
+    glm::vec3 streakColor = settings.streak ? settings.streakIntensity * settings.streakTint : glm::vec3(0.0f);
+    glUniform3fv(glGetUniformLocation(compositeProgram, "streakColor"), 1, &streakColor[0]);
+    glUseProgram(streakProgram);
+    glUniform1f(glGetUniformLocation(streakProgram, "falloff"), settings.streakFalloff);
+    glUseProgram(0);
+
+    std::cout << "[bloom] " << settings.tier << "：" << settings.levels << " 级，最小 "
+              << levels.back().width << "×" << levels.back().height << "，阈值 " << settings.threshold
+              << (settings.streak ? "，横向光芒 " + std::to_string(settings.streakPasses) + " 遍" : std::string()) << std::endl;
+    return true;
+}
+
+void Bloom::destroy() {
+    for (Level& l : levels) {
+        glDeleteFramebuffers(1, &l.fbo);
+        glDeleteTextures(1, &l.texture);
+    }
+    for (Level& l : streak) {
+        glDeleteFramebuffers(1, &l.fbo);
+        glDeleteTextures(1, &l.texture);
+        l = Level();
+    }
+    levels.clear();
+    glDeleteProgram(prefilterProgram);
+    glDeleteProgram(downsampleProgram);
+    glDeleteProgram(upsampleProgram);
+    glDeleteProgram(compositeProgram);
+    glDeleteProgram(streakProgram);
+    prefilterProgram = downsampleProgram = upsampleProgram = compositeProgram = streakProgram = 0;
+}
+
+// ================= 每帧 =================
+void Bloom::apply(GLuint sceneTexture, GLuint sceneFbo, int renderW, int renderH, GLuint vao) {
+    int count = (int)levels.size();
+    glBindVertexArray(vao);
+    glActiveTexture(GL_TEXTURE0);
+    glDisable(GL_BLEND);
+
+    // 1-2. 阈值 + 逐级下采样
+    for (int i = 0; i < count; i++) {
+        if (i == 0) bindSource(prefilterProgram, sceneTexture, width, height, renderW, renderH);
+        else bindSource(downsampleProgram, levels[i - 1].texture, levels[i - 1].width, levels[i - 1].height,
+                        levelSize(renderW, i - 1), levelSize(renderH, i - 1));
+        drawInto(levels[i].fbo, levelSize(renderW, i), levelSize(renderH, i));
+    }
+
+    // 3. 横向光芒：在升采样改写第 1 级之前，从它开始来回两张纹理
+    const Level* streakResult = nullptr;
+    if (settings.streak) {
+        int sw = levelSize(renderW, 1), sh = levelSize(renderH, 1);
+        streakResult = &levels[1];
+        for (int p = 0; p < settings.streakPasses; p++) {
+            const Level& target = streak[p % 2];
+            bindSource(streakProgram, streakResult->texture, streakResult->width, streakResult->height, sw, sh);
+            glUniform1f(glGetUniformLocation(streakProgram, "stepTexels"), std::pow(4.0f, (float)p));
+            drawInto(target.fbo, sw, sh);
+            streakResult = &target;
+        }
+    }
+
+    // 4. 逐级升采样，加法混合到上一级
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    for (int i = count - 2; i >= 0; i--) {
+        bindSource(upsampleProgram, levels[i + 1].texture, levels[i + 1].width, levels[i + 1].height,
+                   levelSize(renderW, i + 1), levelSize(renderH, i + 1));
+        drawInto(levels[i].fbo, levelSize(renderW, i), levelSize(renderH, i));
+    }
+
+    // 5. 加回场景；没有光芒时 streakColor 为 0，1 号单元随便绑一张有效纹理
+    bindSource(compositeProgram, levels[0].texture, levels[0].width, levels[0].height,
+               levelSize(renderW, 0), levelSize(renderH, 0));
+    const Level& s = streakResult ? *streakResult : levels[0];
+    int sw = streakResult ? levelSize(renderW, 1) : levelSize(renderW, 0);
+    int sh = streakResult ? levelSize(renderH, 1) : levelSize(renderH, 0);
+    glUniform2f(glGetUniformLocation(compositeProgram, "streakScale"), (float)sw / s.width, (float)sh / s.height);
+    glUniform2f(glGetUniformLocation(compositeProgram, "streakTexel"), 1.0f / s.width, 1.0f / s.height);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, s.texture);
+    glActiveTexture(GL_TEXTURE0);
+    drawInto(sceneFbo, renderW, renderH);
+    glDisable(GL_BLEND);
+}
+
+void Bloom::recordGpuMs(double ms) {
+    if (ms < 0.0) return;
+    gpuMsSum += ms;
+    samples++;
+}
+
+void Bloom::printSummary() const {
+    std::cout << "[bloom] " << settings.tier << "（" << settings.levels << " 级" << (settings.streak ? "，横向光芒" : "")
+              << "）：平均 GPU " << meanGpuMs() << " ms（" << samples << " 帧有 GPU 计时）" << std::endl;
+}
+
+// ================= CPU 比对 =================
+double Bloom::verifyAgainstCPU(GLuint sceneTexture, GLuint vao) {
+    size_t count = (size_t)width * height;
+    std::vector<float> rgba(count * 4);
+    glBindTexture(GL_TEXTURE_2D, sceneTexture);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, rgba.data());
+    std::vector<glm::vec3> input(count);
+    for (size_t i = 0; i < count; i++) input[i] = glm::vec3(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2]);
+
+    // GPU：在 RGBA32F 副本上跑一遍，不改动场景
+    GLuint texture = 0, fbo = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, rgba.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    apply(texture, fbo, width, height, vao);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, rgba.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &texture);
+
+    // 只比较 bloom 增量，场景本身两边相同
+    std::vector<glm::vec3> expected = input;
+    applyBloomCPU(expected, width, height, settings);
+    double mse = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        for (int c = 0; c < 3; c++) {
+            double gpu = std::min(std::max(rgba[i * 4 + c] - input[i][c], 0.0f), 1.0f);
+            double cpu = std::min(std::max(expected[i][c] - input[i][c], 0.0f), 1.0f);
+            mse += (gpu - cpu) * (gpu - cpu);
+        }
+    }
+    mse /= (double)count * 3.0;
+    return mse > 0.0 ? 10.0 * std::log10(1.0 / mse) : 99.0;
+}
+
+// ================= CPU 实现 =================
+// 与三个着色器逐行对应。CPU 图像即有效区域（不需要 sourceScale），uv 为像素中心
+namespace {
+
+struct BloomImage {
+    int width = 0;
+    int height = 0;
+    std::vector<glm::vec3> pixels;
+};
+
+// 与 textureLod 的双线性过滤一致：坐标先限制在半个 texel 以内
+glm::vec3 sampleBilinear(const BloomImage& image, glm::vec2 p) {
+    glm::vec2 texel(1.0f / image.width, 1.0f / image.height);
+    p = glm::clamp(p, 0.5f * texel, glm::vec2(1.0f) - 0.5f * texel);
+    float x = p.x * image.width - 0.5f;
+    float y = p.y * image.height - 0.5f;
+    int x0 = (int)std::floor(x), y0 = (int)std::floor(y);
+    float fx = x - x0, fy = y - y0;
+    int x1 = std::min(x0 + 1, image.width - 1), y1 = std::min(y0 + 1, image.height - 1);
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    const glm::vec3* row0 = &image.pixels[(size_t)y0 * image.width];
+    const glm::vec3* row1 = &image.pixels[(size_t)y1 * image.width];
+    return glm::mix(glm::mix(row0[x0], row0[x1], fx), glm::mix(row1[x0], row1[x1], fx), fy);
+}
+
+glm::vec3 prefilter(glm::vec3 c, const BloomSettings& s) {
+    const float MAX_HDR = 1.0e4f;
+    float knee = std::max(s.knee, 1e-4f);
+    c = glm::min(c, glm::vec3(MAX_HDR));
+    float b = std::max(c.x, std::max(c.y, c.z));
+    float soft = std::min(std::max(b - s.threshold + knee, 0.0f), 2.0f * knee);
+    soft = soft * soft / (4.0f * knee + 1e-4f);
+    return c * (std::max(soft, b - s.threshold) / std::max(b, 1e-4f));
+}
+
+// 对 w × h 的目标逐像素求值，shade 的参数为像素中心 uv
+template <typename Shade>
+BloomImage renderPass(int w, int h, Shade shade) {
+    BloomImage out;
+    out.width = w;
+    out.height = h;
+    out.pixels.resize((size_t)w * h);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) out.pixels[(size_t)y * w + x] = shade(glm::vec2((x + 0.5f) / w, (y + 0.5f) / h));
+    }
+    return out;
+}
+
+// bloom_upsample.frag 的 tent 滤波
+glm::vec3 tent(const BloomImage& source, glm::vec2 p) {
+    glm::vec2 t(1.0f / source.width, 1.0f / source.height);
+    glm::vec3 sum = sampleBilinear(source, p + glm::vec2(-t.x, 0.0f)) + sampleBilinear(source, p + glm::vec2(t.x, 0.0f))
+                  + sampleBilinear(source, p + glm::vec2(0.0f, -t.y)) + sampleBilinear(source, p + glm::vec2(0.0f, t.y));
+    sum += 2.0f * (sampleBilinear(source, p + 0.5f * glm::vec2(-t.x, -t.y)) + sampleBilinear(source, p + 0.5f * glm::vec2(t.x, -t.y))
+                 + sampleBilinear(source, p + 0.5f * glm::vec2(-t.x, t.y)) + sampleBilinear(source, p + 0.5f * glm::vec2(t.x, t.y)));
+    return sum / 12.0f;
+}
+
+} // namespace
+
+void applyBloomCPU(std::vector<glm::vec3>& image, int width, int height, const BloomSettings& settings) {
+    int count = clampLevels(settings.levels);
+    BloomImage scene;
+    scene.width = width;
+    scene.height = height;
+    scene.pixels.swap(image);
+
+    // 1-2. 阈值 + 逐级下采样
+    std::vector<BloomImage> levels;
+    for (int i = 0; i < count; i++) {
+        const BloomImage& source = i ? levels[i - 1] : scene;
+        bool first = i == 0;
+        glm::vec2 t(1.0f / source.width, 1.0f / source.height);
+        auto fetch = [&](glm::vec2 p) {
+            glm::vec3 c = sampleBilinear(source, p);
+            return first ? prefilter(c, settings) : c;
+        };
+        levels.push_back(renderPass(levelSize(width, i), levelSize(height, i), [&](glm::vec2 p) {
+            glm::vec3 sum = fetch(p) * 4.0f;
+            sum += fetch(p + glm::vec2(-t.x, -t.y));
+            sum += fetch(p + glm::vec2(t.x, -t.y));
+            sum += fetch(p + glm::vec2(-t.x, t.y));
+            sum += fetch(p + glm::vec2(t.x, t.y));
+            return sum / 8.0f;
+        }));
+    }
+
+    // 3. 横向光芒
+    BloomImage streak;
+    if (settings.streak) {
+        streak = levels[1];
+        for (int pass = 0; pass < settings.streakPasses; pass++) {
+            float step = std::pow(4.0f, (float)pass);
+            float texel = 1.0f / streak.width;
+            streak = renderPass(streak.width, streak.height, [&](glm::vec2 p) {
+                glm::vec3 sum(0.0f);
+                float total = 0.0f;
+                for (int k = -3; k <= 3; k++) {
+                    float w = std::pow(settings.streakFalloff, std::abs((float)k) * step);
+                    sum += sampleBilinear(streak, p + glm::vec2((float)k * step * texel, 0.0f)) * w;
+                    total += w;
+                }
+                return sum / total;
+            });
+        }
+    }
+
+    // 4. 逐级升采样，加到上一级
+    for (int i = count - 2; i >= 0; i--) {
+        const BloomImage& source = levels[i + 1];
+        BloomImage up = renderPass(levels[i].width, levels[i].height, [&](glm::vec2 p) { return tent(source, p); });
+        for (size_t k = 0; k < up.pixels.size(); k++) levels[i].pixels[k] += up.pixels[k];
+    }
+
+    // 5. 加回场景
+    float intensity = settings.intensity / count;
+    glm::vec3 streakColor = settings.streakIntensity * settings.streakTint;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            glm::vec2 uv((x + 0.5f) / width, (y + 0.5f) / height);
+            glm::vec3 c = tent(levels[0], uv) * intensity;
+            if (settings.streak) c += streakColor * sampleBilinear(streak, uv);
+            scene.pixels[(size_t)y * width + x] += c;
+        }
+    }
+    image.swap(scene.pixels);
+}
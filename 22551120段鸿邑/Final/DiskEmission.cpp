@@ -0,0 +1,140 @@
+#include "disk_emission.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+static const float Rs = 1.0f;
+
+// ================= CIE 1931 色匹配函数 =================
+// Wyman, Sloan, Shirley 2013 的多瓣高斯拟合，λ 单位为 nm
+static double lobe(double x, double mu, double s1, double s2) {
+    double t = (x - mu) / (x < mu ? s1 : s2);
+    return std::exp(-0.5 * t * t);
+}
+
+static glm::dvec3 cieXYZ(double lambda) {
+    double x = 1.056 * lobe(lambda, 599.8, 37.9, 31.0) + 0.362 * lobe(lambda, 442.0, 16.0, 26.7)
+             - 0.065 * lobe(lambda, 501.1, 20.4, 26.2);
+    double y = 0.821 * lobe(lambda, 568.8, 46.9, 40.5) + 0.286 * lobe(lambda, 530.9, 16.3, 31.1);
+    double z = 1.217 * lobe(lambda, 437.0, 11.8, 36.0) + 0.681 * lobe(lambda, 459.0, 26.0, 13.8);
+    return glm::dvec3(x, y, z);
+}
+
+// 普朗克定律，λ 单位为 nm，只需相对值
+static double planck(double lambda, double temperature) {
+    const double c2 = 1.4387769e7;   // hc/k，单位 nm·K
+    double l = lambda * 1e-3;        // 转成 μm 避免 λ⁵ 下溢
+    return 1.0 / (l * l * l * l * l * (std::exp(c2 / (lambda * temperature)) - 1.0));
+}
+
+glm::vec3 blackbodyRGB(float temperature) {
+    glm::dvec3 xyz(0.0);
+    for (double lambda = 380.0; lambda <= 780.0; lambda += 5.0) {
+        xyz += cieXYZ(lambda) * planck(lambda, temperature);
+    }
+    // XYZ → 线性 sRGB（D65），低温时的负分量截断为 0
+    glm::vec3 rgb(
+        (float)(3.2406 * xyz.x - 1.5372 * xyz.y - 0.4986 * xyz.z),
+        (float)(-0.9689 * xyz.x + 1.8758 * xyz.y + 0.0415 * xyz.z),
+        (float)(0.0557 * xyz.x - 0.2040 * xyz.y + 1.0570 * xyz.z));
+    return glm::max(rgb, glm::vec3(0.0f));
+}
+
+static float luminance(const glm::vec3& c) {
+    return 0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z;
+}
+
+// ================= 建表 =================
+void DiskEmissionLUT::build() {
+    auto start = std::chrono::steady_clock::now();
+    texels.resize((size_t)RADIUS_SIZE * G_SIZE);
+    for (int x = 0; x < RADIUS_SIZE; x++) {
+        float r = R_MIN + (R_MAX - R_MIN) * x / (RADIUS_SIZE - 1);
+        float temperature = INNER_TEMPERATURE * std::pow(r / R_MIN, -0.75f);
+        float norm = BRIGHTNESS / luminance(blackbodyRGB(temperature));
+        for (int y = 0; y < G_SIZE; y++) {
+            float g = G_MIN + (G_MAX - G_MIN) * y / (G_SIZE - 1);
+            texels[(size_t)y * RADIUS_SIZE + x] = blackbodyRGB(g * temperature) * norm;
+        }
+    }
+    buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// ================= 磁盘缓存 =================
+// 文件头记录表尺寸与全部建表参数，任何一项改变都会使缓存失效
+static const uint32_t LUT_MAGIC = 0x54554C44;   // "DLUT"
+static const uint32_t LUT_VERSION = 1;
+
+static std::vector<float> lutHeader() {
+    return { (float)DiskEmissionLUT::RADIUS_SIZE, (float)DiskEmissionLUT::G_SIZE,
+             DiskEmissionLUT::R_MIN, DiskEmissionLUT::R_MAX, DiskEmissionLUT::G_MIN, DiskEmissionLUT::G_MAX,
+             DiskEmissionLUT::INNER_TEMPERATURE, DiskEmissionLUT::BRIGHTNESS };
+}
+
+void DiskEmissionLUT::loadOrBuild(const std::string& cachePath) {
+    fromCache = false;
+    if (!cachePath.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        std::ifstream f(cachePath, std::ios::binary);
+        uint32_t magic = 0, version = 0;
+        std::vector<float> header = lutHeader();
+        std::vector<float> stored(header.size());
+        f.read((char*)&magic, sizeof(magic));
+        f.read((char*)&version, sizeof(version));
+        f.read((char*)stored.data(), stored.size() * sizeof(float));
+        if (f && magic == LUT_MAGIC && version == LUT_VERSION && stored == header) {
+            texels.resize((size_t)RADIUS_SIZE * G_SIZE);
+            if (f.read((char*)texels.data(), texels.size() * sizeof(glm::vec3))) {
+                fromCache = true;
+                buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                return;
+            }
+        }
+    }
+
+    build();
+    if (cachePath.empty()) return;
+    std::error_code ec;
+    std::filesystem::path dir = std::filesystem::path(cachePath).parent_path();
+    if (!dir.empty()) std::filesystem::create_directories(dir, ec);
+    std::ofstream f(cachePath, std::ios::binary);
+    if (!f) return;
+    std::vector<float> header = lutHeader();
+    f.write((const char*)&LUT_MAGIC, sizeof(LUT_MAGIC));
+    f.write((const char*)&LUT_VERSION, sizeof(LUT_VERSION));
+    f.write((const char*)header.data(), header.size() * sizeof(float));
+    f.write((const char*)texels.data(), texels.size() * sizeof(glm::vec3));
+}
+
+glm::vec3 DiskEmissionLUT::sample(float r, float g) const {
+    float fx = std::min(std::max((r - R_MIN) / (R_MAX - R_MIN), 0.0f), 1.0f) * (RADIUS_SIZE - 1);
+    float fy = std::min(std::max((g - G_MIN) / (G_MAX - G_MIN), 0.0f), 1.0f) * (G_SIZE - 1);
+    int x0 = std::min((int)fx, RADIUS_SIZE - 2);
+    int y0 = std::min((int)fy, G_SIZE - 2);
+    float tx = fx - x0;
+    float ty = fy - y0;
+
+    const glm::vec3* row0 = &texels[(size_t)y0 * RADIUS_SIZE];
+    const glm::vec3* row1 = row0 + RADIUS_SIZE;
+    glm::vec3 a = glm::mix(row0[x0], row0[x0 + 1], tx);
+    glm::vec3 b = glm::mix(row1[x0], row1[x0 + 1], tx);
+    return glm::mix(a, b, ty);
+}
+
+// ================= 频移因子 =================
+float diskRedshift(const glm::vec3& pos, const glm::vec3& dir) {
+    float r = glm::length(pos);
+    float rd = std::sqrt(pos.x * pos.x + pos.z * pos.z);
+    // 静态观者测得的圆轨道速度 β = sqrt(Rs / (2(r − Rs)))，r = 1.5·Rs 处达到光速
+    float beta = std::sqrt(Rs / (2.0f * std::max(rd - Rs, 0.5f * Rs)));
+    beta = std::min(beta, 0.99f);
+    glm::vec3 diskVel = glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), pos));
+    float mu = glm::dot(diskVel, dir);
+
+    float gravity = std::sqrt(std::max(1.0f - Rs / r, 0.0f));
+    float doppler = std::sqrt(1.0f - beta * beta) / (1.0f + beta * mu);
+    return gravity * doppler;
+}
@@ -0,0 +1,138 @@
+#include "dynamic_resolution.h"
+#include "../Common/shadermanager.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// ================= 初始化 =================
+bool DynamicResolution::init(int w, int h, float target, const std::string& logPath) {
+    outW = w;
+    outH = h;
+    targetMs = target;
+
+    // RGBA16F：黑洞着色器输出 HDR，截断或色调映射留到放大锐化时再做
+    glGenTextures(1, &color);
+    glBindTexture(GL_TEXTURE_2D, color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, outW, outH, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        std::cout << "[dynres] 离屏帧缓冲不完整\n";
+        return false;
+    }
+
+    ShaderDefines defines;
+    if (exposureTexture) defines.push_back({ "TONEMAP", "1" });
+    std::vector<GLuint> programs = gShaders.buildAll({
+        { exposureTexture ? "upscale_sharpen_tonemap" : "upscale_sharpen", loadShaderSource("Shaders/fullscreen.vert"),
+          loadShaderSource("Shaders/upscale_sharpen.frag"), defines } });
+    upscaleProgram = programs[0];
+    if (upscaleProgram == 0) return false;
+
+    if (!logPath.empty()) {
+        log.open(logPath);
+        log << "frame,gpu_ms,target_ms,scale,width,height,steps\n";
+    }
+    logWork = 0.0;
+    applyWork();
+    return true;
+}
+
+void DynamicResolution::destroy() {
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &color);
+    glDeleteProgram(upscaleProgram);
+    fbo = color = upscaleProgram = 0;
+    if (log.is_open()) log.close();
+}
+
+// ================= 控制器 =================
+void DynamicResolution::update(int frame, double gpuMs) {
+    if (gpuMs > 0.0) {
+        measured++;
+        if (gpuMs > targetMs) overBudget++;
+        double error = std::log(targetMs / gpuMs);
+        if (std::fabs(error) > DEADBAND) {
+            double minWork = std::log((double)MIN_SCALE * MIN_SCALE * MIN_STEPS / BASE_STEPS);
+            double maxWork = std::log((double)MAX_STEPS / BASE_STEPS);
+            logWork = std::min(std::max(logWork + GAIN * error, minWork), maxWork);
+            applyWork();
+        }
+    }
+
+    frames++;
+    scaleSum += scale;
+    stepsSum += steps;
+    if (log.is_open()) {
+        log << frame << "," << gpuMs << "," << targetMs << "," << scale << ","
+            << renderW << "," << renderH << "," << steps << "\n";
+    }
+}
+
+// 工作量 → 分辨率与步数，顺序见头文件
+void DynamicResolution::applyWork() {
+    double work = std::exp(logWork);
+    const double midWork = (double)MID_SCALE * MID_SCALE;
+    const double lowWork = midWork * MIN_STEPS / BASE_STEPS;
+    double s = 1.0, n = BASE_STEPS;
+    if (work >= 1.0) {
+        n = BASE_STEPS * work;
+    }
+    else if (work >= midWork) {
+        s = std::sqrt(work);
+    }
+    else if (work >= lowWork) {
+        s = MID_SCALE;
+        n = BASE_STEPS * work / midWork;
+    }
+    else {
+        s = std::sqrt(work * BASE_STEPS / MIN_STEPS);
+        n = MIN_STEPS;
+    }
+
+    scale = (float)std::min(std::max(s, (double)MIN_SCALE), 1.0);
+    steps = std::min(std::max((int)std::lround(n), MIN_STEPS), MAX_STEPS);
+    // 渲染尺寸取 8 的倍数，与 8×4 的像素块对齐
+    renderW = std::min(outW, std::max(8, (int)std::lround(outW * scale / 8.0) * 8));
+    renderH = std::min(outH, std::max(8, (int)std::lround(outH * scale / 8.0) * 8));
+}
+
+// ================= 渲染 =================
+void DynamicResolution::beginScene() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, renderW, renderH);
+}
+
+void DynamicResolution::endScene(GLuint outputFbo, GLuint vao) {
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFbo);
+    glViewport(0, 0, outW, outH);
+
+    glUseProgram(upscaleProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, color);
+    glUniform1i(glGetUniformLocation(upscaleProgram, "source"), 0);
+    glUniform2f(glGetUniformLocation(upscaleProgram, "sourceScale"), (float)renderW / outW, (float)renderH / outH);
+    glUniform2f(glGetUniformLocation(upscaleProgram, "texelSize"), 1.0f / outW, 1.0f / outH);
+    glUniform1f(glGetUniformLocation(upscaleProgram, "sharpness"), sharpness);
+    if (exposureTexture) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, exposureTexture);
+        glActiveTexture(GL_TEXTURE0);
+        glUniform1i(glGetUniformLocation(upscaleProgram, "exposureTex"), 1);
+    }
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+void DynamicResolution::printSummary() const {
+    std::cout << "[dynres] 目标 " << targetMs << " ms：平均分辨率比例 " << meanScale() << "，平均步数 " << meanSteps()
+              << "，超出目标的帧 " << overBudgetFraction() * 100.0 << "%（" << measured << " 帧有 GPU 计时）" << std::endl;
+}
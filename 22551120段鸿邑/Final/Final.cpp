@@ -1,40 +1,203 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 #include "camera.h"
+#include "../Common/profiler.h"
+#include "../Common/replay.h"
+#include "../Common/benchmark.h"
+#include "../Common/shadermanager.h"
+#include "../Common/streambuffer.h"
+#include "../Common/memoryregistry.h"
+#include "../Common/framecapture.h"
+#include "../Common/framepacing.h"
+#include "blackhole_cpu.h"
+#include "blackhole_compute.h"
+#include "disk_emission.h"
+#include "kerr_geodesic.h"
+#include "tile_render.h"
+#include "dynamic_resolution.h"
+#include "tone_mapping.h"
+#include "bloom.h"
+#include "sky_cubemap.h"
+#include <chrono>
+#include <thread>
 
-// ================= ߺ =================
-std::string loadFile(const char* path) {
-    std::ifstream f(path);
-    std::stringstream ss;
-    ss << f.rdbuf();
-    return ss.str();
+// ================= ʵλ =================
+//    14.4 䣨־̷ͬӽ˥һblackhole.frag  REF_STEP
+// λֻı־Ƭɫ--tier-test  low / high  medium Ļһ
+struct QualityTier {
+    const char* name;
+    const char* maxSteps;
+    const char* step;
+};
+
+const QualityTier QUALITY_TIERS[] = {
+    { "low", "360", "0.04" },
+    { "medium", "720", "0.02" },
+    { "high", "1440", "0.01" },
+};
+const int QUALITY_COUNT = sizeof(QUALITY_TIERS) / sizeof(QUALITY_TIERS[0]);
+int quality = 1;
+
+// ================= Ծ =================
+// ĬϿSKIP_EMPTY ꣩--no-skip رգ--skip-test  CPU ϱȽϿǰĻ
+bool skipEmpty = true;
+
+// ================= ̷ģ =================
+// Ĭʹú/ƲұDISK_LUT ꣩--artistic-disk صԭ cinematicDoppler
+bool physicalDisk = true;
+DiskEmissionLUT diskLUT;
+
+GLuint createDiskLUTTexture(const DiskEmissionLUT& lut) {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, DiskEmissionLUT::RADIUS_SIZE, DiskEmissionLUT::G_SIZE, 0,
+                 GL_RGB, GL_FLOAT, lut.texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return tex;
+}
+
+// ================= ÿ֡ =================
+// Ĭдʽλ岢ƫư󶨵 blackhole.frag  FrameBlockSTREAM_UNIFORMS ꣩
+// --no-stream ص glUniformstd140 ֣mat3 ÿռһ vec4
+struct BlackHoleFrame {
+    glm::vec4 camRot[3];
+    glm::vec3 camPos;
+    float spin;
+    float skyTexelAngle;
+    float skyMaxLod;
+    int32_t stepBudget;
+    float pad;
+};
+static_assert(sizeof(BlackHoleFrame) == 80, "BlackHoleFrame  FrameBlock  std140 һ");
+
+// ================= ǿ =================
+// Ĭϰ HDR ȫͼתɴ mip ͼSKY_CUBEMAP ꣩΢ѡ LOD 
+// --hash-sky ȫͼʧʱصԭĹϣǵ starfield()
+bool cubemapSky = true;
+std::string skyPath = "E:/OpenGLLearning/OpenGLHW02/Resources/SpaceStars01 _2K.hdr";
+SkyCubemap skyCubemap;
+
+// ϴǰ󶨵ͼ
+void uploadSkyLevels(const SkyCubemap& sky) {
+    for (int l = 0; l < sky.levelCount(); l++) {
+        int size = sky.levelSize(l);
+        for (int face = 0; face < 6; face++) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, l, GL_RGB16F, size, size, 0, GL_RGB, GL_FLOAT,
+                         &sky.levels[l][(size_t)face * size * size]);
+        }
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, sky.levelCount() - 1);
+}
+
+GLuint createSkyCubeTexture(const SkyCubemap& sky) {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, tex);
+    uploadSkyLevels(sky);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    // ˣ mip ߽粻ֽӷ
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    return tex;
+}
+
+size_t skyCubemapBytes(const SkyCubemap& sky) {
+    size_t bytes = 0;
+    for (const auto& level : sky.levels) bytes += level.size() * sizeof(glm::vec3);
+    return bytes;
+}
+
+// Դ泬ԤʱĽȥǿյ 0 һԭϴͬһCPU פ
+// texelAngle  faceSize 仯ȫ·ÿ֡ȡ·ĸ
+struct SkyDowngrade {
+    GLuint texture;
+    BlackHoleCompute* compute;
+};
+
+bool dropSkyTopLevel(void* user) {
+    SkyDowngrade* sky = (SkyDowngrade*)user;
+    if (!sky->texture || skyCubemap.levelCount() < 2 || skyCubemap.faceSize <= MemoryRegistry::MIN_DOWNGRADE_SIZE) return false;
+    int oldLevels = skyCubemap.levelCount();
+    gMemory.trackHost("sky_cubemap", -(int64_t)(skyCubemap.levels[0].size() * sizeof(glm::vec3)));
+    skyCubemap.levels.erase(skyCubemap.levels.begin());
+    skyCubemap.faceSize /= 2;
+
+    GLint previous = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_CUBE_MAP, &previous);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, sky->texture);
+    uploadSkyLevels(skyCubemap);
+    for (int face = 0; face < 6; face++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, oldLevels - 1, GL_RGB16F, 0, 0, 0, GL_RGB, GL_FLOAT, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, (GLuint)previous);
+
+    sky->compute->skyTexelAngle = skyCubemap.texelAngle();
+    sky->compute->skyMaxLod = (float)(skyCubemap.levelCount() - 1);
+    std::cout << "[sky] ͼ " << skyCubemap.faceSize << "" << skyCubemap.faceSize << std::endl;
+    return true;
 }
 
-GLuint compileShader(const char* vs, const char* fs) {
-    GLuint v = glCreateShader(GL_VERTEX_SHADER);
-    GLuint f = glCreateShader(GL_FRAGMENT_SHADER);
+// ================= Ⱦ· =================
+// falseȫıƬɫtrueɫǰҪ GL 4.3M л
+bool useCompute = false;
+int waveSteps = 32;
+bool mDown = false;
 
-    glShaderSource(v, 1, &vs, nullptr);
-    glShaderSource(f, 1, &fs, nullptr);
-    glCompileShader(v);
-    glCompileShader(f);
+// ================= ֱ̬ =================
+// --target-ms T  GPU ֡ʱ֡Ⱦֱ벽Ŵ񻯺ֻȫı·
+float targetFrameMs = 0.0f;
+float sharpness = 0.5f;
+std::string dynresLog = "dynres_log.csv";
 
-    GLuint p = glCreateProgram();
-    glAttachShader(p, v);
-    glAttachShader(p, f);
-    glLinkProgram(p);
+// ================= ɫӳ =================
+// ĬϿȾ HDR Ŀ꣬GPU ֱͼԶع filmic ӳ--no-tonemap ֱָд 1 Ĳֽضϣ
+bool toneMapping = true;
+float exposureCompensation = 0.0f;
 
-    glDeleteShader(v);
-    glDeleteShader(f);
-    return p;
+// ================= Bloom =================
+// --bloom low|medium|high --streak ӺâȾ֮عͳ֮ǰ HDR ĿϵӹΡ
+// Ҫ HDR Ŀ꣨ɫӳֱ̬ʣCPU ׼ֿȾ applyBloomCPU ͬĴ
+bool bloomEnabled = false;
+BloomSettings bloomSettings;
+
+void printOccupancy(const MarchOccupancy& occ, int k) {
+    std::cout << "[march] ƽ " << occ.meanSteps << " /أSIMD ͨʣ32 ͨ"
+              << "ȫı " << occ.fragmentLaneUtil * 100.0 << "%ǰ(K=" << k << ") "
+              << occ.computeLaneUtil * 100.0 << "%Ч " << occ.waves << std::endl;
+}
+
+// ڲռܲıԾĲѹӦ
+double diskStepFraction(const std::vector<TraceInfo>& info) {
+    uint64_t steps = 0, disk = 0;
+    for (const TraceInfo& t : info) {
+        steps += t.steps;
+        disk += t.diskSteps;
+    }
+    return steps ? (double)disk / steps : 0.0;
+}
+
+void addOccupancyMetrics(BenchmarkRun& run, const MarchOccupancy& occ, int k) {
+    run.setMetric("mean_steps", occ.meanSteps);
+    run.setMetric("fragment_lane_utilization", occ.fragmentLaneUtil);
+    run.setMetric("wavefront_lane_utilization", occ.computeLaneUtil);
+    run.setMetric("wave_steps", k);
+    run.setMetric("waves", occ.waves);
 }
 
 // ================= ȫ =================
@@ -42,24 +205,460 @@ Camera camera;
 bool firstMouse = true;
 double lastX, lastY;
 
+// ߳ͬʱƶתӽʱ
 void mouseCallback(GLFWwindow*, double x, double y) {
     if (firstMouse) {
         lastX = x; lastY = y;
         firstMouse = false;
     }
-    camera.processMouse(x - lastX, lastY - y);
+    {
+        std::lock_guard<std::mutex> lock(gPacer.cameraMutex());
+        camera.processMouse(x - lastX, lastY - y);
+    }
+    if (x != lastX || y != lastY) gPacer.noteInput();
+    gRecorder.mouse((float)(x - lastX), (float)(lastY - y));
     lastX = x;
     lastY = y;
 }
 
-int main() {
+// ƶطʱ״̬ű֡߳ʱ 1 kHz ã̵߳İ
+void moveCamera(GLFWwindow* window, float dt) {
+    if (gPacer.keyDown(window, GLFW_KEY_W)) camera.processKeyboard(GLFW_KEY_W, dt);
+    if (gPacer.keyDown(window, GLFW_KEY_S)) camera.processKeyboard(GLFW_KEY_S, dt);
+    if (gPacer.keyDown(window, GLFW_KEY_A)) camera.processKeyboard(GLFW_KEY_A, dt);
+    if (gPacer.keyDown(window, GLFW_KEY_D)) camera.processKeyboard(GLFW_KEY_D, dt);
+}
+
+void processCameraInput(GLFWwindow* window, float dt) {
+    if (!gPacer.inputThreadRunning()) moveCamera(window, dt);
+
+    // 1/2/3 лʵλʱȫ룩
+    for (int i = 0; i < QUALITY_COUNT; i++) {
+        if (inputKeyDown(window, GLFW_KEY_1 + i) && quality != i) {
+            quality = i;
+            std::cout << "ʣ" << QUALITY_TIERS[i].name << std::endl;
+        }
+    }
+}
+
+// M лȾ·ش
+bool processPathToggle(GLFWwindow* window, bool computeAvailable) {
+    bool m = inputKeyDown(window, GLFW_KEY_M);
+    bool toggled = m && !mDown && computeAvailable;
+    mDown = m;
+    if (toggled) {
+        useCompute = !useCompute;
+        std::cout << "Ⱦ·" << (useCompute ? "ɫǰ" : "ȫı") << std::endl;
+    }
+    return toggled;
+}
+
+// ================= ׼ģʽ =================
+void setupReplayCallbacks() {
+    gReplay.onMouse = [](float dx, float dy) { camera.processMouse(dx, dy); };
+    gReplay.onCamera = [](const float* v) {
+        camera.position = glm::vec3(v[0], v[1], v[2]);
+        glm::vec3 dir = glm::normalize(glm::vec3(v[3], v[4], v[5]) - camera.position);
+        camera.yaw = glm::degrees(atan2(dir.z, dir.x));
+        camera.pitch = glm::degrees(asin(dir.y));
+    };
+}
+
+// CPU ο·׼ȼԼ顢ֿȾKerrֻʵֹϣǵ starfield()һɰ --hash-sky 
+//  GPU 򱨸ȶʱGPU һҲҪ --hash-skyǿղֲɱ
+void useHashSkyOnCpu() {
+    if (cubemapSky) std::cout << "[sky] CPU ο·ûͼǿգ --hash-sky Ⱦ GPU ȶʱͬ --hash-sky" << std::endl;
+    cubemapSky = false;
+}
+
+// CPU ο· GL ģ֡ű߳Ⱦ
+int runCpuBenchmark(const BenchmarkConfig& config) {
+    useHashSkyOnCpu();
+    if (!gReplay.load(config.script)) return -1;
+    setupReplayCallbacks();
+
+    int w = config.width ? config.width : 320;
+    int h = config.height ? config.height : 200;
+    int frames = config.frames ? config.frames : (int)gReplay.frames;
+    camera.position = glm::vec3(0.0f, 1.2f, 7.5f);
+
+    BenchmarkRun run;
+    run.begin(config, w, h, "cpu-reference");
+    std::vector<glm::vec3> image;
+    std::vector<TraceInfo> info;
+    for (int i = 0; i < frames; i++) {
+        run.frameStart();
+        gReplay.advance();
+        processCameraInput(nullptr, (float)gReplay.dt);
+
+        BlackHoleParams params;
+        params.camPos = camera.position;
+        params.camRot = camera.getRotation();
+        params.spin = 0.9f;
+        params.maxSteps = atoi(QUALITY_TIERS[quality].maxSteps);
+        params.step = (float)atof(QUALITY_TIERS[quality].step);
+        params.skipEmpty = skipEmpty;
+        params.diskLUT = physicalDisk ? &diskLUT : nullptr;
+        renderBlackHoleCPU(params, w, h, image, 0, &info);
+        if (bloomEnabled) applyBloomCPU(image, w, h, bloomSettings);
+        run.frameEnd(false);
+    }
+
+    // ÿز GPU ·ֱͬ GPU ·ͨ
+    std::vector<uint32_t> steps;
+    for (const TraceInfo& t : info) steps.push_back((uint32_t)t.steps);
+    MarchOccupancy occ = analyzeMarchOccupancy(steps, w, h, waveSteps, atoi(QUALITY_TIERS[quality].maxSteps));
+    printOccupancy(occ, waveSteps);
+    addOccupancyMetrics(run, occ, waveSteps);
+    run.setMetric("skip_empty", skipEmpty ? 1 : 0);
+    run.setMetric("disk_step_fraction", diskStepFraction(info));
+    run.setMetric("bloom", bloomEnabled ? 1 : 0);
+
+    if (!config.image.empty()) {
+        std::vector<unsigned char> rgb;
+        convertToRGB8(image, rgb);
+        writeImagePPM(config.image, w, h, rgb.data(), true);
+    }
+    return run.writeReport() ? 0 : -1;
+}
+
+// CPU ʹõĵͻλ׼ڶ
+const float TEST_POSES[][3] = {
+    { 0.0f, 1.2f, 7.5f },    // Ĭϻλ
+    { 0.0f, 4.0f, 6.0f },    // 
+    { 5.0f, 0.3f, 5.0f },    // 
+    { 0.0f, 0.5f, 12.0f },   // Զ
+};
+
+void aimCameraAtHole(const float* p) {
+    camera.position = glm::vec3(p[0], p[1], p[2]);
+    glm::vec3 dir = glm::normalize(-camera.position);
+    camera.yaw = glm::degrees(atan2(dir.z, dir.x));
+    camera.pitch = glm::degrees(asin(dir.y));
+}
+
+// ԾȼԼ飺ͻλֱ/ԾȾ̻ʵֵʱط
+int runSkipTest(const BenchmarkConfig& config) {
+    useHashSkyOnCpu();
+    const double MIN_PSNR = 40.0;
+    const double MAX_VISIBLE = 0.03;
+
+    int w = config.width ? config.width : 320;
+    int h = config.height ? config.height : 200;
+    bool pass = true;
+    for (const auto& p : TEST_POSES) {
+        aimCameraAtHole(p);
+
+        BlackHoleParams params;
+        params.camPos = camera.position;
+        params.camRot = camera.getRotation();
+        params.maxSteps = atoi(QUALITY_TIERS[quality].maxSteps);
+        params.step = (float)atof(QUALITY_TIERS[quality].step);
+        params.diskLUT = physicalDisk ? &diskLUT : nullptr;
+        SkipEquivalence eq = measureSkipEquivalence(params, w, h);
+
+        bool ok = eq.emissionPSNR >= MIN_PSNR && eq.visibleFraction <= MAX_VISIBLE;
+        pass = pass && ok;
+        std::cout << "[skip] λ (" << p[0] << ", " << p[1] << ", " << p[2] << ")"
+                  << "ƽ " << eq.meanStepsBefore << " -> " << eq.meanStepsAfter
+                  << "ڲռ " << eq.diskFractionBefore * 100.0 << "% -> " << eq.diskFractionAfter * 100.0 << "%"
+                  << " PSNR " << eq.emissionPSNR << " dB " << eq.emissionMaxError << ""
+                  << "ɼ " << eq.visibleFraction * 100.0 << "%"
+                  << "ƽ " << eq.meanDirError << " rad"
+                  << (ok ? "" : "  <- δͨ") << std::endl;
+    }
+    std::cout << "[skip] " << (pass ? "ͨ" : "δͨ") << "ֵPSNR >= " << MIN_PSNR
+              << " dBɼ <= " << MAX_VISIBLE * 100.0 << "%" << std::endl;
+    return pass ? 0 : 1;
+}
+
+// ʵλһԼ飺λ low / medium / high Ⱦlow  high ̷ medium Ƚϡ
+// λ֮߹켣ϸСPSNR ֻҪ 30 dBƽ֮ȼ鲽һδһʱΪ 0.5 / 2
+int runTierTest(const BenchmarkConfig& config) {
+    useHashSkyOnCpu();
+    const double MIN_PSNR = 30.0;
+    const double MAX_BRIGHTNESS_ERROR = 0.05;
+    const int MEDIUM = 1;
+
+    int w = config.width ? config.width : 320;
+    int h = config.height ? config.height : 200;
+    bool pass = true;
+    for (const auto& p : TEST_POSES) {
+        aimCameraAtHole(p);
+        std::vector<TraceInfo> info[QUALITY_COUNT];
+        for (int q = 0; q < QUALITY_COUNT; q++) {
+            BlackHoleParams params;
+            params.camPos = camera.position;
+            params.camRot = camera.getRotation();
+            params.maxSteps = atoi(QUALITY_TIERS[q].maxSteps);
+            params.step = (float)atof(QUALITY_TIERS[q].step);
+            params.skipEmpty = skipEmpty;
+            params.diskLUT = physicalDisk ? &diskLUT : nullptr;
+            std::vector<glm::vec3> image;
+            renderBlackHoleCPU(params, w, h, image, 0, &info[q]);
+        }
+
+        std::cout << "[tier] λ (" << p[0] << ", " << p[1] << ", " << p[2] << ")";
+        for (int q = 0; q < QUALITY_COUNT; q++) {
+            if (q == MEDIUM) continue;
+            double squared = 0.0, sum = 0.0, sumMedium = 0.0;
+            for (size_t i = 0; i < info[MEDIUM].size(); i++) {
+                const glm::vec3& e = info[q][i].emission;
+                const glm::vec3& m = info[MEDIUM][i].emission;
+                glm::vec3 c = glm::clamp(e, 0.0f, 1.0f) - glm::clamp(m, 0.0f, 1.0f);
+                squared += (c.x * c.x + c.y * c.y + c.z * c.z) / 3.0;
+                sum += e.x + e.y + e.z;
+                sumMedium += m.x + m.y + m.z;
+            }
+            double mse = squared / info[MEDIUM].size();
+            double psnr = mse > 0.0 ? 10.0 * std::log10(1.0 / mse) : 99.0;
+            double brightness = sumMedium > 0.0 ? sum / sumMedium : 1.0;
+            bool ok = psnr >= MIN_PSNR && std::fabs(brightness - 1.0) <= MAX_BRIGHTNESS_ERROR;
+            pass = pass && ok;
+            std::cout << (q < MEDIUM ? "" : "") << QUALITY_TIERS[q].name << "  PSNR " << psnr
+                      << " dBƽ " << brightness << (ok ? "" : "  <- δͨ");
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "[tier] " << (pass ? "ͨ" : "δͨ") << " medium ȽϣֵPSNR >= " << MIN_PSNR
+              << " dBƽƫ <= " << MAX_BRIGHTNESS_ERROR * 100.0 << "%" << std::endl;
+    return pass ? 0 : 1;
+}
+
+// Kerr ѧģʽͬһλֱ Kerr ģȾֵͼͼͳ
+// ͼ = 0㣬 = 10 ϣƷ = /жһ£ = Kerr ﵽޣδ
+int runKerrReference(const BenchmarkConfig& config) {
+    useHashSkyOnCpu();
+    int w = config.width ? config.width : 320;
+    int h = config.height ? config.height : 200;
+    camera.position = glm::vec3(0.0f, 1.2f, 7.5f);
+    glm::vec3 dir = glm::normalize(-camera.position);
+    camera.yaw = glm::degrees(atan2(dir.z, dir.x));
+    camera.pitch = glm::degrees(asin(dir.y));
+
+    BlackHoleParams params;
+    params.camPos = camera.position;
+    params.camRot = camera.getRotation();
+    params.maxSteps = atoi(QUALITY_TIERS[quality].maxSteps);
+    params.step = (float)atof(QUALITY_TIERS[quality].step);
+    params.skipEmpty = skipEmpty;
+    // ߶úұ⣬ſɱȣ--artistic-disk ڴģʽЧ
+    if (diskLUT.texels.empty()) diskLUT.loadOrBuild("shader_cache/disk_lut.bin");
+    params.diskLUT = &diskLUT;
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<glm::vec3> reference;
+    std::vector<KerrTrace> kerr;
+    renderKerrCPU(params, KerrSettings(), w, h, reference, &kerr);
+    auto t1 = std::chrono::steady_clock::now();
+    std::vector<glm::vec3> approxImage;
+    std::vector<TraceInfo> approx;
+    renderBlackHoleCPU(params, w, h, approxImage, 0, &approx);
+    auto t2 = std::chrono::steady_clock::now();
+
+    KerrComparison cmp = compareWithKerr(approx, kerr);
+    double kerrMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    double approxMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+    uint64_t approxSteps = 0;
+    for (const TraceInfo& t : approx) approxSteps += t.steps;
+
+    std::cout << "[kerr] " << w << "" << h << "Kerr " << kerrMs << " msƽ " << cmp.meanKerrSteps
+              << "  " << approxMs << " msƽ " << (double)approxSteps / approx.size() << " " << std::endl;
+    std::cout << "[kerr] Լв " << cmp.maxConstraintError << "жһ " << cmp.captureMismatch * 100.0
+              << "%ǿշ ƽ " << cmp.meanAngleDeg << " / P95 " << cmp.p95AngleDeg << " /  "
+              << cmp.maxAngleDeg << "㣬̷ PSNR " << cmp.emissionPSNR << " dB" << std::endl;
+    if (cmp.unresolved) {
+        std::cout << "[kerr] " << cmp.unresolved << " شﵽޣ" << KerrSettings().maxSteps
+                  << "δӽݣδͳ" << std::endl;
+    }
+
+    std::string base = config.image.empty() ? "kerr" : config.image;
+    std::vector<unsigned char> rgb;
+    convertToRGB8(reference, rgb);
+    writeImagePPM(base + "_reference.ppm", w, h, rgb.data(), true);
+    for (size_t i = 0; i < cmp.angleDeg.size(); i++) {
+        float e = cmp.angleDeg[i];
+        unsigned char v = (unsigned char)(std::min(std::max(e, 0.0f) / 10.0f, 1.0f) * 255.0f);
+        bool mismatch = e >= 180.0f;
+        bool unresolved = e < 0.0f;
+        rgb[i * 3 + 0] = mismatch ? 255 : unresolved ? 0 : v;
+        rgb[i * 3 + 1] = mismatch ? 0 : unresolved ? 255 : v;
+        rgb[i * 3 + 2] = mismatch ? 255 : unresolved ? 0 : v;
+    }
+    writeImagePPM(base + "_error.ppm", w, h, rgb.data(), true);
+    return 0;
+}
+
+// ֲʽֿȾ --bench űʱű֡ȾֻȾʼӽһ֡
+int runTileRender(const BenchmarkConfig& config, TileRenderConfig tileConfig, bool verify) {
+    useHashSkyOnCpu();
+    tileConfig.width = config.width ? config.width : 1920;
+    tileConfig.height = config.height ? config.height : 1080;
+
+    std::vector<BlackHoleParams> frames;
+    camera.position = glm::vec3(0.0f, 1.2f, 7.5f);
+    int count = 1;
+    if (!config.script.empty()) {
+        if (!gReplay.load(config.script)) return -1;
+        setupReplayCallbacks();
+        count = config.frames ? config.frames : (int)gReplay.frames;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!config.script.empty()) {
+            gReplay.advance();
+            processCameraInput(nullptr, (float)gReplay.dt);
+        }
+        BlackHoleParams params;
+        params.camPos = camera.position;
+        params.camRot = camera.getRotation();
+        params.maxSteps = atoi(QUALITY_TIERS[quality].maxSteps);
+        params.step = (float)atof(QUALITY_TIERS[quality].step);
+        params.skipEmpty = skipEmpty;
+        params.diskLUT = physicalDisk ? &diskLUT : nullptr;
+        frames.push_back(params);
+    }
+
+    // ֡д --image ָļ֡չǰλ֡
+    std::string path = config.image.empty() ? "tiles.ppm" : config.image;
+    size_t dot = path.rfind('.');
+    std::string stem = dot == std::string::npos ? path : path.substr(0, dot);
+    std::string ext = dot == std::string::npos ? ".ppm" : path.substr(dot);
+    std::vector<glm::vec3> first;
+    auto onFrame = [&](int index, const std::vector<glm::vec3>& image) {
+        std::vector<unsigned char> rgb;
+        std::vector<glm::vec3> bloomed;
+        if (bloomEnabled) {
+            bloomed = image;
+            applyBloomCPU(bloomed, tileConfig.width, tileConfig.height, bloomSettings);
+        }
+        convertToRGB8(bloomEnabled ? bloomed : image, rgb);
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), "_%04d", index);
+        std::string file = frames.size() == 1 ? path : stem + suffix + ext;
+        writeImagePPM(file, tileConfig.width, tileConfig.height, rgb.data(), true);
+        if (index == 0 && verify) first = image;
+    };
+
+    TileCoordinator coordinator;
+    bool ok = coordinator.run(frames, tileConfig, onFrame);
+    coordinator.printStats();
+    if (!ok) return 1;
+
+    // 뵥ȾرȽϣÿصļȫͬӦûκβ죩
+    if (verify) {
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<glm::vec3> local;
+        renderBlackHoleCPU(frames[0], tileConfig.width, tileConfig.height, local);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        float maxDiff = 0.0f;
+        for (size_t i = 0; i < local.size(); i++) {
+            glm::vec3 d = glm::abs(local[i] - first[i]);
+            maxDiff = std::max(maxDiff, std::max(d.x, std::max(d.y, d.z)));
+        }
+        std::cout << "[tiles] У飺Ⱦ 0 ֡ " << ms << " msز " << maxDiff << std::endl;
+        if (maxDiff != 0.0f) return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    BenchmarkConfig benchConfig;
+    bool benchMode = parseBenchmarkArgs(argc, argv, "blackhole", benchConfig);
+    PacingConfig pacingConfig;
+    parsePacingArgs(argc, argv, pacingConfig);
+    TileRenderConfig tileConfig;
+    const char* workerAddress = nullptr;
+    int workerFailAfter = -1;
+    bool tileMode = false, tileVerify = false;
+    std::string captureTarget;
+    int captureFps = 60;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--compute") == 0) useCompute = true;
+        if (strcmp(argv[i], "--render-tiles") == 0) tileMode = true;
+        if (strcmp(argv[i], "--verify") == 0) tileVerify = true;
+        if (strcmp(argv[i], "--no-skip") == 0) skipEmpty = false;
+        if (strcmp(argv[i], "--artistic-disk") == 0) physicalDisk = false;
+        if (strcmp(argv[i], "--hash-sky") == 0) cubemapSky = false;
+        if (strcmp(argv[i], "--no-stream") == 0) gStream.enabled = false;
+        if (strcmp(argv[i], "--no-tonemap") == 0) toneMapping = false;
+        if (strcmp(argv[i], "--streak") == 0) bloomSettings.streak = bloomEnabled = true;
+        if (i + 1 >= argc) continue;
+        if (strcmp(argv[i], "--wave-steps") == 0) waveSteps = std::max(1, atoi(argv[i + 1]));
+        if (strcmp(argv[i], "--workers") == 0) tileConfig.workers = std::max(0, atoi(argv[i + 1]));
+        if (strcmp(argv[i], "--tile") == 0) tileConfig.tileSize = std::max(8, atoi(argv[i + 1]));
+        if (strcmp(argv[i], "--port") == 0) tileConfig.port = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--fail-worker") == 0) tileConfig.failWorker = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--tile-worker") == 0) workerAddress = argv[i + 1];
+        if (strcmp(argv[i], "--tile-fail-after") == 0) workerFailAfter = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--target-ms") == 0) targetFrameMs = std::max(0.0f, (float)atof(argv[i + 1]));
+        if (strcmp(argv[i], "--exposure") == 0) exposureCompensation = (float)atof(argv[i + 1]);
+        if (strcmp(argv[i], "--sharpen") == 0) sharpness = std::min(std::max((float)atof(argv[i + 1]), 0.0f), 1.0f);
+        if (strcmp(argv[i], "--dynres-log") == 0) dynresLog = argv[i + 1];
+        if (strcmp(argv[i], "--sky") == 0) skyPath = argv[i + 1];
+        if (strcmp(argv[i], "--vram-budget") == 0) gMemory.budget.gpuBytes = (uint64_t)(atof(argv[i + 1]) * 1024 * 1024);
+        if (strcmp(argv[i], "--host-budget") == 0) gMemory.budget.hostBytes = (uint64_t)(atof(argv[i + 1]) * 1024 * 1024);
+        if (strcmp(argv[i], "--capture") == 0) captureTarget = argv[i + 1];
+        if (strcmp(argv[i], "--capture-fps") == 0) captureFps = std::max(1, atoi(argv[i + 1]));
+        if (strcmp(argv[i], "--bloom") == 0 && applyBloomTier(argv[i + 1], bloomSettings)) bloomEnabled = true;
+        if (strcmp(argv[i], "--bloom-threshold") == 0) bloomSettings.threshold = std::max(0.0f, (float)atof(argv[i + 1]));
+        if (strcmp(argv[i], "--bloom-intensity") == 0) bloomSettings.intensity = std::max(0.0f, (float)atof(argv[i + 1]));
+        if (strcmp(argv[i], "--quality") != 0) continue;
+        for (int q = 0; q < QUALITY_COUNT; q++) {
+            if (strcmp(argv[i + 1], QUALITY_TIERS[q].name) == 0) quality = q;
+        }
+    }
+    // ұ GL ޹أCPU ׼ȼԼͬʹ
+    if (physicalDisk) {
+        diskLUT.loadOrBuild("shader_cache/disk_lut.bin");
+        if (!workerAddress) std::cout << "[disk] ұ " << DiskEmissionLUT::RADIUS_SIZE << "" << DiskEmissionLUT::G_SIZE
+                  << (diskLUT.fromCache ? "ȡ " : " ") << diskLUT.buildMs << " ms" << std::endl;
+    }
+    if (workerAddress) return runTileWorker(workerAddress, &diskLUT, workerFailAfter);
+    if (tileMode) return runTileRender(benchConfig, tileConfig, tileVerify);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--skip-test") == 0) return runSkipTest(benchConfig);
+        if (strcmp(argv[i], "--tier-test") == 0) return runTierTest(benchConfig);
+        if (strcmp(argv[i], "--kerr") == 0) return runKerrReference(benchConfig);
+    }
+    if (benchMode && benchConfig.cpu) return runCpuBenchmark(benchConfig);
+    if (benchMode && !gReplay.load(benchConfig.script)) return -1;
+
+    int width = benchConfig.width ? benchConfig.width : 1280;
+    int height = benchConfig.height ? benchConfig.height : 800;
+
     glfwInit();
-    GLFWwindow* window = glfwCreateWindow(1280, 800, "Black Hole", nullptr, nullptr);
+    if (benchMode) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    // ȴ 4.3 core üɫ·֧ʱ˵Ĭ
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(width, height, "Black Hole", nullptr, nullptr);
+    if (!window) {
+        glfwDefaultWindowHints();
+        if (benchMode) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        window = glfwCreateWindow(width, height, "Black Hole", nullptr, nullptr);
+    }
     glfwMakeContextCurrent(window);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    glfwSetCursorPosCallback(window, mouseCallback);
+    if (!benchMode) {
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        glfwSetCursorPosCallback(window, mouseCallback);
+    }
 
     gladLoadGL();
+    gProfiler.init("blackhole");
+    gMemory.init("blackhole");
+    gStream.init(4 * 1024);
+
+    // ׼ģʽ̶طŽűȾ FBO
+    OffscreenTarget benchTarget;
+    BenchmarkRun benchRun;
+    int benchFrames = 0;
+    if (benchMode) {
+        setupReplayCallbacks();
+        benchTarget.create(width, height);
+        benchFrames = benchConfig.frames ? benchConfig.frames : (int)gReplay.frames;
+        benchRun.begin(benchConfig, width, height, (const char*)glGetString(GL_RENDERER));
+    }
 
     // ================= ȫ =================
     float quad[] = {
@@ -69,68 +668,389 @@ int main() {
 
     GLuint vao, vbo;
     glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
+    {
+        MemoryAssetScope asset("fullscreen_quad");
+        glGenBuffers(1, &vbo);
+    }
     glBindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
     glVertexAttribPointer(0, 2, GL_FLOAT, false, 2 * sizeof(float), 0);
     glEnableVertexAttribArray(0);
 
+    // =================  HDR ǿ =================
+    // ȫͼתͼں̨̣߳ڲٰж̣߳Уɫص
+    std::thread skyThread;
+    float* skyData = nullptr;
+    if (cubemapSky) {
+        stbi_set_flip_vertically_on_load(true);
+        int w, h, n;
+        skyData = stbi_loadf(skyPath.c_str(), &w, &h, &n, 3);
+        if (skyData) {
+            skyThread = std::thread([=]() { skyCubemap.build(skyData, w, h, 3); });
+        }
+        else {
+            std::cout << "Failed to load HDR skyʹùϣǵ\n";
+            cubemapSky = false;
+        }
+    }
+
     // =================  shader =================
-    auto vs = loadFile("Shaders/fullscreen.vert");
-    auto fs = loadFile("Shaders/blackhole.frag");
-    GLuint program = compileShader(vs.c_str(), fs.c_str());
+    // ÿʵλһ壬һύȫ룬лʱֱӼس
+    gShaders.init("shader_cache");
+    std::string vs = loadShaderSource("Shaders/fullscreen.vert");
+    std::string fs = loadShaderSource("Shaders/blackhole.frag");
+    std::vector<ShaderDesc> variants;
+    for (const QualityTier& tier : QUALITY_TIERS) {
+        ShaderDefines defines = { { "MAX_STEPS", tier.maxSteps }, { "STEP", tier.step } };
+        if (skipEmpty) defines.push_back({ "SKIP_EMPTY", "1" });
+        if (physicalDisk) defines.push_back({ "DISK_LUT", "1" });
+        if (cubemapSky) defines.push_back({ "SKY_CUBEMAP", "1" });
+        if (gStream.enabled) defines.push_back({ "STREAM_UNIFORMS", "1" });
+        variants.push_back({ std::string("blackhole_") + tier.name, vs, fs, defines });
+    }
+    // ֱ̬ʱ壺high  MAX_STEPS / STEP Ϊޣʵʲ stepBudget uniform 
+    bool dynamicRes = targetFrameMs > 0.0f;
+    if (dynamicRes) {
+        ShaderDefines defines = variants[QUALITY_COUNT - 1].defines;
+        defines.push_back({ "DYNAMIC_BUDGET", "1" });
+        variants.push_back({ "blackhole_dynamic", vs, fs, defines });
+    }
+    std::vector<GLuint> programs;
+    {
+        MemoryAssetScope asset("blackhole_shaders");
+        programs = gShaders.buildAll(variants);
+    }
+    GLuint skyTex = 0;
+    if (skyThread.joinable()) {
+        skyThread.join();
+        stbi_image_free(skyData);
+        MemoryAssetScope asset("sky_cubemap");
+        skyTex = createSkyCubeTexture(skyCubemap);
+        gMemory.trackHost("sky_cubemap", (int64_t)skyCubemapBytes(skyCubemap));
+        std::cout << "[sky] ͼ " << skyCubemap.faceSize << "" << skyCubemap.faceSize << "  6 棬" << skyCubemap.levelCount()
+                  << "  mipת " << skyCubemap.buildMs << " ms" << std::endl;
+    }
+    for (GLuint p : programs) {
+        if (p == 0) {
+            std::cout << "Failed to build blackhole shader\n";
+            return -1;
+        }
+    }
+    // ʽԪǳ״̬ӺһΣȾѭﲻ֡
+    if (gStream.enabled) {
+        for (GLuint p : programs) {
+            StreamBuffer::bindBlocks(p);
+            glUseProgram(p);
+            glUniform1i(glGetUniformLocation(p, "skyCube"), 2);
+            glUniform1i(glGetUniformLocation(p, "diskLUT"), 1);
+        }
+        glUseProgram(0);
+    }
 
-    // =================  HDR ǿ =================
-    stbi_set_flip_vertically_on_load(true);
-    int w, h, n;
-    float* data = stbi_loadf("E:/OpenGLLearning/OpenGLHW02/Resources/SpaceStars01 _2K.hdr", &w, &h, &n, 0);
-    if (!data) {
-        std::cout << "Failed to load HDR sky\n";
-        return -1;
-    }
-
-    GLuint hdrTex;
-    glGenTextures(1, &hdrTex);
-    glBindTexture(GL_TEXTURE_2D, hdrTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, w, h, 0, GL_RGB, GL_FLOAT, data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    stbi_image_free(data);
+    // ɫ·ÿʵλһ raygen/march 
+    BlackHoleCompute computePath;
+    bool computeAvailable = false;
+    if (BlackHoleCompute::supported()) {
+        MemoryAssetScope asset("compute_path");
+        std::vector<ShaderDefines> tierDefines;
+        // ֻȡǰ QUALITY_COUNT ʵλɫ DYNAMIC_BUDGETֱ̬ʱ岻ٱһ
+        for (int q = 0; q < QUALITY_COUNT; q++) tierDefines.push_back(variants[q].defines);
+        computeAvailable = computePath.init(tierDefines, waveSteps);
+    }
+    GLuint diskLutTex = 0;
+    if (physicalDisk) {
+        MemoryAssetScope asset("disk_lut");
+        diskLutTex = createDiskLUTTexture(diskLUT);
+        gMemory.trackHost("disk_lut", (int64_t)(diskLUT.texels.size() * sizeof(glm::vec3)));
+    }
+    computePath.diskLut = diskLutTex;
+    computePath.skyCube = skyTex;
+    computePath.skyTexelAngle = skyCubemap.texelAngle();
+    computePath.skyMaxLod = (float)(skyCubemap.levelCount() - 1);
+    // ԴԤʱȽǿշֱʣûص mip 
+    SkyDowngrade skyDowngrade = { skyTex, &computePath };
+    gMemory.addDowngrade("sky_cubemap", dropSkyTopLevel, &skyDowngrade);
+    if (useCompute && !computeAvailable) {
+        std::cout << "ɫ·ãҪ GL 4.3ʹȫı\n";
+        useCompute = false;
+    }
+    bool reportOccupancy = useCompute;
+
+    ToneMapping toneMap;
+    if (toneMapping) {
+        toneMap.compensation = exposureCompensation;
+        MemoryAssetScope asset("tone_mapping");
+        if (!toneMap.init(width, height)) return -1;
+    }
+
+    DynamicResolution dynres;
+    if (dynamicRes) {
+        if (useCompute) {
+            std::cout << "ֱֻ̬֧ȫı·ѹرռɫ·\n";
+            useCompute = false;
+            reportOccupancy = false;
+        }
+        dynres.sharpness = sharpness;
+        dynres.exposureTexture = toneMapping ? toneMap.exposureTexture() : 0;
+        MemoryAssetScope asset("dynamic_resolution");
+        if (!dynres.init(width, height, targetFrameMs, dynresLog)) return -1;
+        std::cout << "[dynres] Ŀ֡ʱ " << targetFrameMs << " ms֡¼д " << dynresLog << std::endl;
+    }
+
+    Bloom bloom;
+    if (bloomEnabled && !toneMapping && !dynamicRes) {
+        std::cout << "Bloom Ҫ HDR Ŀ꣨ɫӳֱ̬ʣѹر\n";
+        bloomEnabled = false;
+    }
+    if (bloomEnabled) {
+        MemoryAssetScope asset("bloom");
+        if (!bloom.init(width, height, bloomSettings)) return -1;
+    }
 
     camera.position = glm::vec3(0.0f, 1.2f, 7.5f);
+    if (!captureTarget.empty()) gCapture.start(captureTarget, width, height, captureFps);
+    // ģʽΧ;֡WASD Ļֽ̣߳д֮ǰ
+    if (!benchMode) {
+        gPacer.init(window, pacingConfig);
+        gPacer.startInput({ GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D }, [window](float dt) { moveCamera(window, dt); });
+    }
 
     float lastTime = glfwGetTime();
+    int frameNo = 0;
+    double postGpuMs = 0.0;
+    int postGpuSamples = 0;
 
-    while (!glfwWindowShouldClose(window)) {
+    while (benchMode ? frameNo < benchFrames : !glfwWindowShouldClose(window)) {
+        gProfiler.beginFrame();
+        gPacer.beginFrame();
+        gStream.beginFrame();
         float time = glfwGetTime();
         float dt = time - lastTime;
         lastTime = time;
 
-        if (glfwGetKey(window, GLFW_KEY_W)) camera.processKeyboard(GLFW_KEY_W, dt);
-        if (glfwGetKey(window, GLFW_KEY_S)) camera.processKeyboard(GLFW_KEY_S, dt);
-        if (glfwGetKey(window, GLFW_KEY_A)) camera.processKeyboard(GLFW_KEY_A, dt);
-        if (glfwGetKey(window, GLFW_KEY_D)) camera.processKeyboard(GLFW_KEY_D, dt);
+        {
+            PROFILE_SCOPE("input");
+            if (benchMode) {
+                benchRun.frameStart();
+                gReplay.advance();
+                dt = (float)gReplay.dt;
+                benchTarget.bind();
+            }
+            else {
+                gRecorder.update(window, "blackhole");
+                gCapture.handleHotkey(window, "blackhole", captureTarget);
+            }
+            processCameraInput(window, dt);
+            if (processPathToggle(window, computeAvailable && !dynamicRes) && useCompute) reportOccupancy = true;
+        }
+
+        {
+            PROFILE_SCOPE("render");
+            glClear(GL_COLOR_BUFFER_BIT);
+            GLuint outputFbo = benchMode ? benchTarget.fbo : 0;
+            if (dynamicRes) {
+                dynres.update(frameNo, gProfiler.lastGpuMs());
+                dynres.beginScene();
+            }
+            else if (toneMapping) {
+                toneMap.beginScene();
+            }
+
+            // 棺ȡһ¼ֵ˿̺󿽳ֻ֮ݸ
+            glm::vec3 camPos;
+            glm::mat3 camRot;
+            gPacer.latch(window, [&] {
+                camPos = camera.position;
+                camRot = camera.getRotation();
+            });
+
+            if (useCompute) {
+                PROFILE_GPU_SCOPE("blackhole_compute");
+                MemoryAssetScope asset("compute_path");   // ֱ֡ʷ߻ͼ
+                computePath.render(camPos, camRot, 0.9f, quality, width, height);
+            }
+            else {
+                GLuint program = dynamicRes ? programs.back() : programs[quality];
+                glUseProgram(program);
+                if (gStream.enabled) {
+                    StreamConstantsScope constants;
+                    BlackHoleFrame frame;
+                    for (int c = 0; c < 3; c++) frame.camRot[c] = glm::vec4(camRot[c], 0.0f);
+                    frame.camPos = camPos;
+                    frame.spin = 0.9f;
+                    frame.skyTexelAngle = skyCubemap.texelAngle();
+                    frame.skyMaxLod = (float)(skyCubemap.levelCount() - 1);
+                    frame.stepBudget = dynamicRes ? dynres.stepBudget() : 0;
+                    frame.pad = 0.0f;
+                    gStream.pushUniform(StreamBuffer::FRAME_BINDING, frame);
+                }
+                else {
+                    StreamConstantsScope constants;
+                    if (dynamicRes) glUniform1i(glGetUniformLocation(program, "stepBudget"), dynres.stepBudget());
+
+                    glUniform3fv(glGetUniformLocation(program, "camPos"), 1, &camPos[0]);
+                    glUniformMatrix3fv(glGetUniformLocation(program, "camRot"), 1, GL_FALSE, &camRot[0][0]);
+                    glUniform1f(glGetUniformLocation(program, "spin"), 0.9f);
+                    if (skyTex) {
+                        glUniform1i(glGetUniformLocation(program, "skyCube"), 2);
+                        glUniform1f(glGetUniformLocation(program, "skyTexelAngle"), skyCubemap.texelAngle());
+                        glUniform1f(glGetUniformLocation(program, "skyMaxLod"), (float)(skyCubemap.levelCount() - 1));
+                    }
+                    if (diskLutTex) glUniform1i(glGetUniformLocation(program, "diskLUT"), 1);
+                }
 
-        glClear(GL_COLOR_BUFFER_BIT);
+                if (skyTex) {
+                    glActiveTexture(GL_TEXTURE2);
+                    glBindTexture(GL_TEXTURE_CUBE_MAP, skyTex);
+                    glActiveTexture(GL_TEXTURE0);
+                }
+                if (diskLutTex) {
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, diskLutTex);
+                    glActiveTexture(GL_TEXTURE0);
+                }
 
-        glUseProgram(program);
+                {
+                    PROFILE_GPU_SCOPE("blackhole");
+                    glBindVertexArray(vao);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                }
+                if (dynamicRes) {
+                    if (bloomEnabled) {
+                        PROFILE_GPU_SCOPE("bloom");
+                        bloom.apply(dynres.sceneTexture(), dynres.sceneFramebuffer(), dynres.renderWidth(), dynres.renderHeight(), vao);
+                    }
+                    if (toneMapping) {
+                        PROFILE_GPU_SCOPE("exposure");
+                        toneMap.measure(dynres.sceneTexture(), dynres.renderWidth(), dynres.renderHeight(), dt);
+                    }
+                    PROFILE_GPU_SCOPE("upscale");
+                    dynres.endScene(outputFbo, vao);
+                }
+            }
 
-        glUniform3fv(glGetUniformLocation(program, "camPos"), 1, &camera.position[0]);
-        glm::mat3 camRot = camera.getRotation();
-        glUniformMatrix3fv(glGetUniformLocation(program, "camRot"), 1, GL_FALSE, &camRot[0][0]);
-        glUniform1f(glGetUniformLocation(program, "spin"), 0.9f);
+            if (toneMapping && !dynamicRes) {
+                if (bloomEnabled) {
+                    PROFILE_GPU_SCOPE("bloom");
+                    bloom.apply(toneMap.sceneTexture(), toneMap.sceneFramebuffer(), width, height, vao);
+                }
+                {
+                    PROFILE_GPU_SCOPE("exposure");
+                    toneMap.measure(toneMap.sceneTexture(), width, height, dt);
+                }
+                PROFILE_GPU_SCOPE("tonemap");
+                toneMap.resolve(outputFbo, vao);
+            }
+        }
+        gStream.endFrame();
+        gMemory.endFrame(benchMode ? nullptr : window);
+        gCapture.capture(benchMode ? benchTarget.fbo : 0);   // Ӳ֮ǰ¼µֻл
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, hdrTex);
-        glUniform1i(glGetUniformLocation(program, "hdrSky"), 0);
+        // ÿڿ̨һεǰѡ֡ݼ CSV
+        if (dynamicRes && !benchMode && frameNo % 60 == 0) {
+            std::cout << "[dynres] ֡ " << frameNo << "GPU " << gProfiler.lastGpuMs() << " ms"
+                      << dynres.renderWidth() << "" << dynres.renderHeight() << "" << dynres.stepBudget() << " " << std::endl;
+        }
 
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        // л·ĵһ֡һռʣضȴ GPU
+        if (reportOccupancy && useCompute && !benchMode) {
+            printOccupancy(computePath.readOccupancy(), waveSteps);
+            reportOccupancy = false;
+        }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (benchMode) {
+            benchRun.frameEnd(true);
+            gProfiler.endFrame(nullptr);
+            // ʱѯм֡ӳ٣ȡÿ֡ɶֵƽ
+            double exposureMs = gProfiler.gpuPassMs("exposure");
+            if (toneMapping && exposureMs >= 0.0) {
+                postGpuMs += exposureMs + std::max(gProfiler.gpuPassMs("tonemap"), 0.0);
+                postGpuSamples++;
+            }
+            if (bloomEnabled) bloom.recordGpuMs(gProfiler.gpuPassMs("bloom"));
+            if (frameNo++ == 0) gShaders.reportStartup("blackhole");
+            continue;
+        }
+
+        gProfiler.drawOverlay();
+        gPacer.endFrame();
+        {
+            PROFILE_SCOPE("swap");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+            gPacer.sampleInput(window);
+        }
+        gProfiler.endFrame(window);
+        if (bloomEnabled) bloom.recordGpuMs(gProfiler.gpuPassMs("bloom"));
+        if (frameNo++ == 0) gShaders.reportStartup("blackhole");
+    }
+
+    gPacer.shutdown();
+    if (gCapture.active()) {
+        gCapture.stop();
+        gCapture.printStats("blackhole");
+    }
+
+    int result = 0;
+    if (benchMode) {
+        if (!benchConfig.image.empty()) {
+            std::vector<unsigned char> pixels = benchTarget.readPixels();
+            writeImagePPM(benchConfig.image, width, height, pixels.data(), true);
+        }
+        if (useCompute) {
+            MarchOccupancy occ = computePath.readOccupancy();
+            printOccupancy(occ, waveSteps);
+            addOccupancyMetrics(benchRun, occ, waveSteps);
+        }
+        if (dynamicRes) {
+            benchRun.setMetric("target_ms", targetFrameMs);
+            benchRun.setMetric("mean_render_scale", dynres.meanScale());
+            benchRun.setMetric("mean_step_budget", dynres.meanSteps());
+            benchRun.setMetric("over_target_fraction", dynres.overBudgetFraction());
+        }
+        addStreamMetrics(benchRun, gStream);
+        addMemoryMetrics(benchRun, gMemory);
+        if (gCapture.stats.frames) addCaptureMetrics(benchRun, gCapture);
+        if (toneMapping) {
+            // ֱ̬ʱɫӳ䲢Ŵֻͨعͳ
+            benchRun.setMetric("post_gpu_ms", postGpuSamples ? postGpuMs / postGpuSamples : 0.0);
+            benchRun.setMetric("exposure", toneMap.readExposure());
+        }
+        if (bloomEnabled) {
+            benchRun.setMetric("bloom_gpu_ms", bloom.meanGpuMs());
+            // һ֡ HDR Ϊ CPU ʵֱȽϣֱ̬ʵЧ֡仯Ƚϣ
+            if (!dynamicRes) {
+                double psnr = bloom.verifyAgainstCPU(toneMap.sceneTexture(), vao);
+                std::cout << "[bloom]  CPU ʵֱȽϣ PSNR " << psnr << " dB" << std::endl;
+                benchRun.setMetric("bloom_cpu_psnr", psnr);
+            }
+        }
+        if (skyTex) benchRun.setMetric("sky_face_size", (double)skyCubemap.faceSize);
+        result = benchRun.writeReport() ? 0 : -1;
+        gMemory.writeJson("blackhole_memory.json");
+        benchTarget.destroy();
+    }
+
+    if (dynamicRes) {
+        dynres.printSummary();
+        dynres.destroy();
+    }
+    if (bloomEnabled) {
+        bloom.printSummary();
+        bloom.destroy();
     }
+    if (toneMapping) toneMap.destroy();
+    if (computeAvailable) computePath.destroy();
+    if (diskLutTex) glDeleteTextures(1, &diskLutTex);
+    if (skyTex) glDeleteTextures(1, &skyTex);
+    for (GLuint p : programs) glDeleteProgram(p);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    gStream.printStats("blackhole");
+    gPacer.printStats("blackhole");
+    gStream.shutdown();
+    gProfiler.shutdown();
+    gMemory.shutdown();
+    return result;
 }
@@ -0,0 +1,328 @@
+#include "kerr_geodesic.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+// ================= 时空参数 =================
+static const double M = 0.5;   // Rs = 2M = 1
+
+struct KerrRay {
+    double a;         // 自旋参数
+    double L;         // 轴向角动量（E = 1）
+    double Q;         // Carter 常数
+    double cameraE;   // 归一化前的能量：相机 ZAMO 测得的光子能量为 1 / cameraE
+};
+
+// 状态：r, θ, φ, dr/dλ, dθ/dλ（以反向时间积分，见 initialState）
+struct State {
+    double y[5];
+};
+
+static void derivatives(const KerrRay& k, const double* y, double* dy) {
+    double r = y[0], a = k.a, L = k.L;
+    double s = std::sin(y[1]), c = std::cos(y[1]);
+    if (std::fabs(s) < 1e-9) s = s < 0.0 ? -1e-9 : 1e-9;
+
+    double delta = r * r - 2.0 * M * r + a * a;
+    double P = r * r + a * a - a * L;
+    double K = k.Q + (L - a) * (L - a);
+
+    dy[0] = y[3];
+    dy[1] = y[4];
+    // 反向追踪：φ 的导数取负，r、θ 的二阶方程与时间方向无关
+    dy[2] = -(a * P / delta - a + L / (s * s));
+    dy[3] = 2.0 * r * P - (r - M) * K;
+    dy[4] = -a * a * c * s + L * L * c / (s * s * s);
+}
+
+// ================= 坐标映射 =================
+// 场景 (x, y, z) → 右手系 (X, Y, Z) = (x, −z, y)，使 +φ 与吸积盘气体速度同向；再按扁球坐标映射到 BL
+static void sceneToBL(double a, const glm::dvec3& p, double& r, double& theta, double& phi) {
+    double X = p.x, Y = -p.z, Z = p.y;
+    double R2 = X * X + Y * Y + Z * Z;
+    double b = R2 - a * a;
+    r = std::sqrt(0.5 * (b + std::sqrt(b * b + 4.0 * a * a * Z * Z)));
+    theta = std::acos(std::min(std::max(Z / r, -1.0), 1.0));
+    phi = std::atan2(Y, X);
+}
+
+static glm::dvec3 blToScene(double a, double r, double theta, double phi) {
+    double rho = std::sqrt(r * r + a * a);
+    double X = rho * std::sin(theta) * std::cos(phi);
+    double Y = rho * std::sin(theta) * std::sin(phi);
+    double Z = r * std::cos(theta);
+    return glm::dvec3(X, Z, -Y);
+}
+
+// 状态对 λ 的导数映射到场景坐标中的速度（平直扁球坐标的链式法则）
+static glm::dvec3 sceneVelocity(double a, const double* y, const double* dy) {
+    double r = y[0], s = std::sin(y[1]), c = std::cos(y[1]);
+    double cp = std::cos(y[2]), sp = std::sin(y[2]);
+    double rho = std::sqrt(r * r + a * a);
+    double drho = r * dy[0] / rho;
+    double dX = drho * s * cp + rho * c * dy[1] * cp - rho * s * sp * dy[2];
+    double dY = drho * s * sp + rho * c * dy[1] * sp + rho * s * cp * dy[2];
+    double dZ = dy[0] * c - r * s * dy[1];
+    return glm::dvec3(dX, dZ, -dY);
+}
+
+// ================= 初始条件 =================
+// 相机视为 ZAMO（零角动量观者）。到达相机的光子沿 −n 传播，先求它的 E、L、Q，
+// 再把一阶导数取负得到反向追踪的初始状态
+static void initialState(double a, const glm::dvec3& camPos, const glm::dvec3& n, KerrRay& k, State& st) {
+    double r, theta, phi;
+    sceneToBL(a, camPos, r, theta, phi);
+    double s = std::sin(theta), c = std::cos(theta);
+    double cp = std::cos(phi), sp = std::sin(phi);
+    double rho = std::sqrt(r * r + a * a);
+
+    // 扁球坐标的正交单位基（场景坐标）
+    glm::dvec3 er = glm::normalize(glm::dvec3(r / rho * s * cp, c, -(r / rho * s * sp)));
+    glm::dvec3 et = glm::normalize(glm::dvec3(rho * c * cp, -r * s, -(rho * c * sp)));
+    glm::dvec3 ep(-sp, 0.0, -cp);
+    double nr = glm::dot(n, er), nt = glm::dot(n, et), np = glm::dot(n, ep);
+
+    double sigma = r * r + a * a * c * c;
+    double delta = r * r - 2.0 * M * r + a * a;
+    double A = (r * r + a * a) * (r * r + a * a) - a * a * delta * s * s;
+    double alpha = std::sqrt(sigma * delta / A);
+    double omega = 2.0 * M * a * r / A;
+    double varpi = std::sqrt(A / sigma) * s;
+
+    // 物理光子的局部方向为 −n，局部能量为 1
+    double E = alpha - omega * varpi * np;
+    double L = -varpi * np / E;
+    double pTheta = -std::sqrt(sigma) * nt / E;
+    double pR = -std::sqrt(sigma / delta) * nr / E;
+
+    k.a = a;
+    k.L = L;
+    k.Q = pTheta * pTheta + c * c * (L * L / (s * s) - a * a);
+    k.cameraE = E;
+    st.y[0] = r;
+    st.y[1] = theta;
+    st.y[2] = phi;
+    st.y[3] = -delta * pR;
+    st.y[4] = -pTheta;
+}
+
+// 一阶约束残差，相对于 (r² + a²)² 归一化
+static double constraintError(const KerrRay& k, const double* y) {
+    double r = y[0], a = k.a;
+    double delta = r * r - 2.0 * M * r + a * a;
+    double P = r * r + a * a - a * k.L;
+    double R = P * P - delta * (k.Q + (k.L - a) * (k.L - a));
+    return std::fabs(y[3] * y[3] - R) / ((r * r + a * a) * (r * r + a * a));
+}
+
+// 开普勒顺行圆轨道气体的频移因子 g = E_obs / E_emit（相机 ZAMO 测得的能量为 1 / cameraE）
+static double diskRedshiftKerr(const KerrRay& k, double r, double theta) {
+    double a = k.a;
+    double s = std::sin(theta), c = std::cos(theta);
+    double sigma = r * r + a * a * c * c;
+    double gtt = -(1.0 - 2.0 * M * r / sigma);
+    double gtp = -2.0 * M * a * r * s * s / sigma;
+    double gpp = (r * r + a * a + 2.0 * M * a * a * r * s * s / sigma) * s * s;
+    double Omega = std::sqrt(M) / (r * std::sqrt(r) + a * std::sqrt(M));
+    double norm = -(gtt + 2.0 * Omega * gtp + Omega * Omega * gpp);
+    if (norm <= 0.0) return 0.0;
+    double ut = 1.0 / std::sqrt(norm);
+    return 1.0 / (k.cameraE * ut * (1.0 - Omega * k.L));
+}
+
+// ================= Dormand–Prince 5(4) =================
+// 自治方程不需要节点 c_i，只列出系数
+static const double A21 = 1.0 / 5;
+static const double A31 = 3.0 / 40, A32 = 9.0 / 40;
+static const double A41 = 44.0 / 45, A42 = -56.0 / 15, A43 = 32.0 / 9;
+static const double A51 = 19372.0 / 6561, A52 = -25360.0 / 2187, A53 = 64448.0 / 6561, A54 = -212.0 / 729;
+static const double A61 = 9017.0 / 3168, A62 = -355.0 / 33, A63 = 46732.0 / 5247, A64 = 49.0 / 176, A65 = -5103.0 / 18656;
+static const double B1 = 35.0 / 384, B3 = 500.0 / 1113, B4 = 125.0 / 192, B5 = -2187.0 / 6784, B6 = 11.0 / 84;
+static const double E1 = B1 - 5179.0 / 57600, E3 = B3 - 7571.0 / 16695, E4 = B4 - 393.0 / 640,
+                    E5 = B5 - (-92097.0 / 339200), E6 = B6 - 187.0 / 2100, E7 = -1.0 / 40;
+
+// 试走一步 h，返回误差范数（≤ 1 可接受）；k1 为起点导数，成功时 k7 为终点导数（FSAL）
+static double dopriStep(const KerrRay& k, const double* y, const double* k1, double h, double tol,
+                        double* yOut, double* k7) {
+    double k2[5], k3[5], k4[5], k5[5], k6[5], t[5];
+    for (int i = 0; i < 5; i++) t[i] = y[i] + h * A21 * k1[i];
+    derivatives(k, t, k2);
+    for (int i = 0; i < 5; i++) t[i] = y[i] + h * (A31 * k1[i] + A32 * k2[i]);
+    derivatives(k, t, k3);
+    for (int i = 0; i < 5; i++) t[i] = y[i] + h * (A41 * k1[i] + A42 * k2[i] + A43 * k3[i]);
+    derivatives(k, t, k4);
+    for (int i = 0; i < 5; i++) t[i] = y[i] + h * (A51 * k1[i] + A52 * k2[i] + A53 * k3[i] + A54 * k4[i]);
+    derivatives(k, t, k5);
+    for (int i = 0; i < 5; i++) t[i] = y[i] + h * (A61 * k1[i] + A62 * k2[i] + A63 * k3[i] + A64 * k4[i] + A65 * k5[i]);
+    derivatives(k, t, k6);
+    for (int i = 0; i < 5; i++) yOut[i] = y[i] + h * (B1 * k1[i] + B3 * k3[i] + B4 * k4[i] + B5 * k5[i] + B6 * k6[i]);
+    derivatives(k, yOut, k7);
+
+    double err = 0.0;
+    for (int i = 0; i < 5; i++) {
+        double e = h * (E1 * k1[i] + E3 * k3[i] + E4 * k4[i] + E5 * k5[i] + E6 * k6[i] + E7 * k7[i]);
+        double scale = tol + tol * std::max(std::fabs(y[i]), std::fabs(yOut[i]));
+        err = std::max(err, std::fabs(e) / scale);
+    }
+    return err;
+}
+
+// ================= 单条光线 =================
+glm::vec3 traceKerr(const BlackHoleParams& params, const KerrSettings& settings, glm::vec2 uv, KerrTrace* info) {
+    // 与 traceBlackHole 相同的针孔相机
+    glm::vec2 p = uv * 2.0f - 1.0f;
+    p.x *= 1.6f;
+    glm::dvec3 n = glm::normalize(glm::dvec3(params.camRot * glm::vec3(p.x, p.y, -1.9f)));
+
+    double a = params.spin * M;
+    double horizon = M + std::sqrt(M * M - a * a);
+    KerrRay k;
+    State st;
+    initialState(a, glm::dvec3(params.camPos), n, k, st);
+
+    KerrTrace trace;
+    double* y = st.y;
+    double dy[5];
+    derivatives(k, y, dy);
+    double h = settings.diskStep / std::max(glm::length(sceneVelocity(a, y, dy)), 1e-12);
+    glm::dvec3 pos = blToScene(a, y[0], y[1], y[2]);
+    glm::vec3 color(0.0f);
+
+    while (true) {
+        if (y[0] < horizon * 1.02) {
+            trace.captured = true;
+            break;
+        }
+        if (trace.steps >= settings.maxSteps) {
+            trace.unresolved = true;
+            break;
+        }
+        if (y[0] > settings.escapeRadius && y[3] > 0.0) {
+            trace.finalDir = glm::normalize(sceneVelocity(a, y, dy));
+            break;
+        }
+
+        // 积分发光时，盘体附近弦长不超过 diskStep，远离盘体时最多走到包围区域边界（且不超过 r/4）；
+        // 只求几何时步长完全由误差控制
+        double speed = std::max(glm::length(sceneVelocity(a, y, dy)), 1e-12);
+        double chordCap = 0.25 * y[0];
+        if (params.diskLUT) {
+            double bound = diskBoundDistance(glm::vec3(pos));
+            chordCap = bound > settings.diskStep ? std::min(bound, chordCap) : settings.diskStep;
+        }
+        h = std::min(h, chordCap / speed);
+
+        double yNew[5], dyNew[5];
+        double err = dopriStep(k, y, dy, h, settings.tolerance, yNew, dyNew);
+        if (err > 1.0 || !std::isfinite(err)) {
+            h *= std::max(0.2, 0.9 * std::pow(err, -0.2));
+            if (!std::isfinite(err)) h *= 0.1;
+            continue;
+        }
+
+        glm::dvec3 posNew = blToScene(a, yNew[0], yNew[1], yNew[2]);
+        // 体积发光：起点密度 × 弦长，按 medium 档位步长 0.02 归一化，与近似模型的单步贡献一致
+        float density = diskVolume(glm::vec3(pos));
+        if (params.diskLUT && density > 0.001f) {
+            double g = diskRedshiftKerr(k, y[0], y[1]);
+            float rd = (float)std::sqrt(pos.x * pos.x + pos.z * pos.z);
+            double chord = glm::length(posNew - pos);
+            color += params.diskLUT->sample(rd, (float)g) * density * 0.045f * (float)(chord / 0.02);
+        }
+
+        for (int i = 0; i < 5; i++) {
+            y[i] = yNew[i];
+            dy[i] = dyNew[i];
+        }
+        pos = posNew;
+        trace.steps++;
+        trace.constraintError = std::max(trace.constraintError, constraintError(k, y));
+        h *= std::min(5.0, 0.9 * std::pow(std::max(err, 1e-10), -0.2));
+    }
+
+    trace.emission = color;
+    if (info) *info = trace;
+    if (!trace.captured && !trace.unresolved) color += starfield(glm::vec3(trace.finalDir));
+    return color;
+}
+
+void renderKerrCPU(const BlackHoleParams& params, const KerrSettings& settings, int width, int height,
+                   std::vector<glm::vec3>& out, std::vector<KerrTrace>* info, unsigned threads) {
+    out.resize((size_t)width * height);
+    if (info) info->resize(out.size());
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // 按行动态分发，与 renderBlackHoleCPU 相同
+    std::atomic<int> nextRow(0);
+    auto worker = [&]() {
+        for (int y = nextRow++; y < height; y = nextRow++) {
+            for (int x = 0; x < width; x++) {
+                glm::vec2 uv((x + 0.5f) / width, (y + 0.5f) / height);
+                size_t idx = (size_t)y * width + x;
+                out[idx] = traceKerr(params, settings, uv, info ? &(*info)[idx] : nullptr);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+// ================= 逐像素误差 =================
+KerrComparison compareWithKerr(const std::vector<TraceInfo>& approx, const std::vector<KerrTrace>& kerr) {
+    KerrComparison cmp;
+    size_t n = std::min(approx.size(), kerr.size());
+    cmp.angleDeg.assign(n, 0.0f);
+    if (n == 0) return cmp;
+
+    std::vector<double> escaped;
+    uint64_t mismatch = 0, steps = 0;
+    double squared = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        const TraceInfo& a = approx[i];
+        const KerrTrace& k = kerr[i];
+        steps += k.steps;
+        cmp.maxConstraintError = std::max(cmp.maxConstraintError, k.constraintError);
+        // 真值未知的像素不算作吸收，也不参与发光与方向误差
+        if (k.unresolved) {
+            cmp.unresolved++;
+            cmp.angleDeg[i] = -1.0f;
+            continue;
+        }
+
+        glm::vec3 c = glm::clamp(a.emission, 0.0f, 1.0f) - glm::clamp(k.emission, 0.0f, 1.0f);
+        squared += (c.x * c.x + c.y * c.y + c.z * c.z) / 3.0;
+
+        bool approxCaptured = a.fade < 0.002f;
+        if (approxCaptured != k.captured) {
+            mismatch++;
+            cmp.angleDeg[i] = 180.0f;
+        }
+        else if (!k.captured) {
+            double d = glm::dot(glm::normalize(glm::dvec3(a.finalDir)), k.finalDir);
+            double deg = glm::degrees(std::acos(std::min(1.0, std::max(-1.0, d))));
+            cmp.angleDeg[i] = (float)deg;
+            escaped.push_back(deg);
+        }
+    }
+
+    cmp.meanKerrSteps = (double)steps / n;
+    size_t resolved = n - cmp.unresolved;
+    if (resolved == 0) return cmp;
+    cmp.captureMismatch = (double)mismatch / resolved;
+    double mse = squared / resolved;
+    cmp.emissionPSNR = mse > 0.0 ? 10.0 * std::log10(1.0 / mse) : 99.0;
+    if (!escaped.empty()) {
+        double sum = 0.0;
+        for (double e : escaped) sum += e;
+        cmp.meanAngleDeg = sum / escaped.size();
+        size_t p95 = std::min(escaped.size() - 1, (size_t)(0.95 * escaped.size()));
+        std::nth_element(escaped.begin(), escaped.begin() + p95, escaped.end());
+        cmp.p95AngleDeg = escaped[p95];
+        cmp.maxAngleDeg = *std::max_element(escaped.begin(), escaped.end());
+    }
+    return cmp;
+}
@@ -2,13 +2,46 @@
 out vec4 FragColor;
 in vec2 uv;
 
+// ================= 每帧常量 =================
+// STREAM_UNIFORMS 变体从流式环形缓冲按偏移绑定的 uniform 块读取（std140，与宿主的 BlackHoleFrame 逐字节一致），
+// 否则为逐个 glUniform 设置的普通 uniform（--no-stream）
+#ifdef STREAM_UNIFORMS
+layout(std140) uniform FrameBlock {
+    mat3 camRot;
+    vec3 camPos;
+    float spin;
+    float skyTexelAngle;   // 0 级 texel 在面中心张开的角度
+    float skyMaxLod;
+    int stepBudget;
+};
+#else
 uniform vec3 camPos;
 uniform mat3 camRot;
 uniform float spin;
+#endif
 
 const float Rs = 1.0;
-const float STEP = 0.02;
-const int MAX_STEPS = 720;
+// 步长与最大步数可由宿主以 #define 注入（画质档位），未注入时使用默认值
+#ifndef STEP
+#define STEP 0.02
+#endif
+#ifndef MAX_STEPS
+#define MAX_STEPS 720
+#endif
+// 吸积盘发光与视界衰减按实际步长相对参考步长（medium 档位）归一化，
+// 档位与动态步数预算改变步长时亮度不变，只改变积分精度
+const float REF_STEP = 0.02;
+
+// ================= 动态步数预算（DYNAMIC_BUDGET） =================
+// 宿主每帧给出 stepBudget（≤ MAX_STEPS），积分距离 MAX_STEPS × STEP 不变，步长随预算放大
+#ifdef DYNAMIC_BUDGET
+#ifndef STREAM_UNIFORMS
+uniform int stepBudget;
+#endif
+float stepLen;
+#else
+const float stepLen = STEP;
+#endif
 
 // ================= HDR 星空 =================
 vec3 starfield(vec3 d) {
@@ -28,6 +61,97 @@ float diskVolume(vec3 p) {
     return thickness * radial;
 }
 
+// ================= 黑体发光查找表（DISK_LUT） =================
+// 与 disk_emission.h 一致：横轴半径 r_xz，纵轴频移因子 g，每个盘内采样点一次查表
+#ifdef DISK_LUT
+uniform sampler2D diskLUT;
+const vec2 LUT_SIZE = vec2(64.0, 128.0);
+const vec2 LUT_MIN = vec2(1.8, 0.2);
+const vec2 LUT_MAX = vec2(7.0, 2.0);
+
+// Schwarzschild 引力红移 × 开普勒圆轨道的相对论多普勒；光子沿 -dir 传播
+float diskRedshift(vec3 pos, vec3 dir) {
+    float rd = length(pos.xz);
+    float beta = min(sqrt(Rs / (2.0 * max(rd - Rs, 0.5 * Rs))), 0.99);
+    vec3 diskVel = normalize(cross(vec3(0,1,0), pos));
+    float mu = dot(diskVel, dir);
+
+    float gravity = sqrt(max(1.0 - Rs / length(pos), 0.0));
+    return gravity * sqrt(1.0 - beta * beta) / (1.0 + beta * mu);
+}
+
+vec3 diskEmission(vec3 pos, vec3 dir) {
+    vec2 t = clamp((vec2(length(pos.xz), diskRedshift(pos, dir)) - LUT_MIN) / (LUT_MAX - LUT_MIN), 0.0, 1.0);
+    // 映射到首末 texel 中心，与 CPU 的双线性采样一致
+    return textureLod(diskLUT, (t * (LUT_SIZE - 1.0) + 0.5) / LUT_SIZE, 0.0).rgb;
+}
+#endif
+
+// ================= 立方体贴图星空与光线微分（SKY_CUBEMAP） =================
+// 每条光线携带相邻像素（x / y 方向）的位置与方向微分，随步进按透镜加速度的雅可比矩阵一阶传播；
+// 结束时由方向微分的长度（相邻光线的夹角）选择 mip 级别，光子环附近被强烈缩小的星空自动取粗的级别
+#ifdef SKY_CUBEMAP
+uniform samplerCube skyCube;
+#ifndef STREAM_UNIFORMS
+uniform float skyTexelAngle;   // 0 级 texel 在面中心张开的角度
+uniform float skyMaxLod;
+#endif
+
+// 每步方向增量 a(p) = −p̂·L(r) + spin·(p̂ × y)/r²（L = Rs/r²·(1 + 3.8e^(−r))）沿 v 的方向导数。
+// 帧拖拽项不能省略：spin = 0.9 时只算透镜项，光子环外侧的微分会偏大 10%–20%
+vec3 deflectionJacobian(vec3 pos, float r, vec3 v) {
+    vec3 n = pos / r;
+    float e = 3.8 * exp(-r);
+    float L = Rs / (r * r) * (1.0 + e);
+    float dL = -2.0 * L / r - Rs / (r * r) * e;
+    float nv = dot(n, v);
+    vec3 dn = (v - n * nv) / r;
+    vec3 lens = -L * dn - n * (dL * nv);
+    vec3 drag = spin * (cross(dn, vec3(0,1,0)) - 2.0 * cross(n, vec3(0,1,0)) * nv / r) / (r * r);
+    return lens + drag;
+}
+
+// 与步进顺序一致：偏折 → 归一化（rawLength 为归一化前的长度）→ 前进 h
+void propagateDifferential(vec3 pos, float r, vec3 dir, float rawLength, float h, inout vec3 dP, inout vec3 dD) {
+    vec3 raw = dD + deflectionJacobian(pos, r, dP) * h;
+    dD = (raw - dir * dot(dir, raw)) / rawLength;
+    dP += dD * h;
+}
+
+vec3 skyRadiance(vec3 dir, vec3 dDx, vec3 dDy) {
+    float footprint = max(length(dDx), length(dDy));
+    float lod = clamp(log2(max(footprint / skyTexelAngle, 1e-8)), 0.0, skyMaxLod);
+    return textureLod(skyCube, dir, lod).rgb;
+}
+#endif
+
+// ================= 空域跳跃（SKIP_EMPTY） =================
+// 盘体包围区域：|y| < DISK_HALF_HEIGHT 且 1.8 < r_xz < 7 的环形平板。
+// exp(-4.5·h) < 0.001 时密度必然低于采样阈值，即 |y| > ln(1000) / 4.5 ≈ 1.535
+const float DISK_HALF_HEIGHT = 1.54;
+const float SKIP_MAX = 8.0;           // 大步长上限（相对步长的倍数）
+const float SKIP_LENS_RADIUS = 4.0;   // 步长按 (r / SKIP_LENS_RADIUS)² 放大
+
+// 到包围区域的距离下界，区域内为负
+float diskBoundDistance(vec3 p) {
+    float r = length(p.xz);
+    float dy = abs(p.y) - DISK_HALF_HEIGHT;
+    float dr = max(r - 7.0, 1.8 - r);
+    return max(dy, dr);
+}
+
+// 视界区外且远离盘体时按距离下界取大步长，只做透镜偏折；与 BlackHoleCPU.cpp 一致
+float skipStep(vec3 pos, float r, float travelled, out bool inVolume) {
+    float d = diskBoundDistance(pos);
+    inVolume = d <= 0.0;
+    float h = stepLen;
+    if (r > Rs * 2.2 && d > stepLen) {
+        float lensLimit = stepLen * min(SKIP_MAX, r * r / (SKIP_LENS_RADIUS * SKIP_LENS_RADIUS));
+        h = max(stepLen, min(min(d, lensLimit), r - Rs * 2.2));
+    }
+    return min(h, float(MAX_STEPS) * STEP - travelled);
+}
+
 // ================= 电影级多普勒 =================
 vec3 cinematicDoppler(float v) {
     // v ∈ [-1,1]
@@ -48,33 +172,59 @@ void main() {
 
     vec3 dir = normalize(camRot * vec3(p, -1.9));
     vec3 pos = camPos;
+#ifdef SKY_CUBEMAP
+    // 初始方向微分：uv 的屏幕导数在全屏四边形上处处相同；所有光线从同一点出发，位置微分为 0
+    vec3 view = camRot * vec3(p, -1.9);
+    vec3 dvx = camRot * vec3(2.0 * 1.6 * dFdx(uv).x, 0.0, 0.0);
+    vec3 dvy = camRot * vec3(0.0, 2.0 * dFdy(uv).y, 0.0);
+    vec3 dDx = (dvx - dir * dot(dir, dvx)) / length(view);
+    vec3 dDy = (dvy - dir * dot(dir, dvy)) / length(view);
+    vec3 dPx = vec3(0.0), dPy = vec3(0.0);
+#endif
 
     vec3 color = vec3(0.0);
     float fade = 1.0;
+    float travelled = 0.0;
+#ifdef DYNAMIC_BUDGET
+    stepLen = float(MAX_STEPS) * STEP / float(clamp(stepBudget, 1, MAX_STEPS));
+#endif
 
     for (int i = 0; i < MAX_STEPS; i++) {
+#ifdef DYNAMIC_BUDGET
+        if (i >= stepBudget) break;
+#endif
         float r = length(pos);
 
+        float h = stepLen;
+        bool inVolume = true;
+#ifdef SKIP_EMPTY
+        h = skipStep(pos, r, travelled, inVolume);
+#endif
+
         // ================= 超大事件视界反转区 =================
         float horizonFade = smoothstep(Rs * 0.9, Rs * 2.2, r);
-        fade *= mix(0.92, 1.0, horizonFade);
+        fade *= pow(mix(0.92, 1.0, horizonFade), h / REF_STEP);
 
         if (r < Rs * 2.2) {
             vec3 inward = normalize(pos);
             dir = normalize(mix(-inward, dir, horizonFade));
 
             float photon = (1.0 - horizonFade) * 6.0;
-            dir += -inward * photon * STEP;
+            dir += -inward * photon * stepLen;
         }
 
         // ================= 体积吸积盘 =================
-        float density = diskVolume(pos);
+        float density = inVolume ? diskVolume(pos) : 0.0;
         if (density > 0.001) {
+#ifdef DISK_LUT
+            vec3 diskCol = diskEmission(pos, dir);
+#else
             vec3 diskVel = normalize(cross(vec3(0,1,0), pos));
             float v = dot(diskVel, dir);
 
             vec3 diskCol = cinematicDoppler(v);
-            color += diskCol * density * 0.045 * fade;
+#endif
+            color += diskCol * density * 0.045 * fade * (h / REF_STEP);
         }
 
         // ================= 强引力透镜 =================
@@ -82,21 +232,36 @@ void main() {
         lens *= 1.0 + 3.8 * exp(-r);
 
         vec3 gravity = -normalize(pos) * lens;
-        dir += gravity * STEP;
+        dir += gravity * h;
 
         // ================= Kerr 帧拖拽 =================
         vec3 frameDrag =
             spin * cross(normalize(pos), vec3(0,1,0)) / (r * r);
-        dir += frameDrag * STEP;
+        dir += frameDrag * h;
 
+#ifdef SKY_CUBEMAP
+        float rawLength = length(dir);
+#endif
         dir = normalize(dir);
-        pos += dir * STEP;
+#ifdef SKY_CUBEMAP
+        propagateDifferential(pos, r, dir, rawLength, h, dPx, dDx);
+        propagateDifferential(pos, r, dir, rawLength, h, dPy, dDy);
+#endif
+        pos += dir * h;
+        travelled += h;
 
         if (fade < 0.002) break;
+#ifdef SKIP_EMPTY
+        if (travelled >= float(MAX_STEPS) * STEP) break;
+#endif
     }
 
     // ================= 星空（被翻转采样） =================
+#ifdef SKY_CUBEMAP
+    color += skyRadiance(dir, dDx, dDy) * fade;
+#else
     color += starfield(dir) * fade;
+#endif
 
     FragColor = vec4(color, 1.0);
 }
@@ -0,0 +1,47 @@
+#version 330 core
+out vec4 FragColor;
+in vec2 uv;
+
+// ================= Bloom 降采样 =================
+// 双重滤波的下采样：目标分辨率为源的一半，中心双线性样本正好平均 4 个源 texel，权重 ×4；
+// 再加四个相隔一个源 texel 的对角样本，共 8 份，覆盖 4×4 个源 texel，比逐级 2×2 平均更少闪烁。
+// PREFILTER 变体从场景取样，每个样本先过软阈值。applyBloomCPU（Bloom.cpp）逐行对应，修改时两处保持一致
+uniform sampler2D source;
+uniform vec2 sourceScale;   // 有效区域 / 纹理尺寸
+uniform vec2 texelSize;     // 1 / 纹理尺寸
+
+#ifdef PREFILTER
+uniform float threshold;
+uniform float knee;
+
+const float MAX_HDR = 1.0e4;   // 个别极亮像素（光子环）不让整片光晕发白
+
+// 阈值以下为 0，[threshold - knee, threshold + knee] 内二次过渡，以上减去阈值
+vec3 prefilter(vec3 c) {
+    c = min(c, vec3(MAX_HDR));
+    float b = max(c.r, max(c.g, c.b));
+    float soft = clamp(b - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 1e-4);
+    return c * (max(soft, b - threshold) / max(b, 1e-4));
+}
+#endif
+
+vec3 fetch(vec2 p) {
+    p = clamp(p, 0.5 * texelSize, sourceScale - 0.5 * texelSize);
+    vec3 c = textureLod(source, p, 0.0).rgb;
+#ifdef PREFILTER
+    c = prefilter(c);
+#endif
+    return c;
+}
+
+void main() {
+    vec2 p = uv * sourceScale;
+    vec2 t = texelSize;
+    vec3 sum = fetch(p) * 4.0;
+    sum += fetch(p + vec2(-t.x, -t.y));
+    sum += fetch(p + vec2(t.x, -t.y));
+    sum += fetch(p + vec2(-t.x, t.y));
+    sum += fetch(p + vec2(t.x, t.y));
+    FragColor = vec4(sum / 8.0, 1.0);
+}
@@ -0,0 +1,30 @@
+#version 330 core
+out vec4 FragColor;
+in vec2 uv;
+
+// ================= 横向光芒 =================
+// 变形（anamorphic）镜头的水平拉丝：在 1/4 分辨率的 bloom 级上做几遍 7 抽头水平模糊，
+// 第 p 遍的抽头间距为 4^p 个 texel，几遍之后覆盖数百个像素而每遍只有 7 次采样。
+// 权重按距离指数衰减并归一化，能量不变。applyBloomCPU（Bloom.cpp）逐行对应
+uniform sampler2D source;
+uniform vec2 sourceScale;   // 有效区域 / 纹理尺寸
+uniform vec2 texelSize;     // 1 / 纹理尺寸
+uniform float stepTexels;   // 本遍抽头间距
+uniform float falloff;      // 每 texel 的权重衰减
+
+vec3 fetch(vec2 p) {
+    p = clamp(p, 0.5 * texelSize, sourceScale - 0.5 * texelSize);
+    return textureLod(source, p, 0.0).rgb;
+}
+
+void main() {
+    vec2 p = uv * sourceScale;
+    vec3 sum = vec3(0.0);
+    float total = 0.0;
+    for (int k = -3; k <= 3; k++) {
+        float w = pow(falloff, abs(float(k)) * stepTexels);
+        sum += fetch(p + vec2(float(k) * stepTexels * texelSize.x, 0.0)) * w;
+        total += w;
+    }
+    FragColor = vec4(sum / total, 1.0);
+}
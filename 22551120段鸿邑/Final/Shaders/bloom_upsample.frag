@@ -0,0 +1,42 @@
+#version 330 core
+out vec4 FragColor;
+in vec2 uv;
+
+// ================= Bloom 升采样 =================
+// 双重滤波的上采样：源为下一级（分辨率一半），四个相隔一个源 texel 的十字样本权重 1，
+// 四个相隔半个 texel 的对角样本权重 2，共 12 份，近似 3×3 tent。结果以加法混合写入上一级。
+// COMPOSITE 变体放大第 0 级并叠加横向光芒，以加法混合写回 HDR 场景。applyBloomCPU（Bloom.cpp）逐行对应
+uniform sampler2D source;
+uniform vec2 sourceScale;   // 有效区域 / 纹理尺寸
+uniform vec2 texelSize;     // 1 / 纹理尺寸
+
+#ifdef COMPOSITE
+uniform float intensity;
+uniform sampler2D streakTex;
+uniform vec2 streakScale;
+uniform vec2 streakTexel;
+uniform vec3 streakColor;   // 强度 × 色调，关闭光芒时为 0
+#endif
+
+vec3 fetch(vec2 p) {
+    p = clamp(p, 0.5 * texelSize, sourceScale - 0.5 * texelSize);
+    return textureLod(source, p, 0.0).rgb;
+}
+
+void main() {
+    vec2 p = uv * sourceScale;
+    vec2 t = texelSize;
+    vec3 sum = fetch(p + vec2(-t.x, 0.0)) + fetch(p + vec2(t.x, 0.0))
+             + fetch(p + vec2(0.0, -t.y)) + fetch(p + vec2(0.0, t.y));
+    sum += 2.0 * (fetch(p + 0.5 * vec2(-t.x, -t.y)) + fetch(p + 0.5 * vec2(t.x, -t.y))
+                + fetch(p + 0.5 * vec2(-t.x, t.y)) + fetch(p + 0.5 * vec2(t.x, t.y)));
+    vec3 c = sum / 12.0;
+#ifdef COMPOSITE
+    c *= intensity;
+    if (any(greaterThan(streakColor, vec3(0.0)))) {
+        vec2 q = clamp(uv * streakScale, 0.5 * streakTexel, streakScale - 0.5 * streakTexel);
+        c += streakColor * textureLod(streakTex, q, 0.0).rgb;
+    }
+#endif
+    FragColor = vec4(c, 1.0);
+}
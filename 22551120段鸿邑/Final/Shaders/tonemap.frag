@@ -0,0 +1,25 @@
+#version 330 core
+out vec4 FragColor;
+in vec2 uv;
+
+// ================= 色调映射 =================
+// HDR 场景乘以自动曝光后经 Hable 的 filmic 曲线（Uncharted 2）压到 [0, 1]，再 gamma 编码输出。
+// 曲线的肩部让吸积盘内缘与光子环平滑地趋于饱和，而不是硬截断成一片白；趾部保留星空暗部的层次。
+// upscale_sharpen.frag 的 TONEMAP 变体使用同一条曲线，修改时两处保持一致
+uniform sampler2D source;        // 与输出同尺寸，逐像素读取
+uniform sampler2D exposureTex;   // 1×1，r 为当前曝光
+
+const float EXPOSURE_BIAS = 2.0;
+const float WHITE = 11.2;        // 映射到 1 的线性值
+
+vec3 hable(vec3 x) {
+    const float A = 0.15, B = 0.50, C = 0.10, D = 0.20, E = 0.02, F = 0.30;
+    return (x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F) - E / F;
+}
+
+void main() {
+    float exposure = texelFetch(exposureTex, ivec2(0), 0).r;
+    vec3 hdr = texelFetch(source, ivec2(gl_FragCoord.xy), 0).rgb;
+    vec3 mapped = hable(hdr * exposure * EXPOSURE_BIAS) / hable(vec3(WHITE));
+    FragColor = vec4(pow(clamp(mapped, 0.0, 1.0), vec3(1.0 / 2.2)), 1.0);
+}
@@ -0,0 +1,55 @@
+#version 330 core
+out vec4 FragColor;
+in vec2 uv;
+
+// ================= 放大 + 对比度自适应锐化 =================
+// source 只有左下角 sourceScale 比例的区域有效（动态分辨率在满尺寸纹理中渲染子矩形）。
+// 中心用双线性放大，再与上下左右相隔一个源 texel 的样本做十字形锐化：
+// 权重随局部对比度自适应（参照 AMD CAS），已经很锐的边缘（局部最小值接近 0 或最大值接近 1）减弱锐化，避免振铃
+uniform sampler2D source;
+uniform vec2 sourceScale;   // 渲染尺寸 / 纹理尺寸
+uniform vec2 texelSize;     // 1 / 纹理尺寸
+uniform float sharpness;    // 0 = 只放大，1 = 最强
+
+#ifdef TONEMAP
+// 色调映射与 tonemap.frag 相同，放在锐化之前：CAS 的权重按 [0, 1] 的显示值设计
+uniform sampler2D exposureTex;   // 1×1，r 为当前曝光
+float exposure;
+
+const float EXPOSURE_BIAS = 2.0;
+const float WHITE = 11.2;
+
+vec3 hable(vec3 x) {
+    const float A = 0.15, B = 0.50, C = 0.10, D = 0.20, E = 0.02, F = 0.30;
+    return (x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F) - E / F;
+}
+#endif
+
+vec3 fetch(vec2 p) {
+    p = clamp(p, 0.5 * texelSize, sourceScale - 0.5 * texelSize);
+    vec3 c = textureLod(source, p, 0.0).rgb;
+#ifdef TONEMAP
+    c = pow(clamp(hable(c * exposure * EXPOSURE_BIAS) / hable(vec3(WHITE)), 0.0, 1.0), vec3(1.0 / 2.2));
+#endif
+    return clamp(c, 0.0, 1.0);
+}
+
+void main() {
+#ifdef TONEMAP
+    exposure = texelFetch(exposureTex, ivec2(0), 0).r;
+#endif
+    vec2 p = uv * sourceScale;
+    vec3 e = fetch(p);
+    vec3 a = fetch(p - vec2(0.0, texelSize.y));
+    vec3 b = fetch(p - vec2(texelSize.x, 0.0));
+    vec3 c = fetch(p + vec2(texelSize.x, 0.0));
+    vec3 d = fetch(p + vec2(0.0, texelSize.y));
+
+    vec3 mn = min(e, min(min(a, b), min(c, d)));
+    vec3 mx = max(e, max(max(a, b), max(c, d)));
+    vec3 amp = sqrt(clamp(min(mn, 1.0 - mx) / max(mx, 1e-4), 0.0, 1.0));
+    vec3 w = -amp / mix(8.0, 5.0, sharpness);
+
+    vec3 color = (e + w * (a + b + c + d)) / (1.0 + 4.0 * w);
+    FragColor = vec4(mix(e, clamp(color, 0.0, 1.0), step(0.001, sharpness)), 1.0);
+}
@@ -0,0 +1,113 @@
+#include "sky_cubemap.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+static const float PI = 3.14159265358979f;
+
+// GL 约定：major 轴为 ±X/±Y/±Z，sc / tc 按规范表 8.19 取值，这里反解出方向
+glm::vec3 cubeFaceDirection(int face, float s, float t) {
+    switch (face) {
+    case 0: return glm::vec3(1.0f, -t, -s);
+    case 1: return glm::vec3(-1.0f, -t, s);
+    case 2: return glm::vec3(s, 1.0f, t);
+    case 3: return glm::vec3(s, -1.0f, -t);
+    case 4: return glm::vec3(s, -t, 1.0f);
+    default: return glm::vec3(-s, -t, -1.0f);
+    }
+}
+
+// equirect 双线性采样，水平方向环绕，竖直方向截断
+static glm::vec3 sampleEquirect(const float* pixels, int width, int height, int channels, const glm::vec3& dir) {
+    glm::vec3 d = glm::normalize(dir);
+    float u = std::atan2(d.z, d.x) / (2.0f * PI) + 0.5f;
+    float v = std::asin(std::min(std::max(d.y, -1.0f), 1.0f)) / PI + 0.5f;
+    float fx = u * width - 0.5f;
+    float fy = std::min(std::max(v * height - 0.5f, 0.0f), (float)(height - 1));
+    int x0 = (int)std::floor(fx);
+    int y0 = std::min((int)fy, std::max(height - 2, 0));
+    float tx = fx - x0;
+    float ty = fy - y0;
+    int y1 = std::min(y0 + 1, height - 1);
+    int xa = ((x0 % width) + width) % width;
+    int xb = (xa + 1) % width;
+
+    auto texel = [&](int x, int y) {
+        const float* p = pixels + ((size_t)y * width + x) * channels;
+        return channels >= 3 ? glm::vec3(p[0], p[1], p[2]) : glm::vec3(p[0]);
+    };
+    glm::vec3 a = glm::mix(texel(xa, y0), texel(xb, y0), tx);
+    glm::vec3 b = glm::mix(texel(xa, y1), texel(xb, y1), tx);
+    return glm::mix(a, b, ty);
+}
+
+// 面坐标 (s, t) 处 texel 的相对立体角 ∝ (1 + s² + t²)^(-3/2)
+static float texelSolidAngle(float s, float t) {
+    float q = 1.0f + s * s + t * t;
+    return 1.0f / (q * std::sqrt(q));
+}
+
+// 按行分发到线程池，rows 为 6 个面的总行数
+template <typename F>
+static void parallelRows(int rows, unsigned threads, F&& rowFn) {
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int r = next++; r < rows; r = next++) rowFn(r);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+void SkyCubemap::build(const float* pixels, int width, int height, int channels, unsigned threads) {
+    auto start = std::chrono::steady_clock::now();
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    faceSize = 1;
+    while (faceSize < width / 4 && faceSize < MAX_FACE_SIZE) faceSize *= 2;
+    int count = 1;
+    for (int s = faceSize; s > 1; s /= 2) count++;
+    levels.assign(count, {});
+
+    // 0 级：逐 texel 采样 equirect
+    levels[0].resize((size_t)6 * faceSize * faceSize);
+    parallelRows(6 * faceSize, threads, [&](int row) {
+        int face = row / faceSize;
+        int y = row % faceSize;
+        float t = 2.0f * (y + 0.5f) / faceSize - 1.0f;
+        glm::vec3* out = &levels[0][(size_t)row * faceSize];
+        for (int x = 0; x < faceSize; x++) {
+            float s = 2.0f * (x + 0.5f) / faceSize - 1.0f;
+            out[x] = sampleEquirect(pixels, width, height, channels, cubeFaceDirection(face, s, t));
+        }
+    });
+
+    // 其余各级：2×2 按立体角加权
+    for (int l = 1; l < count; l++) {
+        int size = levelSize(l);
+        int src = levelSize(l - 1);
+        const std::vector<glm::vec3>& prev = levels[l - 1];
+        levels[l].resize((size_t)6 * size * size);
+        parallelRows(6 * size, threads, [&](int row) {
+            int face = row / size;
+            int y = row % size;
+            const glm::vec3* base = &prev[(size_t)face * src * src];
+            glm::vec3* out = &levels[l][(size_t)row * size];
+            for (int x = 0; x < size; x++) {
+                glm::vec3 sum(0.0f);
+                float weight = 0.0f;
+                for (int dy = 0; dy < 2; dy++) {
+                    for (int dx = 0; dx < 2; dx++) {
+                        int sx = x * 2 + dx, sy = y * 2 + dy;
+                        float w = texelSolidAngle(2.0f * (sx + 0.5f) / src - 1.0f, 2.0f * (sy + 0.5f) / src - 1.0f);
+                        sum += base[(size_t)sy * src + sx] * w;
+                        weight += w;
+                    }
+                }
+                out[x] = sum / weight;
+            }
+        });
+    }
+    buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
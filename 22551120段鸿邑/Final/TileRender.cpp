@@ -0,0 +1,527 @@
+#include "tile_render.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <process.h>
+using socket_t = SOCKET;
+static void closeSocket(socket_t s) { closesocket(s); }
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using socket_t = int;
+static const socket_t INVALID_SOCKET = -1;
+static void closeSocket(socket_t s) { close(s); }
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// ================= 协议 =================
+// 每条消息：MessageHeader + payload。同一台机器或同构机器之间使用，按本机字节序直接收发
+static const uint32_t TILE_MAGIC = 0x454C4954;   // "TILE"
+
+enum MessageType : uint32_t {
+    MSG_HELLO = 1,    // 工作进程 → 协调进程：进程号
+    MSG_JOB = 2,      // 协调进程 → 工作进程：TileJob
+    MSG_RESULT = 3,   // 工作进程 → 协调进程：TileResult + 像素
+    MSG_QUIT = 4,
+};
+
+struct MessageHeader {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t bytes;
+};
+
+struct TileJob {
+    uint32_t tile;
+    int32_t x0, y0, w, h;
+    int32_t width, height;
+    float camPos[3];
+    float camRot[9];
+    float spin;
+    float step;
+    int32_t maxSteps;
+    int32_t skipEmpty;
+    int32_t diskLUT;
+};
+
+struct TileResult {
+    uint32_t tile;
+    float ms;
+};
+
+static bool sendAll(socket_t s, const void* data, size_t bytes) {
+    const char* p = (const char*)data;
+    while (bytes > 0) {
+        int n = (int)send(s, p, (int)bytes, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+static bool recvAll(socket_t s, void* data, size_t bytes) {
+    char* p = (char*)data;
+    while (bytes > 0) {
+        int n = (int)recv(s, p, (int)bytes, 0);
+        if (n <= 0) return false;
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+static bool sendMessage(socket_t s, uint32_t type, const void* a, size_t aBytes, const void* b = nullptr, size_t bBytes = 0) {
+    MessageHeader h = { TILE_MAGIC, type, (uint32_t)(aBytes + bBytes) };
+    return sendAll(s, &h, sizeof(h)) && (aBytes == 0 || sendAll(s, a, aBytes)) && (bBytes == 0 || sendAll(s, b, bBytes));
+}
+
+static bool recvMessage(socket_t s, MessageHeader& h, std::vector<char>& payload) {
+    if (!recvAll(s, &h, sizeof(h)) || h.magic != TILE_MAGIC) return false;
+    payload.resize(h.bytes);
+    return h.bytes == 0 || recvAll(s, payload.data(), h.bytes);
+}
+
+static void initSockets() {
+#ifdef _WIN32
+    static bool started = false;
+    if (!started) {
+        WSADATA wsa;
+        WSAStartup(MAKEWORD(2, 2), &wsa);
+        started = true;
+    }
+#else
+    signal(SIGPIPE, SIG_IGN);
+#endif
+}
+
+static void setNoDelay(socket_t s) {
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+}
+
+// ================= 派生工作进程 =================
+static std::string currentExecutable() {
+#ifdef _WIN32
+    char path[MAX_PATH];
+    GetModuleFileNameA(nullptr, path, MAX_PATH);
+    return path;
+#else
+    char path[4096];
+    ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (n <= 0) return "";
+    path[n] = 0;
+    return path;
+#endif
+}
+
+static long spawnWorker(const std::string& exe, const std::vector<std::string>& args) {
+    std::vector<const char*> argv;
+    argv.push_back(exe.c_str());
+    for (const auto& a : args) argv.push_back(a.c_str());
+    argv.push_back(nullptr);
+#ifdef _WIN32
+    return (long)_spawnv(_P_NOWAIT, exe.c_str(), argv.data());
+#else
+    pid_t pid = fork();
+    if (pid == 0) {
+        execv(exe.c_str(), (char* const*)argv.data());
+        _exit(127);
+    }
+    return (long)pid;
+#endif
+}
+
+static void reapWorkers(const std::vector<long>& pids) {
+#ifndef _WIN32
+    for (long pid : pids) {
+        if (pid > 0) waitpid((pid_t)pid, nullptr, 0);
+    }
+#endif
+}
+
+// ================= 协调进程 =================
+namespace {
+struct TileState {
+    int frame;
+    int local;            // 帧内编号（同一位置在各帧编号相同）
+    int x0, y0, w, h;
+    bool done = false;
+    int copies = 0;       // 正在执行的副本数
+    int owner = -1;       // 第一个副本所在的工作进程
+    Clock::time_point issued;
+};
+
+struct WorkerConn {
+    socket_t sock = INVALID_SOCKET;
+    bool alive = false;
+    std::vector<int> inFlight;
+};
+
+struct FrameBuffer {
+    std::vector<glm::vec3> image;
+    int remaining = 0;
+};
+}
+
+bool TileCoordinator::run(const std::vector<BlackHoleParams>& frames, const TileRenderConfig& config,
+                          const std::function<void(int, const std::vector<glm::vec3>&)>& onFrame) {
+    initSockets();
+    stats = TileRenderStats();
+    auto start = Clock::now();
+
+    // 1. 监听本机端口
+    socket_t listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET) {
+        std::cout << "[tiles] 无法创建套接字" << std::endl;
+        return false;
+    }
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(config.workers > 0 ? INADDR_LOOPBACK : INADDR_ANY);
+    addr.sin_port = htons((uint16_t)config.port);
+    if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0) {
+        std::cout << "[tiles] 无法监听端口 " << config.port << std::endl;
+        closeSocket(listener);
+        return false;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(listener, (sockaddr*)&addr, &len);
+    int port = ntohs(addr.sin_port);
+    std::cout << "[tiles] 协调进程监听 127.0.0.1:" << port << std::endl;
+
+    // 2. 派生本地工作进程
+    std::string exe = config.executable.empty() ? currentExecutable() : config.executable;
+    std::vector<long> pids;
+    for (int i = 0; i < config.workers; i++) {
+        std::vector<std::string> args = { "--tile-worker", "127.0.0.1:" + std::to_string(port) };
+        if (i == config.failWorker) {
+            args.push_back("--tile-fail-after");
+            args.push_back(std::to_string(config.failAfter));
+        }
+        pids.push_back(spawnWorker(exe, args));
+    }
+
+    // 3. 切块：整帧网格，右/上边缘的块可能较小
+    int tilesX = (config.width + config.tileSize - 1) / config.tileSize;
+    int tilesY = (config.height + config.tileSize - 1) / config.tileSize;
+    int perFrame = tilesX * tilesY;
+    std::vector<TileState> tiles;
+    tiles.reserve((size_t)perFrame * frames.size());
+    for (int f = 0; f < (int)frames.size(); f++) {
+        for (int ty = 0; ty < tilesY; ty++) {
+            for (int tx = 0; tx < tilesX; tx++) {
+                TileState t;
+                t.frame = f;
+                t.local = ty * tilesX + tx;
+                t.x0 = tx * config.tileSize;
+                t.y0 = ty * config.tileSize;
+                t.w = std::min(config.tileSize, config.width - t.x0);
+                t.h = std::min(config.tileSize, config.height - t.y0);
+                tiles.push_back(t);
+            }
+        }
+    }
+    stats.tiles = (int)tiles.size();
+
+    std::vector<double> lastMs(perFrame, 0.0);   // 每个位置最近一次的耗时，用于排序
+    std::deque<int> queue;
+    std::map<int, FrameBuffer> buffers;
+    int nextQueued = 0;      // 下一个要入队的帧
+    int nextEmitted = 0;     // 下一个要输出的帧
+
+    auto enqueueFrames = [&]() {
+        while (nextQueued < (int)frames.size() && nextQueued < nextEmitted + config.framesInFlight) {
+            FrameBuffer& fb = buffers[nextQueued];
+            fb.image.assign((size_t)config.width * config.height, glm::vec3(0.0f));
+            fb.remaining = perFrame;
+            std::vector<int> order(perFrame);
+            for (int i = 0; i < perFrame; i++) order[i] = nextQueued * perFrame + i;
+            std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+                return lastMs[tiles[a].local] > lastMs[tiles[b].local];
+            });
+            for (int id : order) queue.push_back(id);
+            nextQueued++;
+        }
+    };
+    enqueueFrames();
+
+    std::vector<WorkerConn> workers;
+    auto sendJob = [&](int w, int id) {
+        const TileState& t = tiles[id];
+        const BlackHoleParams& p = frames[t.frame];
+        TileJob job = {};
+        job.tile = (uint32_t)id;
+        job.x0 = t.x0; job.y0 = t.y0; job.w = t.w; job.h = t.h;
+        job.width = config.width; job.height = config.height;
+        for (int i = 0; i < 3; i++) job.camPos[i] = p.camPos[i];
+        for (int c = 0; c < 3; c++)
+            for (int r = 0; r < 3; r++) job.camRot[c * 3 + r] = p.camRot[c][r];
+        job.spin = p.spin;
+        job.step = p.step;
+        job.maxSteps = p.maxSteps;
+        job.skipEmpty = p.skipEmpty ? 1 : 0;
+        job.diskLUT = p.diskLUT ? 1 : 0;
+        if (!sendMessage(workers[w].sock, MSG_JOB, &job, sizeof(job))) return false;
+        workers[w].inFlight.push_back(id);
+        tiles[id].copies++;
+        if (tiles[id].owner < 0) {
+            tiles[id].owner = w;
+            tiles[id].issued = Clock::now();
+        }
+        return true;
+    };
+
+    // 给空闲槽位派活：先取队列，队列空时窃取别人手里最早发出、还没有副本的块
+    auto dispatch = [&](int w) {
+        WorkerConn& wc = workers[w];
+        while (wc.alive && (int)wc.inFlight.size() < PIPELINE) {
+            int id = -1;
+            while (!queue.empty()) {
+                int candidate = queue.front();
+                queue.pop_front();
+                if (!tiles[candidate].done) { id = candidate; break; }
+            }
+            if (id < 0) {
+                for (const WorkerConn& other : workers) {
+                    if (&other == &wc || !other.alive) continue;
+                    for (int t : other.inFlight) {
+                        if (tiles[t].done || tiles[t].copies != 1) continue;
+                        if (std::find(wc.inFlight.begin(), wc.inFlight.end(), t) != wc.inFlight.end()) continue;
+                        if (id < 0 || tiles[t].issued < tiles[id].issued) id = t;
+                    }
+                }
+                if (id < 0) return;
+                stats.stolen++;
+            }
+            if (!sendJob(w, id)) {
+                queue.push_front(id);
+                return;
+            }
+        }
+    };
+
+    auto dropWorker = [&](int w) {
+        WorkerConn& wc = workers[w];
+        if (!wc.alive) return;
+        wc.alive = false;
+        stats.workers[w].alive = false;
+        closeSocket(wc.sock);
+        for (int id : wc.inFlight) {
+            tiles[id].copies--;
+            if (!tiles[id].done && tiles[id].copies == 0) {
+                tiles[id].owner = -1;
+                queue.push_front(id);
+                stats.reissued++;
+            }
+        }
+        wc.inFlight.clear();
+        std::cout << "[tiles] 工作进程 " << w << " 断开，未完成的块已重新排队" << std::endl;
+    };
+
+    // 4. 事件循环
+    bool ok = true;
+    std::vector<char> payload;
+    auto lastConnect = Clock::now();
+    while (nextEmitted < (int)frames.size()) {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(listener, &readSet);
+        socket_t maxFd = listener;
+        int aliveCount = 0;
+        for (const WorkerConn& wc : workers) {
+            if (!wc.alive) continue;
+            FD_SET(wc.sock, &readSet);
+            maxFd = std::max(maxFd, wc.sock);
+            aliveCount++;
+        }
+        // 所有连接都断开且 10 秒内没有新的工作进程连进来，放弃
+        if (aliveCount == 0 && std::chrono::duration<double>(Clock::now() - lastConnect).count() > 10.0) {
+            std::cout << "[tiles] 没有可用的工作进程，剩余 " << (int)frames.size() - nextEmitted << " 帧未完成" << std::endl;
+            ok = false;
+            break;
+        }
+
+        timeval timeout = { 1, 0 };
+        int ready = select((int)maxFd + 1, &readSet, nullptr, nullptr, &timeout);
+        if (ready <= 0) continue;
+
+        if (FD_ISSET(listener, &readSet)) {
+            socket_t s = accept(listener, nullptr, nullptr);
+            MessageHeader h;
+            if (s != INVALID_SOCKET && recvMessage(s, h, payload) && h.type == MSG_HELLO) {
+                setNoDelay(s);
+                WorkerConn wc;
+                wc.sock = s;
+                wc.alive = true;
+                workers.push_back(wc);
+                stats.workers.push_back(TileRenderStats::Worker());
+                lastConnect = Clock::now();
+                int pid = payload.size() >= 4 ? *(int32_t*)payload.data() : 0;
+                std::cout << "[tiles] 工作进程 " << workers.size() - 1 << " 已连接（pid " << pid << "）" << std::endl;
+                dispatch((int)workers.size() - 1);
+            }
+            else if (s != INVALID_SOCKET) {
+                closeSocket(s);
+            }
+        }
+
+        for (int w = 0; w < (int)workers.size(); w++) {
+            WorkerConn& wc = workers[w];
+            if (!wc.alive || !FD_ISSET(wc.sock, &readSet)) continue;
+
+            MessageHeader h;
+            if (!recvMessage(wc.sock, h, payload) || h.type != MSG_RESULT || payload.size() < sizeof(TileResult)) {
+                dropWorker(w);
+                for (int o = 0; o < (int)workers.size(); o++) dispatch(o);
+                continue;
+            }
+
+            TileResult res;
+            memcpy(&res, payload.data(), sizeof(res));
+            int id = (int)res.tile;
+            auto it = std::find(wc.inFlight.begin(), wc.inFlight.end(), id);
+            if (id < 0 || id >= (int)tiles.size() || it == wc.inFlight.end()) {
+                dropWorker(w);
+                for (int o = 0; o < (int)workers.size(); o++) dispatch(o);
+                continue;
+            }
+            wc.inFlight.erase(it);
+            TileState& t = tiles[id];
+            t.copies--;
+            stats.workers[w].busyMs += res.ms;
+
+            size_t pixels = (size_t)t.w * t.h;
+            if (t.done) {
+                stats.wasted++;
+            }
+            else if (payload.size() == sizeof(TileResult) + pixels * sizeof(glm::vec3)) {
+                t.done = true;
+                lastMs[t.local] = res.ms;
+                stats.workers[w].tiles++;
+                const glm::vec3* src = (const glm::vec3*)(payload.data() + sizeof(TileResult));
+                FrameBuffer& fb = buffers[t.frame];
+                for (int y = 0; y < t.h; y++) {
+                    std::copy(src + (size_t)y * t.w, src + (size_t)(y + 1) * t.w,
+                              fb.image.begin() + (size_t)(t.y0 + y) * config.width + t.x0);
+                }
+                fb.remaining--;
+            }
+
+            // 按顺序输出已完成的帧，并补充下一帧的块
+            while (nextEmitted < nextQueued && buffers[nextEmitted].remaining == 0) {
+                onFrame(nextEmitted, buffers[nextEmitted].image);
+                buffers.erase(nextEmitted);
+                nextEmitted++;
+                enqueueFrames();
+            }
+            for (int o = 0; o < (int)workers.size(); o++) dispatch(o);
+        }
+    }
+
+    for (WorkerConn& wc : workers) {
+        if (!wc.alive) continue;
+        sendMessage(wc.sock, MSG_QUIT, nullptr, 0);
+        closeSocket(wc.sock);
+    }
+    closeSocket(listener);
+    reapWorkers(pids);
+    stats.wallMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return ok;
+}
+
+void TileCoordinator::printStats() const {
+    double busy = 0.0;
+    for (const auto& w : stats.workers) busy += w.busyMs;
+    std::cout << "[tiles] " << stats.tiles << " 块，耗时 " << stats.wallMs << " ms，工作进程渲染时间合计 " << busy
+              << " ms（并行效率 " << (stats.wallMs > 0.0 && !stats.workers.empty() ? busy / (stats.wallMs * stats.workers.size()) * 100.0 : 0.0)
+              << "%），重新排队 " << stats.reissued << "，窃取 " << stats.stolen << "，丢弃重复结果 " << stats.wasted << std::endl;
+    for (size_t i = 0; i < stats.workers.size(); i++) {
+        const auto& w = stats.workers[i];
+        std::cout << "[tiles]   工作进程 " << i << "：" << w.tiles << " 块，" << w.busyMs << " ms"
+                  << (w.alive ? "" : "（已断开）") << std::endl;
+    }
+}
+
+// ================= 工作进程 =================
+int runTileWorker(const std::string& address, const DiskEmissionLUT* diskLUT, int failAfter) {
+    initSockets();
+    size_t colon = address.rfind(':');
+    std::string host = colon == std::string::npos ? "127.0.0.1" : address.substr(0, colon);
+    int port = std::atoi(address.c_str() + (colon == std::string::npos ? 0 : colon + 1));
+
+    socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) {
+        std::cout << "[tile-worker] 无法创建套接字" << std::endl;
+        return 1;
+    }
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+    if (connect(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        std::cout << "[tile-worker] 无法连接 " << address << std::endl;
+        closeSocket(s);
+        return 1;
+    }
+    setNoDelay(s);
+#ifdef _WIN32
+    int32_t pid = (int32_t)_getpid();
+#else
+    int32_t pid = (int32_t)getpid();
+#endif
+    sendMessage(s, MSG_HELLO, &pid, sizeof(pid));
+
+    MessageHeader h;
+    std::vector<char> payload;
+    std::vector<glm::vec3> pixels;
+    int done = 0;
+    while (recvMessage(s, h, payload) && h.type == MSG_JOB && payload.size() == sizeof(TileJob)) {
+        TileJob job;
+        memcpy(&job, payload.data(), sizeof(job));
+        BlackHoleParams params;
+        params.camPos = glm::vec3(job.camPos[0], job.camPos[1], job.camPos[2]);
+        for (int c = 0; c < 3; c++)
+            for (int r = 0; r < 3; r++) params.camRot[c][r] = job.camRot[c * 3 + r];
+        params.spin = job.spin;
+        params.step = job.step;
+        params.maxSteps = job.maxSteps;
+        params.skipEmpty = job.skipEmpty != 0;
+        params.diskLUT = job.diskLUT ? diskLUT : nullptr;
+
+        auto t0 = Clock::now();
+        renderBlackHoleTile(params, job.width, job.height, job.x0, job.y0, job.w, job.h, pixels);
+        TileResult res = { job.tile, (float)std::chrono::duration<double, std::milli>(Clock::now() - t0).count() };
+        if (!sendMessage(s, MSG_RESULT, &res, sizeof(res), pixels.data(), pixels.size() * sizeof(glm::vec3))) break;
+
+        // 故障注入：模拟崩溃，不发 QUIT、不关闭连接
+        if (failAfter >= 0 && ++done >= failAfter) std::_Exit(3);
+    }
+    closeSocket(s);
+    return 0;
+}
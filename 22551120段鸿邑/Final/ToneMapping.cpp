@@ -0,0 +1,147 @@
+#include "tone_mapping.h"
+#include "blackhole_compute.h"
+#include "../Common/shadermanager.h"
+#include <iostream>
+#include <vector>
+
+// ================= 初始化 =================
+bool ToneMapping::init(int w, int h) {
+    width = w;
+    height = h;
+
+    glGenTextures(1, &color);
+    glBindTexture(GL_TEXTURE_2D, color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+    // tonemap.frag 逐像素 texelFetch，线性过滤只供 bloom 的下采样使用
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        std::cout << "[tonemap] HDR 帧缓冲不完整\n";
+        return false;
+    }
+
+    std::vector<ShaderDesc> descs = {
+        { "tonemap", loadShaderSource("Shaders/fullscreen.vert"), loadShaderSource("Shaders/tonemap.frag"), {} } };
+    bool compute = BlackHoleCompute::supported();
+    if (compute) {
+        descs.push_back({ "luminance_histogram", "", "", {}, loadShaderSource("Shaders/luminance_histogram.comp") });
+        descs.push_back({ "exposure_adapt", "", "", {}, loadShaderSource("Shaders/exposure_adapt.comp") });
+    }
+    std::vector<GLuint> programs = gShaders.buildAll(descs);
+    tonemapProgram = programs[0];
+    if (tonemapProgram == 0) return false;
+    if (compute && programs[1] && programs[2]) {
+        histogramProgram = programs[1];
+        adaptProgram = programs[2];
+    }
+    else {
+        if (compute) {
+            glDeleteProgram(programs[1]);
+            glDeleteProgram(programs[2]);
+        }
+        std::cout << "[tonemap] 计算着色器不可用，曝光固定为 " << FIXED_EXPOSURE << std::endl;
+    }
+
+    // a = 0 表示尚未测光，首帧直接取目标曝光；固定曝光时预先写好
+    float initial[4] = { FIXED_EXPOSURE, 0.0f, FIXED_EXPOSURE, autoExposure() ? 0.0f : 1.0f };
+    glGenTextures(1, &exposure);
+    glBindTexture(GL_TEXTURE_2D, exposure);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, 1, 1, 0, GL_RGBA, GL_FLOAT, initial);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    if (autoExposure()) {
+        std::vector<GLuint> zeros(BINS, 0);
+        glGenBuffers(1, &histogram);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, histogram);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, BINS * sizeof(GLuint), zeros.data(), GL_DYNAMIC_COPY);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // 采样器单元与常量是程序状态，设置一次
+    glUseProgram(tonemapProgram);
+    glUniform1i(glGetUniformLocation(tonemapProgram, "source"), 0);
+    glUniform1i(glGetUniformLocation(tonemapProgram, "exposureTex"), 1);
+    if (autoExposure()) {
+        glUseProgram(histogramProgram);
+        glUniform1i(glGetUniformLocation(histogramProgram, "source"), 0);
+        glUniform1f(glGetUniformLocation(histogramProgram, "minLogLum"), MIN_LOG_LUM);
+        glUniform1f(glGetUniformLocation(histogramProgram, "invLogLumRange"), 1.0f / (MAX_LOG_LUM - MIN_LOG_LUM));
+        glUseProgram(adaptProgram);
+        glUniform1f(glGetUniformLocation(adaptProgram, "minLogLum"), MIN_LOG_LUM);
+        glUniform1f(glGetUniformLocation(adaptProgram, "logLumRange"), MAX_LOG_LUM - MIN_LOG_LUM);
+        glUniform1f(glGetUniformLocation(adaptProgram, "lowPercent"), LOW_PERCENT);
+        glUniform1f(glGetUniformLocation(adaptProgram, "highPercent"), HIGH_PERCENT);
+    }
+    glUseProgram(0);
+    return true;
+}
+
+void ToneMapping::destroy() {
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &color);
+    glDeleteTextures(1, &exposure);
+    glDeleteBuffers(1, &histogram);
+    glDeleteProgram(histogramProgram);
+    glDeleteProgram(adaptProgram);
+    glDeleteProgram(tonemapProgram);
+    fbo = color = exposure = histogram = 0;
+    histogramProgram = adaptProgram = tonemapProgram = 0;
+}
+
+// ================= 每帧 =================
+void ToneMapping::beginScene() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+}
+
+void ToneMapping::measure(GLuint texture, int w, int h, float dt) {
+    if (!autoExposure()) return;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, histogram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glUseProgram(histogramProgram);
+    glUniform2i(glGetUniformLocation(histogramProgram, "size"), w, h);
+    glDispatchCompute((w + 15) / 16, (h + 15) / 16, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(adaptProgram);
+    glBindImageTexture(0, exposure, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+    glUniform1f(glGetUniformLocation(adaptProgram, "dt"), dt);
+    glUniform1f(glGetUniformLocation(adaptProgram, "keyValue"), keyValue);
+    glUniform1f(glGetUniformLocation(adaptProgram, "compensation"), compensation);
+    glUniform1f(glGetUniformLocation(adaptProgram, "adaptUp"), adaptUp);
+    glUniform1f(glGetUniformLocation(adaptProgram, "adaptDown"), adaptDown);
+    glDispatchCompute(1, 1, 1);
+    // 曝光纹理接下来被片段着色器采样，直方图在下一帧被原子累加
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void ToneMapping::resolve(GLuint outputFbo, GLuint vao) {
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFbo);
+    glViewport(0, 0, width, height);
+    glUseProgram(tonemapProgram);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, exposure);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, color);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+float ToneMapping::readExposure() const {
+    float value[4] = {};
+    glBindTexture(GL_TEXTURE_2D, exposure);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, value);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return value[0];
+}
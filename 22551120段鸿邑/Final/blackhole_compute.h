@@ -0,0 +1,69 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "../Common/shadermanager.h"
+
+// ================= 步进占用率统计 =================
+// 片段着色器中同一 warp 的像素要等最慢的光线走完才能一起退出；波前路径每 WAVE_STEPS 步压缩一次队列。
+// 两者的 SIMD 通道利用率都可以由每像素步数推算（两条路径的步进完全相同，步数也相同）：
+//   全屏四边形：按 8×4 像素块（32 通道）统计 Σ步数 / (块内像素数 × 块内最大步数)
+//   波前：每波存活光线按 32 个一组，Σ本波实际步数 / (组数 × 32 × WAVE_STEPS)
+struct MarchOccupancy {
+    uint64_t raySteps = 0;          // 所有光线实际推进的步数
+    double meanSteps = 0.0;
+    double fragmentLaneUtil = 0.0;
+    double computeLaneUtil = 0.0;
+    int waves = 0;                  // 至少有一条存活光线的波数
+    std::vector<uint32_t> waveAlive;
+};
+
+MarchOccupancy analyzeMarchOccupancy(const std::vector<uint32_t>& steps, int width, int height,
+                                     int waveSteps, int maxSteps, int laneWidth = 32);
+
+// ================= 计算着色器波前渲染器 =================
+// 需要 GL 4.3（计算着色器与 SSBO），llvmpipe 可运行。每帧：
+//   1. RAYGEN 程序生成全部光线，队列 A 为所有像素
+//   2. 依次派发 ceil(MAX_STEPS / WAVE_STEPS) 波，每波在 A/B 两个队列之间交替压缩
+//   3. 结果图像 blit 到当前绘制帧缓冲
+// 所有波都无条件派发，不回读存活数；队列取空后的波只有每个工作组一次原子操作的开销
+class BlackHoleCompute {
+public:
+    static constexpr GLuint PERSISTENT_GROUPS = 128;   // 持久线程组数 × 64 线程，约为桌面 GPU 可同时驻留的线程数
+    static bool supported();
+
+    // 每个画质档位一组 defines（MAX_STEPS / STEP），与片段着色器变体一一对应
+    bool init(const std::vector<ShaderDefines>& tiers, int waveSteps);
+    void destroy();
+    void render(const glm::vec3& camPos, const glm::mat3& camRot, float spin, int tier, int width, int height);
+    // 回读最近一帧的每像素步数与每波存活数（会等待 GPU，只在统计时调用）
+    MarchOccupancy readOccupancy() const;
+
+    int waveSteps = 32;
+    GLuint diskLut = 0;   // DISK_LUT 变体使用的黑体查找表，绑定到纹理单元 1
+    GLuint skyCube = 0;   // SKY_CUBEMAP 变体使用的星空立方体贴图，绑定到纹理单元 2；非 0 时分配光线微分缓冲
+    float skyTexelAngle = 0.0f;
+    float skyMaxLod = 0.0f;
+
+private:
+    struct TierPrograms {
+        GLuint raygen = 0;
+        GLuint march = 0;
+        int maxSteps = 0;
+    };
+    std::vector<TierPrograms> tiers;
+    int lastTier = 0;
+    int width = 0;
+    int height = 0;
+    GLuint rayBuffer = 0;
+    GLuint queues[2] = {};
+    GLuint counterBuffer = 0;
+    GLuint stepBuffer = 0;
+    GLuint diffBuffer = 0;
+    GLuint image = 0;
+    GLuint readFbo = 0;
+
+    void resize(int w, int h);
+    int waveCount(int tier) const { return (tiers[tier].maxSteps + waveSteps - 1) / waveSteps; }
+};
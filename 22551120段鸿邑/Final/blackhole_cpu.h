@@ -0,0 +1,64 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "disk_emission.h"
+
+// ================= CPU 参考渲染器 =================
+// 与 Shaders/blackhole.frag 逐行对应的 C++ 实现，用于无 GPU 环境下的基准测试与画面比对
+// 星空只实现哈希星点 starfield()，对应 GPU 的 --hash-sky；SKY_CUBEMAP 的立方体贴图与光线微分没有移植
+
+struct BlackHoleParams {
+    glm::vec3 camPos;
+    glm::mat3 camRot;
+    float spin = 0.9f;
+    int maxSteps = 720;      // 对应着色器的 MAX_STEPS / STEP 变体宏
+    float step = 0.02f;
+    bool skipEmpty = false;  // 对应 SKIP_EMPTY 宏：盘体包围区域外用大步长
+    const DiskEmissionLUT* diskLUT = nullptr;  // 对应 DISK_LUT 宏：非空时用黑体查找表代替 cinematicDoppler
+};
+
+// 单条光线的统计，用于占用率分析与空域跳跃的等价性检查
+struct TraceInfo {
+    int steps = 0;           // 实际推进的步数
+    int diskSteps = 0;       // 其中在盘体内（密度超过采样阈值）的步数
+    glm::vec3 emission{ 0.0f };  // 吸积盘累计发光（不含星空）
+    glm::vec3 finalDir{ 0.0f };  // 星空采样方向
+    float fade = 1.0f;           // 结束时的累计衰减，低于 0.002 视为被视界吸收
+};
+
+// 与着色器相同的场景函数，Kerr 测地线引擎共用
+glm::vec3 starfield(const glm::vec3& d);
+float diskVolume(const glm::vec3& p);
+float diskBoundDistance(const glm::vec3& p);   // 到盘体包围区域的距离下界，区域内为负
+
+// uv ∈ [0,1]²，与全屏四边形的插值坐标一致
+glm::vec3 traceBlackHole(const BlackHoleParams& params, glm::vec2 uv, TraceInfo* info = nullptr);
+
+// 多线程逐行渲染，结果为线性 HDR 颜色，行序自下而上（与 GL 帧缓冲一致）；info 非空时输出每像素统计
+void renderBlackHoleCPU(const BlackHoleParams& params, int width, int height,
+                        std::vector<glm::vec3>& out, unsigned threads = 0,
+                        std::vector<TraceInfo>* info = nullptr);
+
+// 只渲染整帧中的一个矩形块（单线程，分布式渲染的工作进程使用），out 为 tileW × tileH，行序同上
+void renderBlackHoleTile(const BlackHoleParams& params, int width, int height,
+                         int x0, int y0, int tileW, int tileH, std::vector<glm::vec3>& out);
+
+// ================= 空域跳跃等价性 =================
+// 同一参数分别以 skipEmpty = false / true 渲染并比较。星空采样对方向极其敏感（哈希噪声），
+// 因此画质只比较吸积盘发光，方向误差单独统计
+struct SkipEquivalence {
+    double meanStepsBefore = 0.0;
+    double meanStepsAfter = 0.0;
+    double diskFractionBefore = 0.0;  // 盘内步数 / 总步数
+    double diskFractionAfter = 0.0;
+    double emissionPSNR = 0.0;        // 截断到 [0,1] 后计算（与写入 8 位帧缓冲一致）
+    double emissionMaxError = 0.0;    // HDR 值的最大绝对误差
+    double visibleFraction = 0.0;     // 截断到 [0,1] 后差异超过 3/255 的像素比例
+    double meanDirError = 0.0;        // 星空采样方向的平均夹角（弧度）
+};
+
+SkipEquivalence measureSkipEquivalence(BlackHoleParams params, int width, int height);
+
+// HDR 转 8 位（与写入 8 位默认帧缓冲时的截断行为一致）
+void convertToRGB8(const std::vector<glm::vec3>& hdr, std::vector<unsigned char>& rgb);
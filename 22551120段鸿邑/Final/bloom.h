@@ -0,0 +1,82 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// ================= Bloom 与横向光芒 =================
+// 在 HDR 场景上做双重滤波（dual filter，Kawase 的改进）金字塔：
+//   1. bloom_downsample.frag（PREFILTER）：从场景取样到 1/2 分辨率，每个样本先过软阈值（threshold ± knee），只留下高亮部分
+//   2. bloom_downsample.frag：逐级减半到 1/4、1/8 ……，中心 ×4 加四个对角样本（相隔一个源 texel）共 8 份
+//   3. bloom_streak.frag（可选）：在 1/4 分辨率上做几遍水平模糊，每遍间距 ×4，得到变形镜头的横向光芒
+//   4. bloom_upsample.frag：从最小一级起用 tent 滤波放大并加到上一级，低频光晕逐级叠加
+//   5. bloom_upsample.frag（COMPOSITE）：第 0 级放大到场景尺寸，与光芒一起加回 HDR 场景，之后照常曝光与色调映射
+// 金字塔按输出尺寸一次分配（R11F_G11F_B10F，无 alpha），动态分辨率时只使用各级左下角的子矩形，与 dynamic_resolution.h 相同。
+// 每次采样都把坐标限制在有效区域内半个 texel，CPU 版本 applyBloomCPU 按同样的坐标与双线性插值逐步计算，
+// 无头渲染（--cpu 基准、分块渲染）的输出与 GPU 只差纹理格式的精度。
+// 用法：
+//   bloom.init(width, height, settings);
+//   每帧渲染场景之后、曝光统计之前：bloom.apply(sceneTexture, sceneFbo, renderW, renderH, vao);
+struct BloomSettings {
+    const char* tier = "medium";
+    int levels = 4;                 // 金字塔级数，第 i 级为 1/2^(i+1) 分辨率
+    float threshold = 1.0f;         // HDR 亮度阈值（rgb 最大分量），--bloom-threshold
+    float knee = 0.5f;              // 阈值两侧的过渡宽度
+    float intensity = 0.08f;        // 光晕强度（按级数平均），--bloom-intensity
+    bool streak = false;            // 横向光芒，--streak
+    int streakPasses = 3;
+    float streakFalloff = 0.95f;    // 每隔一个 1/4 分辨率 texel 的权重衰减
+    float streakIntensity = 0.05f;
+    glm::vec3 streakTint{ 0.6f, 0.7f, 1.0f };
+};
+
+// low / medium / high，名字无效时返回 false 且不修改 settings
+bool applyBloomTier(const char* name, BloomSettings& settings);
+
+class Bloom {
+public:
+    static constexpr int MIN_LEVELS = 2;    // 至少有 1/2 与 1/4 两级
+    static constexpr int MAX_LEVELS = 6;
+
+    bool init(int width, int height, const BloomSettings& settings);
+    void destroy();
+
+    // sceneTexture 左下角 renderW × renderH 为有效区域（须为线性过滤），结果加回 sceneFbo 的同一区域。
+    // 结束时绑定 sceneFbo，视口为渲染尺寸，混合状态恢复为关闭
+    void apply(GLuint sceneTexture, GLuint sceneFbo, int renderW, int renderH, GLuint vao);
+
+    // 回读 sceneTexture（满尺寸），在临时纹理上跑一遍 GPU 流程，与 applyBloomCPU 的结果比较，
+    // 返回 bloom 增量（截断到 [0,1]）的 PSNR（会等待 GPU，只在基准结束时调用）
+    double verifyAgainstCPU(GLuint sceneTexture, GLuint vao);
+
+    // 每帧传入 profiler 可读到的 "bloom" 计时，退出时输出平均值
+    void recordGpuMs(double ms);
+    double meanGpuMs() const { return samples ? gpuMsSum / samples : 0.0; }
+    void printSummary() const;
+
+    const BloomSettings& config() const { return settings; }
+
+private:
+    struct Level {
+        int width = 0;               // 分配尺寸
+        int height = 0;
+        GLuint texture = 0;
+        GLuint fbo = 0;
+    };
+
+    BloomSettings settings;
+    int width = 0;
+    int height = 0;
+    std::vector<Level> levels;
+    Level streak[2];
+    GLuint prefilterProgram = 0;
+    GLuint downsampleProgram = 0;
+    GLuint upsampleProgram = 0;
+    GLuint compositeProgram = 0;
+    GLuint streakProgram = 0;
+
+    double gpuMsSum = 0.0;
+    int samples = 0;
+};
+
+// CPU 版本，image 为 width × height 的线性 HDR（行序自下而上，与 renderBlackHoleCPU 一致），原地加上 bloom
+void applyBloomCPU(std::vector<glm::vec3>& image, int width, int height, const BloomSettings& settings);
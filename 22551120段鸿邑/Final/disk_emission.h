@@ -0,0 +1,37 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// ================= 吸积盘黑体发光查找表 =================
+// 二维表：横轴为盘面半径 r_xz ∈ [R_MIN, R_MAX]（决定静止温度 T(r)），纵轴为频移因子 g = ν_obs / ν_emit。
+// 黑体辐射经频移后仍是黑体：I_obs(ν) = g³·B(ν/g, T) = B(ν, g·T)，所以每个表项就是温度 g·T(r) 的黑体颜色。
+// 颜色按同一半径 g = 1 时的亮度归一化，盘的径向亮度仍由体积密度决定，表只负责颜色与多普勒增亮。
+// 片段着色器、计算着色器与 CPU 参考路径都只在盘内采样点做一次查表（双线性，边缘钳制）。
+struct DiskEmissionLUT {
+    static constexpr int RADIUS_SIZE = 64;
+    static constexpr int G_SIZE = 128;
+    static constexpr float R_MIN = 1.8f;       // 与 diskVolume 的内外边界一致
+    static constexpr float R_MAX = 7.0f;
+    static constexpr float G_MIN = 0.2f;       // 开普勒轨道 + 引力红移在 r ≥ 1.8 时 g ∈ [0.23, 1.94]
+    static constexpr float G_MAX = 2.0f;
+    static constexpr float INNER_TEMPERATURE = 9000.0f;   // 内缘温度（K），T(r) = T_in·(r / R_MIN)^(-3/4)
+    static constexpr float BRIGHTNESS = 1.25f;            // g = 1 时的亮度，与原 cinematicDoppler(0) 相同
+
+    std::vector<glm::vec3> texels;   // RADIUS_SIZE × G_SIZE，按 g 行优先，可直接上传为 RGB32F 纹理
+    double buildMs = 0.0;
+    bool fromCache = false;
+
+    void build();
+    // 先读缓存文件（表的尺寸与物理参数都一致才采用），否则重新建表并写回；cachePath 为空时只建表
+    void loadOrBuild(const std::string& cachePath);
+    // 与 GL_LINEAR + GL_CLAMP_TO_EDGE 相同的双线性采样（坐标已映射到首末 texel 中心）
+    glm::vec3 sample(float r, float g) const;
+};
+
+// 盘内一点的频移因子：Schwarzschild 引力红移 × 开普勒圆轨道的相对论多普勒。
+// dir 为从相机出发的光线方向，光子实际沿 -dir 传播；气体朝相机运动时 g > 1
+float diskRedshift(const glm::vec3& pos, const glm::vec3& dir);
+
+// 线性 sRGB 黑体颜色（CIE 1931 解析拟合积分），亮度 Y 未归一化
+glm::vec3 blackbodyRGB(float temperature);
@@ -0,0 +1,77 @@
+#pragma once
+#include <glad/glad.h>
+#include <fstream>
+#include <string>
+
+// ================= 动态分辨率与步数预算 =================
+// 每帧用上一次可读到的 GPU 帧时间（profiler 的计时查询环形缓冲，约 3 帧延迟）调整工作量，使其贴近目标帧时间。
+// 工作量 W = scale² × steps / BASE_STEPS，以原生分辨率、medium 步数为 1；控制器在对数域上做积分：
+//   log W += GAIN × log(target / measured)，误差在 DEADBAND 以内不动，避免来回抖动
+// W 按以下顺序映射到分辨率与步数（先降分辨率，画面最不敏感；步数低于 low 档会出现吸积盘分层，放在最后）：
+//   W ≥ 1           原生分辨率，步数 720 → MAX_STEPS（余量用于提高积分精度）
+//   0.49 ≤ W < 1    步数 720，分辨率 1.0 → 0.7
+//   0.245 ≤ W < 0.49 分辨率 0.7，步数 720 → 360
+//   W < 0.245       步数 360，分辨率 0.7 → MIN_SCALE
+// 场景渲染到满尺寸离屏纹理的左下角子矩形（分辨率变化不重新分配），再由 upscale_sharpen.frag 放大到输出并锐化。
+// 设置了 exposureTexture 时放大着色器使用 TONEMAP 变体，锐化前按该曝光做色调映射（见 tone_mapping.h）。
+class DynamicResolution {
+public:
+    static constexpr float MIN_SCALE = 0.5f;
+    static constexpr float MID_SCALE = 0.7f;
+    static constexpr int BASE_STEPS = 720;
+    static constexpr int MIN_STEPS = 360;
+    static constexpr int MAX_STEPS = 1440;     // 动态变体的 MAX_STEPS，与 high 档相同
+    static constexpr double GAIN = 0.2;
+    static constexpr double DEADBAND = 0.05;
+
+    // outW × outH 为输出尺寸；logPath 非空时每帧写一行 CSV
+    bool init(int outW, int outH, float targetMs, const std::string& logPath);
+    void destroy();
+
+    // 每帧渲染前调用，gpuMs 为最近一次测得的整帧 GPU 耗时（< 0 表示尚无数据）
+    void update(int frame, double gpuMs);
+    // 绑定离屏目标并设置视口为当前渲染尺寸
+    void beginScene();
+    // 放大到 outputFbo（视口恢复为输出尺寸），vao 为全屏四边形
+    void endScene(GLuint outputFbo, GLuint vao);
+
+    int renderWidth() const { return renderW; }
+    int renderHeight() const { return renderH; }
+    int stepBudget() const { return steps; }
+    float renderScale() const { return scale; }
+    // HDR 场景纹理与帧缓冲（有效区域为左下角 renderWidth × renderHeight），供 bloom 与自动曝光统计
+    GLuint sceneTexture() const { return color; }
+    GLuint sceneFramebuffer() const { return fbo; }
+
+    // 运行统计（基准报告与退出时的汇总）
+    double meanScale() const { return frames ? scaleSum / frames : 1.0; }
+    double meanSteps() const { return frames ? stepsSum / frames : (double)BASE_STEPS; }
+    double overBudgetFraction() const { return measured ? (double)overBudget / measured : 0.0; }
+    void printSummary() const;
+
+    float targetMs = 16.6f;
+    float sharpness = 0.5f;
+    GLuint exposureTexture = 0;   // 在 init 之前设置
+
+private:
+    int outW = 0;
+    int outH = 0;
+    GLuint fbo = 0;
+    GLuint color = 0;
+    GLuint upscaleProgram = 0;
+
+    double logWork = 0.0;
+    float scale = 1.0f;
+    int steps = BASE_STEPS;
+    int renderW = 0;
+    int renderH = 0;
+
+    std::ofstream log;
+    int frames = 0;
+    int measured = 0;
+    int overBudget = 0;
+    double scaleSum = 0.0;
+    double stepsSum = 0.0;
+
+    void applyWork();
+};
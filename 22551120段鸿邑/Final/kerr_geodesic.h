@@ -0,0 +1,55 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include "blackhole_cpu.h"
+
+// ================= Kerr 零测地线引擎（科学模式 / 参考真值） =================
+// 在 Boyer–Lindquist 坐标中积分真实的 Kerr 零测地线，双精度，按像素多线程。
+// 场景单位 Rs = 2M = 1，即 M = 0.5；自旋参数 a = spin·M，自旋轴为场景 +y，
+// 转向与吸积盘气体速度 cross(y, pos) 相同（吸积盘为顺行盘）。
+//
+// 守恒量降维：光子取 E = 1，轴向角动量 L 与 Carter 常数 Q 在初始时由相机处 ZAMO 局部标架中的
+// 光线方向算出，之后保持不变。以 Mino 时间 λ（dτ = Σ dλ）为参数，径向与极向方程解耦：
+//   (dr/dλ)² = R(r) = (r² + a² − aL)² − Δ·(Q + (L − a)²)
+//   (dθ/dλ)² = Θ(θ) = Q + a²cos²θ − L²cot²θ
+//   dφ/dλ    = a(r² + a² − aL)/Δ − a + L/sin²θ
+// 为避开转折点处的符号切换，积分二阶形式 d²r/dλ² = R'(r)/2、d²θ/dλ² = Θ'(θ)/2，
+// 状态只有 (r, θ, φ, dr/dλ, dθ/dλ) 五个量；一阶约束 (dr/dλ)² = R(r) 的残差用来监测精度。
+// 方程在 Mino 时间下没有奇点，自适应 Dormand–Prince 5(4) 可以在盘外取很大的步长。
+struct KerrSettings {
+    double tolerance = 1e-9;      // 每步局部误差（相对 + 绝对）
+    double diskStep = 0.02;       // 盘体包围区域内的最大弦长，与 medium 档位步长相同
+    double escapeRadius = 200.0;  // 超过此半径且向外运动视为逃逸，取此时的方向采样星空
+    int maxSteps = 20000;
+};
+
+struct KerrTrace {
+    bool captured = false;        // 落入视界
+    bool unresolved = false;      // 达到 maxSteps 仍未落入视界或逃逸，结果未知（不计入误差统计）
+    glm::dvec3 finalDir{ 0.0 };   // 逃逸方向（场景坐标）
+    glm::vec3 emission{ 0.0f };   // 吸积盘累计发光
+    int steps = 0;                // 接受的积分步数
+    double constraintError = 0.0; // 全程最大的 |(dr/dλ)² − R(r)| / (r² + a²)²
+};
+
+// 与 traceBlackHole 相同的相机模型；params.diskLUT 为空时只积分几何（不计发光）
+glm::vec3 traceKerr(const BlackHoleParams& params, const KerrSettings& settings, glm::vec2 uv, KerrTrace* info = nullptr);
+
+void renderKerrCPU(const BlackHoleParams& params, const KerrSettings& settings, int width, int height,
+                   std::vector<glm::vec3>& out, std::vector<KerrTrace>* info = nullptr, unsigned threads = 0);
+
+// ================= 近似模型的逐像素误差 =================
+// approx 来自 renderBlackHoleCPU（同一相机与分辨率），以 Kerr 结果为真值
+struct KerrComparison {
+    double captureMismatch = 0.0;   // 吸收/逃逸判定不一致的像素比例（分母不含未解出的像素，下同）
+    double meanAngleDeg = 0.0;      // 两者都逃逸的像素：星空采样方向夹角
+    double p95AngleDeg = 0.0;
+    double maxAngleDeg = 0.0;
+    double emissionPSNR = 0.0;      // 截断到 [0,1] 后
+    double meanKerrSteps = 0.0;
+    double maxConstraintError = 0.0;
+    size_t unresolved = 0;          // Kerr 达到步数上限的像素数，不参与上面的比较
+    std::vector<float> angleDeg;    // 每像素误差，判定不一致的像素为 180，两者都被吸收为 0，未解出为 -1
+};
+
+KerrComparison compareWithKerr(const std::vector<TraceInfo>& approx, const std::vector<KerrTrace>& kerr);
@@ -0,0 +1,32 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// ================= 立方体贴图星空 =================
+// 加载时把等距柱状投影（equirect）HDR 转成带完整 mip 链的立方体贴图，CPU 多线程：
+//   - 0 级：每个面 texel 中心的方向在 equirect 上双线性采样，面尺寸取 equirect 宽度 / 4 向上取 2 的幂，
+//     这时 texel 角度与 equirect 赤道处相当（面中心略粗，边角更细）
+//   - 其余各级：上一级 2×2 按 texel 立体角加权平均（预过滤），一直到 1×1
+// 面的朝向与 texel 行序遵循 GL 立方体贴图约定，可按 levels[l] 逐面直接上传。
+// equirect 约定：行序自下而上（stbi 翻转加载），u = atan2(z, x) / 2π + 0.5，v = asin(y) / π + 0.5
+struct SkyCubemap {
+    static constexpr int MAX_FACE_SIZE = 1024;
+
+    int faceSize = 0;
+    // levels[l] 依次存放 +X、-X、+Y、-Y、+Z、-Z 六个面，每面 (faceSize >> l)² 个 texel
+    std::vector<std::vector<glm::vec3>> levels;
+    double buildMs = 0.0;
+
+    // pixels 为 width × height × channels 的 float 数据；threads 为 0 时使用全部硬件线程
+    void build(const float* pixels, int width, int height, int channels, unsigned threads = 0);
+
+    int levelCount() const { return (int)levels.size(); }
+    int levelSize(int level) const { return std::max(1, faceSize >> level); }
+    // 0 级 texel 在面中心张开的角度，着色器用它把光线微分换算成 LOD
+    float texelAngle() const { return 2.0f * std::atan(1.0f / faceSize); }
+};
+
+// 立方体贴图面 face 上 (s, t) ∈ [-1, 1]² 对应的方向（未归一化），t 对应 texel 行
+glm::vec3 cubeFaceDirection(int face, float s, float t);
@@ -0,0 +1,56 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+#include "blackhole_cpu.h"
+
+// ================= 分布式分块渲染 =================
+// 协调进程把每帧切成 tileSize × tileSize 的块，通过本机 TCP 连接分发给若干工作进程（CPU 参考渲染器）：
+//   - 拉取式调度：每个工作进程最多同时持有 PIPELINE 个块（一个在算、一个在路上），做完一个再领一个
+//   - 耗时排序：同一位置的块按上一帧的实测耗时从大到小排队，光子环附近的昂贵块先发
+//   - 窃取：队列空了之后，空闲进程复制执行别人手里最早发出的块，先回来的结果生效，消除帧尾的拖尾
+//   - 容错：连接断开（进程崩溃/被杀）时，它手里未完成的块重新排到队首
+// 同一台 Linux 机器上即可测试：协调进程自己派生工作进程（--workers N），--fail-worker 让其中一个中途退出。
+// 其他机器上的进程也可以用 --tile-worker host:port 连进来。
+struct TileRenderConfig {
+    int width = 1920;
+    int height = 1080;
+    int tileSize = 64;
+    int workers = 4;               // 自动派生的本地工作进程数
+    int port = 0;                  // 0 表示由系统分配
+    int framesInFlight = 2;        // 同时排队的帧数（动画时相邻帧的块可以交错执行）
+    std::string executable;        // 工作进程可执行文件，为空时使用当前进程
+    int failWorker = -1;           // 测试用：该编号的工作进程完成 failAfter 个块后直接退出
+    int failAfter = 3;
+};
+
+struct TileRenderStats {
+    int tiles = 0;                 // 每帧块数 × 帧数
+    int reissued = 0;              // 工作进程断开后重新排队的块
+    int stolen = 0;                // 队列空时复制执行的块
+    int wasted = 0;                // 复制执行中后回来、被丢弃的结果
+    double wallMs = 0.0;
+    struct Worker {
+        int tiles = 0;
+        double busyMs = 0.0;       // 工作进程报告的渲染耗时之和
+        bool alive = true;
+    };
+    std::vector<Worker> workers;
+};
+
+class TileCoordinator {
+public:
+    static constexpr int PIPELINE = 2;
+
+    // 按顺序渲染 frames，每完成一帧（且之前的帧都已完成）调用一次 onFrame(帧号, 图像)。
+    // 图像为 width × height 的线性 HDR，行序自下而上。全部工作进程都断开且仍有未完成的块时返回 false
+    bool run(const std::vector<BlackHoleParams>& frames, const TileRenderConfig& config,
+             const std::function<void(int, const std::vector<glm::vec3>&)>& onFrame);
+    void printStats() const;
+
+    TileRenderStats stats;
+};
+
+// 工作进程入口：连接 address（host:port），循环接收块并回传结果；diskLUT 为任务要求黑体发光时使用的表
+int runTileWorker(const std::string& address, const DiskEmissionLUT* diskLUT, int failAfter = -1);
@@ -0,0 +1,60 @@
+#pragma once
+#include <glad/glad.h>
+
+// ================= HDR 色调映射与自动曝光 =================
+// 黑洞着色器输出的是无上限的 HDR 值（吸积盘逐步累加发光，星点 × 5.5），原来直接写进 8 位默认帧缓冲，内缘与光子环大片截断。
+// 现在场景先渲染到 RGBA16F 目标，之后全在 GPU 上完成，不回读：
+//   1. luminance_histogram.comp：16×16 工作组在共享内存里原子累加 log2 亮度直方图（BINS 个桶），再合并到全局缓冲
+//   2. exposure_adapt.comp：单个工作组做前缀和，取 [LOW_PERCENT, HIGH_PERCENT] 之间的像素求平均亮度，
+//      算出目标曝光并在 log2 域上随时间逼近，结果写进 1×1 的曝光纹理，同时清空直方图
+//   3. tonemap.frag：曝光后经 Hable filmic 曲线映射、gamma 编码到输出帧缓冲
+// 桶 0 收集低于 MIN_LOG_LUM 的像素（黑色背景），不参与平均，否则画面大半是黑色时曝光会一直拉高。
+// 动态分辨率时不单独做第 3 步，由放大锐化着色器（TONEMAP 变体）读取曝光纹理，在锐化前映射。
+// 没有计算着色器（GL 4.3 以下）时曝光固定为 FIXED_EXPOSURE，只做色调映射。
+// 用法：
+//   toneMap.init(width, height);
+//   每帧：toneMap.beginScene(); 渲染场景;
+//         toneMap.measure(toneMap.sceneTexture(), width, height, dt);
+//         toneMap.resolve(outputFbo, vao);
+class ToneMapping {
+public:
+    static constexpr int BINS = 256;                // 与两个计算着色器的工作组大小一致
+    static constexpr float MIN_LOG_LUM = -10.0f;    // 直方图覆盖的 log2 亮度范围
+    static constexpr float MAX_LOG_LUM = 6.0f;
+    static constexpr float LOW_PERCENT = 0.5f;      // 非黑像素中去掉最暗的一半（星空与盘外缘）
+    static constexpr float HIGH_PERCENT = 0.98f;    // 去掉最亮的 2%（光子环、恒星核心），避免少数亮点压暗整幅画面
+    static constexpr float FIXED_EXPOSURE = 1.0f;
+
+    bool init(int width, int height);
+    void destroy();
+
+    // 绑定 HDR 目标，视口为满尺寸
+    void beginScene();
+    // 统计 texture 左下角 w × h 区域的亮度并更新曝光；dt 为本帧时长（秒），决定适应速度
+    void measure(GLuint texture, int w, int h, float dt);
+    // 把 sceneTexture 映射到 outputFbo，vao 为全屏四边形
+    void resolve(GLuint outputFbo, GLuint vao);
+    // 回读当前曝光（会等待 GPU，只在统计时调用）
+    float readExposure() const;
+
+    GLuint sceneTexture() const { return color; }
+    GLuint sceneFramebuffer() const { return fbo; }
+    GLuint exposureTexture() const { return exposure; }
+    bool autoExposure() const { return histogramProgram != 0; }
+
+    float keyValue = 0.18f;        // 平均亮度映射到的中灰
+    float compensation = 0.0f;     // 曝光补偿（EV），--exposure
+    float adaptUp = 1.0f;          // 曝光升高（画面变暗后）的速度，1/s；人眼适应暗处更慢
+    float adaptDown = 3.0f;        // 曝光降低（画面变亮后）的速度
+
+private:
+    int width = 0;
+    int height = 0;
+    GLuint fbo = 0;
+    GLuint color = 0;
+    GLuint exposure = 0;           // 1×1 RGBA32F：r 当前曝光，g 平均亮度，b 目标曝光，a 是否已初始化
+    GLuint histogram = 0;
+    GLuint histogramProgram = 0;
+    GLuint adaptProgram = 0;
+    GLuint tonemapProgram = 0;
+};
@@ -2,6 +2,8 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -9,6 +11,18 @@
 // stb_image 配置
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "../Common/profiler.h"
+#include "../Common/replay.h"
+#include "../Common/benchmark.h"
+#include "../Common/shadermanager.h"
+#include "../Common/streambuffer.h"
+#include "../Common/renderqueue.h"
+#include "../Common/memoryregistry.h"
+#include "../Common/framecapture.h"
+#include "../Common/framepacing.h"
+#include "virtual_texture.h"
+#include "planet_quadtree.h"
+#include "atmosphere.h"
 #define M_PI 3.14159265358979323846
 // 全局变量
 GLFWwindow* window = nullptr;
@@ -19,9 +33,52 @@ const unsigned int SCR_HEIGHT = 600;
 unsigned int sunShaderProgram, earthShaderProgram;
 // 纹理ID
 unsigned int sunTex, earthDiffuseTex, earthNormalTex;
+// 虚拟纹理：地球漫反射贴图按页流式加载（--no-vt 回到整张 2K 纹理，--vt-source 指定 16K–64K 源图）
+bool useVirtualTexture = true;
+std::string vtSource = "E:/OpenGLLearning/OpenGLHW02/Resources/世界地球日地图_2K.jpg";
+VirtualTexture earthVT;
 // 球体VAO/VBO/EBO
 unsigned int sphereVAO, sphereVBO, sphereEBO;
 unsigned int sphereIndexCount = 0;
+// 地球：立方体球四叉树分块 LOD，三角形数随视角变化（--uv-sphere 回到固定的 36×18 UV 球）
+bool usePlanetQuadtree = true;
+PlanetQuadtree earthPlanet;
+// 大气：预计算散射查找表，地球着色器做大气透视、天空通道画大气边缘（--no-atmosphere 关闭，--atmosphere-scale 加厚大气层）
+bool useAtmosphere = true;
+float atmosphereScale = 1.0f;
+float atmosphereExposure = 10.0f;
+Atmosphere earthAtmosphere;
+unsigned int skyShaderProgram = 0;
+unsigned int skyVAO = 0;
+
+// 每帧 / 每次绘制常量：默认写入流式环形缓冲，按偏移绑定到各着色器共用的 FrameBlock / DrawBlock（STREAM_UNIFORMS 变体宏），
+// --no-stream 回到每个程序逐个 glUniform。成员顺序与 frameConstantsSource 一致（std140）
+struct FrameConstants {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 inverseViewProjection;
+    glm::vec3 viewPos;
+    float lightIntensity;
+    glm::vec3 lightPos;
+    float kmPerUnit;
+    glm::vec3 lightColor;
+    float atmosphereExposure;
+    glm::vec3 earthCenter;
+    float pad0;
+    glm::vec3 sunDirection;
+    float pad1;
+};
+static_assert(sizeof(FrameConstants) == 272, "FrameConstants 需与 FrameBlock 的 std140 布局一致");
+struct DrawConstants {
+    glm::mat4 model;
+};
+
+// 渲染队列：太阳、小行星、地球各块与天空作为绘制包提交，按状态排序后统一执行（--immediate 回到按代码顺序立即绘制）；
+// 每次绘制的常量要先写入流式缓冲，--no-stream 时同样立即绘制
+enum RenderPass { PASS_OPAQUE = 0, PASS_SKY = 1 };
+uint16_t sunMaterial = 0, rockMaterial = 0, earthMaterial = 0, skyMaterial = 0;
+// 小行星带：--asteroids N 在太阳与地球轨道之间加 N 颗小球，用于在物体较多的场景下对比每帧状态切换
+int asteroidCount = 0;
 
 // 相机参数
 glm::vec3 cameraPos = glm::vec3(0.0f, 5.0f, 15.0f);
@@ -31,6 +88,9 @@ glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 // 视图矩阵+投影矩阵（全局可访问，供鼠标回调使用）
 glm::mat4 view;
 glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / SCR_HEIGHT, 0.1f, 100.0f);
+// 当前绘制区域大小（拾取射线需要；基准模式下由 --size 决定）
+int viewportWidth = SCR_WIDTH;
+int viewportHeight = SCR_HEIGHT;
 
 // 球体信息结构体：存储名称、世界空间球心、实际半径
 struct SphereInfo {
@@ -106,20 +166,15 @@ Ray screenToWorldRay(float mouseX, float mouseY, const glm::mat4& viewMat, const
     return ray;
 }
 
-// GLFW鼠标按钮回调函数
-void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
-    // 仅处理左键按下事件（GLFW_PRESS：按下；GLFW_RELEASE：释放）
-    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
-        // 步骤1：获取鼠标当前窗口坐标
-        double mouseX, mouseY;
-        glfwGetCursorPos(window, &mouseX, &mouseY);
-
+// 在窗口坐标 (mouseX, mouseY) 处拾取球体（回放脚本中的 click 事件也走这里）
+void pickSphere(float mouseX, float mouseY) {
+    {
         // 步骤2：获取当前的视图矩阵和投影矩阵（全局变量已更新）
         glm::mat4 currentView = view;
         glm::mat4 currentProj = projection;
 
         // 步骤3：转换为世界空间射线
-        Ray ray = screenToWorldRay((float)mouseX, (float)mouseY, currentView, currentProj, SCR_WIDTH, SCR_HEIGHT);
+        Ray ray = screenToWorldRay(mouseX, mouseY, currentView, currentProj, viewportWidth, viewportHeight);
 
         // 步骤4：遍历所有球体，检测相交（记录最近的球体）
         std::string hitSphereName = "";
@@ -151,15 +206,24 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
     }
 }
 
+// GLFW鼠标按钮回调函数
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+    // 仅处理左键按下事件（GLFW_PRESS：按下；GLFW_RELEASE：释放）
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+        // 获取鼠标当前窗口坐标
+        double mouseX, mouseY;
+        glfwGetCursorPos(window, &mouseX, &mouseY);
+        gRecorder.click((float)mouseX, (float)mouseY);
+        pickSphere((float)mouseX, (float)mouseY);
+        gPacer.noteInput();
+    }
+}
+
 // -------------------------- 辅助函数声明 --------------------------
 // GLFW错误回调
 void glfwErrorCallback(int error, const char* description);
 // 窗口大小调整回调
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
-// 编译着色器
-unsigned int compileShader(unsigned int type, const char* source);
-// 创建着色器程序
-unsigned int createShaderProgram(const char* vertexSource, const char* fragmentSource);
 // 生成球体数据（顶点、法线、纹理坐标、索引）
 void generateSphere(float radius, unsigned int sectors, unsigned int stacks);
 // 加载纹理
@@ -170,8 +234,54 @@ bool initResources();
 void renderFrame();
 // 释放资源
 void releaseResources();
+// 绘制地球几何（四叉树星球的本帧块列表或 UV 球）
+void drawEarthGeometry();
+
+glm::mat4 asteroidModel(int index, float time);
 
 // -------------------------- 着色器源码 --------------------------
+// 各着色器共用的常量声明，由 withFrameConstants() 插入到 #version 之后
+const char* frameConstantsSource = R"(
+#ifdef STREAM_UNIFORMS
+    layout(std140) uniform FrameBlock {
+        mat4 view;
+        mat4 projection;
+        mat4 inverseViewProjection;
+        vec3 viewPos;              // 相机位置
+        float lightIntensity;      // 光源强度
+        vec3 lightPos;             // 太阳位置（光源位置）
+        float kmPerUnit;
+        vec3 lightColor;           // 光源颜色
+        float atmosphereExposure;
+        vec3 earthCenter;
+        vec3 sunDirection;
+    };
+    layout(std140) uniform DrawBlock {
+        mat4 model;
+    };
+#else
+    uniform mat4 view;
+    uniform mat4 projection;
+    uniform mat4 inverseViewProjection;
+    uniform vec3 viewPos;
+    uniform float lightIntensity;
+    uniform vec3 lightPos;
+    uniform float kmPerUnit;
+    uniform vec3 lightColor;
+    uniform float atmosphereExposure;
+    uniform vec3 earthCenter;
+    uniform vec3 sunDirection;
+    uniform mat4 model;
+#endif
+)";
+
+std::string withFrameConstants(const char* source)
+{
+    std::string text = source;
+    size_t eol = text.find('\n', text.find("#version"));
+    return text.substr(0, eol + 1) + frameConstantsSource + text.substr(eol + 1);
+}
+
 // 太阳着色器（自发光，仅显示贴图，无需光照）
 const char* sunVertexShaderSource = R"(
     #version 330 core
@@ -180,10 +290,6 @@ const char* sunVertexShaderSource = R"(
 
     out vec2 TexCoords;
 
-    uniform mat4 model;
-    uniform mat4 view;
-    uniform mat4 projection;
-
     void main()
     {
         TexCoords = aTexCoords;
@@ -221,10 +327,6 @@ const char* earthVertexShaderSource = R"(
         mat3 TBN;
     } vs_out;
 
-    uniform mat4 model;
-    uniform mat4 view;
-    uniform mat4 projection;
-
     void main()
     {
         vs_out.FragPos = vec3(model * vec4(aPos, 1.0f));
@@ -257,11 +359,37 @@ const char* earthFragmentShaderSource = R"(
     uniform sampler2D earthDiffuse;
     uniform sampler2D earthNormal;
 
-    // 光照参数
-    uniform vec3 lightPos;     // 太阳位置（光源位置）
-    uniform vec3 viewPos;      // 相机位置
-    uniform vec3 lightColor;   // 光源颜色
-    uniform float lightIntensity; // 光源强度
+#ifdef VIRTUAL_TEXTURE
+    // 虚拟纹理：按屏幕导数选 mip，查间接纹理得到物理页，再在页内双线性采样（页边 4 texel 供过滤使用）
+    uniform sampler2D vtPhysical;
+    uniform usampler2D vtIndirection;
+    uniform vec2 vtSize;
+    uniform int vtLevels;
+    uniform float vtPhysicalSize;
+
+    vec3 sampleVirtual(vec2 uv)
+    {
+        vec2 texel = uv * vtSize;
+        float lod = log2(max(max(length(dFdx(texel)), length(dFdy(texel))), 1e-6));
+        int mip = clamp(int(floor(lod + 0.5)), 0, vtLevels - 1);
+        vec2 p = vec2(fract(uv.x), clamp(uv.y, 0.0, 0.99999));
+        ivec2 pages = (ivec2(vtSize) >> mip) / VT_PAGE_SIZE;
+        ivec2 page = min(ivec2(p * vec2(pages)), pages - 1);
+        // 页未驻留时该项指向最近的已驻留祖先，按实际驻留级别计算页内坐标
+        uvec4 entry = texelFetch(vtIndirection, page, mip);
+        vec2 inPage = fract(p * vtSize / (float(VT_PAGE_SIZE) * exp2(float(entry.z))));
+        vec2 phys = (vec2(entry.xy) * float(VT_SLOT_SIZE) + float(VT_BORDER) + inPage * float(VT_PAGE_SIZE)) / vtPhysicalSize;
+        return textureLod(vtPhysical, phys, 0.0).rgb;
+    }
+#endif
+
+    // 光照参数（lightPos / viewPos / lightColor / lightIntensity）见 frameConstantsSource
+
+#ifdef ATMOSPHERE
+    // 预计算大气：查表函数（Atmosphere::shaderSource()）拼接在本着色器末尾，长度单位为 km
+    vec3 GetSkyRadianceToPoint(vec3 camera, vec3 point, vec3 sunDirection, out vec3 transmittance);
+    vec3 GetSunAndSkyIrradiance(vec3 point, vec3 normal, vec3 sunDirection, out vec3 skyIrradiance);
+#endif
 
     void main()
     {
@@ -271,7 +399,11 @@ const char* earthFragmentShaderSource = R"(
         vec3 normal = normalize(fs_in.TBN * normalMap); // 切线空间 -> 世界空间
 
         // 2. 采样漫反射贴图
+#ifdef VIRTUAL_TEXTURE
+        vec3 diffuseColor = sampleVirtual(fs_in.TexCoords);
+#else
         vec3 diffuseColor = texture(earthDiffuse, fs_in.TexCoords).rgb;
+#endif
 
         // 3. Phong光照计算
         // 环境光
@@ -290,10 +422,50 @@ const char* earthFragmentShaderSource = R"(
 
         // 最终颜色
         vec3 result = ambient + diffuse + specular;
+#ifdef ATMOSPHERE
+        // 大气：太阳直射经大气衰减、天空漫射照亮地面，再乘相机到该点的透射率并加上路径上的内散射（替代 Phong）
+        vec3 pointKm = (fs_in.FragPos - earthCenter) * kmPerUnit;
+        vec3 cameraKm = (viewPos - earthCenter) * kmPerUnit;
+        vec3 skyIrradiance;
+        vec3 sunIrradiance = GetSunAndSkyIrradiance(pointKm, normal, lightDir, skyIrradiance);
+        vec3 groundRadiance = diffuseColor / 3.14159265 * (sunIrradiance + skyIrradiance) * lightIntensity;
+        vec3 transmittance;
+        vec3 inscatter = GetSkyRadianceToPoint(cameraKm, pointKm, lightDir, transmittance);
+        result = 1.0 - exp(-atmosphereExposure * (groundRadiance * transmittance + inscatter));
+#endif
         FragColor = vec4(result, 1.0f);
     }
 )";
 
+// 天空通道：全屏三角形放在远平面，只覆盖没有画到东西的像素，沿视线查散射表得到大气亮度
+const char* skyVertexShaderSource = R"(
+    #version 330 core
+    out vec2 ndc;
+
+    void main()
+    {
+        ndc = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+        gl_Position = vec4(ndc, 1.0, 1.0);
+    }
+)";
+
+const char* skyFragmentShaderSource = R"(
+    #version 330 core
+    out vec4 FragColor;
+    in vec2 ndc;
+
+    vec3 GetSkyRadiance(vec3 camera, vec3 viewRay, vec3 sunDirection, out vec3 transmittance);
+
+    void main()
+    {
+        vec4 farPoint = inverseViewProjection * vec4(ndc, 1.0, 1.0);
+        vec3 viewRay = normalize(farPoint.xyz / farPoint.w - viewPos);
+        vec3 transmittance;
+        vec3 radiance = GetSkyRadiance((viewPos - earthCenter) * kmPerUnit, viewRay, sunDirection, transmittance);
+        FragColor = vec4(1.0 - exp(-atmosphereExposure * radiance), 1.0);
+    }
+)";
+
 // -------------------------- 辅助函数实现 --------------------------
 void glfwErrorCallback(int error, const char* description)
 {
@@ -303,68 +475,18 @@ void glfwErrorCallback(int error, const char* description)
 void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
+    viewportWidth = width;
+    viewportHeight = height;
     // 更新投影矩阵
     projection = glm::perspective(glm::radians(45.0f), (float)width / height, 0.1f, 100.0f);
 }
 
-unsigned int compileShader(unsigned int type, const char* source)
-{
-    unsigned int id = glCreateShader(type);
-    glShaderSource(id, 1, &source, nullptr);
-    glCompileShader(id);
-
-    // 检查编译错误
-    int success;
-    char infoLog[512];
-    glGetShaderiv(id, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(id, 512, nullptr, infoLog);
-        std::cerr << "Shader Compilation Error (" << (type == GL_VERTEX_SHADER ? "Vertex" : "Fragment") << "):\n" << infoLog << std::endl;
-        glDeleteShader(id);
-        return 0;
-    }
-    return id;
-}
-
-unsigned int createShaderProgram(const char* vertexSource, const char* fragmentSource)
-{
-    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
-    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
-    if (vertexShader == 0 || fragmentShader == 0)
-    {
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        return 0;
-    }
-
-    unsigned int program = glCreateProgram();
-    glAttachShader(program, vertexShader);
-    glAttachShader(program, fragmentShader);
-    glLinkProgram(program);
-
-    // 检查链接错误
-    int success;
-    char infoLog[512];
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(program, 512, nullptr, infoLog);
-        std::cerr << "Shader Program Link Error:\n" << infoLog << std::endl;
-        glDeleteProgram(program);
-        program = 0;
-    }
-
-    // 删除中间着色器
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    return program;
-}
-
 void generateSphere(float radius, unsigned int sectors, unsigned int stacks)
 {
     std::vector<float> vertices;
     std::vector<unsigned int> indices;
+    vertices.reserve((size_t)(stacks + 1) * (sectors + 1) * 14);
+    indices.reserve((size_t)stacks * sectors * 6);
 
     float x, y, z, xy;
     float nx, ny, nz, lengthInv = 1.0f / radius;
@@ -530,32 +652,135 @@ unsigned int loadTexture(const char* path, bool isNormalMap)
 
 bool initResources()
 {
-    // 1. 生成球体（半径1，36扇区，18堆叠，足够平滑）
-    generateSphere(1.0f, 36, 18);
+    // 1. 生成球体（半径1，36扇区，18堆叠，足够平滑）；地球默认改用四叉树星球
+    {
+        MemoryAssetScope asset("sphere_mesh");
+        generateSphere(1.0f, 36, 18);
+    }
+    if (usePlanetQuadtree) {
+        MemoryAssetScope asset("planet_chunks");
+        usePlanetQuadtree = earthPlanet.init(1.0f);
+    }
 
-    // 2. 创建着色器程序
-    sunShaderProgram = createShaderProgram(sunVertexShaderSource, sunFragmentShaderSource);
-    earthShaderProgram = createShaderProgram(earthVertexShaderSource, earthFragmentShaderSource);
-    if (sunShaderProgram == 0 || earthShaderProgram == 0)
+    // 流式常量变体：常量声明为 uniform 块，由 gStream 按偏移绑定
+    ShaderDefines streamDefines;
+    if (gStream.enabled) streamDefines.push_back({ "STREAM_UNIFORMS", "1" });
+    std::string earthVertex = withFrameConstants(earthVertexShaderSource);
+
+    // 2. 预切页（页文件已是最新时直接复用）并打开虚拟纹理，失败时回到整张纹理（反馈通道复用地球顶点着色器）
+    const std::string pagePath = "vt_cache/earth_diffuse.vtp";
+    if (useVirtualTexture) {
+        MemoryAssetScope asset("earth_vt");
+        useVirtualTexture = buildPageFile(vtSource, pagePath) && earthVT.open(pagePath, earthVertex.c_str(), streamDefines);
+        if (!useVirtualTexture) {
+            earthVT.close();   // 打开到一半失败时释放已创建的对象
+            std::cerr << "虚拟纹理不可用，使用整张漫反射贴图" << std::endl;
+        }
+    }
+
+    // 3. 大气查找表：参数不变时直接读 atmosphere_cache/ 下的缓存，否则多线程预计算后写入
+    if (useAtmosphere) {
+        MemoryAssetScope asset("atmosphere_luts");
+        useAtmosphere = earthAtmosphere.init(AtmosphereParams().thickened(atmosphereScale), "atmosphere_cache");
+        if (!useAtmosphere) std::cerr << "大气查找表不可用，使用 Phong 光照" << std::endl;
+    }
+
+    // 4. 创建着色器程序（大气查表函数拼接在地球与天空片段着色器末尾）
+    ShaderDefines earthDefines = streamDefines;
+    if (useVirtualTexture) {
+        ShaderDefines vtDefines = VirtualTexture::defines();
+        earthDefines.push_back({ "VIRTUAL_TEXTURE", "1" });
+        earthDefines.insert(earthDefines.end(), vtDefines.begin(), vtDefines.end());
+    }
+    std::string earthFragment = withFrameConstants(earthFragmentShaderSource);
+    std::vector<ShaderDesc> shaderDescs;
+    if (useAtmosphere) {
+        ShaderDefines atmosphereDefines = earthAtmosphere.defines();
+        ShaderDefines skyDefines = streamDefines;
+        skyDefines.insert(skyDefines.end(), atmosphereDefines.begin(), atmosphereDefines.end());
+        earthDefines.insert(earthDefines.end(), atmosphereDefines.begin(), atmosphereDefines.end());
+        earthFragment += Atmosphere::shaderSource();
+        shaderDescs.push_back({ "sky", skyVertexShaderSource, withFrameConstants(skyFragmentShaderSource) + Atmosphere::shaderSource(), skyDefines });
+    }
+    shaderDescs.insert(shaderDescs.begin(), {
+        { "sun", withFrameConstants(sunVertexShaderSource), sunFragmentShaderSource, streamDefines },
+        { "earth", earthVertex, earthFragment, earthDefines },
+    });
+    std::vector<GLuint> programs;
+    {
+        MemoryAssetScope asset("shaders");
+        programs = gShaders.buildAll(shaderDescs);
+    }
+    sunShaderProgram = programs[0];
+    earthShaderProgram = programs[1];
+    if (sunShaderProgram == 0 || earthShaderProgram == 0 || (useAtmosphere && programs[2] == 0))
     {
         return false;
     }
+    if (useAtmosphere) {
+        skyShaderProgram = programs[2];
+        glGenVertexArrays(1, &skyVAO);   // 全屏三角形由 gl_VertexID 生成，核心模式仍需绑定一个 VAO
+    }
+    // 流式常量：块绑定与固定的采样器单元都是程序状态，链接后设置一次
+    if (gStream.enabled) {
+        for (GLuint program : programs) StreamBuffer::bindBlocks(program);
+        glUseProgram(sunShaderProgram);
+        glUniform1i(glGetUniformLocation(sunShaderProgram, "sunTexture"), 0);
+        glUseProgram(earthShaderProgram);
+        glUniform1i(glGetUniformLocation(earthShaderProgram, "earthDiffuse"), 0);
+        glUniform1i(glGetUniformLocation(earthShaderProgram, "earthNormal"), 1);
+        glUseProgram(0);
+    }
 
-    // 3. 加载纹理
+    // 5. 加载纹理（虚拟纹理模式下不再整张加载地球漫反射贴图）
     stbi_set_flip_vertically_on_load(true); // 翻转纹理（OpenGL纹理坐标Y轴向下）
-    sunTex = loadTexture("E:/OpenGLLearning/OpenGLHW02/Resources/太阳_2K.jpg"); // 太阳漫反射贴图
-    earthDiffuseTex = loadTexture("E:/OpenGLLearning/OpenGLHW02/Resources/世界地球日地图_2K.jpg"); // 地球漫反射贴图
-    earthNormalTex = loadTexture("E:/OpenGLLearning/OpenGLHW02/Resources/地球法线贴图_2K.jpg", true); // 地球法线贴图
-    if (sunTex == 0 || earthDiffuseTex == 0 || earthNormalTex == 0)
+    {
+        MemoryAssetScope asset("sun_diffuse");
+        sunTex = loadTexture("E:/OpenGLLearning/OpenGLHW02/Resources/太阳_2K.jpg"); // 太阳漫反射贴图
+    }
+    if (!useVirtualTexture) {
+        MemoryAssetScope asset("earth_diffuse");
+        earthDiffuseTex = loadTexture("E:/OpenGLLearning/OpenGLHW02/Resources/世界地球日地图_2K.jpg"); // 地球漫反射贴图
+    }
+    {
+        MemoryAssetScope asset("earth_normal");
+        earthNormalTex = loadTexture("E:/OpenGLLearning/OpenGLHW02/Resources/地球法线贴图_2K.jpg", true); // 地球法线贴图
+    }
+    if (sunTex == 0 || (!useVirtualTexture && earthDiffuseTex == 0) || earthNormalTex == 0)
     {
         return false;
     }
 
-    // 4. 开启深度测试
+    // 6. 渲染队列材质：纹理绑定由队列按影子状态去重，虚拟纹理与大气查找表的 bind 作为材质回调
+    if (gRenderQueue.enabled) {
+        RenderMaterial sun;
+        sun.textures[0] = { 0, GL_TEXTURE_2D, sunTex };
+        sun.textureCount = 1;
+        sunMaterial = gRenderQueue.addMaterial(sun);
+        // 小行星交替使用太阳贴图与地球法线贴图，同一程序下有两种材质
+        RenderMaterial rock = sun;
+        rock.textures[0].texture = earthNormalTex;
+        rockMaterial = gRenderQueue.addMaterial(rock);
+
+        RenderMaterial earth;
+        earth.textures[earth.textureCount++] = { 1, GL_TEXTURE_2D, earthNormalTex };
+        if (!useVirtualTexture) earth.textures[earth.textureCount++] = { 0, GL_TEXTURE_2D, earthDiffuseTex };
+        earth.apply = [](GLuint program, void*) {
+            if (useVirtualTexture) earthVT.bind(program, 0, 2);
+            if (useAtmosphere) earthAtmosphere.bind(program, 3);
+        };
+        earthMaterial = gRenderQueue.addMaterial(earth);
+
+        RenderMaterial sky;
+        sky.apply = [](GLuint program, void*) { earthAtmosphere.bind(program, 3); };
+        skyMaterial = gRenderQueue.addMaterial(sky);
+    }
+
+    // 7. 开启深度测试
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
 
-    // 5. 设置清屏颜色
+    // 8. 设置清屏颜色
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // 黑色背景（模拟宇宙）
 
     return true;
@@ -569,75 +794,266 @@ void renderFrame()
     // 2. 计算视图矩阵（更新全局view矩阵）
     view = glm::lookAt(cameraPos, cameraTarget, cameraUp);
 
-    // 3. 获取时间（用于地球公转）
-    float time = (float)glfwGetTime();
+    // 3. 获取时间（用于地球公转；回放时使用固定步长的脚本时间）
+    float time = gReplay.active ? (float)gReplay.time() : (float)glfwGetTime();
+    // 公转：绕Y轴旋转，轨道半径8.0f
+    glm::vec3 earthWorldPos = glm::vec3(cos(time) * 8.0f, 0.0f, sin(time) * 8.0f);
+
+    // 贴近地表时按相机高度收近裁剪面，否则掠过地表的近景会被 0.1 的近平面裁掉
+    if (usePlanetQuadtree) {
+        float altitude = glm::length(cameraPos - earthWorldPos) - 0.5f;
+        float nearPlane = glm::clamp(altitude * 0.5f, 0.0005f, 0.1f);
+        projection = glm::perspective(glm::radians(45.0f), (float)viewportWidth / viewportHeight, nearPlane, 100.0f);
+    }
+
+    // 太阳作为点光源位于世界原点；大气：场景单位换算到 km（地球半径 0.5 对应大气模型的地面半径）
+    glm::vec3 sunPos = glm::vec3(0.0f, 0.0f, 0.0f);
+    glm::vec3 lightColor = glm::vec3(1.0f, 0.9f, 0.7f); // 暖黄色太阳光
+    float kmPerUnit = earthAtmosphere.params.bottomRadius / 0.5f;
+    glm::vec3 sunDirection = glm::normalize(sunPos - earthWorldPos);
+
+    // 每帧常量：一次写入环形缓冲并绑定到 FrameBlock，太阳、地球、反馈通道与天空共用
+    if (gStream.enabled) {
+        StreamConstantsScope constants;
+        FrameConstants frame;
+        frame.view = view;
+        frame.projection = projection;
+        frame.inverseViewProjection = glm::inverse(projection * view);
+        frame.viewPos = cameraPos;
+        frame.lightIntensity = 1.0f;
+        frame.lightPos = sunPos;
+        frame.kmPerUnit = kmPerUnit;
+        frame.lightColor = lightColor;
+        frame.atmosphereExposure = atmosphereExposure;
+        frame.earthCenter = earthWorldPos;
+        frame.pad0 = 0.0f;
+        frame.sunDirection = sunDirection;
+        frame.pad1 = 0.0f;
+        gStream.pushUniform(StreamBuffer::FRAME_BINDING, frame);
+    }
 
-    // -------------------------- 渲染太阳 --------------------------
-    glUseProgram(sunShaderProgram);
     // 太阳模型矩阵：缩放（比地球大），无位移（太阳系中心）
     glm::mat4 sunModel = glm::mat4(1.0f);
     sunModel = glm::scale(sunModel, glm::vec3(2.0f, 2.0f, 2.0f)); // 太阳半径放大2倍
-
-    // 设置太阳着色器uniform
-    unsigned int sunModelLoc = glGetUniformLocation(sunShaderProgram, "model");
-    unsigned int sunViewLoc = glGetUniformLocation(sunShaderProgram, "view");
-    unsigned int sunProjLoc = glGetUniformLocation(sunShaderProgram, "projection");
-    glUniformMatrix4fv(sunModelLoc, 1, GL_FALSE, glm::value_ptr(sunModel));
-    glUniformMatrix4fv(sunViewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(sunProjLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-    // 绑定太阳纹理
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, sunTex);
-    glUniform1i(glGetUniformLocation(sunShaderProgram, "sunTexture"), 0);
-
-    // 绘制太阳
-    glBindVertexArray(sphereVAO);
-    glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-
-    // -------------------------- 渲染地球 --------------------------
-    glUseProgram(earthShaderProgram);
     // 地球模型矩阵：公转+缩放（比太阳小）
     glm::mat4 earthModel = glm::mat4(1.0f);
-    // 公转：绕Y轴旋转，轨道半径8.0f
-    glm::vec3 earthWorldPos = glm::vec3(cos(time) * 8.0f, 0.0f, sin(time) * 8.0f);
     earthModel = glm::translate(earthModel, earthWorldPos);
     earthModel = glm::scale(earthModel, glm::vec3(0.5f, 0.5f, 0.5f)); // 地球半径缩小为0.5倍
+    // 反馈通道与正式绘制共用同一个 DrawBlock：写一次，两处按偏移绑定
+    GLintptr earthConstants = -1;
+    if (gStream.enabled) {
+        StreamConstantsScope constants;
+        earthConstants = gStream.write(DrawConstants{ earthModel });
+    }
 
-    // 设置地球着色器uniform（模型/视图/投影矩阵）
-    unsigned int earthModelLoc = glGetUniformLocation(earthShaderProgram, "model");
-    unsigned int earthViewLoc = glGetUniformLocation(earthShaderProgram, "view");
-    unsigned int earthProjLoc = glGetUniformLocation(earthShaderProgram, "projection");
-    glUniformMatrix4fv(earthModelLoc, 1, GL_FALSE, glm::value_ptr(earthModel));
-    glUniformMatrix4fv(earthViewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(earthProjLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-    // 设置光照参数（太阳作为点光源）
-    glm::vec3 sunPos = glm::vec3(0.0f, 0.0f, 0.0f); // 太阳在世界原点
-    glUniform3fv(glGetUniformLocation(earthShaderProgram, "lightPos"), 1, glm::value_ptr(sunPos));
-    glUniform3fv(glGetUniformLocation(earthShaderProgram, "viewPos"), 1, glm::value_ptr(cameraPos));
-    glUniform3f(glGetUniformLocation(earthShaderProgram, "lightColor"), 1.0f, 0.9f, 0.7f); // 暖黄色太阳光
-    glUniform1f(glGetUniformLocation(earthShaderProgram, "lightIntensity"), 1.0f);
-
-    // 绑定地球纹理
-    // 漫反射纹理 -> GL_TEXTURE0
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, earthDiffuseTex);
-    glUniform1i(glGetUniformLocation(earthShaderProgram, "earthDiffuse"), 0);
-    // 法线纹理 -> GL_TEXTURE1
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, earthNormalTex);
-    glUniform1i(glGetUniformLocation(earthShaderProgram, "earthNormal"), 1);
-
-    // 绘制地球
-    glBindVertexArray(sphereVAO);
-    glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    // 四叉树星球：按本帧相机分裂/合并、上传生成好的块并确定绘制列表（反馈通道与正式绘制共用）
+    if (usePlanetQuadtree) {
+        PROFILE_SCOPE("planet_lod");
+        MemoryAssetScope asset("planet_chunks");   // 分裂时新上传的块
+        earthPlanet.update(earthModel, view, projection, cameraPos, viewportHeight, glm::radians(45.0f));
+    }
+
+    // 虚拟纹理：低分辨率反馈通道 + 处理就绪的反馈与读好的页（本帧使用的是几帧前的反馈）
+    // 反馈通道渲染到自己的帧缓冲，不进渲染队列
+    if (useVirtualTexture) {
+        PROFILE_GPU_SCOPE("vt_feedback");
+        MemoryAssetScope asset("earth_vt");        // 窗口尺寸变化时重建的反馈目标
+        GLuint feedbackProgram = earthVT.beginFeedback(viewportWidth, viewportHeight);
+        if (gStream.enabled) gStream.bindRange(StreamBuffer::DRAW_BINDING, earthConstants, sizeof(DrawConstants));
+        else {
+            StreamConstantsScope constants;
+            glUniformMatrix4fv(glGetUniformLocation(feedbackProgram, "model"), 1, GL_FALSE, glm::value_ptr(earthModel));
+            glUniformMatrix4fv(glGetUniformLocation(feedbackProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(glGetUniformLocation(feedbackProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        }
+        drawEarthGeometry();
+        earthVT.endFeedback();
+        earthVT.update();
+    }
+
+    // -------------------------- 渲染队列 --------------------------
+    // 太阳与小行星（同一程序）排在一起、按材质分组；地球四叉树的每一块是一个绘制包；天空在不透明物体之后
+    if (gRenderQueue.enabled) {
+        PROFILE_GPU_SCOPE("bodies");
+        const float farPlane = 100.0f;
+        DrawPacket sphere;
+        sphere.vao = sphereVAO;
+        sphere.count = sphereIndexCount;
+        sphere.indexType = GL_UNSIGNED_INT;
+        sphere.drawConstantsSize = sizeof(DrawConstants);
+
+        DrawPacket sun = sphere;
+        sun.program = sunShaderProgram;
+        sun.material = sunMaterial;
+        {
+            StreamConstantsScope constants;
+            sun.drawConstants = gStream.write(DrawConstants{ sunModel });
+        }
+        gRenderQueue.submit(sun, PASS_OPAQUE, glm::length(cameraPos - sunPos), farPlane);
+
+        for (int i = 0; i < asteroidCount; ++i) {
+            glm::mat4 model = asteroidModel(i, time);
+            DrawPacket rock = sun;
+            rock.material = i % 2 ? rockMaterial : sunMaterial;
+            {
+                StreamConstantsScope constants;
+                rock.drawConstants = gStream.write(DrawConstants{ model });
+            }
+            gRenderQueue.submit(rock, PASS_OPAQUE, glm::length(cameraPos - glm::vec3(model[3])), farPlane);
+        }
+
+        DrawPacket earth = sphere;
+        earth.program = earthShaderProgram;
+        earth.material = earthMaterial;
+        earth.drawConstants = earthConstants;
+        float earthDepth = glm::length(cameraPos - earthWorldPos);
+        if (usePlanetQuadtree) {
+            earth.count = earthPlanet.chunkIndexCount();
+            for (GLuint vao : earthPlanet.drawVAOs()) {
+                earth.vao = vao;
+                gRenderQueue.submit(earth, PASS_OPAQUE, earthDepth, farPlane);
+            }
+        }
+        else gRenderQueue.submit(earth, PASS_OPAQUE, earthDepth, farPlane);
+
+        // 深度 1.0 + GL_LEQUAL：只通过清屏后没被太阳、地球覆盖的像素；不写深度
+        if (useAtmosphere) {
+            DrawPacket sky;
+            sky.program = skyShaderProgram;
+            sky.material = skyMaterial;
+            sky.vao = skyVAO;
+            sky.count = 3;
+            sky.depthWrite = false;
+            gRenderQueue.submit(sky, PASS_SKY, farPlane, farPlane);
+        }
+
+        gRenderQueue.execute();
+    }
+    else {
+        // -------------------------- 渲染太阳 --------------------------
+        glUseProgram(sunShaderProgram);
+
+        // 设置太阳着色器uniform
+        if (gStream.enabled) {
+            StreamConstantsScope constants;
+            gStream.pushUniform(StreamBuffer::DRAW_BINDING, DrawConstants{ sunModel });
+        }
+        else {
+            StreamConstantsScope constants;
+            unsigned int sunModelLoc = glGetUniformLocation(sunShaderProgram, "model");
+            unsigned int sunViewLoc = glGetUniformLocation(sunShaderProgram, "view");
+            unsigned int sunProjLoc = glGetUniformLocation(sunShaderProgram, "projection");
+            glUniformMatrix4fv(sunModelLoc, 1, GL_FALSE, glm::value_ptr(sunModel));
+            glUniformMatrix4fv(sunViewLoc, 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(sunProjLoc, 1, GL_FALSE, glm::value_ptr(projection));
+            glUniform1i(glGetUniformLocation(sunShaderProgram, "sunTexture"), 0);
+        }
 
-    // 解绑纹理和着色器
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glUseProgram(0);
+        // 绑定太阳纹理
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, sunTex);
+
+        // 绘制太阳
+        {
+            PROFILE_GPU_SCOPE("sun");
+            glBindVertexArray(sphereVAO);
+            glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+            glBindVertexArray(0);
+        }
+
+        // -------------------------- 渲染小行星 --------------------------
+        for (int i = 0; i < asteroidCount; ++i) {
+            glUseProgram(sunShaderProgram);
+            glm::mat4 model = asteroidModel(i, time);
+            if (gStream.enabled) {
+                StreamConstantsScope constants;
+                gStream.pushUniform(StreamBuffer::DRAW_BINDING, DrawConstants{ model });
+            }
+            else {
+                StreamConstantsScope constants;
+                glUniformMatrix4fv(glGetUniformLocation(sunShaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+            }
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, i % 2 ? earthNormalTex : sunTex);
+            glBindVertexArray(sphereVAO);
+            glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+            glBindVertexArray(0);
+        }
+
+        // -------------------------- 渲染地球 --------------------------
+        glUseProgram(earthShaderProgram);
+        if (gStream.enabled) gStream.bindRange(StreamBuffer::DRAW_BINDING, earthConstants, sizeof(DrawConstants));
+
+        // 设置地球着色器uniform（模型/视图/投影矩阵、光照参数与大气参数）
+        if (!gStream.enabled) {
+            StreamConstantsScope constants;
+            unsigned int earthModelLoc = glGetUniformLocation(earthShaderProgram, "model");
+            unsigned int earthViewLoc = glGetUniformLocation(earthShaderProgram, "view");
+            unsigned int earthProjLoc = glGetUniformLocation(earthShaderProgram, "projection");
+            glUniformMatrix4fv(earthModelLoc, 1, GL_FALSE, glm::value_ptr(earthModel));
+            glUniformMatrix4fv(earthViewLoc, 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(earthProjLoc, 1, GL_FALSE, glm::value_ptr(projection));
+            glUniform3fv(glGetUniformLocation(earthShaderProgram, "lightPos"), 1, glm::value_ptr(sunPos));
+            glUniform3fv(glGetUniformLocation(earthShaderProgram, "viewPos"), 1, glm::value_ptr(cameraPos));
+            glUniform3fv(glGetUniformLocation(earthShaderProgram, "lightColor"), 1, glm::value_ptr(lightColor));
+            glUniform1f(glGetUniformLocation(earthShaderProgram, "lightIntensity"), 1.0f);
+            if (useAtmosphere) {
+                glUniform3fv(glGetUniformLocation(earthShaderProgram, "earthCenter"), 1, glm::value_ptr(earthWorldPos));
+                glUniform1f(glGetUniformLocation(earthShaderProgram, "kmPerUnit"), kmPerUnit);
+                glUniform1f(glGetUniformLocation(earthShaderProgram, "atmosphereExposure"), atmosphereExposure);
+            }
+        }
+        // 大气查找表 -> GL_TEXTURE3–5
+        if (useAtmosphere) earthAtmosphere.bind(earthShaderProgram, 3);
+
+        // 绑定地球纹理
+        // 漫反射纹理 -> GL_TEXTURE0（虚拟纹理：物理页缓存 -> GL_TEXTURE0，间接纹理 -> GL_TEXTURE2）
+        if (useVirtualTexture) {
+            earthVT.bind(earthShaderProgram, 0, 2);
+        }
+        else {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, earthDiffuseTex);
+            if (!gStream.enabled) glUniform1i(glGetUniformLocation(earthShaderProgram, "earthDiffuse"), 0);
+        }
+        // 法线纹理 -> GL_TEXTURE1
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, earthNormalTex);
+        if (!gStream.enabled) glUniform1i(glGetUniformLocation(earthShaderProgram, "earthNormal"), 1);
+
+        // 绘制地球
+        {
+            PROFILE_GPU_SCOPE("earth");
+            drawEarthGeometry();
+        }
+
+        // -------------------------- 渲染天空（大气边缘） --------------------------
+        if (useAtmosphere) {
+            PROFILE_GPU_SCOPE("sky");
+            glUseProgram(skyShaderProgram);
+            if (!gStream.enabled) {
+                StreamConstantsScope constants;
+                glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+                glUniformMatrix4fv(glGetUniformLocation(skyShaderProgram, "inverseViewProjection"), 1, GL_FALSE, glm::value_ptr(inverseViewProjection));
+                glUniform3fv(glGetUniformLocation(skyShaderProgram, "viewPos"), 1, glm::value_ptr(cameraPos));
+                glUniform3fv(glGetUniformLocation(skyShaderProgram, "earthCenter"), 1, glm::value_ptr(earthWorldPos));
+                glUniform3fv(glGetUniformLocation(skyShaderProgram, "sunDirection"), 1, glm::value_ptr(sunDirection));
+                glUniform1f(glGetUniformLocation(skyShaderProgram, "kmPerUnit"), kmPerUnit);
+                glUniform1f(glGetUniformLocation(skyShaderProgram, "atmosphereExposure"), atmosphereExposure);
+            }
+            earthAtmosphere.bind(skyShaderProgram, 3);
+            // 深度 1.0 + GL_LEQUAL：只通过清屏后没被太阳、地球覆盖的像素；不写深度
+            glDepthMask(GL_FALSE);
+            glBindVertexArray(skyVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glBindVertexArray(0);
+            glDepthMask(GL_TRUE);
+        }
+
+        // 解绑纹理和着色器
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glUseProgram(0);
+    }
 
     // 关键：实时更新地球的世界球心（因公转位置变化）
     if (!sphereList.empty() && sphereList.size() >= 2) {
@@ -645,6 +1061,29 @@ void renderFrame()
     }
 }
 
+void drawEarthGeometry()
+{
+    if (usePlanetQuadtree) {
+        earthPlanet.draw();
+        return;
+    }
+    glBindVertexArray(sphereVAO);
+    glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
+// 小行星 index 在时刻 time 的模型矩阵：半径 4–6 的环带上按黄金角分布，各自以略不同的角速度公转
+glm::mat4 asteroidModel(int index, float time)
+{
+    auto hash = [](float x) { return x - std::floor(x); };
+    float angle = index * 2.39996323f + time * (0.3f + 0.2f * hash(index * 0.381966f));
+    float radius = 4.0f + 2.0f * hash(index * 0.618034f);
+    float height = 0.4f * (hash(index * 0.754878f) - 0.5f);
+    float scale = 0.04f + 0.06f * hash(index * 0.569840f);
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(cos(angle) * radius, height, sin(angle) * radius));
+    return glm::scale(model, glm::vec3(scale));
+}
+
 void releaseResources()
 {
     // 删除VAO/VBO/EBO
@@ -656,6 +1095,14 @@ void releaseResources()
     glDeleteProgram(sunShaderProgram);
     glDeleteProgram(earthShaderProgram);
 
+    if (useVirtualTexture) earthVT.close();
+    if (usePlanetQuadtree) earthPlanet.destroy();
+    if (useAtmosphere) {
+        earthAtmosphere.destroy();
+        glDeleteProgram(skyShaderProgram);
+        glDeleteVertexArrays(1, &skyVAO);
+    }
+
     // 删除纹理
     glDeleteTextures(1, &sunTex);
     glDeleteTextures(1, &earthDiffuseTex);
@@ -663,8 +1110,34 @@ void releaseResources()
 }
 
 // -------------------------- 主函数 --------------------------
-int main()
+int main(int argc, char** argv)
 {
+    // 基准模式：--bench <脚本>，固定步长回放输入并离屏渲染
+    BenchmarkConfig benchConfig;
+    bool benchMode = parseBenchmarkArgs(argc, argv, "solar_system", benchConfig);
+    if (benchMode && !gReplay.load(benchConfig.script)) return -1;
+    PacingConfig pacingConfig;
+    parsePacingArgs(argc, argv, pacingConfig);
+    std::string captureTarget;
+    int captureFps = 60;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-vt") == 0) useVirtualTexture = false;
+        if (strcmp(argv[i], "--vt-source") == 0 && i + 1 < argc) vtSource = argv[i + 1];
+        if (strcmp(argv[i], "--uv-sphere") == 0) usePlanetQuadtree = false;
+        if (strcmp(argv[i], "--no-atmosphere") == 0) useAtmosphere = false;
+        if (strcmp(argv[i], "--no-stream") == 0) gStream.enabled = false;
+        if (strcmp(argv[i], "--immediate") == 0) gRenderQueue.enabled = false;
+        if (strcmp(argv[i], "--asteroids") == 0 && i + 1 < argc) asteroidCount = std::max(0, atoi(argv[i + 1]));
+        if (strcmp(argv[i], "--atmosphere-scale") == 0 && i + 1 < argc) atmosphereScale = std::max(1.0f, (float)atof(argv[i + 1]));
+        if (strcmp(argv[i], "--vram-budget") == 0 && i + 1 < argc) gMemory.budget.gpuBytes = (uint64_t)(atof(argv[i + 1]) * 1024 * 1024);
+        if (strcmp(argv[i], "--host-budget") == 0 && i + 1 < argc) gMemory.budget.hostBytes = (uint64_t)(atof(argv[i + 1]) * 1024 * 1024);
+        if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) captureTarget = argv[i + 1];
+        if (strcmp(argv[i], "--capture-fps") == 0 && i + 1 < argc) captureFps = std::max(1, atoi(argv[i + 1]));
+    }
+    if (!gStream.enabled) gRenderQueue.enabled = false;
+    int width = benchConfig.width ? benchConfig.width : SCR_WIDTH;
+    int height = benchConfig.height ? benchConfig.height : SCR_HEIGHT;
+
     // 1. 初始化GLFW
     glfwSetErrorCallback(glfwErrorCallback);
     if (!glfwInit())
@@ -677,9 +1150,10 @@ int main()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (benchMode) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     // 3. 创建窗口
-    window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Simple Solar System (GLFW)", nullptr, nullptr);
+    window = glfwCreateWindow(width, height, "Simple Solar System (GLFW)", nullptr, nullptr);
     if (window == nullptr)
     {
         std::cerr << "GLFW window creation failed!" << std::endl;
@@ -687,9 +1161,11 @@ int main()
         return -1;
     }
     glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-    // 设置鼠标按钮回调（关键：监听左键点击）
-    glfwSetMouseButtonCallback(window, mouseButtonCallback);
+    if (!benchMode) {
+        glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+        // 设置鼠标按钮回调（关键：监听左键点击）
+        glfwSetMouseButtonCallback(window, mouseButtonCallback);
+    }
 
     // 4. 初始化GLAD
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -700,11 +1176,23 @@ int main()
         return -1;
     }
 
+    gProfiler.init("solar_system");
+    gMemory.init("solar_system");
+    // 超出预算时先逐级降低星球的最深级别（更深的块合并释放），降到 6 级后再由内置回调去掉纹理的顶层 mip
+    gMemory.addDowngrade("planet_lod", [](void*) {
+        if (!usePlanetQuadtree || earthPlanet.maxDepth <= 6) return false;
+        earthPlanet.maxDepth--;
+        return true;
+    });
+    gShaders.init("shader_cache");
+    gStream.init(16 * 1024 + (size_t)asteroidCount * 256);   // 每颗小行星一个 DrawBlock（按 256 字节对齐计）
+
     // 5. 初始化资源
     if (!initResources())
     {
         std::cerr << "Resource initialization failed!" << std::endl;
         releaseResources();
+        gMemory.shutdown();
         glfwDestroyWindow(window);
         glfwTerminate();
         return -1;
@@ -725,21 +1213,140 @@ int main()
     earth.worldRadius = 1.0f * 0.5f; // 局部半径1.0f * 缩放0.5倍
     sphereList.push_back(earth);
 
+    // 基准模式准备：回放回调与离屏目标
+    OffscreenTarget benchTarget;
+    BenchmarkRun benchRun;
+    int benchFrames = 0;
+    int frameNo = 0;
+    // 四叉树星球每帧的三角形数（基准报告）
+    double planetTriangleSum = 0.0;
+    uint64_t planetTriangleMax = 0;
+    if (benchMode) {
+        gReplay.onClick = [](float x, float y) { pickSphere(x, y); };
+        gReplay.onCamera = [](const float* v) {
+            cameraPos = glm::vec3(v[0], v[1], v[2]);
+            cameraTarget = glm::vec3(v[3], v[4], v[5]);
+        };
+        benchTarget.create(width, height);
+        viewportWidth = width;
+        viewportHeight = height;
+        projection = glm::perspective(glm::radians(45.0f), (float)width / height, 0.1f, 100.0f);
+        benchFrames = benchConfig.frames ? benchConfig.frames : (int)gReplay.frames;
+        benchRun.begin(benchConfig, width, height, (const char*)glGetString(GL_RENDERER));
+    }
+
+    if (!captureTarget.empty()) gCapture.start(captureTarget, viewportWidth, viewportHeight, captureFps);
+    // 相机只由回放驱动，没有可积分的输入：只用围栏限制在途帧数，点击选取计入延迟测量
+    if (!benchMode) gPacer.init(window, pacingConfig);
+
     // 7. 渲染循环
-    while (!glfwWindowShouldClose(window))
+    double loopStart = glfwGetTime();
+    while (benchMode ? frameNo < benchFrames : !glfwWindowShouldClose(window))
     {
-        // 渲染帧
-        renderFrame();
+        gProfiler.beginFrame();
+        gPacer.beginFrame();
+        gStream.beginFrame();
+        if (benchMode) {
+            benchRun.frameStart();
+            gReplay.advance();
+            benchTarget.bind();
+        }
+        else {
+            gRecorder.update(window, "solar_system");
+            gCapture.handleHotkey(window, "solar_system", captureTarget);
+        }
+
+        // 渲染帧：开始前再取一次事件，帧开始时等围栏期间的点击也赶得上本帧
+        gPacer.latch(window, [] {});
+        {
+            PROFILE_SCOPE("render");
+            renderFrame();
+        }
+        gStream.endFrame();
+        gRenderQueue.endFrame();
+        // 虚拟纹理命中率与读盘带宽、星球块与三角形数，每 120 帧输出一次
+        if (useVirtualTexture && !benchMode && frameNo % 120 == 119) earthVT.printStats();
+        if (usePlanetQuadtree) {
+            planetTriangleSum += (double)earthPlanet.stats.triangles;
+            planetTriangleMax = std::max(planetTriangleMax, earthPlanet.stats.triangles);
+            if (!benchMode && frameNo % 120 == 119) earthPlanet.printStats();
+        }
+
+        gMemory.endFrame(benchMode ? nullptr : window);
+        gCapture.capture(benchMode ? benchTarget.fbo : 0);   // 叠加层之前，录下的只有画面
+
+        if (benchMode) {
+            benchRun.frameEnd(true);
+            gProfiler.endFrame(nullptr);
+            if (frameNo++ == 0) gShaders.reportStartup("solar_system");
+            continue;
+        }
 
         // 交换缓冲+处理事件
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        gProfiler.drawOverlay();
+        gPacer.endFrame();
+        {
+            PROFILE_SCOPE("swap");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        gProfiler.endFrame(window);
+        if (frameNo++ == 0) gShaders.reportStartup("solar_system");
+    }
+
+    gPacer.shutdown();
+    if (gCapture.active()) {
+        gCapture.stop();
+        gCapture.printStats("solar_system");
+    }
+
+    int result = 0;
+    if (benchMode) {
+        if (!benchConfig.image.empty()) {
+            std::vector<unsigned char> pixels = benchTarget.readPixels();
+            writeImagePPM(benchConfig.image, width, height, pixels.data(), true);
+        }
+        if (useVirtualTexture) {
+            const VirtualTextureStats& vt = earthVT.stats;
+            double seconds = std::max(glfwGetTime() - loopStart, 1e-6);
+            earthVT.printStats();
+            benchRun.setMetric("vt_hit_rate", vt.requests ? (double)vt.hits / vt.requests : 1.0);
+            benchRun.setMetric("vt_stream_mb_per_s", vt.bytesStreamed / (1024.0 * 1024.0) / seconds);
+            benchRun.setMetric("vt_pages_streamed", (double)vt.pagesStreamed);
+            benchRun.setMetric("vt_evictions", (double)vt.evictions);
+        }
+        if (usePlanetQuadtree) {
+            earthPlanet.printStats();
+            benchRun.setMetric("planet_mean_triangles", planetTriangleSum / std::max(frameNo, 1));
+            benchRun.setMetric("planet_max_triangles", (double)planetTriangleMax);
+            benchRun.setMetric("planet_chunks_built", (double)earthPlanet.stats.chunksBuilt);
+            benchRun.setMetric("planet_chunk_build_ms", earthPlanet.stats.buildMs);
+        }
+        if (useAtmosphere) {
+            benchRun.setMetric("atmosphere_lut_ms", earthAtmosphere.precomputeMs);
+            benchRun.setMetric("atmosphere_lut_cached", earthAtmosphere.fromCache ? 1.0 : 0.0);
+        }
+        addStreamMetrics(benchRun, gStream);
+        addRenderQueueMetrics(benchRun, gRenderQueue);
+        addMemoryMetrics(benchRun, gMemory);
+        if (gCapture.stats.frames) addCaptureMetrics(benchRun, gCapture);
+        if (usePlanetQuadtree) benchRun.setMetric("planet_max_depth", (double)earthPlanet.maxDepth);
+        benchRun.setMetric("asteroids", (double)asteroidCount);
+        gMemory.writeJson("solar_system_memory.json");
+        result = benchRun.writeReport() ? 0 : -1;
+        benchTarget.destroy();
     }
 
     // 8. 释放资源
+    gStream.printStats("solar_system");
+    gRenderQueue.printStats("solar_system");
+    gPacer.printStats("solar_system");
+    gStream.shutdown();
+    gProfiler.shutdown();
     releaseResources();
+    gMemory.shutdown();
     glfwDestroyWindow(window);
     glfwTerminate();
 
-    return 0;
+    return result;
 }
\ No newline at end of file
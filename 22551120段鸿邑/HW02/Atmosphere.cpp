@@ -0,0 +1,694 @@
+#include "atmosphere.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+static const float PI = 3.14159265358979f;
+static const uint32_t CACHE_MAGIC = 0x4F4D5441;   // "ATMO"
+static const uint32_t CACHE_VERSION = 1;
+
+template <typename F>
+static void parallelRows(int rows, unsigned threads, F&& rowFn) {
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int r = next++; r < rows; r = next++) rowFn(r);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+// ================= 大气模型（CPU 端，与 shaderSource() 中的 GLSL 一一对应） =================
+namespace {
+
+float clamp01(float x) { return std::min(std::max(x, 0.0f), 1.0f); }
+float clampCos(float x) { return std::min(std::max(x, -1.0f), 1.0f); }
+float coordFromUnit(float x, int n) { return 0.5f / n + x * (1.0f - 1.0f / n); }
+float unitFromCoord(float u, int n) { return (u - 0.5f / n) / (1.0f - 1.0f / n); }
+float smoothstep(float a, float b, float x) {
+    float t = clamp01((x - a) / (b - a));
+    return t * t * (3.0f - 2.0f * t);
+}
+glm::vec3 expNeg(const glm::vec3& x) { return glm::vec3(std::exp(-x.x), std::exp(-x.y), std::exp(-x.z)); }
+float rayleighPhase(float nu) { return 3.0f / (16.0f * PI) * (1.0f + nu * nu); }
+float miePhase(float g, float nu) {
+    float k = 3.0f / (8.0f * PI) * (1.0f - g * g) / (2.0f + g * g);
+    return k * (1.0f + nu * nu) / std::pow(1.0f + g * g - 2.0f * g * nu, 1.5f);
+}
+
+struct Model {
+    const AtmosphereParams& p;
+    float H;   // 地面处水平射线到大气顶的距离
+    std::vector<glm::vec4>& transmittance;
+    std::vector<glm::vec3> multiScattering;
+    std::vector<glm::vec4>& scattering;
+
+    Model(const AtmosphereParams& params, std::vector<glm::vec4>& t, std::vector<glm::vec4>& s)
+        : p(params), H(std::sqrt(params.topRadius * params.topRadius - params.bottomRadius * params.bottomRadius)),
+          transmittance(t), scattering(s) {}
+
+    float clampRadius(float r) const { return std::min(std::max(r, p.bottomRadius), p.topRadius); }
+    float distanceToTop(float r, float mu) const {
+        float disc = r * r * (mu * mu - 1.0f) + p.topRadius * p.topRadius;
+        return std::max(-r * mu + std::sqrt(std::max(disc, 0.0f)), 0.0f);
+    }
+    float distanceToBottom(float r, float mu) const {
+        float disc = r * r * (mu * mu - 1.0f) + p.bottomRadius * p.bottomRadius;
+        return std::max(-r * mu - std::sqrt(std::max(disc, 0.0f)), 0.0f);
+    }
+    bool intersectsGround(float r, float mu) const {
+        return mu < 0.0f && r * r * (mu * mu - 1.0f) + p.bottomRadius * p.bottomRadius >= 0.0f;
+    }
+    float distanceToNearest(float r, float mu, bool ground) const {
+        return ground ? distanceToBottom(r, mu) : distanceToTop(r, mu);
+    }
+
+    // 密度分布：Rayleigh、Mie 指数衰减，臭氧为以 ozoneCenter 为峰的帐篷形
+    float rayleighDensity(float h) const { return std::exp(-h / p.rayleighScaleHeight); }
+    float mieDensity(float h) const { return std::exp(-h / p.mieScaleHeight); }
+    float ozoneDensity(float h) const { return std::max(0.0f, 1.0f - std::fabs(h - p.ozoneCenter) / (p.ozoneWidth * 0.5f)); }
+    glm::vec3 extinction(float h) const {
+        return p.rayleighScattering * rayleighDensity(h) + p.mieExtinction * mieDensity(h) + p.ozoneAbsorption * ozoneDensity(h);
+    }
+    glm::vec3 scatteringCoefficient(float h) const {
+        return p.rayleighScattering * rayleighDensity(h) + p.mieScattering * mieDensity(h);
+    }
+
+    // ---- 透射率 ----
+    glm::vec3 computeTransmittanceToTop(float r, float mu) const {
+        const int SAMPLES = 500;
+        float dx = distanceToTop(r, mu) / SAMPLES;
+        glm::vec3 depth(0.0f);
+        for (int i = 0; i <= SAMPLES; ++i) {
+            float d = i * dx;
+            float h = std::sqrt(d * d + 2.0f * r * mu * d + r * r) - p.bottomRadius;
+            depth += extinction(h) * (i == 0 || i == SAMPLES ? 0.5f : 1.0f);
+        }
+        return expNeg(depth * dx);
+    }
+    void transmittanceTexel(int x, int y, float& r, float& mu) const {
+        float xMu = unitFromCoord((x + 0.5f) / Atmosphere::TRANSMITTANCE_W, Atmosphere::TRANSMITTANCE_W);
+        float xR = unitFromCoord((y + 0.5f) / Atmosphere::TRANSMITTANCE_H, Atmosphere::TRANSMITTANCE_H);
+        float rho = H * xR;
+        r = std::sqrt(rho * rho + p.bottomRadius * p.bottomRadius);
+        float dMin = p.topRadius - r, dMax = rho + H;
+        float d = dMin + xMu * (dMax - dMin);
+        mu = d == 0.0f ? 1.0f : clampCos((H * H - rho * rho - d * d) / (2.0f * r * d));
+    }
+    glm::vec3 transmittanceToTop(float r, float mu) const {
+        float rho = std::sqrt(std::max(r * r - p.bottomRadius * p.bottomRadius, 0.0f));
+        float d = distanceToTop(r, mu);
+        float dMin = p.topRadius - r, dMax = rho + H;
+        float u = coordFromUnit((d - dMin) / (dMax - dMin), Atmosphere::TRANSMITTANCE_W);
+        float v = coordFromUnit(rho / H, Atmosphere::TRANSMITTANCE_H);
+        // 双线性，边缘截断（与 GL_LINEAR + CLAMP_TO_EDGE 一致）
+        float fx = std::min(std::max(u * Atmosphere::TRANSMITTANCE_W - 0.5f, 0.0f), Atmosphere::TRANSMITTANCE_W - 1.0f);
+        float fy = std::min(std::max(v * Atmosphere::TRANSMITTANCE_H - 0.5f, 0.0f), Atmosphere::TRANSMITTANCE_H - 1.0f);
+        int x0 = (int)fx, y0 = (int)fy;
+        int x1 = std::min(x0 + 1, Atmosphere::TRANSMITTANCE_W - 1), y1 = std::min(y0 + 1, Atmosphere::TRANSMITTANCE_H - 1);
+        float tx = fx - x0, ty = fy - y0;
+        auto at = [&](int x, int y) { return glm::vec3(transmittance[(size_t)y * Atmosphere::TRANSMITTANCE_W + x]); };
+        return (at(x0, y0) * (1.0f - tx) + at(x1, y0) * tx) * (1.0f - ty) + (at(x0, y1) * (1.0f - tx) + at(x1, y1) * tx) * ty;
+    }
+    glm::vec3 transmittanceAlong(float r, float mu, float d, bool ground) const {
+        float rd = clampRadius(std::sqrt(d * d + 2.0f * r * mu * d + r * r));
+        float mud = clampCos((r * mu + d) / rd);
+        glm::vec3 a = ground ? transmittanceToTop(rd, -mud) : transmittanceToTop(r, mu);
+        glm::vec3 b = ground ? transmittanceToTop(r, -mu) : transmittanceToTop(rd, mud);
+        return glm::vec3(std::min(a.x / std::max(b.x, 1e-20f), 1.0f), std::min(a.y / std::max(b.y, 1e-20f), 1.0f),
+                         std::min(a.z / std::max(b.z, 1e-20f), 1.0f));
+    }
+    // 太阳圆盘落到地平线下的部分按面积近似为 smoothstep
+    glm::vec3 transmittanceToSun(float r, float muS) const {
+        float sinH = p.bottomRadius / r;
+        float cosH = -std::sqrt(std::max(1.0f - sinH * sinH, 0.0f));
+        return transmittanceToTop(r, muS) * smoothstep(-sinH * p.sunAngularRadius, sinH * p.sunAngularRadius, muS - cosH);
+    }
+
+    // ---- 多次散射 ψms(r, μs)（Hillaire 2020）----
+    // 对 64 个方向各做一次到边界的步进：L 为以各向同性相函数散射一次的太阳光（含地面反射），
+    // f 为散射回该点的比例；无穷阶几何级数求和得 ψ = L / (1 - f)。太阳辐照度留到使用时再乘
+    glm::vec3 computeMultiScattering(float r, float muS) const {
+        const int SQRT_DIRECTIONS = 8;
+        const int STEPS = 20;
+        glm::vec3 position(0.0f, 0.0f, r);
+        glm::vec3 sun(0.0f, std::sqrt(std::max(1.0f - muS * muS, 0.0f)), muS);
+        glm::vec3 secondOrder(0.0f), transfer(0.0f);
+        for (int i = 0; i < SQRT_DIRECTIONS; ++i) {
+            float cosTheta = 1.0f - 2.0f * (i + 0.5f) / SQRT_DIRECTIONS;
+            float sinTheta = std::sqrt(std::max(1.0f - cosTheta * cosTheta, 0.0f));
+            for (int j = 0; j < SQRT_DIRECTIONS; ++j) {
+                float phi = 2.0f * PI * (j + 0.5f) / SQRT_DIRECTIONS;
+                glm::vec3 dir(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+                bool ground = intersectsGround(r, cosTheta);
+                float distance = distanceToNearest(r, cosTheta, ground);
+                float dt = distance / STEPS;
+                glm::vec3 throughput(1.0f), L(0.0f), f(0.0f);
+                for (int s = 0; s < STEPS; ++s) {
+                    glm::vec3 x = position + dir * ((s + 0.5f) * dt);
+                    float rx = glm::length(x);
+                    float h = rx - p.bottomRadius;
+                    glm::vec3 sigmaS = scatteringCoefficient(h);
+                    glm::vec3 sigmaT = extinction(h);
+                    glm::vec3 stepT = expNeg(sigmaT * dt);
+                    // 步内解析积分 ∫ T·e^(-σt·τ) dτ
+                    glm::vec3 integral = throughput * (glm::vec3(1.0f) - stepT) / glm::max(sigmaT, glm::vec3(1e-9f));
+                    L += integral * sigmaS * transmittanceToSun(rx, glm::dot(x, sun) / rx) / (4.0f * PI);
+                    f += integral * sigmaS;
+                    throughput *= stepT;
+                }
+                if (ground) {
+                    glm::vec3 x = position + dir * distance;
+                    float muSGround = glm::dot(x, sun) / glm::length(x);
+                    L += throughput * transmittanceToSun(p.bottomRadius, muSGround) * std::max(muSGround, 0.0f) * p.groundAlbedo / PI;
+                }
+                secondOrder += L;
+                transfer += f;
+            }
+        }
+        float n = (float)(SQRT_DIRECTIONS * SQRT_DIRECTIONS);
+        secondOrder /= n;
+        transfer /= n;
+        return secondOrder / (glm::vec3(1.0f) - glm::min(transfer, glm::vec3(0.99f)));
+    }
+    glm::vec3 multiScatteringAt(float r, float muS) const {
+        const int N = Atmosphere::MULTI_SCATTERING_SIZE;
+        float fx = std::min(std::max((muS * 0.5f + 0.5f) * N - 0.5f, 0.0f), N - 1.0f);
+        float fy = std::min(std::max((r - p.bottomRadius) / (p.topRadius - p.bottomRadius) * N - 0.5f, 0.0f), N - 1.0f);
+        int x0 = (int)fx, y0 = (int)fy, x1 = std::min(x0 + 1, N - 1), y1 = std::min(y0 + 1, N - 1);
+        float tx = fx - x0, ty = fy - y0;
+        auto at = [&](int x, int y) { return multiScattering[(size_t)y * N + x]; };
+        return (at(x0, y0) * (1.0f - tx) + at(x1, y0) * tx) * (1.0f - ty) + (at(x0, y1) * (1.0f - tx) + at(x1, y1) * tx) * ty;
+    }
+
+    // ---- 散射表参数化 ----
+    glm::vec4 scatteringUvwz(float r, float mu, float muS, float nu, bool ground) const {
+        float rho = std::sqrt(std::max(r * r - p.bottomRadius * p.bottomRadius, 0.0f));
+        float uR = coordFromUnit(rho / H, Atmosphere::SCATTERING_R);
+        float rMu = r * mu;
+        float disc = rMu * rMu - r * r + p.bottomRadius * p.bottomRadius;
+        float uMu;
+        if (ground) {
+            float d = -rMu - std::sqrt(std::max(disc, 0.0f));
+            float dMin = r - p.bottomRadius, dMax = rho;
+            uMu = 0.5f - 0.5f * coordFromUnit(dMax == dMin ? 0.0f : (d - dMin) / (dMax - dMin), Atmosphere::SCATTERING_MU / 2);
+        }
+        else {
+            float d = -rMu + std::sqrt(std::max(disc + H * H, 0.0f));
+            float dMin = p.topRadius - r, dMax = rho + H;
+            uMu = 0.5f + 0.5f * coordFromUnit((d - dMin) / (dMax - dMin), Atmosphere::SCATTERING_MU / 2);
+        }
+        float d = distanceToTop(p.bottomRadius, muS);
+        float dMin = p.topRadius - p.bottomRadius, dMax = H;
+        float a = (d - dMin) / (dMax - dMin);
+        float A = (distanceToTop(p.bottomRadius, p.muSMin) - dMin) / (dMax - dMin);
+        float uMuS = coordFromUnit(std::max(1.0f - a / A, 0.0f) / (1.0f + a), Atmosphere::SCATTERING_MU_S);
+        return glm::vec4((nu + 1.0f) * 0.5f, uMuS, uMu, uR);
+    }
+    void scatteringTexel(int x, int y, int z, float& r, float& mu, float& muS, float& nu, bool& ground) const {
+        int nuIndex = x / Atmosphere::SCATTERING_MU_S;
+        float uMuS = ((x % Atmosphere::SCATTERING_MU_S) + 0.5f) / Atmosphere::SCATTERING_MU_S;
+        float uMu = (y + 0.5f) / Atmosphere::SCATTERING_MU;
+        float uR = (z + 0.5f) / Atmosphere::SCATTERING_R;
+
+        float rho = H * unitFromCoord(uR, Atmosphere::SCATTERING_R);
+        r = std::sqrt(rho * rho + p.bottomRadius * p.bottomRadius);
+        if (uMu < 0.5f) {
+            float dMin = r - p.bottomRadius, dMax = rho;
+            float d = dMin + (dMax - dMin) * unitFromCoord(1.0f - 2.0f * uMu, Atmosphere::SCATTERING_MU / 2);
+            mu = d == 0.0f ? -1.0f : clampCos(-(rho * rho + d * d) / (2.0f * r * d));
+            ground = true;
+        }
+        else {
+            float dMin = p.topRadius - r, dMax = rho + H;
+            float d = dMin + (dMax - dMin) * unitFromCoord(2.0f * uMu - 1.0f, Atmosphere::SCATTERING_MU / 2);
+            mu = d == 0.0f ? 1.0f : clampCos((H * H - rho * rho - d * d) / (2.0f * r * d));
+            ground = false;
+        }
+        float xMuS = unitFromCoord(uMuS, Atmosphere::SCATTERING_MU_S);
+        float dMin = p.topRadius - p.bottomRadius, dMax = H;
+        float A = (distanceToTop(p.bottomRadius, p.muSMin) - dMin) / (dMax - dMin);
+        float a = (A - xMuS * A) / (1.0f + xMuS * A);
+        float d = dMin + std::min(a, A) * (dMax - dMin);
+        muS = d == 0.0f ? 1.0f : clampCos((H * H - d * d) / (2.0f * p.bottomRadius * d));
+        nu = clampCos(nuIndex / (Atmosphere::SCATTERING_NU - 1.0f) * 2.0f - 1.0f);
+        // ν 受 μ、μs 约束（三个方向不能任意组合）
+        float spread = std::sqrt(std::max((1.0f - mu * mu) * (1.0f - muS * muS), 0.0f));
+        nu = std::min(std::max(nu, mu * muS - spread), mu * muS + spread);
+    }
+    // 单次散射 + 多次散射近似，沿视线梯形积分
+    glm::vec4 computeScattering(float r, float mu, float muS, float nu, bool ground) const {
+        const int SAMPLES = 50;
+        float dx = distanceToNearest(r, mu, ground) / SAMPLES;
+        glm::vec3 rayleigh(0.0f), mie(0.0f), multiple(0.0f);
+        for (int i = 0; i <= SAMPLES; ++i) {
+            float d = i * dx;
+            float rd = clampRadius(std::sqrt(d * d + 2.0f * r * mu * d + r * r));
+            float muSd = clampCos((r * muS + d * nu) / rd);
+            float h = rd - p.bottomRadius;
+            float w = (i == 0 || i == SAMPLES) ? 0.5f : 1.0f;
+            glm::vec3 view = transmittanceAlong(r, mu, d, ground);
+            glm::vec3 lit = view * transmittanceToSun(rd, muSd) * w;
+            rayleigh += lit * rayleighDensity(h);
+            mie += lit * mieDensity(h);
+            multiple += view * scatteringCoefficient(h) * multiScatteringAt(rd, muSd) * w;
+        }
+        rayleigh *= dx * p.solarIrradiance * p.rayleighScattering;
+        mie *= dx * p.solarIrradiance * p.mieScattering;
+        multiple *= dx * p.solarIrradiance;
+        glm::vec3 rgb = rayleigh + multiple / rayleighPhase(nu);
+        return glm::vec4(rgb, mie.x);
+    }
+    // 与 GLSL 的 atmCombinedScattering 相同：ν 方向在两片之间线性插值，其余三维三线性
+    glm::vec4 sampleScattering(const glm::vec3& uvw) const {
+        const int W = Atmosphere::SCATTERING_NU * Atmosphere::SCATTERING_MU_S;
+        const int Hh = Atmosphere::SCATTERING_MU, D = Atmosphere::SCATTERING_R;
+        float f[3] = { std::min(std::max(uvw.x * W - 0.5f, 0.0f), W - 1.0f), std::min(std::max(uvw.y * Hh - 0.5f, 0.0f), Hh - 1.0f),
+                       std::min(std::max(uvw.z * D - 0.5f, 0.0f), D - 1.0f) };
+        int x0 = (int)f[0], y0 = (int)f[1], z0 = (int)f[2];
+        int x1 = std::min(x0 + 1, W - 1), y1 = std::min(y0 + 1, Hh - 1), z1 = std::min(z0 + 1, D - 1);
+        float tx = f[0] - x0, ty = f[1] - y0, tz = f[2] - z0;
+        auto at = [&](int x, int y, int z) { return scattering[((size_t)z * Hh + y) * W + x]; };
+        auto plane = [&](int z) {
+            return (at(x0, y0, z) * (1.0f - tx) + at(x1, y0, z) * tx) * (1.0f - ty) + (at(x0, y1, z) * (1.0f - tx) + at(x1, y1, z) * tx) * ty;
+        };
+        return plane(z0) * (1.0f - tz) + plane(z1) * tz;
+    }
+    glm::vec3 skyRadiance(float r, float mu, float muS, float nu, bool ground) const {
+        glm::vec4 uvwz = scatteringUvwz(r, mu, muS, nu, ground);
+        float texX = uvwz.x * (Atmosphere::SCATTERING_NU - 1);
+        float tx = std::floor(texX);
+        float l = texX - tx;
+        glm::vec4 s0 = sampleScattering(glm::vec3((tx + uvwz.y) / Atmosphere::SCATTERING_NU, uvwz.z, uvwz.w));
+        glm::vec4 s1 = sampleScattering(glm::vec3((tx + 1.0f + uvwz.y) / Atmosphere::SCATTERING_NU, uvwz.z, uvwz.w));
+        glm::vec4 s = s0 * (1.0f - l) + s1 * l;
+        glm::vec3 rgb(s);
+        glm::vec3 mie = s.x > 0.0f ? rgb * (s.w / s.x) * (p.rayleighScattering.x / p.mieScattering.x) * (p.mieScattering / p.rayleighScattering)
+                                   : glm::vec3(0.0f);
+        return rgb * rayleighPhase(nu) + mie * miePhase(p.mieG, nu);
+    }
+
+    // ---- 天空间接辐照度 ----
+    glm::vec3 computeIndirectIrradiance(float r, float muS) const {
+        const int THETA = 16, PHI = 32;
+        glm::vec3 sun(std::sqrt(std::max(1.0f - muS * muS, 0.0f)), 0.0f, muS);
+        float dTheta = PI / 2.0f / THETA, dPhi = 2.0f * PI / PHI;
+        glm::vec3 result(0.0f);
+        for (int j = 0; j < THETA; ++j) {
+            float theta = (j + 0.5f) * dTheta;
+            for (int i = 0; i < PHI; ++i) {
+                float phi = (i + 0.5f) * dPhi;
+                glm::vec3 omega(std::cos(phi) * std::sin(theta), std::sin(phi) * std::sin(theta), std::cos(theta));
+                result += skyRadiance(r, omega.z, muS, glm::dot(omega, sun), false) * omega.z * std::sin(theta) * dTheta * dPhi;
+            }
+        }
+        return result;
+    }
+};
+
+uint64_t hashParams(const AtmosphereParams& params) {
+    // FNV-1a：参数逐字节 + 表尺寸与缓存版本，任一改变都换一个缓存文件
+    const int sizes[] = { Atmosphere::TRANSMITTANCE_W, Atmosphere::TRANSMITTANCE_H, Atmosphere::SCATTERING_R, Atmosphere::SCATTERING_MU,
+                          Atmosphere::SCATTERING_MU_S, Atmosphere::SCATTERING_NU, Atmosphere::IRRADIANCE_W, Atmosphere::IRRADIANCE_H,
+                          Atmosphere::MULTI_SCATTERING_SIZE, (int)CACHE_VERSION };
+    uint64_t h = 1469598103934665603ull;
+    auto feed = [&](const void* data, size_t size) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; ++i) h = (h ^ bytes[i]) * 1099511628211ull;
+    };
+    feed(&params, sizeof(params));
+    feed(sizes, sizeof(sizes));
+    return h;
+}
+
+}  // namespace
+
+AtmosphereParams AtmosphereParams::thickened(float factor) const {
+    AtmosphereParams p = *this;
+    p.topRadius = bottomRadius + (topRadius - bottomRadius) * factor;
+    p.rayleighScaleHeight *= factor;
+    p.mieScaleHeight *= factor;
+    p.ozoneCenter *= factor;
+    p.ozoneWidth *= factor;
+    p.rayleighScattering /= factor;
+    p.mieScattering /= factor;
+    p.mieExtinction /= factor;
+    p.ozoneAbsorption /= factor;
+    return p;
+}
+
+// ================= 预计算 =================
+void Atmosphere::precompute(unsigned threads) {
+    transmittance.assign((size_t)TRANSMITTANCE_W * TRANSMITTANCE_H, glm::vec4(0.0f));
+    scattering.assign((size_t)SCATTERING_NU * SCATTERING_MU_S * SCATTERING_MU * SCATTERING_R, glm::vec4(0.0f));
+    irradiance.assign((size_t)IRRADIANCE_W * IRRADIANCE_H, glm::vec4(0.0f));
+    Model model(params, transmittance, scattering);
+
+    // 1. 透射率
+    parallelRows(TRANSMITTANCE_H, threads, [&](int y) {
+        for (int x = 0; x < TRANSMITTANCE_W; ++x) {
+            float r, mu;
+            model.transmittanceTexel(x, y, r, mu);
+            transmittance[(size_t)y * TRANSMITTANCE_W + x] = glm::vec4(model.computeTransmittanceToTop(r, mu), 1.0f);
+        }
+    });
+
+    // 2. 多次散射 ψms
+    model.multiScattering.assign((size_t)MULTI_SCATTERING_SIZE * MULTI_SCATTERING_SIZE, glm::vec3(0.0f));
+    parallelRows(MULTI_SCATTERING_SIZE, threads, [&](int y) {
+        float r = params.bottomRadius + (params.topRadius - params.bottomRadius) * (y + 0.5f) / MULTI_SCATTERING_SIZE;
+        for (int x = 0; x < MULTI_SCATTERING_SIZE; ++x) {
+            float muS = -1.0f + 2.0f * (x + 0.5f) / MULTI_SCATTERING_SIZE;
+            model.multiScattering[(size_t)y * MULTI_SCATTERING_SIZE + x] = model.computeMultiScattering(r, muS);
+        }
+    });
+
+    // 3. 散射（按 (r, μ) 行并行，每行 NU × MU_S 个 texel）
+    const int width = SCATTERING_NU * SCATTERING_MU_S;
+    parallelRows(SCATTERING_R * SCATTERING_MU, threads, [&](int row) {
+        int z = row / SCATTERING_MU, y = row % SCATTERING_MU;
+        for (int x = 0; x < width; ++x) {
+            float r, mu, muS, nu;
+            bool ground;
+            model.scatteringTexel(x, y, z, r, mu, muS, nu, ground);
+            scattering[((size_t)z * SCATTERING_MU + y) * width + x] = model.computeScattering(r, mu, muS, nu, ground);
+        }
+    });
+
+    // 4. 天空间接辐照度（用上一步的散射表）
+    parallelRows(IRRADIANCE_H, threads, [&](int y) {
+        float r = params.bottomRadius + (params.topRadius - params.bottomRadius) * unitFromCoord((y + 0.5f) / IRRADIANCE_H, IRRADIANCE_H);
+        for (int x = 0; x < IRRADIANCE_W; ++x) {
+            float muS = 2.0f * unitFromCoord((x + 0.5f) / IRRADIANCE_W, IRRADIANCE_W) - 1.0f;
+            irradiance[(size_t)y * IRRADIANCE_W + x] = glm::vec4(model.computeIndirectIrradiance(r, muS), 1.0f);
+        }
+    });
+}
+
+// ================= 磁盘缓存 =================
+struct AtmosphereCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t paramsHash;
+};
+
+bool Atmosphere::load(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    AtmosphereCacheHeader header{};
+    f.read((char*)&header, sizeof(header));
+    if (!f || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.paramsHash != paramsHash) return false;
+    transmittance.resize((size_t)TRANSMITTANCE_W * TRANSMITTANCE_H);
+    scattering.resize((size_t)SCATTERING_NU * SCATTERING_MU_S * SCATTERING_MU * SCATTERING_R);
+    irradiance.resize((size_t)IRRADIANCE_W * IRRADIANCE_H);
+    f.read((char*)transmittance.data(), transmittance.size() * sizeof(glm::vec4));
+    f.read((char*)scattering.data(), scattering.size() * sizeof(glm::vec4));
+    f.read((char*)irradiance.data(), irradiance.size() * sizeof(glm::vec4));
+    return (bool)f;
+}
+
+void Atmosphere::save(const std::string& path) const {
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    std::ofstream f(path, std::ios::binary);
+    if (!f) {
+        std::cout << "[atmosphere] 无法写入缓存 " << path << std::endl;
+        return;
+    }
+    AtmosphereCacheHeader header{ CACHE_MAGIC, CACHE_VERSION, paramsHash };
+    f.write((const char*)&header, sizeof(header));
+    f.write((const char*)transmittance.data(), transmittance.size() * sizeof(glm::vec4));
+    f.write((const char*)scattering.data(), scattering.size() * sizeof(glm::vec4));
+    f.write((const char*)irradiance.data(), irradiance.size() * sizeof(glm::vec4));
+}
+
+// ================= 初始化 =================
+bool Atmosphere::init(const AtmosphereParams& p, const std::string& cacheDir, unsigned threads) {
+    params = p;
+    paramsHash = hashParams(params);
+    std::ostringstream name;
+    name << cacheDir << "/atmosphere_" << std::hex << paramsHash << ".bin";
+    std::string path = name.str();
+
+    auto start = std::chrono::steady_clock::now();
+    fromCache = load(path);
+    if (!fromCache) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        precompute(threads);
+        save(path);
+    }
+    precomputeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[atmosphere] " << (fromCache ? "读取缓存 " : "预计算并写入 ") << path << "，" << precomputeMs << " ms" << std::endl;
+
+    upload();
+    // 上传后 CPU 端不再需要（散射表约 16 MB）
+    transmittance = std::vector<glm::vec4>();
+    scattering = std::vector<glm::vec4>();
+    irradiance = std::vector<glm::vec4>();
+    return transmittanceTex && scatteringTex && irradianceTex;
+}
+
+void Atmosphere::upload() {
+    auto texture2D = [](GLuint& tex, int w, int h, const std::vector<glm::vec4>& data, GLenum format) {
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0, GL_RGBA, GL_FLOAT, data.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    };
+    // 透射率在地平线附近相除，需要 32 位精度；散射与辐照度用 16 位即可
+    texture2D(transmittanceTex, TRANSMITTANCE_W, TRANSMITTANCE_H, transmittance, GL_RGBA32F);
+    texture2D(irradianceTex, IRRADIANCE_W, IRRADIANCE_H, irradiance, GL_RGBA16F);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenTextures(1, &scatteringTex);
+    glBindTexture(GL_TEXTURE_3D, scatteringTex);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, SCATTERING_NU * SCATTERING_MU_S, SCATTERING_MU, SCATTERING_R, 0, GL_RGBA, GL_FLOAT,
+                 scattering.data());
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+void Atmosphere::destroy() {
+    glDeleteTextures(1, &transmittanceTex);
+    glDeleteTextures(1, &scatteringTex);
+    glDeleteTextures(1, &irradianceTex);
+    transmittanceTex = scatteringTex = irradianceTex = 0;
+}
+
+void Atmosphere::bind(GLuint program, int firstUnit) const {
+    glActiveTexture(GL_TEXTURE0 + firstUnit);
+    glBindTexture(GL_TEXTURE_2D, transmittanceTex);
+    glUniform1i(glGetUniformLocation(program, "transmittanceLUT"), firstUnit);
+    glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+    glBindTexture(GL_TEXTURE_3D, scatteringTex);
+    glUniform1i(glGetUniformLocation(program, "scatteringLUT"), firstUnit + 1);
+    glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+    glBindTexture(GL_TEXTURE_2D, irradianceTex);
+    glUniform1i(glGetUniformLocation(program, "irradianceLUT"), firstUnit + 2);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// ================= 着色器 =================
+ShaderDefines Atmosphere::defines() const {
+    auto num = [](float v) {
+        std::ostringstream s;
+        s.precision(9);
+        s << std::showpoint << v;
+        return s.str();
+    };
+    auto vec = [&](const glm::vec3& v) { return "vec3(" + num(v.x) + ", " + num(v.y) + ", " + num(v.z) + ")"; };
+    return {
+        { "ATMOSPHERE", "1" },
+        { "ATM_BOTTOM", num(params.bottomRadius) },
+        { "ATM_TOP", num(params.topRadius) },
+        { "ATM_MU_S_MIN", num(params.muSMin) },
+        { "ATM_SUN_RADIUS", num(params.sunAngularRadius) },
+        { "ATM_SOLAR", vec(params.solarIrradiance) },
+        { "ATM_RAYLEIGH", vec(params.rayleighScattering) },
+        { "ATM_MIE_SCATTERING", vec(params.mieScattering) },
+        { "ATM_MIE_G", num(params.mieG) },
+        { "ATM_TRANSMITTANCE_W", num((float)TRANSMITTANCE_W) },
+        { "ATM_TRANSMITTANCE_H", num((float)TRANSMITTANCE_H) },
+        { "ATM_SCATTERING_R", num((float)SCATTERING_R) },
+        { "ATM_SCATTERING_MU", num((float)SCATTERING_MU) },
+        { "ATM_SCATTERING_MU_S", num((float)SCATTERING_MU_S) },
+        { "ATM_SCATTERING_NU", num((float)SCATTERING_NU) },
+        { "ATM_IRRADIANCE_W", num((float)IRRADIANCE_W) },
+        { "ATM_IRRADIANCE_H", num((float)IRRADIANCE_H) },
+    };
+}
+
+// 与上面的 Model 一一对应；每次查询：透射率 2–4 次、散射 4 次（两个 ν 片各一次，到点的散射再两次）、辐照度 1 次
+const char* Atmosphere::shaderSource() {
+    return R"(
+    // ---------------- 预计算大气查表（Atmosphere.cpp） ----------------
+    uniform sampler2D transmittanceLUT;
+    uniform sampler3D scatteringLUT;
+    uniform sampler2D irradianceLUT;
+
+    const float ATM_PI = 3.14159265;
+    const float ATM_H = sqrt(ATM_TOP * ATM_TOP - ATM_BOTTOM * ATM_BOTTOM);
+
+    float atmCoord(float x, float n) { return 0.5 / n + x * (1.0 - 1.0 / n); }
+    float atmClampRadius(float r) { return clamp(r, ATM_BOTTOM, ATM_TOP); }
+    float atmDistanceToTop(float r, float mu)
+    {
+        float disc = r * r * (mu * mu - 1.0) + ATM_TOP * ATM_TOP;
+        return max(-r * mu + sqrt(max(disc, 0.0)), 0.0);
+    }
+    bool atmIntersectsGround(float r, float mu)
+    {
+        return mu < 0.0 && r * r * (mu * mu - 1.0) + ATM_BOTTOM * ATM_BOTTOM >= 0.0;
+    }
+    float atmRayleighPhase(float nu) { return 3.0 / (16.0 * ATM_PI) * (1.0 + nu * nu); }
+    float atmMiePhase(float nu)
+    {
+        float g = ATM_MIE_G;
+        float k = 3.0 / (8.0 * ATM_PI) * (1.0 - g * g) / (2.0 + g * g);
+        return k * (1.0 + nu * nu) / pow(1.0 + g * g - 2.0 * g * nu, 1.5);
+    }
+
+    vec3 atmTransmittanceToTop(float r, float mu)
+    {
+        float rho = sqrt(max(r * r - ATM_BOTTOM * ATM_BOTTOM, 0.0));
+        float d = atmDistanceToTop(r, mu);
+        float dMin = ATM_TOP - r;
+        float dMax = rho + ATM_H;
+        vec2 uv = vec2(atmCoord((d - dMin) / (dMax - dMin), ATM_TRANSMITTANCE_W), atmCoord(rho / ATM_H, ATM_TRANSMITTANCE_H));
+        return texture(transmittanceLUT, uv).rgb;
+    }
+    vec3 atmTransmittance(float r, float mu, float d, bool ground)
+    {
+        float rd = atmClampRadius(sqrt(d * d + 2.0 * r * mu * d + r * r));
+        float mud = clamp((r * mu + d) / rd, -1.0, 1.0);
+        if (ground)
+            return min(atmTransmittanceToTop(rd, -mud) / atmTransmittanceToTop(r, -mu), vec3(1.0));
+        return min(atmTransmittanceToTop(r, mu) / atmTransmittanceToTop(rd, mud), vec3(1.0));
+    }
+    vec3 atmTransmittanceToSun(float r, float muS)
+    {
+        float sinH = ATM_BOTTOM / r;
+        float cosH = -sqrt(max(1.0 - sinH * sinH, 0.0));
+        return atmTransmittanceToTop(r, muS) * smoothstep(-sinH * ATM_SUN_RADIUS, sinH * ATM_SUN_RADIUS, muS - cosH);
+    }
+
+    vec3 atmCombinedScattering(float r, float mu, float muS, float nu, bool ground, out vec3 singleMie)
+    {
+        float rho = sqrt(max(r * r - ATM_BOTTOM * ATM_BOTTOM, 0.0));
+        float uR = atmCoord(rho / ATM_H, ATM_SCATTERING_R);
+        float rMu = r * mu;
+        float disc = rMu * rMu - r * r + ATM_BOTTOM * ATM_BOTTOM;
+        float uMu;
+        if (ground) {
+            float d = -rMu - sqrt(max(disc, 0.0));
+            float dMin = r - ATM_BOTTOM;
+            float dMax = rho;
+            uMu = 0.5 - 0.5 * atmCoord(dMax == dMin ? 0.0 : (d - dMin) / (dMax - dMin), ATM_SCATTERING_MU / 2.0);
+        }
+        else {
+            float d = -rMu + sqrt(max(disc + ATM_H * ATM_H, 0.0));
+            float dMin = ATM_TOP - r;
+            float dMax = rho + ATM_H;
+            uMu = 0.5 + 0.5 * atmCoord((d - dMin) / (dMax - dMin), ATM_SCATTERING_MU / 2.0);
+        }
+        float dMin = ATM_TOP - ATM_BOTTOM;
+        float dMax = ATM_H;
+        float a = (atmDistanceToTop(ATM_BOTTOM, muS) - dMin) / (dMax - dMin);
+        float A = (atmDistanceToTop(ATM_BOTTOM, ATM_MU_S_MIN) - dMin) / (dMax - dMin);
+        float uMuS = atmCoord(max(1.0 - a / A, 0.0) / (1.0 + a), ATM_SCATTERING_MU_S);
+
+        float texX = (nu + 1.0) * 0.5 * (ATM_SCATTERING_NU - 1.0);
+        float x0 = floor(texX);
+        float l = texX - x0;
+        vec4 s = mix(texture(scatteringLUT, vec3((x0 + uMuS) / ATM_SCATTERING_NU, uMu, uR)),
+                     texture(scatteringLUT, vec3((x0 + 1.0 + uMuS) / ATM_SCATTERING_NU, uMu, uR)), l);
+        singleMie = s.r > 0.0 ? s.rgb * s.a / s.r * (ATM_RAYLEIGH.r / ATM_MIE_SCATTERING.r) * (ATM_MIE_SCATTERING / ATM_RAYLEIGH) : vec3(0.0);
+        return s.rgb;
+    }
+
+    // 从 camera 沿 viewRay 看向太空（不击中地面时）的天空亮度；相机在大气外时先移到大气顶
+    vec3 GetSkyRadiance(vec3 camera, vec3 viewRay, vec3 sunDirection, out vec3 transmittance)
+    {
+        float r = length(camera);
+        float rMu = dot(camera, viewRay);
+        float disc = rMu * rMu - r * r + ATM_TOP * ATM_TOP;
+        float distanceToTop = -rMu - sqrt(max(disc, 0.0));
+        if (distanceToTop > 0.0 && disc >= 0.0) {
+            camera += viewRay * distanceToTop;
+            r = ATM_TOP;
+            rMu += distanceToTop;
+        }
+        else if (r > ATM_TOP) {
+            transmittance = vec3(1.0);
+            return vec3(0.0);
+        }
+        float mu = rMu / r;
+        float muS = dot(camera, sunDirection) / r;
+        float nu = dot(viewRay, sunDirection);
+        bool ground = atmIntersectsGround(r, mu);
+        transmittance = ground ? vec3(0.0) : atmTransmittanceToTop(r, mu);
+        vec3 singleMie;
+        vec3 scattering = atmCombinedScattering(r, mu, muS, nu, ground, singleMie);
+        return scattering * atmRayleighPhase(nu) + singleMie * atmMiePhase(nu);
+    }
+
+    // camera 到地表点 point 之间的内散射（大气透视）；transmittance 为这段路径的透射率
+    vec3 GetSkyRadianceToPoint(vec3 camera, vec3 point, vec3 sunDirection, out vec3 transmittance)
+    {
+        vec3 viewRay = normalize(point - camera);
+        float r = length(camera);
+        float rMu = dot(camera, viewRay);
+        float disc = rMu * rMu - r * r + ATM_TOP * ATM_TOP;
+        float distanceToTop = -rMu - sqrt(max(disc, 0.0));
+        if (distanceToTop > 0.0) {
+            camera += viewRay * distanceToTop;
+            r = ATM_TOP;
+            rMu += distanceToTop;
+        }
+        float mu = rMu / r;
+        float muS = dot(camera, sunDirection) / r;
+        float nu = dot(viewRay, sunDirection);
+        float d = length(point - camera);
+        bool ground = atmIntersectsGround(r, mu);
+        transmittance = atmTransmittance(r, mu, d, ground);
+
+        vec3 singleMie;
+        vec3 scattering = atmCombinedScattering(r, mu, muS, nu, ground, singleMie);
+        float rP = atmClampRadius(sqrt(d * d + 2.0 * r * mu * d + r * r));
+        float muP = (r * mu + d) / rP;
+        float muSP = (r * muS + d * nu) / rP;
+        vec3 singleMieP;
+        vec3 scatteringP = atmCombinedScattering(rP, muP, muSP, nu, ground, singleMieP);
+        scattering = max(scattering - transmittance * scatteringP, vec3(0.0));
+        singleMie = max(singleMie - transmittance * singleMieP, vec3(0.0));
+        singleMie *= smoothstep(0.0, 0.01, muS);   // 太阳落到地平线下时 Mie 相减误差较大
+        return scattering * atmRayleighPhase(nu) + singleMie * atmMiePhase(nu);
+    }
+
+    // 地表点 point（法线 normal）受到的太阳直射辐照度（返回值）与天空辐照度（skyIrradiance）
+    vec3 GetSunAndSkyIrradiance(vec3 point, vec3 normal, vec3 sunDirection, out vec3 skyIrradiance)
+    {
+        float r = length(point);
+        float muS = dot(point, sunDirection) / r;
+        vec2 uv = vec2(atmCoord(muS * 0.5 + 0.5, ATM_IRRADIANCE_W), atmCoord((r - ATM_BOTTOM) / (ATM_TOP - ATM_BOTTOM), ATM_IRRADIANCE_H));
+        skyIrradiance = texture(irradianceLUT, uv).rgb * (1.0 + dot(normal, point) / r) * 0.5;
+        return ATM_SOLAR * atmTransmittanceToSun(atmClampRadius(r), muS) * max(dot(normal, sunDirection), 0.0);
+    }
+)";
+}
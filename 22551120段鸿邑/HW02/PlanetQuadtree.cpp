@@ -0,0 +1,398 @@
+#include "planet_quadtree.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+static const float PI = 3.14159265358979f;
+static const int GRID = PlanetQuadtree::CHUNK_QUADS + 1;            // 每边顶点数
+static const int CHUNK_VERTICES = GRID * GRID + 4 * GRID;            // 网格 + 四条裙边
+
+// ================= 立方体 → 球面 =================
+// 面 f 上 (s, t) ∈ [-1, 1]² 对应立方体表面点 normal + s·axisS + t·axisT，axisS × axisT = normal（外侧看逆时针）
+static const glm::vec3 FACE_NORMAL[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+static const glm::vec3 FACE_AXIS_S[6] = { { 0, 0, -1 }, { 0, 0, 1 }, { 1, 0, 0 }, { 1, 0, 0 }, { 1, 0, 0 }, { -1, 0, 0 } };
+static const glm::vec3 FACE_AXIS_T[6] = { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, 1, 0 }, { 0, 1, 0 } };
+
+// spherified cube：结果恰为单位向量，网格比直接归一化均匀
+static glm::vec3 cubeToSphere(int face, float s, float t) {
+    glm::vec3 p = FACE_NORMAL[face] + s * FACE_AXIS_S[face] + t * FACE_AXIS_T[face];
+    glm::vec3 q = p * p;
+    return glm::vec3(p.x * std::sqrt(std::max(0.0f, 1.0f - q.y * 0.5f - q.z * 0.5f + q.y * q.z / 3.0f)),
+                     p.y * std::sqrt(std::max(0.0f, 1.0f - q.z * 0.5f - q.x * 0.5f + q.z * q.x / 3.0f)),
+                     p.z * std::sqrt(std::max(0.0f, 1.0f - q.x * 0.5f - q.y * 0.5f + q.x * q.y / 3.0f)));
+}
+
+static float longitudeOf(const glm::vec3& dir) {
+    float s = std::atan2(dir.y, dir.x) / (2.0f * PI);
+    return s < 0.0f ? s + 1.0f : s;
+}
+
+static uint64_t nodeKey(int face, int level, int x, int y) {
+    return (1ull << 63) | (uint64_t)face << 60 | (uint64_t)level << 52 | (uint64_t)y << 26 | (uint64_t)x;
+}
+
+// ================= 初始化 =================
+bool PlanetQuadtree::init(float r, unsigned threads) {
+    radius = r;
+
+    // 共用索引：网格每个四边形两个三角形，四条裙边各 CHUNK_QUADS 个四边形
+    std::vector<unsigned int> indices;
+    indices.reserve((size_t)CHUNK_QUADS * CHUNK_QUADS * 6 + 4 * CHUNK_QUADS * 6);
+    for (int j = 0; j < CHUNK_QUADS; ++j) {
+        for (int i = 0; i < CHUNK_QUADS; ++i) {
+            unsigned int a = j * GRID + i, b = a + 1, c = a + GRID, d = c + 1;
+            indices.insert(indices.end(), { a, b, d, a, d, c });
+        }
+    }
+    // 裙边顺序与 buildChunk 一致：下 (j = 0)、右 (i = N)、上 (j = N)、左 (i = 0)
+    auto edgeVertex = [](int edge, int k) {
+        switch (edge) {
+        case 0: return k;
+        case 1: return k * GRID + CHUNK_QUADS;
+        case 2: return CHUNK_QUADS * GRID + k;
+        default: return k * GRID;
+        }
+    };
+    for (int edge = 0; edge < 4; ++edge) {
+        for (int k = 0; k < CHUNK_QUADS; ++k) {
+            unsigned int top0 = edgeVertex(edge, k), top1 = edgeVertex(edge, k + 1);
+            unsigned int bottom0 = GRID * GRID + edge * GRID + k, bottom1 = bottom0 + 1;
+            indices.insert(indices.end(), { top0, bottom0, bottom1, top0, bottom1, top1 });
+        }
+    }
+    indexCount = (int)indices.size();
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    // 6 个根节点 + 24 个 1 级块；1 级块在主线程直接生成，保证第一帧就有完整的球
+    nodes.assign(6, Node());
+    std::vector<Vertex> vertices;
+    for (int face = 0; face < 6; ++face) {
+        roots[face] = face;
+        initNode(face, face, 0, 0, 0);
+        int first = allocateChildren(face);
+        for (int c = 0; c < 4; ++c) {
+            Node& child = nodes[first + c];
+            buildChunk(child.face, child.level, child.x, child.y, vertices);
+            upload(child, vertices);
+            child.building = false;
+        }
+    }
+    jobs.clear();   // 工作线程尚未启动，allocateChildren 提交的任务已在上面完成
+
+    if (threads == 0) threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    quit = false;
+    for (unsigned i = 0; i < threads; ++i) workers.emplace_back(&PlanetQuadtree::workerMain, this);
+    std::cout << "[planet] 立方体球四叉树：每块 " << CHUNK_QUADS << "×" << CHUNK_QUADS << " 网格，"
+              << threads << " 个生成线程" << std::endl;
+    return true;
+}
+
+void PlanetQuadtree::destroy() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        jobs.clear();
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+    built.clear();
+
+    for (Node& node : nodes) releaseNode(node);
+    nodes.clear();
+    freeBlocks.clear();
+    drawList.clear();
+    glDeleteBuffers(1, &indexBuffer);
+    indexBuffer = 0;
+}
+
+// ================= 节点池 =================
+void PlanetQuadtree::initNode(int index, int face, int level, int x, int y) {
+    Node& node = nodes[index];
+    node = Node();
+    node.key = nodeKey(face, level, x, y);
+    node.face = face;
+    node.level = level;
+    node.x = x;
+    node.y = y;
+
+    // 包围球与张角取 9 个采样点（角、边中点、中心），另加裙边深度
+    float size = 2.0f / (1 << level);
+    float s0 = -1.0f + x * size, t0 = -1.0f + y * size;
+    glm::vec3 centerDir = cubeToSphere(face, s0 + size * 0.5f, t0 + size * 0.5f);
+    glm::vec3 corner00 = cubeToSphere(face, s0, t0);
+    glm::vec3 corner10 = cubeToSphere(face, s0 + size, t0);
+    glm::vec3 corner01 = cubeToSphere(face, s0, t0 + size);
+    node.quadSize = radius * std::max(glm::length(corner10 - corner00), glm::length(corner01 - corner00)) / CHUNK_QUADS;
+    node.center = centerDir * radius;
+    float minCos = 1.0f;
+    for (int j = 0; j <= 2; ++j) {
+        for (int i = 0; i <= 2; ++i) {
+            glm::vec3 dir = cubeToSphere(face, s0 + size * 0.5f * i, t0 + size * 0.5f * j);
+            node.boundRadius = std::max(node.boundRadius, glm::length(dir * radius - node.center));
+            minCos = std::min(minCos, glm::dot(dir, centerDir));
+        }
+    }
+    node.boundRadius += node.quadSize;
+    node.coneAngle = std::acos(std::min(std::max(minCos, -1.0f), 1.0f));
+}
+
+int PlanetQuadtree::allocateChildren(int parent) {
+    int first;
+    if (!freeBlocks.empty()) {
+        first = freeBlocks.back();
+        freeBlocks.pop_back();
+    }
+    else {
+        first = (int)nodes.size();
+        nodes.resize(nodes.size() + 4);
+    }
+    Node& p = nodes[parent];
+    int face = p.face, level = p.level + 1, x = p.x * 2, y = p.y * 2;
+    p.firstChild = first;
+    for (int c = 0; c < 4; ++c) {
+        initNode(first + c, face, level, x + (c & 1), y + (c >> 1));
+        requestBuild(first + c);
+    }
+    return first;
+}
+
+void PlanetQuadtree::freeChildren(int parent) {
+    int first = nodes[parent].firstChild;
+    if (first < 0) return;
+    for (int c = 0; c < 4; ++c) {
+        freeChildren(first + c);
+        releaseNode(nodes[first + c]);
+    }
+    nodes[parent].firstChild = -1;
+    freeBlocks.push_back(first);
+}
+
+// 键清零后，仍在排队或生成中的任务在上传时会被丢弃
+void PlanetQuadtree::releaseNode(Node& node) {
+    if (node.vao) glDeleteVertexArrays(1, &node.vao);
+    if (node.vbo) glDeleteBuffers(1, &node.vbo);
+    node = Node();
+}
+
+void PlanetQuadtree::requestBuild(int index) {
+    Node& node = nodes[index];
+    node.building = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back({ node.key, index, node.face, node.level, node.x, node.y });
+    }
+    wake.notify_one();
+}
+
+void PlanetQuadtree::upload(Node& node, const std::vector<Vertex>& vertices) {
+    glGenVertexArrays(1, &node.vao);
+    glGenBuffers(1, &node.vbo);
+    glBindVertexArray(node.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, node.vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    // 与 generateSphere 相同的 location 0–4
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
+    glEnableVertexAttribArray(4);
+    glBindVertexArray(0);
+    node.ready = true;
+}
+
+// ================= 块网格生成（工作线程） =================
+void PlanetQuadtree::buildChunk(int face, int level, int x, int y, std::vector<Vertex>& out) const {
+    out.resize(CHUNK_VERTICES);
+    float size = 2.0f / (1 << level);
+    float s0 = -1.0f + x * size, t0 = -1.0f + y * size;
+    glm::vec3 centerDir = cubeToSphere(face, s0 + size * 0.5f, t0 + size * 0.5f);
+    float centerLon = longitudeOf(centerDir);
+    glm::vec3 fallbackTangent(-centerDir.y, centerDir.x, 0.0f);
+    fallbackTangent = glm::length(fallbackTangent) > 1e-6f ? glm::normalize(fallbackTangent) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+    for (int j = 0; j < GRID; ++j) {
+        for (int i = 0; i < GRID; ++i) {
+            glm::vec3 dir = cubeToSphere(face, s0 + size * i / CHUNK_QUADS, t0 + size * j / CHUNK_QUADS);
+            Vertex& v = out[j * GRID + i];
+            v.position = dir * radius;
+            v.normal = dir;
+            // 经度相对块中心展开到 (-0.5, 0.5]，块内连续；落在接缝上的顶点随所在块取 0 或 1（纹理水平方向重复）
+            glm::vec3 tangent(-dir.y, dir.x, 0.0f);
+            float planar = glm::length(tangent);
+            float s = centerLon;
+            if (planar > 1e-6f) {
+                float d = longitudeOf(dir) - centerLon;
+                s = centerLon + d - std::round(d);
+                tangent /= planar;
+            }
+            else {
+                tangent = fallbackTangent;   // 极点：经度无定义，取块中心经度
+            }
+            v.uv = glm::vec2(s, std::acos(std::min(std::max(dir.z, -1.0f), 1.0f)) / PI);
+            v.tangent = tangent;
+            v.bitangent = glm::cross(dir, tangent);
+        }
+    }
+
+    // 裙边：沿四条边复制顶点并向球心下沉一个网格边长，足以盖住相邻级别间的 T 形缝
+    float skirtDepth = radius * size * (PI * 0.25f) / CHUNK_QUADS;   // 面上长度 2 对应弧长 π/2
+    for (int edge = 0; edge < 4; ++edge) {
+        for (int k = 0; k < GRID; ++k) {
+            int source = edge == 0 ? k : edge == 1 ? k * GRID + CHUNK_QUADS : edge == 2 ? CHUNK_QUADS * GRID + k : k * GRID;
+            Vertex& v = out[GRID * GRID + edge * GRID + k];
+            v = out[source];
+            v.position = v.normal * (radius - skirtDepth);
+        }
+    }
+}
+
+void PlanetQuadtree::workerMain() {
+    std::vector<Vertex> vertices;
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || !jobs.empty(); });
+            if (quit) return;
+            // 粗级别优先：它们决定能否尽快分裂出可见的细节
+            auto next = std::min_element(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.level < b.level; });
+            job = *next;
+            jobs.erase(next);
+        }
+        auto start = std::chrono::steady_clock::now();
+        buildChunk(job.face, job.level, job.x, job.y, vertices);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock(mutex);
+        built.push_back({ job.key, job.node, vertices, ms });
+    }
+}
+
+// ================= 每帧更新 =================
+void PlanetQuadtree::update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection,
+                            const glm::vec3& cameraWorld, int viewportHeight, float fovY) {
+    // 1. 上传生成好的块，丢弃已被合并掉的节点的任务
+    std::vector<Built> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&](const Job& j) { return nodes[j.node].key != j.key; }), jobs.end());
+        size_t count = 0;
+        while (count < built.size() && ready.size() < (size_t)MAX_UPLOADS) {
+            ready.push_back(std::move(built[count++]));
+        }
+        built.erase(built.begin(), built.begin() + count);
+    }
+    for (Built& b : ready) {
+        stats.chunksBuilt++;
+        buildMsSum += b.ms;
+        Node& node = nodes[b.node];
+        // 节点已合并掉，或合并后又以同一位置重新分裂、旧任务先完成（新任务的结果到达时 ready 已为真）
+        if (node.key != b.key || node.ready) continue;
+        upload(node, b.vertices);
+        node.building = false;
+    }
+
+    // 2. 相机与视锥换到星球局部空间（模型矩阵只含平移与均匀缩放，局部空间里比较距离即可）
+    Frame frame;
+    frame.cameraLocal = glm::vec3(glm::inverse(model) * glm::vec4(cameraWorld, 1.0f));
+    frame.cameraDistance = glm::length(frame.cameraLocal);
+    frame.pixelsPerUnit = viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+    glm::mat4 m = projection * view * model;
+    for (int i = 0; i < 3; ++i) {
+        glm::vec4 row(m[0][i], m[1][i], m[2][i], m[3][i]);
+        glm::vec4 w(m[0][3], m[1][3], m[2][3], m[3][3]);
+        frame.planes[i * 2] = w + row;
+        frame.planes[i * 2 + 1] = w - row;
+    }
+    for (glm::vec4& plane : frame.planes) plane /= glm::length(glm::vec3(plane));
+
+    // 3. 遍历四叉树，确定分裂/合并并收集绘制列表
+    drawList.clear();
+    stats.drawnChunks = 0;
+    stats.triangles = 0;
+    stats.maxDepth = 0;
+    for (int face = 0; face < 6; ++face) visit(roots[face], frame);
+
+    stats.chunks = 0;
+    stats.pendingBuilds = 0;
+    for (const Node& node : nodes) {
+        if (node.key == 0) continue;
+        stats.chunks++;
+        if (node.building) stats.pendingBuilds++;
+    }
+    int readyChunks = 0;
+    for (const Node& node : nodes) readyChunks += node.ready ? 1 : 0;
+    stats.geometryMB = readyChunks * (double)CHUNK_VERTICES * sizeof(Vertex) / (1024.0 * 1024.0);
+    stats.buildMs = stats.chunksBuilt ? buildMsSum / stats.chunksBuilt : 0.0;
+}
+
+void PlanetQuadtree::visit(int index, const Frame& frame) {
+    Node node = nodes[index];   // 副本：分配子节点可能让 nodes 重新分配
+
+    // 地平线剔除：相机能看到的球冠半角为 acos(R / d)，块中心方向与相机方向的夹角减去块的张角仍超出它则整块不可见
+    bool visible = true;
+    if (frame.cameraDistance > radius) {
+        float horizon = std::acos(radius / frame.cameraDistance);
+        float angle = std::acos(std::min(std::max(glm::dot(node.center / radius, frame.cameraLocal / frame.cameraDistance), -1.0f), 1.0f));
+        if (angle - node.coneAngle > horizon) visible = false;
+    }
+    for (int i = 0; i < 6 && visible; ++i) {
+        if (glm::dot(glm::vec3(frame.planes[i]), node.center) + frame.planes[i].w < -node.boundRadius) visible = false;
+    }
+
+    // 屏幕空间误差：一个网格四边形在包围球最近处投影的像素边长
+    float distance = std::max(glm::length(node.center - frame.cameraLocal) - node.boundRadius, radius * 1e-6f);
+    float error = node.quadSize / distance * frame.pixelsPerUnit;
+    bool canSplit = node.level < std::min(maxDepth, MAX_DEPTH);
+    // 不可见的块不新分裂，但已有的子块按误差保留，转回视野时不用重新生成
+    bool wantSplit = node.level < MIN_DEPTH || (canSplit && visible && error > SPLIT_PIXELS);
+    bool keepChildren = node.level < MIN_DEPTH || (canSplit && error > SPLIT_PIXELS * MERGE_RATIO);
+
+    if (node.firstChild < 0 && wantSplit) node.firstChild = allocateChildren(index);
+    else if (node.firstChild >= 0 && !keepChildren) {
+        freeChildren(index);
+        node.firstChild = -1;
+    }
+    if (!visible) return;
+
+    if (node.firstChild >= 0) {
+        bool childrenReady = true;
+        for (int c = 0; c < 4; ++c) childrenReady = childrenReady && nodes[node.firstChild + c].ready;
+        if (childrenReady || !node.ready) {
+            for (int c = 0; c < 4; ++c) visit(node.firstChild + c, frame);
+            return;
+        }
+    }
+    if (node.ready) {
+        drawList.push_back(node.vao);
+        stats.drawnChunks++;
+        stats.triangles += indexCount / 3;
+        stats.maxDepth = std::max(stats.maxDepth, node.level);
+    }
+}
+
+// ================= 绘制 =================
+void PlanetQuadtree::draw() const {
+    for (GLuint vao : drawList) {
+        glBindVertexArray(vao);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    }
+    glBindVertexArray(0);
+}
+
+void PlanetQuadtree::printStats() const {
+    std::cout << "[planet] 块 " << stats.chunks << "（绘制 " << stats.drawnChunks << "，最深 " << stats.maxDepth
+              << " 级），三角形 " << stats.triangles << "，待生成 " << stats.pendingBuilds << "，累计生成 " << stats.chunksBuilt
+              << " 块（平均 " << stats.buildMs << " ms/块），顶点数据 " << stats.geometryMB << " MB" << std::endl;
+}
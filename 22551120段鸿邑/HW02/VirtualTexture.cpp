@@ -0,0 +1,687 @@
+#include "virtual_texture.h"
+#include "stb_image.h"
+#include "../Common/memoryregistry.h"
+#include "../Common/shadermanager.h"
+#include "../Common/streambuffer.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace fs = std::filesystem;
+
+// ================= 页文件格式 =================
+// 文件头之后按 mip 级别从细到粗、每级按行存放全部页，每页 SLOT_SIZE² 个 RGBA8 texel（含边）
+struct PageFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceSize;      // 源文件大小与修改时间，任一改变即重新切页
+    int64_t sourceTime;
+    int32_t width;
+    int32_t height;
+    int32_t pageSize;
+    int32_t border;
+    int32_t levels;
+    int32_t reserved;
+};
+
+static const uint32_t PAGE_MAGIC = 0x46505456;   // "VTPF"
+static const uint32_t PAGE_VERSION = 1;
+static const size_t PAGE_BYTES = (size_t)VirtualTexture::SLOT_SIZE * VirtualTexture::SLOT_SIZE * 4;
+
+static double nowSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t pageKey(int level, int x, int y) {
+    return (uint32_t)level << 24 | (uint32_t)y << 12 | (uint32_t)x;
+}
+
+static bool readHeader(const std::string& path, PageFileHeader& header) {
+    std::ifstream f(path, std::ios::binary);
+    return f.read((char*)&header, sizeof(header)) && header.magic == PAGE_MAGIC && header.version == PAGE_VERSION
+        && header.pageSize == VirtualTexture::PAGE_SIZE && header.border == VirtualTexture::BORDER;
+}
+
+// ================= 预切页 =================
+// 源图按行读取。stb_image 只能整张解码，且解码结果不能超过 2 GB（RGBA 约 5.3 亿像素，32768 × 16384 已超出）；
+// 更大的源图转成二进制 PPM（P6，maxval 255），逐行从文件读入，内存只有两行。
+// 行号与 loadTexture 一致：第 0 行为图像底行（v = 0）
+class SourceImage {
+public:
+    ~SourceImage() { if (pixels) stbi_image_free(pixels); }
+
+    bool open(const std::string& path) {
+        if (openPPM(path)) return true;
+        int n;
+        stbi_set_flip_vertically_on_load(true);
+        pixels = stbi_load(path.c_str(), &width, &height, &n, 4);
+        return pixels != nullptr;
+    }
+
+    // 返回的指针在下一次读取与 y 奇偶相同的行之前有效（双线性重采样同时用到相邻两行）
+    const uint8_t* row(int y) {
+        if (pixels) return pixels + (size_t)y * width * 4;
+        std::vector<uint8_t>& out = rows[y & 1];
+        if (cached[y & 1] == y) return out.data();
+        file.seekg(dataStart + (uint64_t)(height - 1 - y) * width * 3);
+        file.read((char*)rgb.data(), rgb.size());
+        for (int x = 0; x < width; x++) {
+            out[x * 4 + 0] = rgb[x * 3 + 0];
+            out[x * 4 + 1] = rgb[x * 3 + 1];
+            out[x * 4 + 2] = rgb[x * 3 + 2];
+            out[x * 4 + 3] = 255;
+        }
+        cached[y & 1] = y;
+        return out.data();
+    }
+
+    int width = 0;
+    int height = 0;
+
+private:
+    uint8_t* pixels = nullptr;
+    std::ifstream file;
+    uint64_t dataStart = 0;
+    std::vector<uint8_t> rgb;
+    std::vector<uint8_t> rows[2];
+    int cached[2] = { -1, -1 };
+
+    // 跳过空白与 # 注释后读一个整数
+    bool readField(int& value) {
+        int c;
+        while ((c = file.peek()) != EOF && (std::isspace(c) || c == '#')) {
+            if (c == '#') file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            else file.get();
+        }
+        return (bool)(file >> value);
+    }
+
+    bool openPPM(const std::string& path) {
+        file.open(path, std::ios::binary);
+        char magic[2] = {};
+        int maxval = 0;
+        if (!file.read(magic, 2) || magic[0] != 'P' || magic[1] != '6' || !readField(width) || !readField(height)
+            || !readField(maxval) || maxval != 255 || width <= 0 || height <= 0) {
+            file.close();
+            width = height = 0;
+            return false;
+        }
+        file.get();   // 数据前的单个空白
+        dataStart = (uint64_t)file.tellg();
+        rgb.resize((size_t)width * 3);
+        rows[0].resize((size_t)width * 4);
+        rows[1].resize((size_t)width * 4);
+        return true;
+    }
+};
+
+// 双线性重采样一行（水平环绕），r0 / r1 为上下两行源图，ty 为两者之间的权重
+static void resampleRow(const uint8_t* r0, const uint8_t* r1, float ty, int w, uint8_t* out, int dw) {
+    for (int x = 0; x < dw; x++) {
+        float fx = (x + 0.5f) * w / dw - 0.5f;
+        int x0 = (int)std::floor(fx);
+        float tx = fx - x0;
+        x0 = (x0 % w + w) % w;
+        int x1 = (x0 + 1) % w;
+        for (int c = 0; c < 4; c++) {
+            float a = r0[x0 * 4 + c] * (1 - tx) + r0[x1 * 4 + c] * tx;
+            float b = r1[x0 * 4 + c] * (1 - tx) + r1[x1 * 4 + c] * tx;
+            out[(size_t)x * 4 + c] = (uint8_t)(a * (1 - ty) + b * ty + 0.5f);
+        }
+    }
+}
+
+// 逐行生成整个 mip 链并切页：每级只保留最近 SLOT_SIZE 行（一整行页加上下边），
+// 行满一行页就写出这些页，偶数行与下一行凑齐后平均出下一级的一行。
+// 内存与源图尺寸无关，只与宽度成正比（64K 宽时 0 级约 35 MB，全部级别不到两倍）
+class PageBandWriter {
+public:
+    PageBandWriter(std::ofstream& file, int width, int height, int levels) : f(file) {
+        uint64_t first = 0;
+        for (int l = 0; l < levels; l++) {
+            Level level;
+            level.width = width >> l;
+            level.height = height >> l;
+            level.firstPage = first;
+            level.ring.resize((size_t)S * level.width * 4);
+            first += (uint64_t)(level.width / P) * (level.height / P);
+            bufferBytes += level.ring.size();
+            chain.push_back(std::move(level));
+        }
+        page.resize(PAGE_BYTES);
+        next.resize((size_t)(width / 2) * 4);
+    }
+
+    void push(int l, int y, const uint8_t* row) {
+        Level& level = chain[l];
+        std::copy(row, row + (size_t)level.width * 4, rowAt(level, y));
+        // 凑齐一行页（含下边；最后一行页的下边截断到末行）就写出
+        while (level.band < level.height / P && y == std::min(level.band * P + P + B - 1, level.height - 1)) {
+            writeBand(l, level.band);
+            level.band++;
+        }
+        // 下一级：2×2 平均
+        if ((y & 1) && l + 1 < (int)chain.size()) {
+            const uint8_t* a = rowAt(level, y - 1);
+            const uint8_t* b = rowAt(level, y);
+            for (int x = 0; x < level.width / 2; x++) {
+                for (int c = 0; c < 4; c++) {
+                    int sum = a[(2 * x) * 4 + c] + a[(2 * x + 1) * 4 + c] + b[(2 * x) * 4 + c] + b[(2 * x + 1) * 4 + c];
+                    next[(size_t)x * 4 + c] = (uint8_t)((sum + 2) / 4);
+                }
+            }
+            push(l + 1, y / 2, next.data());
+        }
+    }
+
+    uint64_t pages = 0;
+    size_t bufferBytes = 0;   // 各级行缓冲之和，即切页的峰值内存（不含 stb_image 整张解码的源图）
+
+private:
+    static constexpr int S = VirtualTexture::SLOT_SIZE, B = VirtualTexture::BORDER, P = VirtualTexture::PAGE_SIZE;
+    struct Level {
+        int width;
+        int height;
+        uint64_t firstPage;
+        int band = 0;                 // 下一行待写出的页
+        std::vector<uint8_t> ring;    // 第 y 行存在 y % SLOT_SIZE
+    };
+    std::ofstream& f;
+    std::vector<Level> chain;
+    std::vector<uint8_t> page;
+    std::vector<uint8_t> next;        // 下一级的一行；push 先把它拷进行缓冲，所以各级可以共用
+
+    uint8_t* rowAt(Level& level, int y) { return &level.ring[(size_t)(y % S) * level.width * 4]; }
+
+    // 一行页在页文件中是连续的，定位一次后顺序写出
+    void writeBand(int l, int py) {
+        Level& level = chain[l];
+        int lw = level.width, lh = level.height;
+        f.seekp(sizeof(PageFileHeader) + (level.firstPage + (uint64_t)py * (lw / P)) * PAGE_BYTES);
+        for (int px = 0; px < lw / P; px++) {
+            for (int y = 0; y < S; y++) {
+                int sy = std::min(std::max(py * P + y - B, 0), lh - 1);
+                const uint8_t* src = rowAt(level, sy);
+                for (int x = 0; x < S; x++) {
+                    int sx = ((px * P + x - B) % lw + lw) % lw;
+                    std::copy(src + (size_t)sx * 4, src + (size_t)sx * 4 + 4, &page[((size_t)y * S + x) * 4]);
+                }
+            }
+            f.write((const char*)page.data(), page.size());
+            pages++;
+        }
+    }
+};
+
+bool buildPageFile(const std::string& source, const std::string& pagePath) {
+    std::error_code ec;
+    uint64_t sourceSize = fs::file_size(source, ec);
+    if (ec) {
+        std::cerr << "[vt] 找不到源图：" << source << std::endl;
+        return false;
+    }
+    int64_t sourceTime = (int64_t)fs::last_write_time(source, ec).time_since_epoch().count();
+
+    PageFileHeader header;
+    if (readHeader(pagePath, header) && header.sourceSize == sourceSize && header.sourceTime == sourceTime) return true;
+
+    auto start = std::chrono::steady_clock::now();
+    SourceImage image;
+    if (!image.open(source)) {
+        std::cerr << "[vt] 源图加载失败：" << source << "（超过 2 GB 的源图请转为二进制 PPM）" << std::endl;
+        return false;
+    }
+    int w = image.width, h = image.height;
+
+    // 虚拟尺寸取不小于源图的 PAGE_SIZE·2^k，每级尺寸都是整页；切到短边只剩一页为止
+    int vw = VirtualTexture::PAGE_SIZE, vh = VirtualTexture::PAGE_SIZE;
+    while (vw < w) vw *= 2;
+    while (vh < h) vh *= 2;
+    int levels = 1;
+    while ((vw >> levels) >= VirtualTexture::PAGE_SIZE && (vh >> levels) >= VirtualTexture::PAGE_SIZE) levels++;
+
+    fs::path dir = fs::path(pagePath).parent_path();
+    if (!dir.empty()) fs::create_directories(dir, ec);
+    std::ofstream f(pagePath, std::ios::binary | std::ios::trunc);
+    if (!f) return false;
+    header = { PAGE_MAGIC, PAGE_VERSION, sourceSize, sourceTime, vw, vh,
+               VirtualTexture::PAGE_SIZE, VirtualTexture::BORDER, levels, 0 };
+    f.write((const char*)&header, sizeof(header));
+
+    // 0 级逐行送入：尺寸已是页的 2 的幂倍时直接取源图的行，否则双线性重采样（竖直截断）
+    PageBandWriter writer(f, vw, vh, levels);
+    std::vector<uint8_t> row((size_t)vw * 4);
+    for (int y = 0; y < vh; y++) {
+        if (vw == w && vh == h) {
+            writer.push(0, y, image.row(y));
+            continue;
+        }
+        float fy = std::min(std::max((y + 0.5f) * h / vh - 0.5f, 0.0f), (float)(h - 1));
+        int y0 = (int)fy, y1 = std::min(y0 + 1, h - 1);
+        const uint8_t* r0 = image.row(y0);
+        resampleRow(r0, image.row(y1), fy - y0, w, row.data(), vw);
+        writer.push(0, y, row.data());
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[vt] 切页 " << source << "：" << vw << "×" << vh << "，" << levels << " 级，" << writer.pages << " 页，"
+              << writer.pages * PAGE_BYTES / (1024.0 * 1024.0) << " MB，行缓冲 " << writer.bufferBytes / (1024.0 * 1024.0)
+              << " MB，" << ms << " ms" << std::endl;
+    return (bool)f;
+}
+
+// ================= 反馈着色器 =================
+// 与地球片段着色器的 sampleVirtual() 使用同一套 mip 与页坐标计算；反馈缓冲的屏幕导数是全分辨率的
+// FEEDBACK_DIVISOR 倍，用 vtLodBias 抵消
+static const char* feedbackFragmentSource = R"(
+    #version 330 core
+    layout (location = 0) out uint pageKey;
+
+    in VS_OUT {
+        vec2 TexCoords;
+        vec3 FragPos;
+        mat3 TBN;
+    } fs_in;
+
+    uniform vec2 vtSize;
+    uniform int vtLevels;
+    uniform float vtLodBias;
+
+    void main()
+    {
+        vec2 texel = fs_in.TexCoords * vtSize;
+        float lod = log2(max(max(length(dFdx(texel)), length(dFdy(texel))), 1e-6)) - vtLodBias;
+        int mip = clamp(int(floor(lod + 0.5)), 0, vtLevels - 1);
+        vec2 p = vec2(fract(fs_in.TexCoords.x), clamp(fs_in.TexCoords.y, 0.0, 0.99999));
+        ivec2 pages = (ivec2(vtSize) >> mip) / VT_PAGE_SIZE;
+        ivec2 page = min(ivec2(p * vec2(pages)), pages - 1);
+        pageKey = uint(mip) << 24 | uint(page.y) << 12 | uint(page.x);
+    }
+)";
+
+// ================= 打开 / 关闭 =================
+bool VirtualTexture::open(const std::string& pagePath, const char* vertexSource, const ShaderDefines& vertexDefines) {
+    PageFileHeader header;
+    if (!readHeader(pagePath, header)) return false;
+    path = pagePath;
+    width = header.width;
+    height = header.height;
+    levels = header.levels;
+    dataOffset = sizeof(PageFileHeader);
+    levelInfo.clear();
+    uint64_t first = 0;
+    for (int l = 0; l < levels; l++) {
+        Level info;
+        info.pagesX = (width >> l) / PAGE_SIZE;
+        info.pagesY = (height >> l) / PAGE_SIZE;
+        info.firstPage = first;
+        first += (uint64_t)info.pagesX * info.pagesY;
+        levelInfo.push_back(info);
+    }
+
+    ShaderDefines feedbackDefines = vertexDefines;
+    ShaderDefines vtDefines = defines();
+    feedbackDefines.insert(feedbackDefines.end(), vtDefines.begin(), vtDefines.end());
+    std::vector<GLuint> programs = gShaders.buildAll({ { "vt_feedback", vertexSource, feedbackFragmentSource, feedbackDefines } });
+    feedbackProgram = programs[0];
+    if (!feedbackProgram) return false;
+    StreamBuffer::bindBlocks(feedbackProgram);
+
+    // 物理页缓存
+    int physicalSize = PHYSICAL_PAGES * SLOT_SIZE;
+    glGenTextures(1, &physicalTex);
+    glBindTexture(GL_TEXTURE_2D, physicalTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, physicalSize, physicalSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // 间接纹理：整数格式，mip 链与页网格逐级对应
+    glGenTextures(1, &indirectionTex);
+    glBindTexture(GL_TEXTURE_2D, indirectionTex);
+    indirection.assign(levels, {});
+    for (int l = 0; l < levels; l++) {
+        indirection[l].assign((size_t)levelInfo[l].pagesX * levelInfo[l].pagesY * 4, 0);
+        glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8UI, levelInfo[l].pagesX, levelInfo[l].pagesY, 0,
+                     GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+        gMemory.trackHost("vt_indirection", (int64_t)indirection[l].size());   // CPU 侧副本常驻
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    for (Readback& r : ring) glGenBuffers(1, &r.pbo);
+
+    slots.assign(PHYSICAL_PAGES * PHYSICAL_PAGES, Slot());
+    freeSlots.clear();
+    for (int i = (int)slots.size() - 1; i >= 0; i--) freeSlots.push_back(i);
+
+    // 最粗一级同步读入并常驻，保证任何位置都有可采样的内容
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> texels(PAGE_BYTES);
+    const Level& top = levelInfo[levels - 1];
+    for (int y = 0; y < top.pagesY; y++) {
+        for (int x = 0; x < top.pagesX; x++) {
+            file.seekg((std::streamoff)(dataOffset + (top.firstPage + (uint64_t)y * top.pagesX + x) * PAGE_BYTES));
+            if (!file.read((char*)texels.data(), texels.size())) return false;
+            makeResident(pageKey(levels - 1, x, y), texels.data(), true);
+        }
+    }
+    rebuildIndirection();
+
+    quit = false;
+    lastSecond = nowSeconds();
+    loader = std::thread(&VirtualTexture::loaderMain, this);
+    std::cout << "[vt] " << width << "×" << height << "，" << levels << " 级，物理缓存 " << slots.size() << " 页" << std::endl;
+    return true;
+}
+
+void VirtualTexture::close() {
+    if (loader.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        loader.join();
+    }
+    for (Readback& r : ring) {
+        if (r.fence) glDeleteSync(r.fence);
+        glDeleteBuffers(1, &r.pbo);
+        r = Readback();
+    }
+    glDeleteProgram(feedbackProgram);
+    glDeleteTextures(1, &physicalTex);
+    glDeleteTextures(1, &indirectionTex);
+    for (const std::vector<uint8_t>& level : indirection) gMemory.trackHost("vt_indirection", -(int64_t)level.size());
+    indirection.clear();
+    glDeleteFramebuffers(1, &feedbackFbo);
+    glDeleteTextures(1, &feedbackColor);
+    glDeleteRenderbuffers(1, &feedbackDepth);
+    feedbackProgram = physicalTex = indirectionTex = feedbackFbo = feedbackColor = feedbackDepth = 0;
+}
+
+// ================= 读盘线程 =================
+void VirtualTexture::loaderMain() {
+    std::ifstream file(path, std::ios::binary);
+    while (true) {
+        uint32_t key;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return quit || !queue.empty(); });
+            if (quit) return;
+            key = queue.front();
+            queue.erase(queue.begin());
+            requested.insert(key);
+        }
+
+        const Level& level = levelInfo[key >> 24];
+        uint64_t index = level.firstPage + (uint64_t)((key >> 12) & 0xFFF) * level.pagesX + (key & 0xFFF);
+        LoadedPage page{ key, std::vector<uint8_t>(PAGE_BYTES) };
+        file.seekg((std::streamoff)(dataOffset + index * PAGE_BYTES));
+        file.read((char*)page.texels.data(), page.texels.size());
+        if (!file) {
+            file.clear();
+            std::lock_guard<std::mutex> lock(mutex);
+            requested.erase(key);
+            continue;
+        }
+        bytesRead += PAGE_BYTES;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded.push_back(std::move(page));
+    }
+}
+
+// ================= 反馈 =================
+GLuint VirtualTexture::beginFeedback(int viewWidth, int viewHeight) {
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &savedFbo);
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+
+    int w = std::max(1, viewWidth / FEEDBACK_DIVISOR);
+    int h = std::max(1, viewHeight / FEEDBACK_DIVISOR);
+    if (w != feedbackW || h != feedbackH) {
+        feedbackW = w;
+        feedbackH = h;
+        if (!feedbackFbo) glGenFramebuffers(1, &feedbackFbo);
+        if (!feedbackColor) glGenTextures(1, &feedbackColor);
+        if (!feedbackDepth) glGenRenderbuffers(1, &feedbackDepth);
+        glBindTexture(GL_TEXTURE_2D, feedbackColor);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, w, h, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+        glBindFramebuffer(GL_FRAMEBUFFER, feedbackFbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackColor, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, feedbackFbo);
+    glViewport(0, 0, w, h);
+    const GLuint none[4] = { 0xFFFFFFFFu, 0, 0, 0 };
+    glClearBufferuiv(GL_COLOR, 0, none);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(feedbackProgram);
+    glUniform2f(glGetUniformLocation(feedbackProgram, "vtSize"), (float)width, (float)height);
+    glUniform1i(glGetUniformLocation(feedbackProgram, "vtLevels"), levels);
+    glUniform1f(glGetUniformLocation(feedbackProgram, "vtLodBias"), std::log2((float)FEEDBACK_DIVISOR));
+    return feedbackProgram;
+}
+
+void VirtualTexture::endFeedback() {
+    // 最旧的槽还没处理完（GPU 落后超过 FEEDBACK_RING 帧）时跳过本帧反馈，不等待
+    Readback& r = ring[ringHead];
+    if (!r.fence) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+        if (r.width != feedbackW || r.height != feedbackH) {
+            r.width = feedbackW;
+            r.height = feedbackH;
+            glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)r.width * r.height * sizeof(uint32_t), nullptr, GL_STREAM_READ);
+        }
+        glReadPixels(0, 0, r.width, r.height, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        ringHead = (ringHead + 1) % FEEDBACK_RING;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, savedFbo);
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+}
+
+void VirtualTexture::processFeedback(const uint32_t* ids, int count) {
+    std::unordered_map<uint32_t, int> pages;
+    for (int i = 0; i < count; i++) {
+        uint32_t key = ids[i];
+        if (key == 0xFFFFFFFFu) continue;
+        int level = (int)(key >> 24);
+        if (level >= levels || (int)(key & 0xFFF) >= levelInfo[level].pagesX
+            || (int)((key >> 12) & 0xFFF) >= levelInfo[level].pagesY) continue;
+        pages[key]++;
+    }
+
+    std::unordered_map<uint32_t, int> missingPixels;
+    uint64_t hits = 0;
+    for (const auto& p : pages) {
+        // 页本身与全部祖先都刷新 LRU：祖先是页缺失时的回退内容
+        uint32_t key = p.first;
+        bool resident = residentSlot.count(key) != 0;
+        if (resident) hits++;
+        else missingPixels[key] += p.second;
+        for (int level = (int)(key >> 24); level < levels; level++) {
+            int x = (int)(key & 0xFFF) >> (level - (int)(key >> 24));
+            int y = (int)((key >> 12) & 0xFFF) >> (level - (int)(key >> 24));
+            uint32_t k = pageKey(level, x, y);
+            if (residentSlot.count(k)) touch(k);
+            else if (k != key) missingPixels.emplace(k, 0);
+        }
+    }
+    stats.requests += pages.size();
+    stats.hits += hits;
+    stats.hitRate = pages.empty() ? 1.0 : (double)hits / pages.size();
+
+    // 粗级别优先（先有能用的回退），同级按请求像素数；缺失的祖先也一并请求
+    std::vector<std::pair<uint32_t, int>> missing(missingPixels.begin(), missingPixels.end());
+    std::sort(missing.begin(), missing.end(), [](const auto& a, const auto& b) {
+        if ((a.first >> 24) != (b.first >> 24)) return (a.first >> 24) > (b.first >> 24);
+        if (a.second != b.second) return a.second > b.second;
+        return a.first < b.first;
+    });
+
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.clear();
+    for (const auto& m : missing) {
+        if ((int)queue.size() >= MAX_REQUESTS) break;
+        if (!requested.count(m.first)) queue.push_back(m.first);
+    }
+    wake.notify_one();
+}
+
+// ================= 页缓存 =================
+void VirtualTexture::touch(uint32_t key) {
+    auto it = lruPos.find(key);
+    if (it == lruPos.end()) return;
+    lru.splice(lru.begin(), lru, it->second);
+}
+
+int VirtualTexture::allocateSlot() {
+    if (!freeSlots.empty()) {
+        int slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+    if (lru.empty()) return -1;
+    uint32_t victim = lru.back();
+    lru.pop_back();
+    lruPos.erase(victim);
+    int slot = residentSlot[victim];
+    residentSlot.erase(victim);
+    stats.evictions++;
+    return slot;
+}
+
+void VirtualTexture::makeResident(uint32_t key, const uint8_t* texels, bool pinned) {
+    int slot = allocateSlot();
+    if (slot < 0) return;
+    glBindTexture(GL_TEXTURE_2D, physicalTex);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % PHYSICAL_PAGES) * SLOT_SIZE, (slot / PHYSICAL_PAGES) * SLOT_SIZE,
+                    SLOT_SIZE, SLOT_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+    slots[slot].key = key;
+    slots[slot].pinned = pinned;
+    residentSlot[key] = slot;
+    if (!pinned) {
+        lru.push_front(key);
+        lruPos[key] = lru.begin();
+    }
+    indirectionDirty = true;
+}
+
+// 自粗到细逐级填写：已驻留的页指向自己的槽，否则沿用父页的项
+void VirtualTexture::rebuildIndirection() {
+    glBindTexture(GL_TEXTURE_2D, indirectionTex);
+    for (int l = levels - 1; l >= 0; l--) {
+        const Level& info = levelInfo[l];
+        for (int y = 0; y < info.pagesY; y++) {
+            for (int x = 0; x < info.pagesX; x++) {
+                uint8_t* entry = &indirection[l][((size_t)y * info.pagesX + x) * 4];
+                auto it = residentSlot.find(pageKey(l, x, y));
+                if (it != residentSlot.end()) {
+                    entry[0] = (uint8_t)(it->second % PHYSICAL_PAGES);
+                    entry[1] = (uint8_t)(it->second / PHYSICAL_PAGES);
+                    entry[2] = (uint8_t)l;
+                    entry[3] = 255;
+                }
+                else if (l + 1 < levels) {
+                    const Level& parent = levelInfo[l + 1];
+                    const uint8_t* p = &indirection[l + 1][((size_t)(y / 2) * parent.pagesX + x / 2) * 4];
+                    std::copy(p, p + 4, entry);
+                }
+            }
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, l, 0, 0, info.pagesX, info.pagesY, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,
+                        indirection[l].data());
+    }
+    indirectionDirty = false;
+}
+
+// ================= 每帧更新 =================
+void VirtualTexture::update() {
+    // 1. 按发出顺序处理已就绪的反馈
+    for (int i = 0; i < FEEDBACK_RING; i++) {
+        Readback& r = ring[(ringHead + i) % FEEDBACK_RING];
+        if (!r.fence) continue;
+        GLenum status = glClientWaitSync(r.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        glDeleteSync(r.fence);
+        r.fence = nullptr;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+        const uint32_t* ids = (const uint32_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+            (size_t)r.width * r.height * sizeof(uint32_t), GL_MAP_READ_BIT);
+        if (ids) processFeedback(ids, r.width * r.height);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // 2. 上传读好的页；超出本帧配额的留在队列里下一帧再传
+    std::vector<LoadedPage> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        int n = std::min((int)loaded.size(), MAX_UPLOADS);
+        ready.assign(std::make_move_iterator(loaded.begin()), std::make_move_iterator(loaded.begin() + n));
+        loaded.erase(loaded.begin(), loaded.begin() + n);
+        for (const LoadedPage& p : ready) requested.erase(p.key);
+    }
+    for (const LoadedPage& p : ready) {
+        if (residentSlot.count(p.key)) continue;
+        makeResident(p.key, p.texels.data(), false);
+        stats.pagesStreamed++;
+        stats.bytesStreamed += PAGE_BYTES;
+    }
+
+    // 3. 间接纹理
+    if (indirectionDirty) rebuildIndirection();
+
+    stats.resident = (int)residentSlot.size();
+    double now = nowSeconds();
+    if (now - lastSecond >= 1.0) {
+        uint64_t bytes = bytesRead.load();
+        stats.streamMBps = (bytes - bytesAtLastSecond) / (1024.0 * 1024.0) / (now - lastSecond);
+        bytesAtLastSecond = bytes;
+        lastSecond = now;
+    }
+}
+
+ShaderDefines VirtualTexture::defines() {
+    return {
+        { "VT_PAGE_SIZE", std::to_string(PAGE_SIZE) },
+        { "VT_BORDER", std::to_string(BORDER) },
+        { "VT_SLOT_SIZE", std::to_string(SLOT_SIZE) },
+    };
+}
+
+void VirtualTexture::bind(GLuint program, int physicalUnit, int indirectionUnit) const {
+    glActiveTexture(GL_TEXTURE0 + physicalUnit);
+    glBindTexture(GL_TEXTURE_2D, physicalTex);
+    glActiveTexture(GL_TEXTURE0 + indirectionUnit);
+    glBindTexture(GL_TEXTURE_2D, indirectionTex);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(program, "vtPhysical"), physicalUnit);
+    glUniform1i(glGetUniformLocation(program, "vtIndirection"), indirectionUnit);
+    glUniform2f(glGetUniformLocation(program, "vtSize"), (float)width, (float)height);
+    glUniform1i(glGetUniformLocation(program, "vtLevels"), levels);
+    glUniform1f(glGetUniformLocation(program, "vtPhysicalSize"), (float)(PHYSICAL_PAGES * SLOT_SIZE));
+}
+
+void VirtualTexture::printStats() const {
+    std::cout << "[vt] 命中率 " << stats.hitRate * 100.0 << "%（累计 "
+              << (stats.requests ? 100.0 * stats.hits / stats.requests : 100.0) << "%），读盘 " << stats.streamMBps
+              << " MB/s，累计流入 " << stats.pagesStreamed << " 页（" << stats.bytesStreamed / (1024.0 * 1024.0)
+              << " MB），淘汰 " << stats.evictions << " 页，驻留 " << stats.resident << " / " << slots.size() << std::endl;
+}
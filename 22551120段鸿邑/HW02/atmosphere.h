@@ -0,0 +1,79 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../Common/shadermanager.h"
+
+// ================= 预计算大气散射 =================
+// Bruneton 式查找表，纹理参数化与着色器查表函数沿用 Bruneton 2017 参考实现，CPU 多线程预计算后缓存到磁盘：
+//   - 透射率 T(r, μ)：TRANSMITTANCE_W × TRANSMITTANCE_H，按高度与到大气顶的距离参数化
+//   - 散射 S(r, μ, μs, ν)：4D 表排成 3D 纹理 (NU × MU_S, MU, R)。rgb 为 Rayleigh（含多次散射），a 为单次 Mie 的红色分量
+//   - 辐照度 E(r, μs)：天空对水平面的间接辐照度。太阳直射部分由着色器从透射率表算出
+// 多次散射不逐阶迭代：在 CPU 上，每一阶都要对整张 4D 表逐 texel 做球面积分，太慢。
+// 这里改用 Hillaire 2020 的各向同性近似：先算一张 ψms(r, μs) 小表，沿视线积分时把 σs·ψms 与单次散射一起累加，
+// 再按 Bruneton 的约定除以 Rayleigh 相函数，存入 rgb。
+// 距离单位为 km，着色器用 kmPerUnit 把场景坐标换算过去。
+struct AtmosphereParams {
+    float bottomRadius = 6360.0f;
+    float topRadius = 6420.0f;
+    glm::vec3 solarIrradiance = glm::vec3(1.474f, 1.8504f, 1.91198f);
+    float sunAngularRadius = 0.004675f;
+    glm::vec3 rayleighScattering = glm::vec3(5.802e-3f, 13.558e-3f, 33.1e-3f);   // 海平面，1/km
+    float rayleighScaleHeight = 8.0f;
+    glm::vec3 mieScattering = glm::vec3(3.996e-3f);
+    float mieScaleHeight = 1.2f;
+    glm::vec3 mieExtinction = glm::vec3(4.44e-3f);
+    float mieG = 0.8f;
+    glm::vec3 ozoneAbsorption = glm::vec3(0.65e-3f, 1.881e-3f, 0.085e-3f);      // 帐篷形分布的峰值
+    float ozoneCenter = 25.0f;
+    glm::vec3 groundAlbedo = glm::vec3(0.1f);
+    float ozoneWidth = 30.0f;
+    float muSMin = -0.2f;         // 散射表覆盖的最低太阳高度（cos 102°）
+
+    // 大气层加厚 factor 倍，各高度尺度同比放大、系数同比缩小，光学厚度不变。
+    // 场景里地球半径只有 0.5 个单位，真实厚度的大气边缘在默认视角下不到一个像素
+    AtmosphereParams thickened(float factor) const;
+};
+
+class Atmosphere {
+public:
+    static constexpr int TRANSMITTANCE_W = 256;
+    static constexpr int TRANSMITTANCE_H = 64;
+    static constexpr int SCATTERING_R = 32;
+    static constexpr int SCATTERING_MU = 128;
+    static constexpr int SCATTERING_MU_S = 32;
+    static constexpr int SCATTERING_NU = 8;
+    static constexpr int IRRADIANCE_W = 64;
+    static constexpr int IRRADIANCE_H = 16;
+    static constexpr int MULTI_SCATTERING_SIZE = 32;
+
+    // 缓存文件按参数哈希命名，参数不变时直接读取；threads 为 0 时使用全部硬件线程
+    bool init(const AtmosphereParams& params, const std::string& cacheDir, unsigned threads = 0);
+    void destroy();
+    // 着色器常量（大气参数与表尺寸），配合 shaderSource() 使用
+    ShaderDefines defines() const;
+    // GLSL 查表函数 GetSkyRadiance / GetSkyRadianceToPoint / GetSunAndSkyIrradiance，拼接在片段着色器末尾
+    static const char* shaderSource();
+    // 三张表依次绑定到 firstUnit 起的纹理单元，并设置 sampler uniform
+    void bind(GLuint program, int firstUnit) const;
+
+    AtmosphereParams params;
+    uint64_t paramsHash = 0;
+    bool fromCache = false;
+    double precomputeMs = 0.0;
+
+private:
+    GLuint transmittanceTex = 0;
+    GLuint scatteringTex = 0;
+    GLuint irradianceTex = 0;
+    std::vector<glm::vec4> transmittance;
+    std::vector<glm::vec4> scattering;
+    std::vector<glm::vec4> irradiance;
+
+    void precompute(unsigned threads);
+    bool load(const std::string& path);
+    void save(const std::string& path) const;
+    void upload();
+};
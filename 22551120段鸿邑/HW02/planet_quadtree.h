@@ -0,0 +1,133 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ================= 立方体球星球（四叉树分块 LOD） =================
+// 单位立方体的 6 个面各是一棵四叉树，节点对应面上的一个方形区域（块），块内 CHUNK_QUADS² 的网格
+// 映射到球面（spherified cube，面中心与边角的网格间距相差不到 1.5 倍，且没有 UV 球两极的扇形退化三角形）。
+//   - 分裂/合并：块内一个网格四边形投到屏幕上的边长（像素）作为屏幕空间误差，超过 SPLIT_PIXELS 分裂，
+//     低于 SPLIT_PIXELS × MERGE_RATIO 合并，中间留回滞避免在阈值附近来回切换
+//   - 子块网格由工作线程生成（CPU 顶点数据），主线程每帧最多上传 MAX_UPLOADS 块；四个子块都就绪前继续画父块，
+//     所以分裂过程中不会出现空洞
+//   - 每块有自己的 VAO/VBO，拓扑相同，共用一个索引缓冲
+//   - 相邻块级别不同处的 T 形接缝用裙边（块四周向球心下垂的一圈三角形）遮住，不需要相邻块互相约束级别
+//   - 视锥外、地平线后的块不画也不细分
+// 顶点格式与 generateSphere 相同（位置、法线、纹理坐标、切线、副切线，共 14 个 float），地球着色器无需改动。
+// 纹理坐标沿用 UV 球的约定（z 轴为极轴，s 从 +X 起按经度增加，t 从北极 0 到南极 1）。经度接缝 (y = 0, x > 0)
+// 在 1 级以下恰好落在块的边上，所以每块内按块中心经度展开 s 即可连续，最少细分到 MIN_DEPTH = 1。
+struct PlanetStats {
+    int chunks = 0;            // 已分配的块（含未就绪、被剔除的）
+    int drawnChunks = 0;       // 本帧绘制的块
+    uint64_t triangles = 0;    // 本帧绘制的三角形（含裙边）
+    int maxDepth = 0;          // 本帧绘制的最深级别
+    int pendingBuilds = 0;     // 排队或生成中的块
+    uint64_t chunksBuilt = 0;  // 累计生成的块
+    double buildMs = 0.0;      // 工作线程生成一块的平均耗时
+    double geometryMB = 0.0;   // 已上传的顶点数据
+};
+
+class PlanetQuadtree {
+public:
+    static constexpr int CHUNK_QUADS = 16;         // 每块 16 × 16 个四边形
+    static constexpr int MIN_DEPTH = 1;
+    static constexpr int MAX_DEPTH = 12;           // 网格边长约为半径的 10^-5；再细时轨道半径 8 处的 float 世界坐标开始抖动
+    static constexpr float SPLIT_PIXELS = 8.0f;
+    static constexpr float MERGE_RATIO = 0.5f;
+    static constexpr int MAX_UPLOADS = 16;
+
+    // radius 为局部空间半径；threads 为 0 时使用硬件线程数 - 1（至少 1 个）
+    bool init(float radius, unsigned threads = 0);
+    void destroy();
+
+    // 每帧一次：按相机更新四叉树、上传生成好的块并确定本帧绘制列表
+    // model 为星球的模型矩阵（只含平移与均匀缩放），fovY 为竖直视场角（弧度）
+    void update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection,
+                const glm::vec3& cameraWorld, int viewportHeight, float fovY);
+    // 按本帧绘制列表逐块绘制，调用方负责设置程序与 uniform；一帧内可调用多次（反馈通道与正式绘制）
+    void draw() const;
+    // 本帧绘制列表与每块的索引数（渲染队列逐块提交绘制包）
+    const std::vector<GLuint>& drawVAOs() const { return drawList; }
+    GLsizei chunkIndexCount() const { return indexCount; }
+    void printStats() const;
+
+    PlanetStats stats;
+    // 运行时的最深级别，不超过 MAX_DEPTH；显存超出预算时由降级回调逐级降低，更深的块随之合并释放
+    int maxDepth = MAX_DEPTH;
+
+private:
+    struct Vertex {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 uv;
+        glm::vec3 tangent;
+        glm::vec3 bitangent;
+    };
+    static_assert(sizeof(Vertex) == 14 * sizeof(float), "顶点格式需与 generateSphere 一致");
+
+    struct Node {
+        uint64_t key = 0;          // face << 60 | level << 52 | y << 26 | x，0 表示空闲
+        int face = 0;
+        int level = 0;
+        int x = 0;
+        int y = 0;
+        int firstChild = -1;       // 四个子节点在池中连续存放
+        bool ready = false;        // 网格已上传
+        bool building = false;
+        GLuint vao = 0;
+        GLuint vbo = 0;
+        glm::vec3 center{ 0.0f };  // 局部空间包围球
+        float boundRadius = 0.0f;
+        float coneAngle = 0.0f;    // 块内各点方向与中心方向的最大夹角（地平线剔除）
+        float quadSize = 0.0f;     // 局部空间网格四边形边长
+    };
+    std::vector<Node> nodes;
+    std::vector<int> freeBlocks;   // 空闲的四节点组（首节点下标）
+    int roots[6] = {};
+
+    GLuint indexBuffer = 0;
+    int indexCount = 0;
+    float radius = 1.0f;
+    std::vector<GLuint> drawList;  // 本帧绘制的 VAO
+
+    // 工作线程
+    struct Job {
+        uint64_t key;
+        int node;
+        int face, level, x, y;
+    };
+    struct Built {
+        uint64_t key;
+        int node;
+        std::vector<Vertex> vertices;
+        double ms;
+    };
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Job> jobs;
+    std::vector<Built> built;
+    bool quit = false;
+    double buildMsSum = 0.0;
+
+    void workerMain();
+    void buildChunk(int face, int level, int x, int y, std::vector<Vertex>& out) const;
+    int allocateChildren(int parent);
+    void freeChildren(int parent);
+    void releaseNode(Node& node);
+    void initNode(int index, int face, int level, int x, int y);
+    void upload(Node& node, const std::vector<Vertex>& vertices);
+    void requestBuild(int index);
+
+    struct Frame {
+        glm::vec3 cameraLocal;
+        float cameraDistance;      // 局部空间，到球心
+        float pixelsPerUnit;       // 距离 1 处的局部长度 → 像素
+        glm::vec4 planes[6];       // 局部空间视锥平面
+    };
+    void visit(int index, const Frame& frame);
+};
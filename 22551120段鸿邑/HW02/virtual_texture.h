@@ -0,0 +1,135 @@
+#pragma once
+#include <glad/glad.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../Common/shadermanager.h"
+
+// ================= 虚拟纹理 =================
+// 16K–64K 的星球贴图无法整张放进显存。做法：
+//   1. 预切页：源图重采样到 (PAGE_SIZE·2^a) × (PAGE_SIZE·2^b)，逐级生成 mip，每级切成 PAGE_SIZE² 的页，
+//      四周各带 BORDER 个 texel 的边（水平环绕、竖直截断），供页内双线性过滤使用，顺序写入页文件
+//   2. 反馈：地球以 1/FEEDBACK_DIVISOR 分辨率再画一遍，每像素输出所需的 (mip, 页 x, 页 y)，
+//      经 PBO 异步回读（围栏就绪后才映射，不阻塞）
+//   3. 流式加载：缺页按“粗级别优先、请求像素多优先”排序交给读盘线程，读好的页每帧最多上传 MAX_UPLOADS 个
+//      到物理页缓存纹理；缓存满时淘汰最久未被反馈引用的页（LRU），最粗一级常驻
+//   4. 间接寻址：间接纹理与虚拟纹理的页网格逐级对应，每项记录 (物理页 x, 物理页 y, 实际驻留的 mip)，
+//      未驻留的页指向最近的已驻留祖先，着色器永远能采到（可能更模糊的）内容
+struct VirtualTextureStats {
+    double hitRate = 1.0;          // 最近一次反馈中，请求的页已驻留的比例
+    uint64_t requests = 0;         // 累计请求（去重后的页）
+    uint64_t hits = 0;
+    uint64_t pagesStreamed = 0;    // 累计从页文件读入的页
+    uint64_t bytesStreamed = 0;
+    uint64_t evictions = 0;
+    double streamMBps = 0.0;       // 最近一秒的读盘带宽
+    int resident = 0;
+};
+
+// 源图 source 预切页写到 pagePath；页文件已存在且源文件的大小与修改时间未变时直接返回 true
+bool buildPageFile(const std::string& source, const std::string& pagePath);
+
+class VirtualTexture {
+public:
+    static constexpr int PAGE_SIZE = 128;
+    static constexpr int BORDER = 4;
+    static constexpr int SLOT_SIZE = PAGE_SIZE + 2 * BORDER;
+    static constexpr int PHYSICAL_PAGES = 16;      // 物理页缓存为 16 × 16 页（RGBA8 约 18 MB）
+    static constexpr int FEEDBACK_DIVISOR = 8;
+    static constexpr int FEEDBACK_RING = 3;
+    static constexpr int MAX_UPLOADS = 16;         // 每帧最多上传的页
+    static constexpr int MAX_REQUESTS = 64;        // 每次反馈最多提交的缺页
+
+    // vertexSource 为地球顶点着色器，反馈程序与地球共用它（vertexDefines 为其变体宏，流式常量块在链接后绑定）
+    bool open(const std::string& pagePath, const char* vertexSource, const ShaderDefines& vertexDefines = ShaderDefines());
+    void close();
+
+    // 反馈通道：begin 绑定低分辨率整数 FBO 并返回反馈程序（调用方设置矩阵或绑定 DrawBlock 并绘制），end 发起异步回读并恢复原帧缓冲
+    GLuint beginFeedback(int viewWidth, int viewHeight);
+    void endFeedback();
+    // 每帧一次：处理就绪的反馈、提交缺页、上传读好的页、更新间接纹理
+    void update();
+    // 把物理页缓存与间接纹理绑定到两个纹理单元，并设置 program 中的 vt* uniform
+    void bind(GLuint program, int physicalUnit, int indirectionUnit) const;
+    // 着色器常量 VT_PAGE_SIZE / VT_BORDER / VT_SLOT_SIZE，反馈程序与地球着色器都注入，页尺寸只在这里定义一次
+    static ShaderDefines defines();
+    void printStats() const;
+
+    VirtualTextureStats stats;
+    int width = 0;      // 0 级虚拟尺寸
+    int height = 0;
+    int levels = 0;
+
+private:
+    struct Level {
+        int pagesX = 0;
+        int pagesY = 0;
+        uint64_t firstPage = 0;   // 在页文件中的页序号
+    };
+    std::vector<Level> levelInfo;
+    uint64_t dataOffset = 0;
+
+    GLuint physicalTex = 0;
+    GLuint indirectionTex = 0;
+    GLuint feedbackProgram = 0;
+    GLuint feedbackFbo = 0;
+    GLuint feedbackColor = 0;
+    GLuint feedbackDepth = 0;
+    int feedbackW = 0;
+    int feedbackH = 0;
+    GLint savedFbo = 0;
+    GLint savedViewport[4] = {};
+
+    struct Readback {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        int width = 0;
+        int height = 0;
+    };
+    Readback ring[FEEDBACK_RING];
+    int ringHead = 0;
+
+    // 页键：mip << 24 | y << 12 | x，与反馈着色器的编码一致
+    struct Slot {
+        uint32_t key = 0xFFFFFFFFu;
+        bool pinned = false;
+    };
+    std::vector<Slot> slots;
+    std::vector<int> freeSlots;
+    std::unordered_map<uint32_t, int> residentSlot;
+    std::list<uint32_t> lru;                     // 队首最近使用
+    std::unordered_map<uint32_t, std::list<uint32_t>::iterator> lruPos;
+    std::vector<std::vector<uint8_t>> indirection;   // 每级 pagesX × pagesY × RGBA8UI
+    bool indirectionDirty = true;
+
+    // 读盘线程
+    struct LoadedPage {
+        uint32_t key;
+        std::vector<uint8_t> texels;
+    };
+    std::string path;
+    std::thread loader;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<uint32_t> queue;                 // 待读，队首优先
+    std::vector<LoadedPage> loaded;
+    std::unordered_set<uint32_t> requested;      // 已提交但尚未上传（排队、读盘中或已读好）
+    bool quit = false;
+    std::atomic<uint64_t> bytesRead{ 0 };
+    uint64_t bytesAtLastSecond = 0;
+    double lastSecond = 0.0;
+
+    void loaderMain();
+    void processFeedback(const uint32_t* ids, int count);
+    void touch(uint32_t key);
+    int allocateSlot();
+    void makeResident(uint32_t key, const uint8_t* texels, bool pinned);
+    void rebuildIndirection();
+};
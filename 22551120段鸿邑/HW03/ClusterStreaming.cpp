@@ -0,0 +1,736 @@
+#include "cluster_streaming.h"
+#include "scene_graph.h"
+#include "../Common/memoryregistry.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+// ===================== 簇文件格式 =====================
+// 文件头之后是各页的数据（顶点在前、索引在后），最后是节点表；节点按层序存放，子节点连续
+struct ClusterFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceSize;      // 源文件大小与修改时间，任一改变即重新分页
+    int64_t sourceTime;
+    uint64_t tableOffset;
+    int32_t nodeCount;
+    int32_t pageTriangles;
+    int32_t pageVertices;
+    int32_t proxyGrid;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+struct ClusterNodeRecord {
+    float boundsMin[3];
+    float boundsMax[3];
+    float error;
+    int32_t firstChild;
+    int32_t childCount;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t reserved;
+    uint64_t offset;
+};
+
+struct PageVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+};
+static_assert(sizeof(PageVertex) * ClusterStreamer::PAGE_VERTICES == ClusterStreamer::SLOT_VERTEX_BYTES, "槽位大小需与页顶点格式一致");
+
+static const uint32_t CLUSTER_MAGIC = 0x43335748;   // "HW3C"
+static const uint32_t CLUSTER_VERSION = 1;
+
+static bool readHeader(const std::string& path, ClusterFileHeader& header) {
+    std::ifstream f(path, std::ios::binary);
+    return f.read((char*)&header, sizeof(header)) && header.magic == CLUSTER_MAGIC && header.version == CLUSTER_VERSION
+        && header.pageTriangles == ClusterStreamer::PAGE_TRIANGLES && header.pageVertices == ClusterStreamer::PAGE_VERTICES
+        && header.proxyGrid == ClusterStreamer::PROXY_GRID;
+}
+
+static void sourceStamp(const std::string& source, uint64_t& size, int64_t& time) {
+    std::error_code ec;
+    size = fs::file_size(source, ec);
+    if (ec) size = 0;
+    time = ec ? 0 : (int64_t)fs::last_write_time(source, ec).time_since_epoch().count();
+}
+
+bool clusterFileUpToDate(const std::string& source, const std::string& clusterPath) {
+    ClusterFileHeader header;
+    if (!readHeader(clusterPath, header)) return false;
+    std::error_code ec;
+    if (!fs::exists(source, ec)) return true;
+    uint64_t size;
+    int64_t time;
+    sourceStamp(source, size, time);
+    return header.sourceSize == size && header.sourceTime == time;
+}
+
+// ===================== 分页输入（临时文件） =====================
+// 三角形的每个角带上全局顶点编号与顶点数据，拆分、求包围盒与聚类都只需顺序读这一个文件
+struct SpillCorner {
+    uint32_t id;
+    PageVertex vertex;
+};
+struct SpillTriangle {
+    SpillCorner corners[3];
+};
+
+ClusterInput::ClusterInput(const std::string& tempDir) : dir(tempDir) {
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir, ec);
+    vertexFile.open(vertexPath(), std::ios::binary | std::ios::trunc);
+    triangleFile.open(trianglePath(), std::ios::binary | std::ios::trunc);
+}
+
+ClusterInput::~ClusterInput() {
+    vertexFile.close();
+    triangleFile.close();
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+}
+
+void ClusterInput::addMesh(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+                           const std::vector<unsigned int>& indices) {
+    uint32_t base = vertexCount;
+    for (size_t v = 0; v < positions.size(); v++) {
+        PageVertex vertex = { positions[v], normals[v] };
+        vertexFile.write((const char*)&vertex, sizeof(vertex));
+        boundsMin = glm::min(boundsMin, positions[v]);
+        boundsMax = glm::max(boundsMax, positions[v]);
+    }
+    vertexCount += (uint32_t)positions.size();
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        SpillTriangle tri;
+        for (int k = 0; k < 3; k++) tri.corners[k] = { base + indices[t + k], { positions[indices[t + k]], normals[indices[t + k]] } };
+        triangleFile.write((const char*)&tri, sizeof(tri));
+        triangleCount++;
+    }
+}
+
+bool ClusterInput::finish() {
+    vertexFile.close();
+    triangleFile.close();
+    return !vertexFile.fail() && !triangleFile.fail() && vertexCount > 0 && triangleCount > 0;
+}
+
+// ===================== 离线分页 =====================
+namespace {
+
+// 按块顺序读取临时文件中的定长记录；fn 返回 false 时提前结束（结果为 false）
+template <typename T, typename F>
+bool forEachRecord(const std::string& path, F&& fn) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    std::vector<T> chunk(4096);
+    while (f) {
+        f.read((char*)chunk.data(), (std::streamsize)(chunk.size() * sizeof(T)));
+        size_t count = (size_t)f.gcount() / sizeof(T);
+        for (size_t i = 0; i < count; i++)
+            if (!fn(chunk[i])) return false;
+    }
+    return f.eof();
+}
+
+// 聚类网格：整个模型的外接立方体按 resolution³ 划分，同一 resolution 下所有节点共用同一套格子
+struct CellSum {
+    glm::vec3 position{ 0.0f };
+    glm::vec3 normal{ 0.0f };
+    uint32_t count = 0;
+};
+
+// 节点的三角形与顶点都在临时文件里，逐层拆分到子节点的文件，内存中只有当前节点的一页与它的聚类格子。
+// 格子取落入其中的全部模型顶点的平均：节点的顶点文件除自身立方体内的顶点外，还带一圈外延（halo），
+// 宽度为三角形顶点到重心的最大距离加 1/HALO_CELLS 个节点边长，本节点三角形碰到的每个格子都完整地落在其中，
+// 所以逐节点求出的平均与整模型的全局网格逐位相同，相邻页的边界顶点仍然重合
+class ClusterBuilder {
+public:
+    // 聚类网格退到每个节点边长不足 HALO_CELLS 格时，外延不再覆盖整个格子（只在三角形极大、一页放不下时发生）
+    static constexpr int HALO_CELLS = 4;
+
+    ClusterBuilder(const std::string& tempDir, const glm::vec3& boundsMin, const glm::vec3& boundsMax) : dir(tempDir) {
+        cubeMin = boundsMin;
+        glm::vec3 extent = boundsMax - boundsMin;
+        cubeSize = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f)) * 1.0001f;
+    }
+
+    // 节点按层序处理，子节点连续追加在 records 末尾；每页算好后立即写入文件，处理完的节点删除其临时文件
+    bool build(std::ofstream& f, std::vector<ClusterNodeRecord>& records, const std::string& triangles,
+               const std::string& vertices, uint64_t triangleCount) {
+        std::vector<Pending> current(1), next;
+        current[0] = { cubeMin, cubeSize, 0, triangles, vertices, triangleCount };
+        records.resize(1);
+
+        int first = 0;
+        for (int level = 0; !current.empty(); level++) {
+            int firstNext = first + (int)current.size();
+            for (size_t i = 0; i < current.size(); i++) {
+                Pending& node = current[i];
+                ClusterNodeRecord& record = records[first + i];
+                record = ClusterNodeRecord();
+                record.firstChild = -1;
+                glm::vec3 boundsMin(1e30f), boundsMax(-1e30f);
+                float reach = 0.0f;   // 顶点到所在三角形重心的最大轴向距离，决定子节点的外延
+                bool ok = forEachRecord<SpillTriangle>(node.triangles, [&](const SpillTriangle& t) {
+                    glm::vec3 c = centroid(t);
+                    for (int k = 0; k < 3; k++) {
+                        const glm::vec3& p = t.corners[k].vertex.position;
+                        boundsMin = glm::min(boundsMin, p);
+                        boundsMax = glm::max(boundsMax, p);
+                        glm::vec3 d = glm::abs(p - c);
+                        reach = std::max(reach, std::max(d.x, std::max(d.y, d.z)));
+                    }
+                    return true;
+                });
+                if (!ok) return false;
+                for (int k = 0; k < 3; k++) {
+                    record.boundsMin[k] = boundsMin[k];
+                    record.boundsMax[k] = boundsMax[k];
+                }
+
+                std::vector<PageVertex> vertices;
+                std::vector<uint16_t> pageIndices;
+                bool leaf = extractOriginal(node, vertices, pageIndices);
+                if (!leaf) {
+                    // 代理：按本层的网格聚类，放不进一页时逐次减半网格
+                    int resolution = ClusterStreamer::PROXY_GRID << level;
+                    while (!simplify(node, resolution, vertices, pageIndices) && resolution > 1) resolution /= 2;
+                    record.error = cubeSize / resolution * std::sqrt(3.0f);
+                    if (level >= ClusterStreamer::MAX_DEPTH) leaf = true;
+                }
+
+                if (!leaf) {
+                    int before = (int)next.size();
+                    if (!split(node, reach, next)) return false;
+                    record.firstChild = firstNext + before;
+                    record.childCount = (int)next.size() - before;
+                }
+                std::error_code ec;
+                fs::remove(node.triangles, ec);
+                fs::remove(node.vertices, ec);
+
+                record.offset = (uint64_t)f.tellp();
+                record.vertexCount = (uint32_t)vertices.size();
+                record.indexCount = (uint32_t)pageIndices.size();
+                f.write((const char*)vertices.data(), vertices.size() * sizeof(PageVertex));
+                f.write((const char*)pageIndices.data(), pageIndices.size() * sizeof(uint16_t));
+                if (!f) return false;
+            }
+            first = firstNext;
+            records.resize(first + next.size());
+            current.swap(next);
+            next.clear();
+        }
+        return true;
+    }
+
+    glm::vec3 cubeMin;
+    float cubeSize;
+
+private:
+    struct Pending {
+        glm::vec3 cellMin;       // 节点在八叉树中的立方体
+        float size;
+        int level;
+        std::string triangles;   // 重心落在立方体内的三角形（SpillTriangle）
+        std::string vertices;    // 立方体加外延内的全部模型顶点（PageVertex），按全局编号递增
+        uint64_t triangleCount;
+    };
+    std::string dir;
+    int fileCounter = 0;
+
+    static glm::vec3 centroid(const SpillTriangle& t) {
+        return (t.corners[0].vertex.position + t.corners[1].vertex.position + t.corners[2].vertex.position) / 3.0f;
+    }
+
+    // 按三角形重心分到 8 个子立方体，子节点按卦限顺序追加到 next，空的子立方体不建节点
+    bool split(const Pending& node, float reach, std::vector<Pending>& next) {
+        float half = node.size * 0.5f;
+        std::string triPaths[8], vtxPaths[8];
+        std::ofstream triFiles[8];
+        uint64_t counts[8] = {};
+        bool ok = forEachRecord<SpillTriangle>(node.triangles, [&](const SpillTriangle& t) {
+            glm::vec3 local = centroid(t) - node.cellMin;
+            int o = (local.x >= half ? 1 : 0) | (local.y >= half ? 2 : 0) | (local.z >= half ? 4 : 0);
+            if (!triFiles[o].is_open()) {
+                triPaths[o] = tempPath(".tri");
+                triFiles[o].open(triPaths[o], std::ios::binary | std::ios::trunc);
+            }
+            triFiles[o].write((const char*)&t, sizeof(t));
+            counts[o]++;
+            return (bool)triFiles[o];
+        });
+        for (int o = 0; o < 8; o++) {
+            if (!counts[o]) continue;
+            triFiles[o].close();
+            ok = ok && !triFiles[o].fail();
+        }
+        if (!ok) return false;
+
+        // 顶点按子立方体加外延分发，同一顶点可能进入多个子节点
+        glm::vec3 boxMin[8], boxMax[8];
+        std::ofstream vtxFiles[8];
+        float margin = (reach + half / HALO_CELLS) * 1.001f + cubeSize * 1e-5f;
+        for (int o = 0; o < 8; o++) {
+            if (!counts[o]) continue;
+            glm::vec3 cellMin = node.cellMin + glm::vec3(o & 1 ? half : 0.0f, o & 2 ? half : 0.0f, o & 4 ? half : 0.0f);
+            boxMin[o] = cellMin - glm::vec3(margin);
+            boxMax[o] = cellMin + glm::vec3(half + margin);
+            vtxPaths[o] = tempPath(".vtx");
+            vtxFiles[o].open(vtxPaths[o], std::ios::binary | std::ios::trunc);
+        }
+        ok = forEachRecord<PageVertex>(node.vertices, [&](const PageVertex& v) {
+            const glm::vec3& p = v.position;
+            for (int o = 0; o < 8; o++) {
+                if (!counts[o]) continue;
+                bool inside = p.x >= boxMin[o].x && p.y >= boxMin[o].y && p.z >= boxMin[o].z
+                           && p.x <= boxMax[o].x && p.y <= boxMax[o].y && p.z <= boxMax[o].z;
+                if (inside && !vtxFiles[o].write((const char*)&v, sizeof(v))) return false;
+            }
+            return true;
+        });
+        for (int o = 0; o < 8; o++) {
+            if (!counts[o]) continue;
+            vtxFiles[o].close();
+            ok = ok && !vtxFiles[o].fail();
+            glm::vec3 cellMin = node.cellMin + glm::vec3(o & 1 ? half : 0.0f, o & 2 ? half : 0.0f, o & 4 ? half : 0.0f);
+            next.push_back({ cellMin, half, node.level + 1, triPaths[o], vtxPaths[o], counts[o] });
+        }
+        return ok;
+    }
+
+    std::string tempPath(const char* extension) {
+        return (fs::path(dir) / ("node" + std::to_string(fileCounter++) + extension)).string();
+    }
+
+    // 原始三角形能放进一页时直接作为叶节点
+    bool extractOriginal(const Pending& node, std::vector<PageVertex>& vertices, std::vector<uint16_t>& pageIndices) {
+        if (node.triangleCount > (uint64_t)ClusterStreamer::PAGE_TRIANGLES) return false;
+        std::unordered_map<uint32_t, uint16_t> remap;
+        vertices.clear();
+        pageIndices.clear();
+        return forEachRecord<SpillTriangle>(node.triangles, [&](const SpillTriangle& t) {
+            for (int k = 0; k < 3; k++) {
+                auto it = remap.find(t.corners[k].id);
+                if (it == remap.end()) {
+                    if (vertices.size() >= (size_t)ClusterStreamer::PAGE_VERTICES) return false;
+                    it = remap.emplace(t.corners[k].id, (uint16_t)vertices.size()).first;
+                    vertices.push_back(t.corners[k].vertex);
+                }
+                pageIndices.push_back(it->second);
+            }
+            return true;
+        });
+    }
+
+    uint64_t cellKey(const glm::vec3& p, int resolution) const {
+        glm::vec3 f = (p - cubeMin) / cubeSize * (float)resolution;
+        uint64_t x = (uint64_t)std::min(std::max((int)f.x, 0), resolution - 1);
+        uint64_t y = (uint64_t)std::min(std::max((int)f.y, 0), resolution - 1);
+        uint64_t z = (uint64_t)std::min(std::max((int)f.z, 0), resolution - 1);
+        return z << 42 | y << 21 | x;
+    }
+
+    // 节点顶点文件（立方体加外延）中的格子平均，只保存本节点三角形碰到的格子
+    bool cellMap(const Pending& node, int resolution, std::unordered_map<uint64_t, CellSum>& map) {
+        map.clear();
+        bool ok = forEachRecord<SpillTriangle>(node.triangles, [&](const SpillTriangle& t) {
+            for (int k = 0; k < 3; k++) map[cellKey(t.corners[k].vertex.position, resolution)];
+            return true;
+        });
+        return ok && forEachRecord<PageVertex>(node.vertices, [&](const PageVertex& v) {
+            auto it = map.find(cellKey(v.position, resolution));
+            if (it != map.end()) {
+                it->second.position += v.position;
+                it->second.normal += v.normal;
+                it->second.count++;
+            }
+            return true;
+        });
+    }
+
+    // 顶点聚类：三角形的三个顶点换成所在格子的代表点，落在同一格子里的退化三角形去掉；超出一页时返回 false
+    bool simplify(const Pending& node, int resolution, std::vector<PageVertex>& vertices, std::vector<uint16_t>& pageIndices) {
+        std::unordered_map<uint64_t, CellSum> map;
+        std::unordered_map<uint64_t, uint16_t> remap;
+        vertices.clear();
+        pageIndices.clear();
+        if (!cellMap(node, resolution, map)) return false;
+        return forEachRecord<SpillTriangle>(node.triangles, [&](const SpillTriangle& t) {
+            uint64_t keys[3];
+            for (int k = 0; k < 3; k++) keys[k] = cellKey(t.corners[k].vertex.position, resolution);
+            if (keys[0] == keys[1] || keys[1] == keys[2] || keys[0] == keys[2]) return true;
+            if (pageIndices.size() + 3 > (size_t)ClusterStreamer::PAGE_TRIANGLES * 3) return false;
+            for (int k = 0; k < 3; k++) {
+                auto it = remap.find(keys[k]);
+                if (it == remap.end()) {
+                    if (vertices.size() >= (size_t)ClusterStreamer::PAGE_VERTICES) return false;
+                    const CellSum& cell = map.at(keys[k]);
+                    glm::vec3 normal = glm::length(cell.normal) > 0.0f ? glm::normalize(cell.normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+                    it = remap.emplace(keys[k], (uint16_t)vertices.size()).first;
+                    vertices.push_back({ cell.position / (float)cell.count, normal });
+                }
+                pageIndices.push_back(it->second);
+            }
+            return true;
+        });
+    }
+};
+
+} // namespace
+
+bool buildClusterFile(const std::string& source, const std::string& clusterPath, ClusterInput& input) {
+    if (!input.finish()) return false;
+    auto start = std::chrono::steady_clock::now();
+
+    std::error_code ec;
+    fs::path dir = fs::path(clusterPath).parent_path();
+    if (!dir.empty()) fs::create_directories(dir, ec);
+    std::ofstream f(clusterPath, std::ios::binary | std::ios::trunc);
+    if (!f) return false;
+    ClusterFileHeader header = {};
+    f.write((const char*)&header, sizeof(header));
+
+    ClusterBuilder builder(input.dir, input.boundsMin, input.boundsMax);
+    std::vector<ClusterNodeRecord> records;
+    if (!builder.build(f, records, input.trianglePath(), input.vertexPath(), input.triangleCount)) return false;
+
+    header.magic = CLUSTER_MAGIC;
+    header.version = CLUSTER_VERSION;
+    sourceStamp(source, header.sourceSize, header.sourceTime);
+    header.tableOffset = (uint64_t)f.tellp();
+    header.nodeCount = (int32_t)records.size();
+    header.pageTriangles = ClusterStreamer::PAGE_TRIANGLES;
+    header.pageVertices = ClusterStreamer::PAGE_VERTICES;
+    header.proxyGrid = ClusterStreamer::PROXY_GRID;
+    for (int k = 0; k < 3; k++) {
+        header.boundsMin[k] = records[0].boundsMin[k];
+        header.boundsMax[k] = records[0].boundsMax[k];
+    }
+    f.write((const char*)records.data(), records.size() * sizeof(ClusterNodeRecord));
+    f.seekp(0);
+    f.write((const char*)&header, sizeof(header));
+    if (!f) return false;
+
+    int leaves = 0;
+    for (const ClusterNodeRecord& r : records) leaves += r.childCount == 0 ? 1 : 0;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[ooc] 分页完成：" << input.triangleCount << " 个三角形 → " << records.size() << " 页（叶节点 " << leaves
+              << "），" << header.tableOffset / (1024.0 * 1024.0) << " MB，耗时 " << ms << " ms" << std::endl;
+    return true;
+}
+
+// ===================== 打开 / 关闭 =====================
+size_t ClusterStreamer::pageBytes(const Node& node) const {
+    return node.vertexCount * sizeof(PageVertex) + node.indexCount * sizeof(uint16_t);
+}
+
+bool ClusterStreamer::open(const std::string& clusterPath, uint64_t gpuBytes, uint64_t hostLimit) {
+    ClusterFileHeader header;
+    if (!readHeader(clusterPath, header) || header.nodeCount <= 0) {
+        std::cerr << "[ooc] 簇文件无效：" << clusterPath << std::endl;
+        return false;
+    }
+    std::ifstream f(clusterPath, std::ios::binary);
+    std::vector<ClusterNodeRecord> records(header.nodeCount);
+    f.seekg((std::streamoff)header.tableOffset);
+    if (!f.read((char*)records.data(), records.size() * sizeof(ClusterNodeRecord))) return false;
+
+    nodes.resize(records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        const ClusterNodeRecord& r = records[i];
+        Node& n = nodes[i];
+        n.boundsMin = glm::vec3(r.boundsMin[0], r.boundsMin[1], r.boundsMin[2]);
+        n.boundsMax = glm::vec3(r.boundsMax[0], r.boundsMax[1], r.boundsMax[2]);
+        n.error = r.error;
+        n.firstChild = r.firstChild;
+        n.childCount = r.childCount;
+        n.vertexCount = r.vertexCount;
+        n.indexCount = r.indexCount;
+        n.offset = r.offset;
+    }
+    rootMin = nodes[0].boundsMin;
+    rootMax = nodes[0].boundsMax;
+    gMemory.trackHost("cluster_nodes", (int64_t)(nodes.size() * sizeof(Node)));
+
+    // 缓冲池：所有槽位共用一个 VBO / EBO
+    uint64_t slotBytes = SLOT_VERTEX_BYTES + SLOT_INDEX_BYTES;
+    int slots = (int)std::min<uint64_t>(std::max<uint64_t>(gpuBytes / slotBytes, MIN_SLOTS), nodes.size());
+    slotNode.assign(slots, -1);
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(slots * SLOT_VERTEX_BYTES), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(slots * SLOT_INDEX_BYTES), nullptr, GL_DYNAMIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PageVertex), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(PageVertex), (void*)offsetof(PageVertex, normal));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // 根节点同步读入并常驻，之后任何时候都至少有整个模型的粗糙代理可画
+    std::vector<uint8_t> root(pageBytes(nodes[0]));
+    f.seekg((std::streamoff)nodes[0].offset);
+    if (!f.read((char*)root.data(), root.size())) {
+        close();
+        return false;
+    }
+    upload(0, root.data(), allocateSlot());
+
+    path = clusterPath;
+    hostBytes = hostLimit;
+    quit = false;
+    loader = std::thread(&ClusterStreamer::loaderMain, this);
+    stats.nodes = (int)nodes.size();
+    stats.poolSlots = slots;
+    std::cout << "[ooc] " << nodes.size() << " 页，缓冲池 " << slots << " 个槽位（" << slots * slotBytes / (1024.0 * 1024.0)
+              << " MB），读入上限 " << hostBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+    return true;
+}
+
+void ClusterStreamer::close() {
+    if (loader.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        loader.join();
+    }
+    gMemory.trackHost("cluster_staging", -(int64_t)stagingBytes);
+    gMemory.trackHost("cluster_nodes", -(int64_t)(nodes.size() * sizeof(Node)));
+    stagingBytes = 0;
+    loaded.clear();
+    queue.clear();
+    requested.clear();
+    nodes.clear();
+    slotNode.clear();
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+    vao = vbo = ebo = 0;
+}
+
+// ===================== 读盘线程 =====================
+void ClusterStreamer::loaderMain() {
+    std::ifstream file(path, std::ios::binary);
+    while (true) {
+        int index;
+        size_t bytes;
+        {
+            // 已读入未上传的页达到上限时等待主线程上传（单页超过上限时仍允许读，否则会卡死）
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() {
+                return quit || (!queue.empty() && (stagingBytes == 0 || stagingBytes + pageBytes(nodes[queue.front()]) <= hostBytes));
+            });
+            if (quit) return;
+            index = queue.front();
+            queue.erase(queue.begin());
+            bytes = pageBytes(nodes[index]);
+            stagingBytes += bytes;
+            stats.stagingPeak = std::max(stats.stagingPeak, stagingBytes);
+        }
+        gMemory.trackHost("cluster_staging", (int64_t)bytes);
+
+        LoadedPage page{ index, std::vector<uint8_t>(bytes) };
+        file.seekg((std::streamoff)nodes[index].offset);
+        file.read((char*)page.data.data(), page.data.size());
+        if (!file) {
+            file.clear();
+            gMemory.trackHost("cluster_staging", -(int64_t)bytes);
+            std::lock_guard<std::mutex> lock(mutex);
+            requested.erase(index);
+            stagingBytes -= bytes;
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded.push_back(std::move(page));
+    }
+}
+
+// ===================== 缓冲池 =====================
+// 空闲槽位优先；否则淘汰上一帧没有用到的页中最久未用的一页，根节点不淘汰
+int ClusterStreamer::allocateSlot() {
+    int victim = -1;
+    for (int s = 0; s < (int)slotNode.size(); s++) {
+        int n = slotNode[s];
+        if (n < 0) return s;
+        if (n == 0 || nodes[n].lastUsed + 1 >= frame) continue;
+        if (victim < 0 || nodes[n].lastUsed < nodes[slotNode[victim]].lastUsed) victim = s;
+    }
+    if (victim >= 0) {
+        nodes[slotNode[victim]].slot = -1;
+        slotNode[victim] = -1;
+        stats.evictions++;
+    }
+    return victim;
+}
+
+void ClusterStreamer::upload(int index, const uint8_t* data, int slot) {
+    Node& node = nodes[index];
+    size_t vertexBytes = node.vertexCount * sizeof(PageVertex);
+    // GL_COPY_WRITE_BUFFER 不影响 VAO 记录的索引缓冲绑定
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(slot * SLOT_VERTEX_BYTES), (GLsizeiptr)vertexBytes, data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(slot * SLOT_INDEX_BYTES), (GLsizeiptr)(node.indexCount * sizeof(uint16_t)),
+                    data + vertexBytes);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    node.slot = slot;
+    node.lastUsed = frame;
+    slotNode[slot] = index;
+}
+
+// ===================== 每帧 =====================
+void ClusterStreamer::beginFrame() {
+    frame++;
+    stats.drawnPages = stats.proxyPages = 0;
+    stats.triangles = 0;
+    wants.clear();
+
+    // 上传读好的页；超出本帧配额的留到下一帧
+    std::vector<LoadedPage> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        int n = std::min((int)loaded.size(), MAX_UPLOADS);
+        ready.assign(std::make_move_iterator(loaded.begin()), std::make_move_iterator(loaded.begin() + n));
+        loaded.erase(loaded.begin(), loaded.begin() + n);
+        for (const LoadedPage& p : ready) requested.erase(p.node);
+    }
+    if (ready.empty()) return;
+    size_t released = 0;
+    for (const LoadedPage& p : ready) {
+        released += p.data.size();
+        if (nodes[p.node].slot >= 0) continue;
+        int slot = allocateSlot();
+        if (slot < 0) {
+            stats.dropped++;
+            continue;
+        }
+        upload(p.node, p.data.data(), slot);
+        stats.pagesStreamed++;
+        stats.bytesStreamed += p.data.size();
+    }
+    gMemory.trackHost("cluster_staging", -(int64_t)released);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stagingBytes -= released;
+    }
+    wake.notify_all();
+}
+
+float ClusterStreamer::screenError(const Node& node, const glm::vec3& cameraLocal, float pixelsPerUnit) const {
+    glm::vec3 d = glm::max(glm::max(node.boundsMin - cameraLocal, cameraLocal - node.boundsMax), glm::vec3(0.0f));
+    return node.error * pixelsPerUnit / std::max(glm::length(d), 1e-4f);
+}
+
+void ClusterStreamer::select(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight,
+                             std::vector<ClusterDraw>& out) {
+    // 在模型局部空间遍历：误差与距离同在局部空间，（均匀）缩放相互抵消
+    glm::vec3 cameraWorld = glm::vec3(glm::inverse(view)[3]);
+    glm::vec3 cameraLocal = glm::vec3(glm::inverse(model) * glm::vec4(cameraWorld, 1.0f));
+    Frustum frustum = Frustum::fromMatrix(projection * view * model);
+    float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+    visit(0, cameraLocal, frustum, pixelsPerUnit, out);
+}
+
+void ClusterStreamer::visit(int index, const glm::vec3& cameraLocal, const Frustum& frustum, float pixelsPerUnit,
+                            std::vector<ClusterDraw>& out) {
+    Node& node = nodes[index];
+    if (!frustum.intersects(node.boundsMin, node.boundsMax)) return;
+    node.lastUsed = frame;
+
+    float error = screenError(node, cameraLocal, pixelsPerUnit);
+    bool refine = node.childCount > 0 && error > errorPixels;
+    if (refine) {
+        // 视锥内的子节点全部驻留才细分；缺的页按各自的屏幕空间误差排优先级，
+        // 已驻留的兄弟节点同样标记为使用中，等待期间不会被淘汰
+        bool ready = true;
+        for (int c = node.firstChild; c < node.firstChild + node.childCount; c++) {
+            Node& child = nodes[c];
+            if (!frustum.intersects(child.boundsMin, child.boundsMax)) continue;
+            if (child.slot >= 0) {
+                child.lastUsed = frame;
+                continue;
+            }
+            ready = false;
+            wants.push_back({ c, screenError(child, cameraLocal, pixelsPerUnit) });
+        }
+        if (ready) {
+            for (int c = node.firstChild; c < node.firstChild + node.childCount; c++) visit(c, cameraLocal, frustum, pixelsPerUnit, out);
+            return;
+        }
+    }
+
+    if (node.indexCount == 0) return;
+    glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+    out.push_back({ (GLsizei)node.indexCount, node.slot * SLOT_INDEX_BYTES, node.slot * PAGE_VERTICES,
+                    glm::length(center - cameraLocal) });
+    stats.drawnPages++;
+    if (refine) stats.proxyPages++;
+    stats.triangles += node.indexCount / 3;
+}
+
+void ClusterStreamer::endFrame() {
+    // 可用槽位：空闲的，加上本帧没有用到的；没有可用槽位时不再提交，画面停留在已驻留的代理上
+    int available = 0;
+    for (int n : slotNode) {
+        if (n < 0 || (n != 0 && nodes[n].lastUsed < frame)) available++;
+    }
+    std::sort(wants.begin(), wants.end(), [](const Want& a, const Want& b) { return a.priority > b.priority; });
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // 还没开始读的页按本帧的优先级重新排
+        for (int n : queue) requested.erase(n);
+        queue.clear();
+        int budget = std::min(MAX_REQUESTS, available - (int)requested.size());
+        if (budget <= 0 && !wants.empty()) stats.poolFullFrames++;
+        for (const Want& w : wants) {
+            if ((int)queue.size() >= budget) break;
+            if (requested.count(w.node)) continue;
+            queue.push_back(w.node);
+            requested.insert(w.node);
+        }
+        stats.pending = (int)requested.size();
+    }
+    wake.notify_all();
+
+    stats.resident = 0;
+    for (int n : slotNode) stats.resident += n >= 0 ? 1 : 0;
+    stats.frames++;
+    stats.pagesDrawnTotal += stats.drawnPages;
+    stats.proxyPagesTotal += stats.proxyPages;
+    stats.trianglesTotal += stats.triangles;
+}
+
+void ClusterStreamer::draw(const std::vector<ClusterDraw>& draws) const {
+    glBindVertexArray(vao);
+    for (const ClusterDraw& d : draws) {
+        glDrawElementsBaseVertex(GL_TRIANGLES, d.count, GL_UNSIGNED_SHORT, (const void*)d.indexOffset, d.baseVertex);
+    }
+    glBindVertexArray(0);
+}
+
+void ClusterStreamer::printStats() const {
+    uint64_t frames = std::max<uint64_t>(stats.frames, 1);
+    std::cout << "[ooc] 驻留 " << stats.resident << " / " << stats.poolSlots << " 槽位（共 " << stats.nodes << " 页），累计流入 "
+              << stats.pagesStreamed << " 页（" << stats.bytesStreamed / (1024.0 * 1024.0) << " MB），淘汰 " << stats.evictions
+              << "，丢弃 " << stats.dropped << "；每帧平均绘制 " << (double)stats.pagesDrawnTotal / frames << " 页、"
+              << (double)stats.trianglesTotal / frames << " 个三角形，其中代理 "
+              << (stats.pagesDrawnTotal ? 100.0 * stats.proxyPagesTotal / stats.pagesDrawnTotal : 0.0) << "%；读入峰值 "
+              << stats.stagingPeak / (1024.0 * 1024.0) << " MB，缓冲池满 " << stats.poolFullFrames << " 帧" << std::endl;
+}
@@ -11,6 +11,27 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include "lightbake.h"
+#include "scene_graph.h"
+#include "skeletal_animation.h"
+#include "cluster_streaming.h"
+#include "../Common/profiler.h"
+#include "../Common/replay.h"
+#include "../Common/benchmark.h"
+#include "../Common/shadermanager.h"
+#include "../Common/streambuffer.h"
+#include "../Common/renderqueue.h"
+#include "../Common/memoryregistry.h"
+#include "../Common/framecapture.h"
+#include "../Common/framepacing.h"
 
 // ===================== ȫֳ =====================
 const unsigned int SCR_WIDTH = 1280;
@@ -54,12 +75,79 @@ float lastY = SCR_HEIGHT / 2.0f;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
+// Ƿʹú決գBлعնԱȣƤģģʽûк決ݣл
+bool useBakedLighting = true;
+bool lightingBaked = false;
+
+// ÿ֡ / ÿλƳĬдʽλ岢ƫư󶨵 lighting.vs/.fs  FrameBlock / DrawBlock
+// --no-stream ص setMat4/setVec3std140 ֣GLSL  bool ռ 4 ֽ
+struct FrameConstants {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 viewPos;
+    int32_t useBakedLighting;
+};
+static_assert(sizeof(FrameConstants) == 144, "FrameConstants  FrameBlock  std140 һ");
+struct DrawConstants {
+    glm::mat4 model;
+    glm::mat4 normalMatrix;   //  33 Ϊ߾std140  mat3 ÿҪ뵽 vec4ֱ mat4
+};
+// Ƥģ͵ DrawBlock  Animator ľ飬ǰ HEADER  mat4  DrawConstants ͬ
+static_assert(sizeof(DrawConstants) == Animator::HEADER * sizeof(glm::mat4), "DrawConstants  Animator ͷһ");
+
+// ȾУÿΪưύ VAO ִУ--immediate ص󶨡ơ--no-stream ʱͬƣ
+// --grid N  NN ڷ NN ģͣڶԱ϶ʱÿ֡״̬л
+int gridSize = 1;
+
+// ͼ--grid ÿģͰģĽڵ㼶һݹҵڵ£뷨߾󻺴ڽڵϣ
+// ֻб仯㣻ÿڵΧ׶޳--no-cull رգ
+bool sceneCulling = true;
+
+// ģļ--model 滻ĬϵĲģͣ FBX / glTF ɫÿʵ Animator ڹ߳
+// ɫƤ--anim-threads N ָ߳ĬӲ߳ - 1
+std::string modelPath = "E:/OpenGLLearning/OpenGLHW02/Resources/teapot.obj";
+unsigned animThreads = 0;
+
+// ģʽ--out-of-coreģ߷ҳ <ģ>.clustersʱĻռҳ̶СĻأ
+// ٴ Model cluster_streaming.h--ooc-gpu-mb / --ooc-host-mb Ϊ뻺Ӳޣ--ooc-error Ϊֵأ
+bool outOfCore = false;
+uint64_t oocGpuBytes = 256ull * 1024 * 1024;
+uint64_t oocHostBytes = 64ull * 1024 * 1024;
+float oocErrorPixels = 1.0f;
+
+// ͼ--batch <Ŀ¼|嵥>뽻ѭΪģͿȾת̨ͼ runBatch
+// --batch-out Ŀ¼--views N ÿģ͵ӽ--thumb WxH ͼߴ磬--batch-threads N ߳ĬӲ߳ - 1
+std::string batchInput;
+std::string batchOutput = "thumbnails";
+int batchViews = 8;
+int thumbWidth = 256;
+int thumbHeight = 256;
+unsigned batchThreads = 0;
+
+// ģͿռΧģġΧ뾶ʼӵ
+void setModelBounds(const glm::vec3& minPos, const glm::vec3& maxPos) {
+    // ģ
+    modelCenter = (minPos + maxPos) * 0.5f;
+    // Χ뾶
+    modelRadius = glm::length(maxPos - minPos) * 0.5f;
+    // ʼӵ
+    mc_Distance = modelRadius * 2.0f;
+    vc_CameraPos = modelCenter + glm::vec3(0.0f, 0.0f, modelRadius * 2.0f);
+}
+
+// aiMatrix4x4 Ϊתú glm 
+glm::mat4 toGlm(const aiMatrix4x4& t) {
+    return glm::mat4(glm::vec4(t.a1, t.b1, t.c1, t.d1), glm::vec4(t.a2, t.b2, t.c2, t.d2),
+                     glm::vec4(t.a3, t.b3, t.c3, t.d3), glm::vec4(t.a4, t.b4, t.c4, t.d4));
+}
+
 // ===================== ɫ =====================
 class Shader {
 public:
     unsigned int ID;
 
-    Shader(const char* vertexPath, const char* fragmentPath) {
+    // defines ɫ壨Դƻ gShaders 
+    Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines = ShaderDefines()) {
         // 1. ȡɫļ
         std::string vertexCode;
         std::string fragmentCode;
@@ -83,31 +171,13 @@ public:
         catch (std::ifstream::failure& e) {
             std::cout << "ERROR::SHADER::FILE_NOT_READ: " << e.what() << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-
-        // 2. 붥ɫ
-        unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &vShaderCode, NULL);
-        glCompileShader(vertexShader);
-        checkCompileErrors(vertexShader, "VERTEX");
 
-        // 3. Ƭɫ
-        unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
-        glCompileShader(fragmentShader);
-        checkCompileErrors(fragmentShader, "FRAGMENT");
-
-        // 4. ɫ
-        ID = glCreateProgram();
-        glAttachShader(ID, vertexShader);
-        glAttachShader(ID, fragmentShader);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-
-        // 5. ɾʱɫ
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
+        // 2. 벢ӣлʱֱӼسƣʧʱ ID Ϊ 0
+        std::string name = fragmentPath;
+        name = name.substr(name.find_last_of("/\\") + 1);
+        name = name.substr(0, name.find('.'));
+        MemoryAssetScope asset(name + "_shader");
+        ID = gShaders.build({ name, vertexCode, fragmentCode, defines });
     }
 
     // ɫ
@@ -132,27 +202,6 @@ public:
     void setMat4(const std::string& name, const glm::mat4& mat) const {
         glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
     }
-
-private:
-    // ɫ/Ӵ
-    void checkCompileErrors(unsigned int shader, std::string type) {
-        int success;
-        char infoLog[512];
-        if (type != "PROGRAM") {
-            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-            if (!success) {
-                glGetShaderInfoLog(shader, 512, NULL, infoLog);
-                std::cout << "ERROR::SHADER_COMPILE_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-            }
-        }
-        else {
-            glGetProgramiv(shader, GL_LINK_STATUS, &success);
-            if (!success) {
-                glGetProgramInfoLog(shader, 512, NULL, infoLog);
-                std::cout << "ERROR::PROGRAM_LINK_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-            }
-        }
-    }
 };
 
 // ===================== 񶥵ṹ =====================
@@ -160,6 +209,13 @@ struct Vertex {
     glm::vec3 Position;  // λ
     glm::vec3 Normal;    // 㷨
     glm::vec2 TexCoords; // 
+    // 決ݣ lightbake.h  BakedVertex ˵
+    glm::vec3 BakedDiffuse = glm::vec3(0.0f);
+    glm::vec3 BakedLightDir = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 BakedSpecular = glm::vec3(0.0f);
+    // 4 ±ȨأȨذ 8 λţΪ 255޶ģȫΪ 0 ɫȡ
+    uint8_t BoneIds[4] = { 0, 0, 0, 0 };
+    uint8_t BoneWeights[4] = { 0, 0, 0, 0 };
 };
 
 // =====================  =====================
@@ -167,12 +223,17 @@ class Mesh {
 public:
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    unsigned int VAO, VBO, EBO;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
 
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices) {
+    // upload Ϊ false ʱֻ CPU ݣģʽڹ߳ϵ룩̵֮߳ upload()
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, bool upload = true) {
         this->vertices = vertices;
         this->indices = indices;
-        setupMesh();
+        if (upload) setupMesh();
+    }
+
+    void upload() {
+        if (VAO == 0) setupMesh();
     }
 
     // 
@@ -182,9 +243,39 @@ public:
         glBindVertexArray(0);
     }
 
+    // ΪưύȾУpacket ó볣VAO İ󶨽еӰ״̬ȥ
+    void Submit(RenderQueue& queue, DrawPacket packet, float depth, float far) {
+        packet.vao = VAO;
+        packet.count = (GLsizei)indices.size();
+        packet.indexType = GL_UNSIGNED_INT;
+        queue.submit(packet, 0, depth, far);
+    }
+
+    // ݣ決ºϴVBO
+    void updateVertexBuffer() {
+        if (vertices.empty()) return;   // ֻеߵǻΪ
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(Vertex), vertices.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // ͷGLMeshֵ Model::meshesͬһ֣Բ
+    void release() {
+        if (VAO == 0) return;
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+        gMemory.trackHost("model_vertices", -(int64_t)hostBytes());
+    }
+
 private:
+    //  CPU ೣפ決ʱдڴ
+    size_t hostBytes() const { return vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int); }
+
     // ʼ񻺳
     void setupMesh() {
+        gMemory.trackHost("model_vertices", (int64_t)hostBytes());
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
@@ -193,11 +284,11 @@ private:
 
         // VBOд붥
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
 
         // EBOд
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
         // öλ
         glEnableVertexAttribArray(0);
@@ -211,6 +302,20 @@ private:
         glEnableVertexAttribArray(2);
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
 
+        // ú決
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, BakedDiffuse));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, BakedLightDir));
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, BakedSpecular));
+
+        // ùԣ±ԣȨعһ [0, 1]
+        glEnableVertexAttribArray(6);
+        glVertexAttribIPointer(6, 4, GL_UNSIGNED_BYTE, sizeof(Vertex), (void*)offsetof(Vertex, BoneIds));
+        glEnableVertexAttribArray(7);
+        glVertexAttribPointer(7, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, BoneWeights));
+
         glBindVertexArray(0);
     }
 };
@@ -220,23 +325,99 @@ class Model {
 public:
     std::vector<Mesh> meshes;
     std::string directory;
+    std::string path;
 
-    // 캯ģ
-    Model(const char* path) {
+    // 캯ģͣĻǵģļ£
+    // upload Ϊ false ʱ GLڹ߳Ϲ죬ɳĵ̵߳ upload()
+    Model(const char* path, bool upload = true) : path(path), uploadMeshes(upload) {
+        MemoryAssetScope asset(assetName());
         loadModel(path);
         calculateModelCenterAndRadius();
     }
 
-    // ģ
-    void Draw(Shader& shader) {
-        for (unsigned int i = 0; i < meshes.size(); i++) {
-            meshes[i].Draw(shader);
-        }
+    void upload() {
+        MemoryAssetScope asset(assetName());
+        for (auto& mesh : meshes) mesh.upload();
+        uploadMeshes = true;
+    }
+
+    ~Model() {
+        for (auto& mesh : meshes) mesh.release();
+    }
+
+    // ģĽڵ㼶Assimp  aiNode  mTransformation񶥵㱣ڵľֲռ䡣
+    // ԭͣģ͸ڵ㣬Ⱦʱ SceneGraph::instantiate Ƶͼ
+    SceneGraph nodes;
+    std::vector<int> meshNodes;   // ÿĽڵ㣨nodes е±꣩
+    // 붯ƬΣ skeletal_animation.hйģƤ·
+    Skeleton skeleton;
+    std::vector<AnimationClip> clips;
+    bool animated() const { return skeleton.size() > 0; }
+
+    // ȡģϢģͿռ䣨ڵ任󣩵İΧСΧ뾶
+    glm::vec3 getModelCenter() { return center; }
+    float getModelRadius() { return radius; }
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    bool loaded() const { return !meshes.empty(); }
+    size_t triangleCount() const {
+        size_t count = 0;
+        for (auto& mesh : meshes) count += mesh.indices.size() / 3;
+        return count;
     }
 
-    // ȡģϢ
-    glm::vec3 getModelCenter() { return modelCenter; }
-    float getModelRadius() { return modelRadius; }
+    // 決̬յɫļģͬĿ¼<ģ>.bake
+    // Դʡ決򼸺һ仯ʹʧЧԶº決
+    // ԴģͿռ䣬Ȱڵ任ģͿռٺ決
+    void bakeLighting(const LightSetup& setup, const BakeOptions& options) {
+        std::vector<glm::vec3> positions, normals;
+        std::vector<unsigned int> indices;
+        for (size_t m = 0; m < meshes.size(); m++) {
+            const Mesh& mesh = meshes[m];
+            const glm::mat4& world = nodes.world(meshNodes[m]);
+            const glm::mat3& normalMat = nodes.normalMatrix(meshNodes[m]);
+            unsigned int base = (unsigned int)positions.size();
+            for (auto& vertex : mesh.vertices) {
+                positions.push_back(glm::vec3(world * glm::vec4(vertex.Position, 1.0f)));
+                normals.push_back(glm::normalize(normalMat * vertex.Normal));
+            }
+            for (auto index : mesh.indices) {
+                indices.push_back(base + index);
+            }
+        }
+
+        std::string cachePath = path + ".bake";
+        uint64_t key = computeBakeKey(setup, options, positions, normals, indices);
+        std::vector<BakedVertex> baked;
+
+        auto start = std::chrono::steady_clock::now();
+        if (loadBakeCache(cachePath, key, positions.size(), baked)) {
+            std::cout << "պ決л " << cachePath << std::endl;
+        }
+        else {
+            baked = bakeVertexLighting(setup, options, positions, normals, indices, radius);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "պ決" << positions.size() << " 㣬ʱ " << ms << " ms" << std::endl;
+            if (!saveBakeCache(cachePath, key, baked)) {
+                std::cout << "պ決дʧ " << cachePath << std::endl;
+            }
+        }
+
+        // дظϴշתؽڵֲռ䣨 = ߾תã
+        // ɫ mat3(model) תռ
+        size_t offset = 0;
+        for (size_t m = 0; m < meshes.size(); m++) {
+            Mesh& mesh = meshes[m];
+            glm::mat3 toLocal = glm::transpose(nodes.normalMatrix(meshNodes[m]));
+            for (auto& vertex : mesh.vertices) {
+                const BakedVertex& b = baked[offset++];
+                vertex.BakedDiffuse = b.diffuse;
+                vertex.BakedLightDir = toLocal * b.lightDir;
+                vertex.BakedSpecular = b.specular;
+            }
+            mesh.updateVertexBuffer();
+        }
+    }
 
 private:
     // ģͣAssimpģ
@@ -256,25 +437,84 @@ private:
         }
         // ȡģĿ¼
         directory = path.substr(0, path.find_last_of('/'));
-        // ݹ鴦нڵ
-        processNode(scene->mRootNode, scene);
+        // жģж㶼Ҫҵϣ processMesh
+        animatedScene = scene->mNumAnimations > 0;
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+            if (scene->mMeshes[i]->HasBones()) animatedScene = true;
+        }
+        // ݹ鴦нڵ㣨ڵӽڵ֮ǰ볡ͼڵģ͸ڵľ
+        processNode(scene->mRootNode, scene, SceneGraph::NO_PARENT);
+        nodes.update();
+        loadAnimations(scene);
+        if (!skeleton.resolve(nodes)) {
+            std::cout << "ֹڽڵ㼶Ҳͬڵ㣬ְ̬" << std::endl;
+        }
+    }
+
+    // ȡƬΣؼ֡ʱ tick 룬ֶͨӦڵ
+    void loadAnimations(const aiScene* scene) {
+        for (unsigned int a = 0; a < scene->mNumAnimations; a++) {
+            const aiAnimation* anim = scene->mAnimations[a];
+            float ticksPerSecond = anim->mTicksPerSecond > 0.0 ? (float)anim->mTicksPerSecond : 25.0f;
+            AnimationClip clip;
+            clip.name = anim->mName.C_Str();
+            clip.duration = (float)anim->mDuration / ticksPerSecond;
+            for (unsigned int c = 0; c < anim->mNumChannels; c++) {
+                const aiNodeAnim* channel = anim->mChannels[c];
+                AnimationChannel out;
+                for (int n = 0; n < nodes.size() && out.node < 0; n++) {
+                    if (nodes.name(n) == channel->mNodeName.C_Str()) out.node = n;
+                }
+                if (out.node < 0) continue;
+                for (unsigned int k = 0; k < channel->mNumPositionKeys; k++) {
+                    const aiVectorKey& key = channel->mPositionKeys[k];
+                    out.positionTimes.push_back((float)key.mTime / ticksPerSecond);
+                    out.positions.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+                }
+                for (unsigned int k = 0; k < channel->mNumRotationKeys; k++) {
+                    const aiQuatKey& key = channel->mRotationKeys[k];
+                    out.rotationTimes.push_back((float)key.mTime / ticksPerSecond);
+                    out.rotations.push_back(glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z));
+                }
+                for (unsigned int k = 0; k < channel->mNumScalingKeys; k++) {
+                    const aiVectorKey& key = channel->mScalingKeys[k];
+                    out.scaleTimes.push_back((float)key.mTime / ticksPerSecond);
+                    out.scales.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+                }
+                clip.channels.push_back(out);
+            }
+            clips.push_back(clip);
+        }
+        if (animated()) {
+            std::cout << "" << skeleton.size() << " " << clips.size() << " Ƭ";
+            if (!clips.empty()) std::cout << " \"" << clips[0].name << "\"" << clips[0].duration << " 룩";
+            std::cout << std::endl;
+        }
     }
 
     // Assimpڵ
-    void processNode(aiNode* node, const aiScene* scene) {
-        // ǰڵ
+    void processNode(aiNode* node, const aiScene* scene, int parent) {
+        int index = nodes.addNode(node->mName.C_Str(), parent, toGlm(node->mTransformation));
+        // ǰڵ񣬰Χмڽڵ
         for (unsigned int i = 0; i < node->mNumMeshes; i++) {
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            meshes.push_back(processMesh(mesh, scene, index));
+            meshNodes.push_back(index);
+            glm::vec3 minPos(1e30f), maxPos(-1e30f);
+            for (auto& vertex : meshes.back().vertices) {
+                minPos = glm::min(minPos, vertex.Position);
+                maxPos = glm::max(maxPos, vertex.Position);
+            }
+            if (!meshes.back().vertices.empty()) nodes.addLocalBounds(index, minPos, maxPos);
         }
         // ݹ鴦ӽڵ
         for (unsigned int i = 0; i < node->mNumChildren; i++) {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, index);
         }
     }
 
     // תAssimpΪԶ
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene) {
+    Mesh processMesh(aiMesh* mesh, const aiScene* scene, int node) {
         std::vector<Vertex> vertices;
         std::vector<unsigned int> indices;
 
@@ -311,6 +551,8 @@ private:
             vertices.push_back(vertex);
         }
 
+        if (animatedScene) readBoneWeights(mesh, node, vertices);
+
         // 
         for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
             aiFace face = mesh->mFaces[i];
@@ -319,44 +561,503 @@ private:
             }
         }
 
-        return Mesh(vertices, indices);
+        return Mesh(vertices, indices, uploadMeshes);
     }
 
-    // ģĺͰΧ뾶
+    // Ȩأÿ㱣 4 Ӱ죬¹һΪ 8 λΪ 255
+    // ûйӰĶҵڵĸϣŽڵ㶯˶
+    void readBoneWeights(aiMesh* mesh, int node, std::vector<Vertex>& vertices) {
+        std::vector<float> weights(vertices.size() * 4, 0.0f);
+        std::vector<int> ids(vertices.size() * 4, 0);
+        for (unsigned int b = 0; b < mesh->mNumBones; b++) {
+            const aiBone* bone = mesh->mBones[b];
+            int id = skeleton.findOrAdd(bone->mName.C_Str(), toGlm(bone->mOffsetMatrix));
+            if (id < 0) {
+                std::cout << " " << Skeleton::MAX_BONES << " " << bone->mName.C_Str() << std::endl;
+                continue;
+            }
+            for (unsigned int w = 0; w < bone->mNumWeights; w++) {
+                unsigned int v = bone->mWeights[w].mVertexId;
+                float weight = bone->mWeights[w].mWeight;
+                // 滻 4 λСһ
+                int slot = 0;
+                for (int k = 1; k < 4; k++) {
+                    if (weights[v * 4 + k] < weights[v * 4 + slot]) slot = k;
+                }
+                if (weight > weights[v * 4 + slot]) {
+                    weights[v * 4 + slot] = weight;
+                    ids[v * 4 + slot] = id;
+                }
+            }
+        }
+
+        int rigid = -1;
+        for (size_t v = 0; v < vertices.size(); v++) {
+            float* w = &weights[v * 4];
+            float sum = w[0] + w[1] + w[2] + w[3];
+            Vertex& vertex = vertices[v];
+            if (sum <= 0.0f) {
+                if (rigid < 0) rigid = skeleton.addRigid(node);
+                vertex.BoneIds[0] = (uint8_t)std::max(rigid, 0);
+                vertex.BoneWeights[0] = 255;
+                continue;
+            }
+            // Ȩϣ֤Ϊ 255
+            int total = 0, largest = 0;
+            for (int k = 0; k < 4; k++) {
+                vertex.BoneIds[k] = (uint8_t)ids[v * 4 + k];
+                vertex.BoneWeights[k] = (uint8_t)(w[k] / sum * 255.0f + 0.5f);
+                total += vertex.BoneWeights[k];
+                if (w[k] > w[largest]) largest = k;
+            }
+            vertex.BoneWeights[largest] = (uint8_t)(vertex.BoneWeights[largest] + 255 - total);
+        }
+    }
+
+    bool animatedScene = false;
+    bool uploadMeshes = true;
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 5.0f;
+
+    std::string assetName() const { return path.substr(path.find_last_of("/\\") + 1); }
+
+    // ģĺͰΧ뾶ֱдȫֵӵģʽ main  setModelBounds
     void calculateModelCenterAndRadius() {
         if (meshes.empty() || meshes[0].vertices.empty()) {
-            modelCenter = glm::vec3(0.0f);
-            modelRadius = 5.0f;
+            boundsMin = glm::vec3(-radius / std::sqrt(3.0f));
+            boundsMax = -boundsMin;
             return;
         }
 
-        // ΧУAABB
-        glm::vec3 minPos = meshes[0].vertices[0].Position;
-        glm::vec3 maxPos = meshes[0].vertices[0].Position;
+        // ģͿռ䣨ڵ任󣩵ΧУAABB
+        glm::vec3 minPos(1e30f);
+        glm::vec3 maxPos(-1e30f);
 
-        for (auto& mesh : meshes) {
-            for (auto& vertex : mesh.vertices) {
-                minPos = glm::min(minPos, vertex.Position);
-                maxPos = glm::max(maxPos, vertex.Position);
+        for (size_t m = 0; m < meshes.size(); m++) {
+            const glm::mat4& world = nodes.world(meshNodes[m]);
+            for (auto& vertex : meshes[m].vertices) {
+                glm::vec3 p = glm::vec3(world * glm::vec4(vertex.Position, 1.0f));
+                minPos = glm::min(minPos, p);
+                maxPos = glm::max(maxPos, p);
+            }
+        }
+
+        boundsMin = minPos;
+        boundsMax = maxPos;
+        center = (minPos + maxPos) * 0.5f;
+        radius = glm::length(maxPos - minPos) * 0.5f;
+    }
+};
+
+// ===================== ģʽ߷ҳ =====================
+// ֻ Assimp ڵ任ģͿռΣ׷ӵҳʱļ GL 
+// ڴг Assimp ֻеǰĸAssimp ݶԴļ
+bool loadModelTriangles(const std::string& path, ClusterInput& input) {
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path,
+        aiProcess_Triangulate |
+        aiProcess_GenSmoothNormals |
+        aiProcess_JoinIdenticalVertices);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+        return false;
+    }
+    std::vector<std::pair<const aiNode*, glm::mat4>> stack = { { scene->mRootNode, glm::mat4(1.0f) } };
+    while (!stack.empty()) {
+        const aiNode* node = stack.back().first;
+        glm::mat4 world = stack.back().second * toGlm(node->mTransformation);
+        glm::mat3 normalMat = glm::mat3(glm::transpose(glm::inverse(world)));
+        stack.pop_back();
+        for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+            const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+            std::vector<glm::vec3> positions, normals;
+            std::vector<unsigned int> indices;
+            for (unsigned int v = 0; v < mesh->mNumVertices; v++) {
+                const aiVector3D& p = mesh->mVertices[v];
+                positions.push_back(glm::vec3(world * glm::vec4(p.x, p.y, p.z, 1.0f)));
+                glm::vec3 n = mesh->HasNormals() ? glm::vec3(mesh->mNormals[v].x, mesh->mNormals[v].y, mesh->mNormals[v].z)
+                                                 : glm::vec3(0.0f, 1.0f, 0.0f);
+                normals.push_back(glm::normalize(normalMat * n));
+            }
+            for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
+                const aiFace& face = mesh->mFaces[f];
+                if (face.mNumIndices != 3) continue;   // ǻֻʣ
+                for (unsigned int k = 0; k < 3; k++) indices.push_back(face.mIndices[k]);
             }
+            input.addMesh(positions, normals, indices);
+        }
+        for (unsigned int i = 0; i < node->mNumChildren; i++) stack.push_back({ node->mChildren[i], world });
+    }
+    return input.triangles() > 0;
+}
+
+// ļڻԴģͱ仯ʱ·ҳʱļڴļԵ .parts Ŀ¼ҳɾ
+bool prepareClusterFile(const std::string& source, const std::string& clusterPath) {
+    if (clusterFileUpToDate(source, clusterPath)) return true;
+    std::cout << "[ooc] ҳ " << source << "  " << clusterPath << std::endl;
+    ClusterInput input(clusterPath + ".parts");
+    return loadModelTriangles(source, input) && buildClusterFile(source, clusterPath, input);
+}
+
+// =====================  =====================
+// ĬϹգһƽй + Χģͷֲ4Դ
+LightSetup createDefaultLightSetup(const glm::vec3& center) {
+    LightSetup setup;
+    setup.material = { glm::vec3(0.3f, 0.3f, 0.3f), glm::vec3(0.8f, 0.8f, 0.8f), glm::vec3(1.0f, 1.0f, 1.0f), 32.0f };
+    setup.dirLight = { glm::vec3(-0.2f, -1.0f, -0.3f), glm::vec3(0.2f, 0.2f, 0.2f), glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 1.0f, 1.0f) };
+
+    const glm::vec3 offsets[4] = {
+        glm::vec3(5.0f, 0.0f, 0.0f),
+        glm::vec3(-5.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 5.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 5.0f)
+    };
+    for (int i = 0; i < 4; i++) {
+        PointLightParams light;
+        light.position = center + offsets[i];
+        light.ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+        light.diffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+        light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+        light.constant = 1.0f;
+        light.linear = 0.09f;
+        light.quadratic = 0.032f;
+        setup.pointLights.push_back(light);
+    }
+    return setup;
+}
+
+// дɫ
+void applyLightSetup(Shader& shader, const LightSetup& setup) {
+    shader.use();
+    // ʲ
+    shader.setVec3("material.ambient", setup.material.ambient);
+    shader.setVec3("material.diffuse", setup.material.diffuse);
+    shader.setVec3("material.specular", setup.material.specular);
+    shader.setFloat("material.shininess", setup.material.shininess);
+
+    // ƽй
+    shader.setVec3("dirLight.direction", setup.dirLight.direction);
+    shader.setVec3("dirLight.ambient", setup.dirLight.ambient);
+    shader.setVec3("dirLight.diffuse", setup.dirLight.diffuse);
+    shader.setVec3("dirLight.specular", setup.dirLight.specular);
+
+    // Դ
+    for (size_t i = 0; i < setup.pointLights.size(); i++) {
+        const PointLightParams& light = setup.pointLights[i];
+        std::string prefix = "pointLights[" + std::to_string(i) + "].";
+        shader.setVec3(prefix + "position", light.position);
+        shader.setVec3(prefix + "ambient", light.ambient);
+        shader.setVec3(prefix + "diffuse", light.diffuse);
+        shader.setVec3(prefix + "specular", light.specular);
+        shader.setFloat(prefix + "constant", light.constant);
+        shader.setFloat(prefix + "linear", light.linear);
+        shader.setFloat(prefix + "quadratic", light.quadratic);
+    }
+}
+
+// ===================== ͼ =====================
+// ģͿͼԭֻ򿪽ģʽشɣ
+//   - ̸߳һ Assimp::Importer е루Model ϴ GLõģͷŽнУ
+//     ģͼڵĲ߳ 2 ߳ͣפĶ
+//   - ̰߳˳ȡģͣϴ calculateModelCenterAndRadius İΧԶȡ
+//     Ⱦ N  Y ת̨ӽǵ FBO漴ͷţͬʱ߳ڵģ
+//   -  PNG 뽻 FrameCapturePBO 첽 + ̣̲߳߳ GPU 
+//   - д <Ŀ¼>/index.jsonÿģ͵·״̬ΧʱͼƬļ
+// ͨƿģ/ӣ浼߳ӣ̵ֱ߳ϴȾϡ
+// ͼֻعգ決Ƥģͻ̬
+const char* BATCH_EXTENSIONS[] = { ".obj", ".fbx", ".gltf", ".glb", ".dae", ".ply", ".3ds", ".stl" };
+
+// Ŀ¼ݹ֪չģͲ򣻷嵥ȡÿһ· # ͷ·嵥Ŀ¼
+std::vector<std::string> listBatchModels(const std::string& input) {
+    std::vector<std::string> paths;
+    std::error_code ec;
+    if (std::filesystem::is_directory(input, ec)) {
+        for (auto it = std::filesystem::recursive_directory_iterator(input, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (!it->is_regular_file(ec)) continue;
+            std::string ext = it->path().extension().string();
+            std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            if (std::find(std::begin(BATCH_EXTENSIONS), std::end(BATCH_EXTENSIONS), ext) != std::end(BATCH_EXTENSIONS)) {
+                paths.push_back(it->path().string());
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }
+
+    std::ifstream file(input);
+    if (!file) {
+        std::cout << "[batch] ޷ȡ " << input << std::endl;
+        return paths;
+    }
+    std::filesystem::path base = std::filesystem::path(input).parent_path();
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t first = line.find_first_not_of(" \t");
+        size_t last = line.find_last_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        std::filesystem::path path(line.substr(first, last - first + 1));
+        paths.push_back((path.is_relative() ? base / path : path).string());
+    }
+    return paths;
+}
+
+// ̳߳أ嵥˳ȡ˳򽻸߳
+class BatchImporter {
+public:
+    struct Item {
+        int index = -1;
+        Model* model = nullptr;    // 쳣ʱΪ
+        double importMs = 0.0;
+    };
+
+    void start(const std::vector<std::string>& list, unsigned threads) {
+        paths = list;
+        capacity = (int)threads * 2;
+        quit = false;
+        for (unsigned i = 0; i < threads; i++) workers.emplace_back(&BatchImporter::workerMain, this);
+    }
+
+    // ȴһõģͣȫȡʱ false
+    bool pop(Item& item) {
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&] { return !ready.empty() || taken == (int)paths.size(); });
+            if (ready.empty()) return false;
+            item = ready.front();
+            ready.pop_front();
+            taken++;
         }
+        wake.notify_one();
+        waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+        workers.clear();
+        for (Item& item : ready) delete item.model;
+        ready.clear();
+    }
 
-        // ģ
-        modelCenter = (minPos + maxPos) * 0.5f;
-        // Χ뾶
-        modelRadius = glm::length(maxPos - minPos) * 0.5f;
-        // ʼӵ
-        mc_Distance = modelRadius * 2.0f;
-        vc_CameraPos = modelCenter + glm::vec3(0.0f, 0.0f, modelRadius * 2.0f);
+    unsigned threadCount() const { return (unsigned)workers.size(); }
+    double waitMs = 0.0;           // ̵߳ȴʱ
+
+private:
+    std::vector<std::string> paths;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::deque<Item> ready;
+    int capacity = 2;
+    int next = 0;                  // һȡģ
+    int importing = 0;
+    int taken = 0;                 // ѽ̵߳ģ
+    bool quit = false;
+
+    void workerMain() {
+        for (;;) {
+            Item item;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return quit || next >= (int)paths.size() || (int)ready.size() + importing < capacity; });
+                if (quit || next >= (int)paths.size()) return;
+                item.index = next++;
+                importing++;
+            }
+            auto start = std::chrono::steady_clock::now();
+            try {
+                item.model = new Model(paths[item.index].c_str(), false);
+            }
+            catch (std::exception& e) {
+                std::cout << "[batch] ʧ " << paths[item.index] << "" << e.what() << std::endl;
+            }
+            item.importMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                importing--;
+                ready.push_back(item);
+            }
+            done.notify_one();
+        }
     }
 };
 
+// ת̨Χǡ÷Žӳ 10% ߾ࣩ 20㣬 Y ÿת 360/N
+// ԶƽŰΧȾģͳߴ޹ءÿӽǻ꼴 capture 첽
+void renderTurntable(Model& model, Shader& shader, const OffscreenTarget& target, FrameCapture& capture) {
+    glm::vec3 center = model.getModelCenter();
+    float radius = std::max(model.getModelRadius(), 1e-4f);
+    float aspect = (float)target.width / target.height;
+    float fov = glm::radians(45.0f);
+    float distance = radius * 1.1f / std::sin(fov * 0.5f) / std::min(aspect, 1.0f);
+    glm::mat4 projection = glm::perspective(fov, aspect, distance - radius * 1.2f, distance + radius * 1.2f);
+    float pitch = glm::radians(20.0f);
+
+    applyLightSetup(shader, createDefaultLightSetup(center));
+    shader.setMat4("projection", projection);
+    shader.setBool("useBakedLighting", false);
+    target.bind();
+    for (int v = 0; v < batchViews; v++) {
+        float yaw = glm::radians(360.0f * v / batchViews);
+        glm::vec3 eye = center + distance * glm::vec3(cos(pitch) * sin(yaw), sin(pitch), cos(pitch) * cos(yaw));
+        shader.setMat4("view", glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f)));
+        shader.setVec3("viewPos", eye);
+
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        int lastNode = -1;
+        for (size_t m = 0; m < model.meshes.size(); m++) {
+            int node = model.meshNodes[m];
+            if (node != lastNode) {
+                shader.setMat4("model", model.nodes.world(node));
+                shader.setMat4("normalMatrix", glm::mat4(model.nodes.normalMatrix(node)));
+                lastNode = node;
+            }
+            model.meshes[m].Draw(shader);
+        }
+        capture.capture(target.fbo);
+    }
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if ((unsigned char)c >= 0x20) out += c;
+    }
+    return out;
+}
+
+// ģʽ̣ҪѴصģ GL 
+int runBatch() {
+    std::vector<std::string> paths = listBatchModels(batchInput);
+    if (paths.empty()) {
+        std::cout << "[batch] " << batchInput << " ûпɵģ" << std::endl;
+        return -1;
+    }
+    unsigned threads = batchThreads ? batchThreads : std::max(2u, std::thread::hardware_concurrency()) - 1;
+    std::filesystem::path outDir(batchOutput);
+    std::error_code ec;
+    std::filesystem::create_directories(outDir, ec);
+
+    // ÿģ͵ĹԴλòͬ٣ͳһı壬ʽ
+    LightSetup lightSetup = createDefaultLightSetup(glm::vec3(0.0f));
+    gShaders.init("shader_cache");
+    ShaderDefines defines = { { "POINT_LIGHT_COUNT", std::to_string(lightSetup.pointLights.size()) } };
+    Shader shader("E:/OpenGLLearning/OpenGLHW02/src/lighting.vs", "E:/OpenGLLearning/OpenGLHW02/src/lighting.fs", defines);
+    OffscreenTarget target;
+    if (shader.ID == 0 || !target.create(thumbWidth, thumbHeight)
+        || !gCapture.start((outDir / "thumb_%06d.png").string(), thumbWidth, thumbHeight)) {
+        std::cout << "[batch] ʼʧ" << std::endl;
+        return -1;
+    }
+    glEnable(GL_DEPTH_TEST);
+
+    struct Entry {
+        bool ok = false;
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = 0.0f;
+        size_t triangles = 0;
+        double importMs = 0.0;
+        uint64_t firstImage = 0;
+    };
+    std::vector<Entry> entries(paths.size());
+    int failed = 0;
+    double renderMs = 0.0;
+    double importMs = 0.0;
+
+    std::cout << "[batch] " << paths.size() << " ģͣ" << threads << " ̣߳ÿ " << batchViews << " ӽ "
+              << thumbWidth << "" << thumbHeight << " -> " << outDir.string() << std::endl;
+    auto begin = std::chrono::steady_clock::now();
+    BatchImporter importer;
+    importer.start(paths, threads);
+    BatchImporter::Item item;
+    while (importer.pop(item)) {
+        Entry& entry = entries[item.index];
+        entry.importMs = item.importMs;
+        importMs += item.importMs;
+        if (!item.model || !item.model->loaded()) {
+            std::cout << "[batch]  " << paths[item.index] << std::endl;
+            failed++;
+            delete item.model;
+            continue;
+        }
+        auto start = std::chrono::steady_clock::now();
+        item.model->upload();
+        entry.ok = true;
+        entry.center = item.model->getModelCenter();
+        entry.radius = item.model->getModelRadius();
+        entry.triangles = item.model->triangleCount();
+        entry.firstImage = gCapture.stats.frames;
+        renderTurntable(*item.model, shader, target, gCapture);
+        delete item.model;
+        renderMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    importer.stop();
+    gCapture.stop();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    int rendered = (int)paths.size() - failed;
+    double perMinute = seconds > 0.0 ? rendered * 60.0 / seconds : 0.0;
+
+    // ͼƬļĿ¼
+    std::string indexPath = (outDir / "index.json").string();
+    std::ofstream f(indexPath);
+    char buf[512];
+    f << "{\n";
+    f << "  \"input\": \"" << jsonEscape(batchInput) << "\",\n";
+    snprintf(buf, sizeof(buf), "  \"views\": %d,\n  \"width\": %d,\n  \"height\": %d,\n  \"import_threads\": %u,\n",
+             batchViews, thumbWidth, thumbHeight, threads);
+    f << buf;
+    snprintf(buf, sizeof(buf), "  \"rendered\": %d,\n  \"failed\": %d,\n  \"wall_seconds\": %.3f,\n  \"models_per_minute\": %.2f,\n",
+             rendered, failed, seconds, perMinute);
+    f << buf;
+    snprintf(buf, sizeof(buf), "  \"import_ms_mean\": %.3f,\n  \"render_ms_mean\": %.3f,\n  \"main_wait_ms\": %.3f,\n",
+             importMs / paths.size(), rendered ? renderMs / rendered : 0.0, importer.waitMs);
+    f << buf;
+    f << "  \"models\": [";
+    for (size_t i = 0; i < paths.size(); i++) {
+        const Entry& e = entries[i];
+        f << (i ? "," : "") << "\n    { \"path\": \"" << jsonEscape(paths[i]) << "\", \"status\": \"" << (e.ok ? "ok" : "failed") << "\"";
+        if (e.ok) {
+            snprintf(buf, sizeof(buf), ", \"center\": [%.6g, %.6g, %.6g], \"radius\": %.6g, \"triangles\": %zu, \"import_ms\": %.3f, \"images\": [",
+                     e.center.x, e.center.y, e.center.z, e.radius, e.triangles, e.importMs);
+            f << buf;
+            for (int v = 0; v < batchViews; v++) {
+                snprintf(buf, sizeof(buf), "%s\"thumb_%06d.png\"", v ? ", " : "", (int)(e.firstImage + v));
+                f << buf;
+            }
+            f << "]";
+        }
+        f << " }";
+    }
+    f << (paths.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    bool written = (bool)f;
+    f.close();
+
+    std::cout << "[batch] " << rendered << " ģͣʧ " << failed << " " << batchViews << " ӽǣʱ " << seconds << " 룬"
+              << perMinute << " ģ/ӣƽ " << importMs / paths.size() << " msϴȾ " << (rendered ? renderMs / rendered : 0.0)
+              << " ms̵߳ȴ " << importer.waitMs << " ms -> " << indexPath << std::endl;
+    gCapture.printStats("model_viewer");
+    target.destroy();
+    glDeleteProgram(shader.ID);
+    return written ? 0 : -1;
+}
+
 // ===================== ص =====================
 // ڴСص
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
 }
 
+void applyMouseOffset(float xoffset, float yoffset);
+
 // ƶص
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn) {
     float xpos = (float)xposIn;
@@ -374,6 +1075,17 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn) {
     lastX = xpos;
     lastY = ypos;
 
+    gRecorder.mouse(xoffset, yoffset);
+    {
+        // ߳ͬʱƶ޸״̬ʱ
+        std::lock_guard<std::mutex> lock(gPacer.cameraMutex());
+        applyMouseOffset(xoffset, yoffset);
+    }
+    gPacer.noteInput();
+}
+
+// ƫתӽǣطŽűе mouse ¼Ҳ
+void applyMouseOffset(float xoffset, float yoffset) {
     xoffset *= MOUSE_SENSITIVITY;
     yoffset *= MOUSE_SENSITIVITY;
 
@@ -406,13 +1118,18 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn) {
 
 // ֻص
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+    gRecorder.scroll((float)yoffset);
+    std::lock_guard<std::mutex> lock(gPacer.cameraMutex());
     if (currentViewMode == ViewMode::MODEL_CENTERED) {
         // ģģʽţӵ룩
         mc_Distance -= (float)yoffset * SCROLL_SENSITIVITY * mc_Distance;
         if (mc_Distance < modelRadius * 0.1f) mc_Distance = modelRadius * 0.1f;
     }
+    gPacer.noteInput();
 }
 
+void moveCamera(GLFWwindow* window, float dt);
+
 // 봦
 void processInput(GLFWwindow* window) {
     // ˳ESC
@@ -422,8 +1139,9 @@ void processInput(GLFWwindow* window) {
 
     // лӵģʽCδظ
     static bool cKeyPressed = false;
-    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS) {
+    if (inputKeyDown(window, GLFW_KEY_C)) {
         if (!cKeyPressed) {
+            std::lock_guard<std::mutex> lock(gPacer.cameraMutex());
             currentViewMode = (currentViewMode == ViewMode::MODEL_CENTERED) ? ViewMode::VIEWPOINT_CENTERED : ViewMode::MODEL_CENTERED;
             std::cout << "ǰģʽ" << (currentViewMode == ViewMode::MODEL_CENTERED ? "ģģʽ" : "ӵģʽ") << std::endl;
             cKeyPressed = true;
@@ -433,14 +1151,33 @@ void processInput(GLFWwindow* window) {
         cKeyPressed = false;
     }
 
-    float speed = MOVE_SPEED * deltaTime;
+    // л決/عգBδ
+    static bool bKeyPressed = false;
+    if (inputKeyDown(window, GLFW_KEY_B)) {
+        if (!bKeyPressed) {
+            useBakedLighting = lightingBaked && !useBakedLighting;
+            std::cout << "ģʽ" << (useBakedLighting ? "決" : "ع") << std::endl;
+            bKeyPressed = true;
+        }
+    }
+    else {
+        bKeyPressed = false;
+    }
+
+    // ֡߳ʱƶ
+    if (!gPacer.inputThreadRunning()) moveCamera(window, deltaTime);
+}
+
+// ƶطʱ״̬ű߳ʱ 1 kHz ã̵߳İ
+void moveCamera(GLFWwindow* window, float dt) {
+    float speed = MOVE_SPEED * dt;
 
     if (currentViewMode == ViewMode::MODEL_CENTERED) {
         // ģģʽƽģͣW/S/A/D
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+        if (gPacer.keyDown(window, GLFW_KEY_W)) {
             mc_ModelOffset.y += speed;
         }
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+        if (gPacer.keyDown(window, GLFW_KEY_S)) {
             mc_ModelOffset.y -= speed;
         }
 
@@ -452,39 +1189,73 @@ void processInput(GLFWwindow* window) {
         ));
         glm::vec3 mc_Right = glm::normalize(glm::cross(mc_Front, glm::vec3(0.0f, 1.0f, 0.0f)));
 
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+        if (gPacer.keyDown(window, GLFW_KEY_A)) {
             mc_ModelOffset -= mc_Right * speed;
         }
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+        if (gPacer.keyDown(window, GLFW_KEY_D)) {
             mc_ModelOffset += mc_Right * speed;
         }
     }
     else if (currentViewMode == ViewMode::VIEWPOINT_CENTERED) {
         // ӵģʽһ˳ΣW/S/A/D/ո/Shift
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+        if (gPacer.keyDown(window, GLFW_KEY_W)) {
             vc_CameraPos += speed * vc_CameraFront;
         }
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+        if (gPacer.keyDown(window, GLFW_KEY_S)) {
             vc_CameraPos -= speed * vc_CameraFront;
         }
         glm::vec3 vc_Right = glm::normalize(glm::cross(vc_CameraFront, vc_CameraUp));
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+        if (gPacer.keyDown(window, GLFW_KEY_A)) {
             vc_CameraPos -= vc_Right * speed;
         }
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+        if (gPacer.keyDown(window, GLFW_KEY_D)) {
             vc_CameraPos += vc_Right * speed;
         }
-        if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+        if (gPacer.keyDown(window, GLFW_KEY_SPACE)) {
             vc_CameraPos += speed * vc_CameraUp;
         }
-        if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) {
+        if (gPacer.keyDown(window, GLFW_KEY_LEFT_SHIFT)) {
             vc_CameraPos -= speed * vc_CameraUp;
         }
     }
 }
 
 // =====================  =====================
-int main() {
+int main(int argc, char** argv) {
+    // ׼ģʽ--bench <ű>̶ط벢Ⱦ
+    BenchmarkConfig benchConfig;
+    bool benchMode = parseBenchmarkArgs(argc, argv, "model_viewer", benchConfig);
+    if (benchMode && !gReplay.load(benchConfig.script)) return -1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-stream") == 0) gStream.enabled = false;
+        if (strcmp(argv[i], "--immediate") == 0) gRenderQueue.enabled = false;
+        if (strcmp(argv[i], "--no-cull") == 0) sceneCulling = false;
+        if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) gridSize = std::max(1, atoi(argv[i + 1]));
+        if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) modelPath = argv[i + 1];
+        if (strcmp(argv[i], "--anim-threads") == 0 && i + 1 < argc) animThreads = (unsigned)std::max(1, atoi(argv[i + 1]));
+        if (strcmp(argv[i], "--out-of-core") == 0) outOfCore = true;
+        if (strcmp(argv[i], "--ooc-gpu-mb") == 0 && i + 1 < argc) oocGpuBytes = (uint64_t)(atof(argv[i + 1]) * 1024 * 1024);
+        if (strcmp(argv[i], "--ooc-host-mb") == 0 && i + 1 < argc) oocHostBytes = (uint64_t)(atof(argv[i + 1]) * 1024 * 1024);
+        if (strcmp(argv[i], "--ooc-error") == 0 && i + 1 < argc) oocErrorPixels = std::max(0.1f, (float)atof(argv[i + 1]));
+        if (strcmp(argv[i], "--vram-budget") == 0 && i + 1 < argc) gMemory.budget.gpuBytes = (uint64_t)(atof(argv[i + 1]) * 1024 * 1024);
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) batchInput = argv[i + 1];
+        if (strcmp(argv[i], "--batch-out") == 0 && i + 1 < argc) batchOutput = argv[i + 1];
+        if (strcmp(argv[i], "--views") == 0 && i + 1 < argc) batchViews = std::max(1, atoi(argv[i + 1]));
+        if (strcmp(argv[i], "--thumb") == 0 && i + 1 < argc) sscanf(argv[i + 1], "%dx%d", &thumbWidth, &thumbHeight);
+        if (strcmp(argv[i], "--batch-threads") == 0 && i + 1 < argc) batchThreads = (unsigned)std::max(1, atoi(argv[i + 1]));
+        if (strcmp(argv[i], "--host-budget") == 0 && i + 1 < argc) gMemory.budget.hostBytes = (uint64_t)(atof(argv[i + 1]) * 1024 * 1024);
+    }
+    if (!gStream.enabled) gRenderQueue.enabled = false;
+    bool batchMode = !batchInput.empty();
+    // ģʽ߷ҳҪ GL ģڴ֮ǰ
+    std::string clusterPath = modelPath + ".clusters";
+    if (outOfCore && !batchMode && !prepareClusterFile(modelPath, clusterPath)) {
+        std::cout << "ģʽҳʧ " << modelPath << std::endl;
+        return -1;
+    }
+    int width = benchConfig.width ? benchConfig.width : SCR_WIDTH;
+    int height = benchConfig.height ? benchConfig.height : SCR_HEIGHT;
+
     // 1. ʼGLFW
     if (!glfwInit()) {
         std::cout << "Failed to initialize GLFW" << std::endl;
@@ -493,21 +1264,26 @@ int main() {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (benchMode || batchMode) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     // 2. 
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "OBJ Multi-Light Viewer (Cлģʽ)", NULL, NULL);
+    GLFWwindow* window = glfwCreateWindow(width, height, "OBJ Multi-Light Viewer (Cлģʽ)", NULL, NULL);
     if (window == NULL) {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+    if (!benchMode && !batchMode) {
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
 
-    // 겢
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        // 겢
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
+    PacingConfig pacingConfig;
+    parsePacingArgs(argc, argv, pacingConfig);
 
     // 3. GLAD
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
@@ -515,141 +1291,431 @@ int main() {
         return -1;
     }
 
+    gProfiler.init("model_viewer");
+    gMemory.init("model_viewer");
+
+    // ͼ롢Ⱦдֱ˳
+    if (batchMode) {
+        int result = runBatch();
+        gProfiler.shutdown();
+        gMemory.shutdown();
+        glfwTerminate();
+        return result;
+    }
+
     // 4. Ȳ
     glEnable(GL_DEPTH_TEST);
 
-    // 5. ɫע⣺ȷlighting.vslighting.fsĿĿ¼£
-    Shader lightingShader("E:/OpenGLLearning/OpenGLHW02/src/lighting.vs", "E:/OpenGLLearning/OpenGLHW02/src/lighting.fs");
+    // 5. OBJģ
+    // ģʽΪ򿪴ļ Modelģֻһڵ㣬ΧԴļ
+    Model* model = nullptr;
+    ClusterStreamer clusters;
+    SceneGraph clusterNodes;
+    std::vector<ClusterDraw> clusterDraws;
+    if (outOfCore) {
+        MemoryAssetScope asset("cluster_pool");
+        if (!clusters.open(clusterPath, oocGpuBytes, oocHostBytes)) {
+            glfwTerminate();
+            return -1;
+        }
+        clusters.errorPixels = oocErrorPixels;
+        setModelBounds(clusters.boundsMin(), clusters.boundsMax());
+        clusterNodes.addNode("clusters", SceneGraph::NO_PARENT, glm::mat4(1.0f));
+        clusterNodes.addLocalBounds(0, clusters.boundsMin(), clusters.boundsMax());
+        clusterNodes.update();
+    }
+    else {
+        try {
+            model = new Model(modelPath.c_str());
+            setModelBounds(model->boundsMin, model->boundsMax);
+            std::cout << "ģͼسɹģ(" << modelCenter.x << "," << modelCenter.y << "," << modelCenter.z << ")" << std::endl;
+            std::cout << "ģͰ뾶" << modelRadius << std::endl;
+        }
+        catch (std::exception& e) {
+            std::cout << "ģͼʧܣ" << e.what() << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+    }
+    const SceneGraph& modelNodes = model ? model->nodes : clusterNodes;
+
+    // ͼڵģģʽƽƣÿģһʵڵ㣬ٹģĽڵ㼶
+    SceneGraph scene;
+    int sceneRoot = scene.addNode("scene", SceneGraph::NO_PARENT, glm::mat4(1.0f));
+    std::vector<int> instanceBase;
+    std::vector<int> instanceNodes;
+    float spacing = modelRadius * 2.5f;
+    for (int gz = 0; gz < gridSize; gz++) {
+        for (int gx = 0; gx < gridSize; gx++) {
+            glm::vec3 offset((gx - (gridSize - 1) * 0.5f) * spacing, 0.0f, (gz - (gridSize - 1) * 0.5f) * spacing);
+            int instance = scene.addNode("instance", sceneRoot, glm::translate(glm::mat4(1.0f), offset));
+            instanceNodes.push_back(instance);
+            instanceBase.push_back(scene.instantiate(modelNodes, instance));
+        }
+    }
+    int drawNodes = outOfCore ? 1 : 0;   // Ľڵÿÿ֡һ DrawBlock 256 ֽڶƣģʽÿʵһ
+    for (int i = 0; model && i < model->nodes.size(); i++) {
+        if (std::find(model->meshNodes.begin(), model->meshNodes.end(), i) != model->meshNodes.end()) drawNodes++;
+    }
+    // Ƥģͣÿʵһ飨ģ; + 󣩣 Animator ÿֵ֡
+    Animator animator;
+    bool skinned = model && model->animated();
+    size_t drawBytes = (size_t)drawNodes * 256;
+    if (skinned) {
+        animator.init(model->nodes, model->skeleton, model->clips, gridSize * gridSize, animThreads);
+        drawBytes = (animator.blockBytes() + 255) / 256 * 256;
+    }
+    gStream.init(4 * 1024 + (size_t)gridSize * gridSize * drawBytes);
+    std::cout << "[scene] " << scene.size() << " ڵ㣨ģ " << modelNodes.size() << " " << (model ? model->meshes.size() : 0)
+              << " 񣩡 " << gridSize * gridSize << " " << std::endl;
+    double nodesUpdated = 0.0;
+    double drawsCulled = 0.0;
+    double drawsTotal = 0.0;
+
+    // 6. öԴԴɫ壨ע⣺ȷlighting.vslighting.fsĿĿ¼£
+    LightSetup lightSetup = createDefaultLightSetup(modelCenter);
+    gShaders.init("shader_cache");
+    ShaderDefines lightingDefines = { { "POINT_LIGHT_COUNT", std::to_string(lightSetup.pointLights.size()) } };
+    if (gStream.enabled) lightingDefines.push_back({ "STREAM_UNIFORMS", "1" });
+    if (skinned) {
+        lightingDefines.push_back({ "SKINNED", "1" });
+        lightingDefines.push_back({ "BONE_COUNT", std::to_string(animator.boneCount()) });
+    }
+    Shader lightingShader("E:/OpenGLLearning/OpenGLHW02/src/lighting.vs", "E:/OpenGLLearning/OpenGLHW02/src/lighting.fs", lightingDefines);
     if (lightingShader.ID == 0) {
         std::cout << "Failed to load shader" << std::endl;
+        delete model;
         glfwTerminate();
         return -1;
     }
-
-    // 6. OBJģ
-    Model* model = nullptr;
-    try {
-        model = new Model("E:/OpenGLLearning/OpenGLHW02/Resources/teapot.obj"); 
-        std::cout << "ģͼسɹģ(" << modelCenter.x << "," << modelCenter.y << "," << modelCenter.z << ")" << std::endl;
-        std::cout << "ģͰ뾶" << modelRadius << std::endl;
+    if (gStream.enabled) StreamBuffer::bindBlocks(lightingShader.ID);
+
+    // 7. дղ̬պ決
+    // Ƥģ͵̬ÿ֡仯決ٳع
+    applyLightSetup(lightingShader, lightSetup);
+    if (outOfCore) {
+        useBakedLighting = false;
+        std::cout << "ģʽ㲻פպ決ʹع" << std::endl;
     }
-    catch (std::exception& e) {
-        std::cout << "ģͼʧܣ" << e.what() << std::endl;
-        glfwTerminate();
-        return -1;
+    else if (skinned) {
+        useBakedLighting = false;
+        std::cout << "ģʹպ決ʹع" << std::endl;
+    }
+    else {
+        model->bakeLighting(lightSetup, BakeOptions());
+        lightingBaked = true;
     }
 
-    // 7. öԴsetVec3glm::vec3ϸҪ
-    lightingShader.use();
-    // ʲ
-    lightingShader.setVec3("material.ambient", glm::vec3(0.3f, 0.3f, 0.3f));
-    lightingShader.setVec3("material.diffuse", glm::vec3(0.8f, 0.8f, 0.8f));
-    lightingShader.setVec3("material.specular", glm::vec3(1.0f, 1.0f, 1.0f));
-    lightingShader.setFloat("material.shininess", 32.0f);
-
-    // ƽй
-    lightingShader.setVec3("dirLight.direction", glm::vec3(-0.2f, -1.0f, -0.3f));
-    lightingShader.setVec3("dirLight.ambient", glm::vec3(0.2f, 0.2f, 0.2f));
-    lightingShader.setVec3("dirLight.diffuse", glm::vec3(0.5f, 0.5f, 0.5f));
-    lightingShader.setVec3("dirLight.specular", glm::vec3(1.0f, 1.0f, 1.0f));
-
-    // 4ԴΧģͷֲ
-    lightingShader.setInt("pointLightCount", 4);
-    // Դ1
-    lightingShader.setVec3("pointLights[0].position", modelCenter + glm::vec3(5.0f, 0.0f, 0.0f));
-    lightingShader.setVec3("pointLights[0].ambient", glm::vec3(0.2f, 0.2f, 0.2f));
-    lightingShader.setVec3("pointLights[0].diffuse", glm::vec3(0.5f, 0.5f, 0.5f));
-    lightingShader.setVec3("pointLights[0].specular", glm::vec3(1.0f, 1.0f, 1.0f));
-    lightingShader.setFloat("pointLights[0].constant", 1.0f);
-    lightingShader.setFloat("pointLights[0].linear", 0.09f);
-    lightingShader.setFloat("pointLights[0].quadratic", 0.032f);
-    // Դ2
-    lightingShader.setVec3("pointLights[1].position", modelCenter + glm::vec3(-5.0f, 0.0f, 0.0f));
-    lightingShader.setVec3("pointLights[1].ambient", glm::vec3(0.2f, 0.2f, 0.2f));
-    lightingShader.setVec3("pointLights[1].diffuse", glm::vec3(0.5f, 0.5f, 0.5f));
-    lightingShader.setVec3("pointLights[1].specular", glm::vec3(1.0f, 1.0f, 1.0f));
-    lightingShader.setFloat("pointLights[1].constant", 1.0f);
-    lightingShader.setFloat("pointLights[1].linear", 0.09f);
-    lightingShader.setFloat("pointLights[1].quadratic", 0.032f);
-    // Դ3
-    lightingShader.setVec3("pointLights[2].position", modelCenter + glm::vec3(0.0f, 5.0f, 0.0f));
-    lightingShader.setVec3("pointLights[2].ambient", glm::vec3(0.2f, 0.2f, 0.2f));
-    lightingShader.setVec3("pointLights[2].diffuse", glm::vec3(0.5f, 0.5f, 0.5f));
-    lightingShader.setVec3("pointLights[2].specular", glm::vec3(1.0f, 1.0f, 1.0f));
-    lightingShader.setFloat("pointLights[2].constant", 1.0f);
-    lightingShader.setFloat("pointLights[2].linear", 0.09f);
-    lightingShader.setFloat("pointLights[2].quadratic", 0.032f);
-    // Դ4
-    lightingShader.setVec3("pointLights[3].position", modelCenter + glm::vec3(0.0f, 0.0f, 5.0f));
-    lightingShader.setVec3("pointLights[3].ambient", glm::vec3(0.2f, 0.2f, 0.2f));
-    lightingShader.setVec3("pointLights[3].diffuse", glm::vec3(0.5f, 0.5f, 0.5f));
-    lightingShader.setVec3("pointLights[3].specular", glm::vec3(1.0f, 1.0f, 1.0f));
-    lightingShader.setFloat("pointLights[3].constant", 1.0f);
-    lightingShader.setFloat("pointLights[3].linear", 0.09f);
-    lightingShader.setFloat("pointLights[3].quadratic", 0.032f);
+    // ׼ģʽ׼طŻصĿ
+    OffscreenTarget benchTarget;
+    BenchmarkRun benchRun;
+    int benchFrames = 0;
+    int frameNo = 0;
+    if (!benchMode) {
+        gPacer.init(window, pacingConfig);
+        gPacer.startInput({ GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_SPACE, GLFW_KEY_LEFT_SHIFT },
+                          [window](float dt) { moveCamera(window, dt); });
+    }
+    if (benchMode) {
+        gReplay.onMouse = [](float dx, float dy) { applyMouseOffset(dx, dy); };
+        gReplay.onScroll = [](float dy) { scroll_callback(nullptr, 0.0, dy); };
+        benchTarget.create(width, height);
+        benchFrames = benchConfig.frames ? benchConfig.frames : (int)gReplay.frames;
+        benchRun.begin(benchConfig, width, height, (const char*)glGetString(GL_RENDERER));
+    }
 
     // 8. Ⱦѭ
-    while (!glfwWindowShouldClose(window)) {
+    while (benchMode ? frameNo < benchFrames : !glfwWindowShouldClose(window)) {
+        gProfiler.beginFrame();
+        gPacer.beginFrame();
+        gStream.beginFrame();
         // ֡ʱ
         float currentFrame = (float)glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
         // 
-        processInput(window);
+        {
+            PROFILE_SCOPE("input");
+            if (benchMode) {
+                benchRun.frameStart();
+                gReplay.advance();
+                deltaTime = (float)gReplay.dt;
+                benchTarget.bind();
+            }
+            else {
+                gRecorder.update(window, "model_viewer");
+            }
+            processInput(window);
+        }
+
+        // ߳̿ʼֵ̼߳볡ͼǰٵȴ
+        if (skinned) animator.beginUpdate(deltaTime);
 
         // ջ
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // ɫ
-        lightingShader.use();
+        // ɫȾԼл
+        if (!gRenderQueue.enabled) lightingShader.use();
 
         // ͶӰ
-        glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / SCR_HEIGHT, 0.1f, 1000.0f);
-        lightingShader.setMat4("projection", projection);
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / height, 0.1f, 1000.0f);
 
         // ͼ󣨸ӵģʽл
         glm::mat4 view = glm::mat4(1.0f);
         glm::vec3 viewPos;
         glm::mat4 modelMat = glm::mat4(1.0f);
 
-        if (currentViewMode == ViewMode::MODEL_CENTERED) {
-            // ģģʽӵλ
-            glm::vec3 cameraPos;
-            cameraPos.x = modelCenter.x + mc_ModelOffset.x + mc_Distance * cos(glm::radians(mc_Pitch)) * cos(glm::radians(mc_Yaw));
-            cameraPos.y = modelCenter.y + mc_ModelOffset.y + mc_Distance * sin(glm::radians(mc_Pitch));
-            cameraPos.z = modelCenter.z + mc_ModelOffset.z + mc_Distance * cos(glm::radians(mc_Pitch)) * sin(glm::radians(mc_Yaw));
-            viewPos = cameraPos;
+        // 棺ȡһ¼ֵ˿̣֡ͼ
+        gPacer.latch(window, [&] {
+            if (currentViewMode == ViewMode::MODEL_CENTERED) {
+                // ģģʽӵλ
+                glm::vec3 cameraPos;
+                cameraPos.x = modelCenter.x + mc_ModelOffset.x + mc_Distance * cos(glm::radians(mc_Pitch)) * cos(glm::radians(mc_Yaw));
+                cameraPos.y = modelCenter.y + mc_ModelOffset.y + mc_Distance * sin(glm::radians(mc_Pitch));
+                cameraPos.z = modelCenter.z + mc_ModelOffset.z + mc_Distance * cos(glm::radians(mc_Pitch)) * sin(glm::radians(mc_Yaw));
+                viewPos = cameraPos;
+
+                // ģ
+                view = glm::lookAt(cameraPos, modelCenter + mc_ModelOffset, glm::vec3(0.0f, 1.0f, 0.0f));
+                // ģ;ƽƫƣ
+                modelMat = glm::translate(glm::mat4(1.0f), mc_ModelOffset);
+            }
+            else if (currentViewMode == ViewMode::VIEWPOINT_CENTERED) {
+                // ӵģʽһ˳ƣ
+                view = glm::lookAt(vc_CameraPos, vc_CameraPos + vc_CameraFront, vc_CameraUp);
+                viewPos = vc_CameraPos;
+                // ģ;޶ƫƣ
+                modelMat = glm::mat4(1.0f);
+            }
+        });
 
-            // ģ
-            view = glm::lookAt(cameraPos, modelCenter + mc_ModelOffset, glm::vec3(0.0f, 1.0f, 0.0f));
-            // ģ;ƽƫƣ
-            modelMat = glm::translate(glm::mat4(1.0f), mc_ModelOffset);
+        // ͶӰͼӵλãд뻷λ岢󶨣ãsetVec3glm::vec3
+        if (gStream.enabled) {
+            StreamConstantsScope constants;
+            FrameConstants frame = { view, projection, viewPos, useBakedLighting ? 1 : 0 };
+            gStream.pushUniform(StreamBuffer::FRAME_BINDING, frame);
         }
-        else if (currentViewMode == ViewMode::VIEWPOINT_CENTERED) {
-            // ӵģʽһ˳ƣ
-            view = glm::lookAt(vc_CameraPos, vc_CameraPos + vc_CameraFront, vc_CameraUp);
-            viewPos = vc_CameraPos;
-            // ģ;޶ƫƣ
-            modelMat = glm::mat4(1.0f);
+        else {
+            StreamConstantsScope constants;
+            lightingShader.setMat4("projection", projection);
+            lightingShader.setMat4("view", view);
+            lightingShader.setVec3("viewPos", viewPos);
+            lightingShader.setBool("useBakedLighting", useBakedLighting);
         }
 
-        // ͼӵλãsetVec3glm::vec3
-        lightingShader.setMat4("view", view);
-        lightingShader.setVec3("viewPos", viewPos);
-        lightingShader.setMat4("model", modelMat);
+        // ³ͼֻģƫƱ仯ʱڵ㱻ǣһΣ֡ûо
+        {
+            PROFILE_SCOPE("scene");
+            scene.setLocal(sceneRoot, modelMat);
+            nodesUpdated += scene.update();
+        }
+        if (skinned) {
+            PROFILE_SCOPE("animation");
+            animator.wait();
+        }
 
-        // ģ
-        model->Draw(lightingShader);
+        // ģͣ--grid N ʱ XZ ƽ 2.5 ģͰ뾶Ϊڷ NN ݡ
+        // ÿʹڵ㻺뷨߾ͬһڵһݳΧ׶
+        {
+            PROFILE_GPU_SCOPE("model");
+            Frustum frustum = Frustum::fromMatrix(projection * view);
+            if (outOfCore) {
+                // ģʽϴõҳÿʵԼģ;ѡҳ׶޳ѡҳʱɣͬһʵҳһݳ
+                clusters.beginFrame();
+                DrawPacket packet;
+                packet.program = lightingShader.ID;
+                packet.vao = clusters.vertexArray();
+                packet.indexType = GL_UNSIGNED_SHORT;
+                packet.drawConstantsSize = sizeof(DrawConstants);
+                for (int node : instanceNodes) {
+                    clusterDraws.clear();
+                    clusters.select(scene.world(node), view, projection, height, clusterDraws);
+                    drawsTotal++;
+                    if (clusterDraws.empty()) {
+                        drawsCulled++;
+                        continue;
+                    }
+                    {
+                        StreamConstantsScope constants;
+                        DrawConstants draw = { scene.world(node), glm::mat4(scene.normalMatrix(node)) };
+                        if (gRenderQueue.enabled) packet.drawConstants = gStream.write(draw);
+                        else if (gStream.enabled) gStream.pushUniform(StreamBuffer::DRAW_BINDING, draw);
+                        else {
+                            lightingShader.setMat4("model", draw.model);
+                            lightingShader.setMat4("normalMatrix", draw.normalMatrix);
+                        }
+                    }
+                    if (gRenderQueue.enabled) {
+                        for (const ClusterDraw& d : clusterDraws) {
+                            packet.count = d.count;
+                            packet.first = d.indexOffset;
+                            packet.baseVertex = d.baseVertex;
+                            gRenderQueue.submit(packet, 0, d.distance, 1000.0f);
+                        }
+                    }
+                    else {
+                        clusters.draw(clusterDraws);
+                    }
+                }
+                clusters.endFrame();
+            }
+            else if (skinned) {
+                // Ƥģͣÿʵдһ鳣ã̬÷Ŵ 1.5 İΧ޳
+                DrawPacket packet;
+                packet.program = lightingShader.ID;
+                packet.drawConstantsSize = (GLsizeiptr)animator.blockBytes();
+                for (size_t i = 0; i < instanceNodes.size(); i++) {
+                    int node = instanceNodes[i];
+                    const glm::mat4& world = scene.world(node);
+                    glm::vec3 center = glm::vec3(world * glm::vec4(modelCenter, 1.0f));
+                    glm::vec3 extent(modelRadius * 1.5f * glm::length(glm::vec3(world[0])));
+                    drawsTotal += model->meshes.size();
+                    if (sceneCulling && !frustum.intersects(center - extent, center + extent)) {
+                        drawsCulled += model->meshes.size();
+                        continue;
+                    }
+                    glm::mat4* block = animator.block((int)i);
+                    block[0] = world;
+                    block[1] = glm::mat4(scene.normalMatrix(node));
+                    {
+                        StreamConstantsScope constants;
+                        if (gRenderQueue.enabled) packet.drawConstants = gStream.write(block, animator.blockBytes());
+                        else if (gStream.enabled) gStream.pushUniform(StreamBuffer::DRAW_BINDING, block, animator.blockBytes());
+                        else {
+                            lightingShader.setMat4("model", block[0]);
+                            lightingShader.setMat4("normalMatrix", block[1]);
+                            glUniformMatrix4fv(glGetUniformLocation(lightingShader.ID, "bones"), animator.boneCount(), GL_FALSE,
+                                               &block[Animator::HEADER][0][0]);
+                        }
+                    }
+                    for (Mesh& mesh : model->meshes) {
+                        if (gRenderQueue.enabled) mesh.Submit(gRenderQueue, packet, glm::length(viewPos - center), 1000.0f);
+                        else mesh.Draw(lightingShader);
+                    }
+                }
+            }
+            else {
+                for (int base : instanceBase) {
+                    int lastNode = -1;
+                    DrawPacket packet;
+                    packet.program = lightingShader.ID;
+                    packet.drawConstantsSize = sizeof(DrawConstants);
+                    for (size_t m = 0; m < model->meshes.size(); m++) {
+                        int node = base + model->meshNodes[m];
+                        drawsTotal++;
+                        if (sceneCulling && !frustum.intersects(scene.worldBoundsMin(node), scene.worldBoundsMax(node))) {
+                            drawsCulled++;
+                            continue;
+                        }
+                        if (node != lastNode) {
+                            StreamConstantsScope constants;
+                            DrawConstants draw = { scene.world(node), glm::mat4(scene.normalMatrix(node)) };
+                            if (gRenderQueue.enabled) packet.drawConstants = gStream.write(draw);
+                            else if (gStream.enabled) gStream.pushUniform(StreamBuffer::DRAW_BINDING, draw);
+                            else {
+                                lightingShader.setMat4("model", draw.model);
+                                lightingShader.setMat4("normalMatrix", draw.normalMatrix);
+                            }
+                            lastNode = node;
+                        }
+                        if (gRenderQueue.enabled) {
+                            glm::vec3 center = (scene.worldBoundsMin(node) + scene.worldBoundsMax(node)) * 0.5f;
+                            model->meshes[m].Submit(gRenderQueue, packet, glm::length(viewPos - center), 1000.0f);
+                        }
+                        else {
+                            model->meshes[m].Draw(lightingShader);
+                        }
+                    }
+                }
+            }
+            if (gRenderQueue.enabled) gRenderQueue.execute();
+        }
+        gStream.endFrame();
+        gRenderQueue.endFrame();
+        gMemory.endFrame(benchMode ? nullptr : window);
+
+        if (benchMode) {
+            benchRun.frameEnd(true);
+            gProfiler.endFrame(nullptr);
+            if (frameNo++ == 0) gShaders.reportStartup("model_viewer");
+            continue;
+        }
 
         // ѯ¼
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        gProfiler.drawOverlay();
+        gPacer.endFrame();
+        {
+            PROFILE_SCOPE("swap");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+            gPacer.sampleInput(window);
+        }
+        gProfiler.endFrame(window);
+        if (frameNo++ == 0) gShaders.reportStartup("model_viewer");
+    }
+
+    gPacer.shutdown();
+    int result = 0;
+    if (benchMode) {
+        if (!benchConfig.image.empty()) {
+            std::vector<unsigned char> pixels = benchTarget.readPixels();
+            writeImagePPM(benchConfig.image, width, height, pixels.data(), true);
+        }
+        addStreamMetrics(benchRun, gStream);
+        addRenderQueueMetrics(benchRun, gRenderQueue);
+        addMemoryMetrics(benchRun, gMemory);
+        benchRun.setMetric("model_instances", (double)gridSize * gridSize);
+        benchRun.setMetric("scene_nodes", (double)scene.size());
+        benchRun.setMetric("nodes_updated_per_frame", frameNo ? nodesUpdated / frameNo : 0.0);
+        benchRun.setMetric("culled_draw_fraction", drawsTotal > 0.0 ? drawsCulled / drawsTotal : 0.0);
+        if (outOfCore) {
+            const ClusterStats& ooc = clusters.stats;
+            double oocFrames = (double)std::max<uint64_t>(ooc.frames, 1);
+            benchRun.setMetric("ooc_pages", (double)ooc.nodes);
+            benchRun.setMetric("ooc_pool_slots", (double)ooc.poolSlots);
+            benchRun.setMetric("ooc_resident_pages", (double)ooc.resident);
+            benchRun.setMetric("ooc_streamed_mb", ooc.bytesStreamed / (1024.0 * 1024.0));
+            benchRun.setMetric("ooc_evictions", (double)ooc.evictions);
+            benchRun.setMetric("ooc_proxy_fraction", ooc.pagesDrawnTotal ? (double)ooc.proxyPagesTotal / ooc.pagesDrawnTotal : 0.0);
+            benchRun.setMetric("ooc_triangles_per_frame", ooc.trianglesTotal / oocFrames);
+            benchRun.setMetric("ooc_staging_peak_mb", ooc.stagingPeak / (1024.0 * 1024.0));
+        }
+        if (skinned) {
+            const AnimatorStats& anim = animator.stats;
+            benchRun.setMetric("skinned_instances", (double)animator.instanceCount());
+            benchRun.setMetric("bones", (double)animator.boneCount());
+            benchRun.setMetric("animation_wait_ms", anim.frames ? anim.waitMs / anim.frames : 0.0);
+            benchRun.setMetric("animation_eval_ms", anim.frames ? anim.evaluateMs / anim.frames : 0.0);
+            benchRun.setMetric("key_cache_hit", anim.keySamples ? 1.0 - (double)anim.keySearches / anim.keySamples : 1.0);
+        }
+        result = benchRun.writeReport() ? 0 : -1;
+        gMemory.writeJson("model_viewer_memory.json");
+        benchTarget.destroy();
     }
 
     // ͷԴ
+    if (frameNo) {
+        std::cout << "[scene] ƽÿ֡ " << nodesUpdated / frameNo << " / " << scene.size() << " ڵ㣬׶޳ "
+                  << (drawsTotal > 0.0 ? drawsCulled / drawsTotal * 100.0 : 0.0) << "% " << std::endl;
+    }
+    gStream.printStats("model_viewer");
+    gRenderQueue.printStats("model_viewer");
+    gPacer.printStats("model_viewer");
+    if (skinned) {
+        animator.printStats("model_viewer");
+        animator.shutdown();
+    }
+    if (outOfCore) {
+        clusters.printStats();
+        clusters.close();
+    }
+    gStream.shutdown();
+    gProfiler.shutdown();
     delete model;
+    glDeleteProgram(lightingShader.ID);
+    gMemory.shutdown();
     glfwTerminate();
-    return 0;
+    return result;
 }
\ No newline at end of file
@@ -0,0 +1,336 @@
+#include "lightbake.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+// ===================== BVH 构建 =====================
+void MeshBVH::build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices) {
+    nodes.clear();
+    tris.clear();
+    triIndex.clear();
+
+    unsigned int triCount = (unsigned int)(indices.size() / 3);
+    if (triCount == 0) return;
+
+    std::vector<glm::vec3> centroids(triCount);
+    tris.resize(triCount);
+    triIndex.resize(triCount);
+    for (unsigned int i = 0; i < triCount; i++) {
+        glm::vec3 a = positions[indices[i * 3 + 0]];
+        glm::vec3 b = positions[indices[i * 3 + 1]];
+        glm::vec3 c = positions[indices[i * 3 + 2]];
+        tris[i] = { a, b - a, c - a };
+        centroids[i] = (a + b + c) / 3.0f;
+        triIndex[i] = i;
+    }
+
+    nodes.reserve(triCount * 2);
+    buildRecursive(centroids, 0, triCount);
+}
+
+unsigned int MeshBVH::buildRecursive(std::vector<glm::vec3>& centroids, unsigned int first, unsigned int count) {
+    unsigned int nodeIdx = (unsigned int)nodes.size();
+    nodes.push_back(Node());
+
+    // 计算节点包围盒与质心包围盒
+    glm::vec3 bmin(FLT_MAX), bmax(-FLT_MAX);
+    glm::vec3 cmin(FLT_MAX), cmax(-FLT_MAX);
+    for (unsigned int i = first; i < first + count; i++) {
+        const Triangle& t = tris[triIndex[i]];
+        glm::vec3 b = t.v0 + t.e1;
+        glm::vec3 c = t.v0 + t.e2;
+        bmin = glm::min(bmin, glm::min(t.v0, glm::min(b, c)));
+        bmax = glm::max(bmax, glm::max(t.v0, glm::max(b, c)));
+        cmin = glm::min(cmin, centroids[triIndex[i]]);
+        cmax = glm::max(cmax, centroids[triIndex[i]]);
+    }
+    nodes[nodeIdx].bmin = bmin;
+    nodes[nodeIdx].bmax = bmax;
+
+    // 叶节点
+    glm::vec3 extent = cmax - cmin;
+    int axis = 0;
+    if (extent.y > extent.x) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+    if (count <= 4 || extent[axis] <= 0.0f) {
+        nodes[nodeIdx].leftOrFirst = first;
+        nodes[nodeIdx].count = count;
+        return nodeIdx;
+    }
+
+    // 沿最长轴按质心中位数划分
+    unsigned int mid = first + count / 2;
+    std::nth_element(triIndex.begin() + first, triIndex.begin() + mid, triIndex.begin() + first + count,
+        [&](unsigned int a, unsigned int b) { return centroids[a][axis] < centroids[b][axis]; });
+
+    // 深度优先构建：左孩子总是紧跟在父节点之后，只需记录右孩子下标
+    buildRecursive(centroids, first, mid - first);
+    unsigned int right = buildRecursive(centroids, mid, first + count - mid);
+    nodes[nodeIdx].leftOrFirst = right;
+    nodes[nodeIdx].count = 0;
+    return nodeIdx;
+}
+
+// ===================== BVH 遮挡查询 =====================
+static bool rayBox(const glm::vec3& o, const glm::vec3& invDir, const glm::vec3& bmin, const glm::vec3& bmax, float tMax) {
+    glm::vec3 t0 = (bmin - o) * invDir;
+    glm::vec3 t1 = (bmax - o) * invDir;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+    return enter <= exit;
+}
+
+bool MeshBVH::occluded(const glm::vec3& origin, const glm::vec3& dir, float tMax) const {
+    if (nodes.empty()) return false;
+
+    glm::vec3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+    unsigned int stack[64];
+    int sp = 0;
+    stack[sp++] = 0;
+
+    while (sp > 0) {
+        unsigned int nodeIdx = stack[--sp];
+        const Node& node = nodes[nodeIdx];
+        if (!rayBox(origin, invDir, node.bmin, node.bmax, tMax)) continue;
+
+        if (node.count > 0) {
+            // Möller–Trumbore 三角形求交
+            for (unsigned int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+                const Triangle& t = tris[triIndex[i]];
+                glm::vec3 p = glm::cross(dir, t.e2);
+                float det = glm::dot(t.e1, p);
+                if (std::fabs(det) < 1e-12f) continue;
+                float invDet = 1.0f / det;
+                glm::vec3 s = origin - t.v0;
+                float u = glm::dot(s, p) * invDet;
+                if (u < 0.0f || u > 1.0f) continue;
+                glm::vec3 q = glm::cross(s, t.e1);
+                float v = glm::dot(dir, q) * invDet;
+                if (v < 0.0f || u + v > 1.0f) continue;
+                float hit = glm::dot(t.e2, q) * invDet;
+                if (hit > 0.0f && hit < tMax) return true;
+            }
+        }
+        else if (sp + 2 <= 64) {
+            stack[sp++] = node.leftOrFirst;
+            stack[sp++] = nodeIdx + 1;
+        }
+    }
+    return false;
+}
+
+// ===================== 缓存键（FNV-1a 64位） =====================
+static const uint32_t BAKE_CACHE_MAGIC = 0x4B414233; // "3BAK"
+static const uint32_t BAKE_CACHE_VERSION = 1;
+
+static void hashBytes(uint64_t& h, const void* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+}
+
+uint64_t computeBakeKey(const LightSetup& setup, const BakeOptions& options,
+                        const std::vector<glm::vec3>& positions,
+                        const std::vector<glm::vec3>& normals,
+                        const std::vector<unsigned int>& indices) {
+    uint64_t h = 1469598103934665603ull;
+    hashBytes(h, &BAKE_CACHE_VERSION, sizeof(BAKE_CACHE_VERSION));
+    hashBytes(h, &setup.material, sizeof(setup.material));
+    hashBytes(h, &setup.dirLight, sizeof(setup.dirLight));
+    for (const auto& light : setup.pointLights) hashBytes(h, &light, sizeof(light));
+    hashBytes(h, &options.aoSamples, sizeof(options.aoSamples));
+    hashBytes(h, &options.aoDistance, sizeof(options.aoDistance));
+    hashBytes(h, &options.shadows, sizeof(options.shadows));
+    if (!positions.empty()) hashBytes(h, positions.data(), positions.size() * sizeof(glm::vec3));
+    if (!normals.empty()) hashBytes(h, normals.data(), normals.size() * sizeof(glm::vec3));
+    if (!indices.empty()) hashBytes(h, indices.data(), indices.size() * sizeof(unsigned int));
+    return h;
+}
+
+// ===================== 采样工具 =====================
+// 每个顶点使用固定种子，保证重复烘焙结果一致
+static uint32_t pcgHash(uint32_t v) {
+    uint32_t state = v * 747796405u + 2891336453u;
+    uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+static float randomFloat(uint32_t& seed) {
+    seed = pcgHash(seed);
+    return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+// 余弦加权半球采样
+static glm::vec3 cosineSampleHemisphere(const glm::vec3& n, uint32_t& seed) {
+    float u1 = randomFloat(seed);
+    float u2 = randomFloat(seed);
+    float r = std::sqrt(u1);
+    float phi = 6.28318530718f * u2;
+
+    glm::vec3 up = std::fabs(n.y) < 0.999f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 t = glm::normalize(glm::cross(up, n));
+    glm::vec3 b = glm::cross(n, t);
+    return glm::normalize(t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + n * std::sqrt(std::max(0.0f, 1.0f - u1)));
+}
+
+static float luminance(const glm::vec3& c) {
+    return glm::dot(c, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+// ===================== 单顶点烘焙 =====================
+static BakedVertex bakeVertex(const LightSetup& setup, const BakeOptions& options, const MeshBVH& bvh,
+                              const glm::vec3& pos, const glm::vec3& normalIn, float sceneRadius, uint32_t seed) {
+    BakedVertex out;
+    out.diffuse = glm::vec3(0.0f);
+    out.lightDir = glm::vec3(0.0f);
+    out.specular = glm::vec3(0.0f);
+
+    float nLen = glm::length(normalIn);
+    if (nLen < 1e-8f) return out;
+    glm::vec3 n = normalIn / nLen;
+    float eps = sceneRadius * 1e-4f;
+    glm::vec3 origin = pos + n * eps;
+
+    // 环境光遮蔽
+    float ao = 1.0f;
+    if (options.aoSamples > 0) {
+        float maxDist = options.aoDistance * sceneRadius;
+        int hits = 0;
+        for (int i = 0; i < options.aoSamples; i++) {
+            glm::vec3 d = cosineSampleHemisphere(n, seed);
+            if (bvh.occluded(origin, d, maxDist)) hits++;
+        }
+        ao = 1.0f - (float)hits / options.aoSamples;
+    }
+
+    glm::vec3 ambient(0.0f);
+    glm::vec3 diffuse(0.0f);
+    float dirWeight = 0.0f;
+
+    // 平行光
+    {
+        const DirLightParams& light = setup.dirLight;
+        glm::vec3 l = glm::normalize(-light.direction);
+        float diff = std::max(glm::dot(n, l), 0.0f);
+        float visible = 1.0f;
+        if (options.shadows && diff > 0.0f && bvh.occluded(origin, l, FLT_MAX)) visible = 0.0f;
+
+        ambient += light.ambient * setup.material.ambient;
+        diffuse += light.diffuse * diff * setup.material.diffuse * visible;
+
+        glm::vec3 spec = light.specular * setup.material.specular * visible;
+        float w = luminance(spec) * (diff > 0.0f ? 1.0f : 0.0f);
+        out.lightDir += l * w;
+        out.specular += spec * (w > 0.0f ? 1.0f : 0.0f);
+        dirWeight += w;
+    }
+
+    // 点光源
+    for (const auto& light : setup.pointLights) {
+        glm::vec3 toLight = light.position - pos;
+        float distance = glm::length(toLight);
+        glm::vec3 l = toLight / std::max(distance, 1e-8f);
+        float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * distance * distance);
+        float diff = std::max(glm::dot(n, l), 0.0f);
+        float visible = 1.0f;
+        if (options.shadows && diff > 0.0f && bvh.occluded(origin, l, distance - eps)) visible = 0.0f;
+
+        ambient += light.ambient * setup.material.ambient * attenuation;
+        diffuse += light.diffuse * diff * setup.material.diffuse * attenuation * visible;
+
+        glm::vec3 spec = light.specular * setup.material.specular * attenuation * visible;
+        float w = luminance(spec) * (diff > 0.0f ? 1.0f : 0.0f);
+        out.lightDir += l * w;
+        out.specular += spec * (w > 0.0f ? 1.0f : 0.0f);
+        dirWeight += w;
+    }
+
+    // AO 只作用于环境光，直接光的遮挡由阴影射线负责
+    out.diffuse = ambient * ao + diffuse;
+    if (dirWeight > 0.0f) {
+        // 各光源方向越分散，合成的主方向越短，高光相应减弱
+        float len = glm::length(out.lightDir);
+        out.lightDir = len > 1e-6f ? out.lightDir / len : n;
+        out.specular *= len / dirWeight;
+    }
+    else {
+        out.lightDir = n;
+    }
+    return out;
+}
+
+// ===================== 多线程烘焙 =====================
+std::vector<BakedVertex> bakeVertexLighting(const LightSetup& setup, const BakeOptions& options,
+                                            const std::vector<glm::vec3>& positions,
+                                            const std::vector<glm::vec3>& normals,
+                                            const std::vector<unsigned int>& indices,
+                                            float sceneRadius) {
+    std::vector<BakedVertex> result(positions.size());
+
+    MeshBVH bvh;
+    bvh.build(positions, indices);
+
+    unsigned int threadCount = options.threads ? options.threads : std::thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 1;
+
+    // 以固定大小的块分发顶点，线程间负载自动均衡
+    const size_t chunk = 256;
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (;;) {
+            size_t begin = next.fetch_add(chunk);
+            if (begin >= positions.size()) break;
+            size_t end = std::min(begin + chunk, positions.size());
+            for (size_t i = begin; i < end; i++) {
+                result[i] = bakeVertex(setup, options, bvh, positions[i], normals[i], sceneRadius, (uint32_t)i * 9781u + 1u);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < threadCount; t++) threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads) t.join();
+    return result;
+}
+
+// ===================== 磁盘缓存 =====================
+bool loadBakeCache(const std::string& path, uint64_t key, size_t vertexCount, std::vector<BakedVertex>& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+
+    uint32_t magic = 0, version = 0;
+    uint64_t fileKey = 0, count = 0;
+    f.read((char*)&magic, sizeof(magic));
+    f.read((char*)&version, sizeof(version));
+    f.read((char*)&fileKey, sizeof(fileKey));
+    f.read((char*)&count, sizeof(count));
+    if (!f || magic != BAKE_CACHE_MAGIC || version != BAKE_CACHE_VERSION || fileKey != key || count != vertexCount) {
+        return false;
+    }
+
+    out.resize(count);
+    f.read((char*)out.data(), count * sizeof(BakedVertex));
+    return (bool)f;
+}
+
+bool saveBakeCache(const std::string& path, uint64_t key, const std::vector<BakedVertex>& data) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f) return false;
+
+    uint64_t count = data.size();
+    f.write((const char*)&BAKE_CACHE_MAGIC, sizeof(BAKE_CACHE_MAGIC));
+    f.write((const char*)&BAKE_CACHE_VERSION, sizeof(BAKE_CACHE_VERSION));
+    f.write((const char*)&key, sizeof(key));
+    f.write((const char*)&count, sizeof(count));
+    f.write((const char*)data.data(), count * sizeof(BakedVertex));
+    return (bool)f;
+}
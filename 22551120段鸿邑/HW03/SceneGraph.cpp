@@ -0,0 +1,111 @@
+#include "scene_graph.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// 左上 3×3 的逆转置。用余子式求：三列两两叉乘得到 det × 逆转置，再除以行列式；
+// 退化矩阵（某个方向缩放为 0）返回余子式本身，法线在片段着色器里会重新归一化
+glm::mat3 computeNormalMatrix(const glm::mat4& world) {
+    glm::vec3 c0(world[0]), c1(world[1]), c2(world[2]);
+    glm::mat3 cofactor(glm::cross(c1, c2), glm::cross(c2, c0), glm::cross(c0, c1));
+    float det = glm::dot(c0, cofactor[0]);
+    if (std::abs(det) < 1e-12f) return cofactor;
+    return cofactor * (1.0f / det);
+}
+
+} // namespace
+
+// ===================== 构建 =====================
+int SceneGraph::addNode(const std::string& name, int parent, const glm::mat4& local) {
+    int index = size();
+    names.push_back(name);
+    parents.push_back(parent);
+    locals.push_back(local);
+    worlds.push_back(local);
+    normals.push_back(glm::mat3(1.0f));
+    // 空包围盒（min > max），addLocalBounds 时合并
+    localMin.push_back(glm::vec3(1e30f));
+    localMax.push_back(glm::vec3(-1e30f));
+    worldMin.push_back(glm::vec3(1e30f));
+    worldMax.push_back(glm::vec3(-1e30f));
+    dirty.push_back(1);
+    return index;
+}
+
+int SceneGraph::instantiate(const SceneGraph& source, int parent) {
+    int base = size();
+    for (int i = 0; i < source.size(); i++) {
+        int p = source.parents[i] == NO_PARENT ? parent : base + source.parents[i];
+        addNode(source.names[i], p, source.locals[i]);
+        localMin[base + i] = source.localMin[i];
+        localMax[base + i] = source.localMax[i];
+    }
+    return base;
+}
+
+void SceneGraph::setLocal(int node, const glm::mat4& local) {
+    if (std::memcmp(&locals[node], &local, sizeof(glm::mat4)) == 0) return;
+    locals[node] = local;
+    dirty[node] = 1;
+}
+
+void SceneGraph::addLocalBounds(int node, const glm::vec3& minPos, const glm::vec3& maxPos) {
+    localMin[node] = glm::min(localMin[node], minPos);
+    localMax[node] = glm::max(localMax[node], maxPos);
+    dirty[node] = 1;
+}
+
+// ===================== 更新 =====================
+int SceneGraph::update() {
+    int updated = 0;
+    int count = size();
+    for (int i = 0; i < count; i++) {
+        int p = parents[i];
+        // 父节点在前，它的标记在这一遍里已经确定
+        if (p != NO_PARENT && dirty[p]) dirty[i] = 1;
+        if (!dirty[i]) continue;
+
+        worlds[i] = p == NO_PARENT ? locals[i] : worlds[p] * locals[i];
+        normals[i] = computeNormalMatrix(worlds[i]);
+        if (hasBounds(i)) {
+            // 变换后的 AABB：中心直接变换，半长取 |M| 作用于局部半长（Arvo）
+            glm::vec3 center = (localMin[i] + localMax[i]) * 0.5f;
+            glm::vec3 extent = (localMax[i] - localMin[i]) * 0.5f;
+            glm::vec3 c = glm::vec3(worlds[i] * glm::vec4(center, 1.0f));
+            glm::vec3 e(0.0f);
+            for (int axis = 0; axis < 3; axis++) e += glm::abs(glm::vec3(worlds[i][axis])) * extent[axis];
+            worldMin[i] = c - e;
+            worldMax[i] = c + e;
+        }
+        updated++;
+    }
+    std::fill(dirty.begin(), dirty.end(), 0);
+    return updated;
+}
+
+// ===================== 视锥 =====================
+Frustum Frustum::fromMatrix(const glm::mat4& clip) {
+    // clip 的第 r 行
+    auto row = [&](int r) { return glm::vec4(clip[0][r], clip[1][r], clip[2][r], clip[3][r]); };
+    Frustum f;
+    f.planes[0] = row(3) + row(0);   // 左
+    f.planes[1] = row(3) - row(0);   // 右
+    f.planes[2] = row(3) + row(1);   // 下
+    f.planes[3] = row(3) - row(1);   // 上
+    f.planes[4] = row(3) + row(2);   // 近
+    f.planes[5] = row(3) - row(2);   // 远
+    return f;
+}
+
+bool Frustum::intersects(const glm::vec3& minPos, const glm::vec3& maxPos) const {
+    for (const glm::vec4& plane : planes) {
+        // 沿平面法线方向最远的角点仍在外侧，则整个包围盒在外侧
+        glm::vec3 corner(plane.x >= 0.0f ? maxPos.x : minPos.x,
+                         plane.y >= 0.0f ? maxPos.y : minPos.y,
+                         plane.z >= 0.0f ? maxPos.z : minPos.z);
+        if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f) return false;
+    }
+    return true;
+}
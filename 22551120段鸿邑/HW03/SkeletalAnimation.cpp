@@ -0,0 +1,229 @@
+#include "skeletal_animation.h"
+#include "scene_graph.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+// ===================== 骨骼 =====================
+int Skeleton::findOrAdd(const std::string& name, const glm::mat4& offset) {
+    for (int i = 0; i < size(); i++) {
+        if (nodes[i] == -1 && names[i] == name) return i;
+    }
+    if (size() >= MAX_BONES) return -1;
+    names.push_back(name);
+    nodes.push_back(-1);
+    offsets.push_back(offset);
+    return size() - 1;
+}
+
+int Skeleton::addRigid(int node) {
+    for (int i = 0; i < size(); i++) {
+        if (nodes[i] == node && names[i].empty()) return i;
+    }
+    if (size() >= MAX_BONES) return -1;
+    names.push_back(std::string());
+    nodes.push_back(node);
+    offsets.push_back(glm::mat4(1.0f));
+    return size() - 1;
+}
+
+bool Skeleton::resolve(const SceneGraph& graph) {
+    bool complete = true;
+    for (int i = 0; i < size(); i++) {
+        if (nodes[i] != -1) continue;
+        for (int n = 0; n < graph.size() && nodes[i] == -1; n++) {
+            if (graph.name(n) == names[i]) nodes[i] = n;
+        }
+        if (nodes[i] == -1) complete = false;
+    }
+    return complete;
+}
+
+// ===================== 关键帧采样 =====================
+namespace {
+
+// 找 t 所在的区间 [k, k+1]：从上次的游标开始，时间单调前进时通常就在原区间或下一个区间
+int findKey(const std::vector<float>& keyTimes, float t, int& cursor, uint64_t& searches) {
+    int last = (int)keyTimes.size() - 1;
+    if (cursor > last || keyTimes[cursor] > t) cursor = 0;   // 循环回到开头
+    if (cursor < last && keyTimes[cursor + 1] <= t) {
+        searches++;
+        while (cursor < last && keyTimes[cursor + 1] <= t) cursor++;
+    }
+    return cursor;
+}
+
+float keyFactor(const std::vector<float>& keyTimes, int k, float t) {
+    float span = keyTimes[k + 1] - keyTimes[k];
+    return span > 0.0f ? std::min(std::max((t - keyTimes[k]) / span, 0.0f), 1.0f) : 0.0f;
+}
+
+glm::vec3 sampleVec3(const std::vector<float>& keyTimes, const std::vector<glm::vec3>& values, float t,
+                     int& cursor, uint64_t& searches, glm::vec3 fallback) {
+    if (values.empty()) return fallback;
+    int k = findKey(keyTimes, t, cursor, searches);
+    if (k + 1 >= (int)values.size()) return values[k];
+    return glm::mix(values[k], values[k + 1], keyFactor(keyTimes, k, t));
+}
+
+glm::quat sampleQuat(const std::vector<float>& keyTimes, const std::vector<glm::quat>& values, float t,
+                     int& cursor, uint64_t& searches) {
+    if (values.empty()) return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    int k = findKey(keyTimes, t, cursor, searches);
+    if (k + 1 >= (int)values.size()) return values[k];
+    return glm::normalize(glm::slerp(values[k], values[k + 1], keyFactor(keyTimes, k, t)));
+}
+
+} // namespace
+
+// ===================== 初始化 =====================
+bool Animator::init(const SceneGraph& graph, const Skeleton& skeleton, const std::vector<AnimationClip>& clips,
+                    int instances, unsigned threads) {
+    parents.clear();
+    bindLocals.clear();
+    for (int i = 0; i < graph.size(); i++) {
+        parents.push_back(graph.parent(i));
+        bindLocals.push_back(graph.local(i));
+    }
+    boneNodes = skeleton.nodes;
+    offsets = skeleton.offsets;
+    if (!clips.empty()) clip = clips[0];
+
+    // 各实例错开播放进度，画面上不会整齐划一
+    times.resize(instances);
+    for (int i = 0; i < instances; i++) times[i] = clip.duration > 0.0f ? std::fmod(i * 0.37f, clip.duration) : 0.0f;
+    cursors.assign((size_t)instances * clip.channels.size() * 3, 0);
+    blocks.assign((size_t)instances * stride(), glm::mat4(1.0f));
+    mainScratch.locals.resize(parents.size());
+    mainScratch.globals.resize(parents.size());
+
+    if (threads == 0) threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    quit = false;
+    for (unsigned i = 0; i < threads; i++) workers.emplace_back(&Animator::workerMain, this);
+
+    // 先求一次，保证第一帧之前矩阵块有效
+    beginUpdate(0.0f);
+    wait();
+    stats = AnimatorStats();
+    return true;
+}
+
+void Animator::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+}
+
+// ===================== 每帧 =====================
+void Animator::beginUpdate(float dt) {
+    // 先设 remaining 再放开 next：上一帧醒得晚的线程在 next 归零之前领不到实例
+    frameDt = dt * speed;
+    remaining = instanceCount();
+    next = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+    }
+    wake.notify_all();
+}
+
+void Animator::wait() {
+    auto start = std::chrono::steady_clock::now();
+    runBatches(mainScratch);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return remaining.load() <= 0; });
+    }
+    stats.frames++;
+    stats.waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats.evaluateMs += evaluateNs.exchange(0) / 1.0e6;
+    stats.keySamples += samples.exchange(0);
+    stats.keySearches += searches.exchange(0);
+}
+
+void Animator::workerMain() {
+    Scratch scratch;
+    scratch.locals.resize(parents.size());
+    scratch.globals.resize(parents.size());
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || generation != seen; });
+            if (quit) return;
+            seen = generation;
+        }
+        runBatches(scratch);
+    }
+}
+
+// 领取实例直到取完；完成最后一批的线程唤醒 wait()
+void Animator::runBatches(Scratch& scratch) {
+    auto start = std::chrono::steady_clock::now();
+    int count = instanceCount();
+    int finished = 0;
+    scratch.samples = scratch.searches = 0;
+    for (;;) {
+        int first = next.fetch_add(BATCH);
+        if (first >= count) break;
+        int last = std::min(first + BATCH, count);
+        for (int i = first; i < last; i++) evaluate(i, scratch);
+        finished += last - first;
+    }
+    if (finished == 0) return;
+    evaluateNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    samples += scratch.samples;
+    searches += scratch.searches;
+    if (remaining.fetch_sub(finished) == finished) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.notify_all();
+    }
+}
+
+void Animator::evaluate(int instance, Scratch& scratch) {
+    float& t = times[instance];
+    if (clip.duration > 0.0f) t = std::fmod(t + frameDt, clip.duration);
+
+    std::vector<glm::mat4>& locals = scratch.locals;
+    std::vector<glm::mat4>& globals = scratch.globals;
+    std::copy(bindLocals.begin(), bindLocals.end(), locals.begin());
+
+    // 动画通道覆盖节点的局部矩阵：T × R × S
+    int* cursor = cursors.data() + (size_t)instance * clip.channels.size() * 3;
+    for (const AnimationChannel& c : clip.channels) {
+        glm::vec3 position = sampleVec3(c.positionTimes, c.positions, t, cursor[0], scratch.searches, glm::vec3(0.0f));
+        glm::quat rotation = sampleQuat(c.rotationTimes, c.rotations, t, cursor[1], scratch.searches);
+        glm::vec3 scale = sampleVec3(c.scaleTimes, c.scales, t, cursor[2], scratch.searches, glm::vec3(1.0f));
+        scratch.samples += 3;
+        cursor += 3;
+
+        glm::mat4 m = glm::mat4_cast(rotation);
+        m[0] *= scale.x;
+        m[1] *= scale.y;
+        m[2] *= scale.z;
+        m[3] = glm::vec4(position, 1.0f);
+        locals[c.node] = m;
+    }
+
+    for (size_t i = 0; i < parents.size(); i++) {
+        globals[i] = parents[i] < 0 ? locals[i] : globals[parents[i]] * locals[i];
+    }
+
+    glm::mat4* bones = block(instance) + HEADER;
+    for (size_t b = 0; b < boneNodes.size(); b++) {
+        bones[b] = boneNodes[b] < 0 ? glm::mat4(1.0f) : globals[boneNodes[b]] * offsets[b];
+    }
+}
+
+void Animator::printStats(const char* app) const {
+    if (stats.frames == 0) return;
+    std::cout << "[anim] " << app << "：" << instanceCount() << " 个实例 × " << boneCount() << " 根骨骼，"
+              << threadCount() << " 个工作线程 + 主线程；每帧主线程等待 " << stats.waitMs / stats.frames
+              << " ms，求值合计 " << stats.evaluateMs / stats.frames << " ms，关键帧游标命中 "
+              << (stats.keySamples ? 100.0 * (1.0 - (double)stats.keySearches / stats.keySamples) : 100.0) << "%" << std::endl;
+}
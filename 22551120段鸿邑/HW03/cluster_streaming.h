@@ -0,0 +1,181 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+struct Frustum;
+
+// ===================== 核外（out-of-core）模型流式加载 =====================
+// 扫描模型比主机内存还大，Model 却把全部顶点同时留在 CPU 与 GPU 上。核外模式改为：
+//   1. 离线分页（buildClusterFile）：按三角形重心把模型划分成八叉树，每个节点是一页，顺序写入簇文件
+//      - 核外进行：模型先追加到临时文件（ClusterInput），每层把节点的三角形与顶点文件拆分到子节点的文件，
+//        内存中只有当前节点的一页与它碰到的聚类格子，与模型大小无关
+//      - 叶节点保存原始三角形，超过 PAGE_TRIANGLES 个三角形或 PAGE_VERTICES 个顶点就继续细分
+//      - 内部节点保存整棵子树的粗糙代理：顶点聚类简化（网格 PROXY_GRID³，对齐到八叉树），
+//        同一层的聚类网格是全局的，每个格子取所有落入顶点的平均（节点的顶点文件带一圈外延，逐节点求出的平均与全局相同），
+//        相邻页的边界顶点一致
+//      - 每页记录几何误差（聚类格子的对角线长度，叶节点为 0），运行时换算成屏幕空间误差
+//   2. 运行时（ClusterStreamer）：节点表常驻，页按需读入
+//      - 从根节点向下遍历：屏幕空间误差超过 errorPixels 且视锥内的子节点全部驻留时细分，否则画当前页。
+//        子节点未就绪时继续画父节点的代理，流式加载期间画面逐步变清晰，不会出现空洞
+//      - 缺页按屏幕空间误差从大到小排序交给读盘线程；读好的页每帧最多上传 MAX_UPLOADS 页
+//      - 显存：固定大小的缓冲池，每个槽位可放一整页（PAGE_VERTICES 个顶点 + PAGE_TRIANGLES 个三角形），
+//        共用一个 VAO，用 glDrawElementsBaseVertex 绘制。池满时淘汰上一帧没有用到的最久未用的页（LRU），根节点常驻
+//      - 主机内存：已读入、尚未上传的页不超过 hostBytes，超出时读盘线程暂停
+// 顶点只有位置与法线（24 字节），索引为 16 位；不参与光照烘焙，使用逐像素光照。
+// 相邻页的级别不同处可能有 T 形接缝，误差阈值取 1 像素时基本不可见。
+struct ClusterStats {
+    int nodes = 0;
+    int resident = 0;
+    int poolSlots = 0;
+    int drawnPages = 0;            // 本帧绘制的页
+    int proxyPages = 0;            // 其中误差仍超过阈值（子节点未就绪）的页
+    uint64_t triangles = 0;        // 本帧绘制的三角形
+    int pending = 0;               // 排队、读盘中或已读好未上传的页
+    uint64_t pagesStreamed = 0;
+    uint64_t bytesStreamed = 0;
+    uint64_t evictions = 0;
+    uint64_t dropped = 0;          // 读好后因池中没有可淘汰的槽位而丢弃的页
+    uint64_t stagingPeak = 0;      // 已读入未上传的页的峰值字节数
+    uint64_t poolFullFrames = 0;   // 缓冲池没有可淘汰的槽位、暂停提交缺页的帧数（停留在代理上）
+    // 累计值，用于求每帧平均
+    uint64_t frames = 0;
+    uint64_t pagesDrawnTotal = 0;
+    uint64_t proxyPagesTotal = 0;
+    uint64_t trianglesTotal = 0;
+};
+
+// 一页的绘制参数，传给 DrawPacket 或 glDrawElementsBaseVertex
+struct ClusterDraw {
+    GLsizei count;
+    size_t indexOffset;            // 索引缓冲内的字节偏移
+    GLint baseVertex;
+    float distance;                // 到相机的距离（局部空间），用于排序
+};
+
+// source 为原始模型文件，簇文件中记录其大小与修改时间；源文件不存在时（只分发簇文件）只检查簇文件本身
+bool clusterFileUpToDate(const std::string& source, const std::string& clusterPath);
+
+// 离线分页的输入：顶点与三角形按顺序追加到临时目录下的两个文件，不在内存中保留整份模型；析构时删除临时目录
+class ClusterInput {
+public:
+    explicit ClusterInput(const std::string& tempDir);
+    ~ClusterInput();
+    // 一个网格的模型空间顶点（已按节点变换）与三角形，indices 为网格内的下标
+    void addMesh(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+                 const std::vector<unsigned int>& indices);
+    uint64_t triangles() const { return triangleCount; }
+
+private:
+    friend bool buildClusterFile(const std::string& source, const std::string& clusterPath, ClusterInput& input);
+    std::string dir;
+    std::ofstream vertexFile;
+    std::ofstream triangleFile;
+    uint32_t vertexCount = 0;
+    uint64_t triangleCount = 0;
+    glm::vec3 boundsMin{ 1e30f };
+    glm::vec3 boundsMax{ -1e30f };
+
+    std::string vertexPath() const { return dir + "/input.vtx"; }
+    std::string trianglePath() const { return dir + "/input.tri"; }
+    bool finish();   // 关闭两个文件，写入出错或没有三角形时返回 false
+};
+
+// 离线分页：input 中的模型写成簇文件，临时文件放在 input 的目录下，逐层删除
+bool buildClusterFile(const std::string& source, const std::string& clusterPath, ClusterInput& input);
+
+class ClusterStreamer {
+public:
+    static constexpr int PAGE_TRIANGLES = 8192;
+    static constexpr int PAGE_VERTICES = 8192;
+    static constexpr int PROXY_GRID = 32;
+    static constexpr int MAX_DEPTH = 12;
+    static constexpr int MAX_UPLOADS = 8;
+    static constexpr int MAX_REQUESTS = 64;
+    static constexpr int MIN_SLOTS = 16;
+    static constexpr size_t SLOT_VERTEX_BYTES = (size_t)PAGE_VERTICES * 6 * sizeof(float);
+    static constexpr size_t SLOT_INDEX_BYTES = (size_t)PAGE_TRIANGLES * 3 * sizeof(uint16_t);
+
+    // gpuBytes 决定缓冲池槽位数（至少 MIN_SLOTS 个），hostBytes 为已读入未上传的页的上限；
+    // 打开时同步读入根节点（整个模型最粗的代理）
+    bool open(const std::string& clusterPath, uint64_t gpuBytes, uint64_t hostBytes);
+    void close();
+    bool isOpen() const { return vao != 0; }
+
+    // 每帧：beginFrame 上传读好的页；每个实例调用一次 select 得到本帧要画的页；endFrame 提交缺页
+    void beginFrame();
+    // model 为实例的模型矩阵，viewportHeight 为视口高度（像素），结果追加到 out
+    void select(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight,
+                std::vector<ClusterDraw>& out);
+    void endFrame();
+
+    // 立即绘制（--immediate / --no-stream）：调用方已设置程序与常量
+    void draw(const std::vector<ClusterDraw>& draws) const;
+    GLuint vertexArray() const { return vao; }
+    const glm::vec3& boundsMin() const { return rootMin; }
+    const glm::vec3& boundsMax() const { return rootMax; }
+    void printStats() const;
+
+    ClusterStats stats;
+    float errorPixels = 1.0f;      // 屏幕空间误差阈值（像素），--ooc-error 设置
+
+private:
+    struct Node {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        float error;
+        int firstChild;
+        int childCount;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint64_t offset;
+        int slot = -1;
+        uint64_t lastUsed = 0;
+    };
+    std::vector<Node> nodes;
+    glm::vec3 rootMin{ 0.0f };
+    glm::vec3 rootMax{ 0.0f };
+
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    std::vector<int> slotNode;     // 槽位 → 节点，-1 为空闲
+    uint64_t frame = 0;
+
+    // 缺页：本帧遍历时收集（节点，屏幕空间误差），endFrame 排序后交给读盘线程
+    struct Want {
+        int node;
+        float priority;
+    };
+    std::vector<Want> wants;
+
+    // 读盘线程
+    struct LoadedPage {
+        int node;
+        std::vector<uint8_t> data;
+    };
+    std::string path;
+    std::thread loader;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<int> queue;                  // 待读，队首优先
+    std::vector<LoadedPage> loaded;
+    std::unordered_set<int> requested;       // 已提交但尚未上传（排队、读盘中或已读好）
+    uint64_t hostBytes = 0;
+    uint64_t stagingBytes = 0;
+    bool quit = false;
+
+    void loaderMain();
+    void visit(int index, const glm::vec3& cameraLocal, const Frustum& frustum, float pixelsPerUnit, std::vector<ClusterDraw>& out);
+    float screenError(const Node& node, const glm::vec3& cameraLocal, float pixelsPerUnit) const;
+    size_t pageBytes(const Node& node) const;
+    int allocateSlot();
+    void upload(int index, const uint8_t* data, int slot);
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ===================== 光源/材质参数（与 lighting.fs 中的结构体一一对应） =====================
+struct MaterialParams {
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+    float shininess;
+};
+
+struct DirLightParams {
+    glm::vec3 direction;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+};
+
+struct PointLightParams {
+    glm::vec3 position;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// 整个场景的静态光照配置（光源相对模型静止，位置均为模型空间）
+struct LightSetup {
+    MaterialParams material;
+    DirLightParams dirLight;
+    std::vector<PointLightParams> pointLights;
+};
+
+// ===================== 烘焙参数 =====================
+struct BakeOptions {
+    int aoSamples = 32;        // 每顶点环境光遮蔽采样数（0 表示关闭AO）
+    float aoDistance = 0.25f;  // AO 射线最大长度（相对模型包围球半径）
+    bool shadows = true;       // 是否对光源投射阴影射线
+    unsigned threads = 0;      // 工作线程数（0 表示使用全部硬件线程）
+};
+
+// 每个顶点的烘焙结果：
+// diffuse  —— 环境光 + 漫反射（已乘材质、衰减、阴影与AO），运行时直接使用
+// lightDir —— 按镜面能量加权的主光方向（模型空间），运行时用于计算视角相关的高光
+// specular —— 主光方向上的高光颜色（已乘材质、衰减与阴影）
+struct BakedVertex {
+    glm::vec3 diffuse;
+    glm::vec3 lightDir;
+    glm::vec3 specular;
+};
+
+// ===================== 网格 BVH（仅用于遮挡查询） =====================
+class MeshBVH {
+public:
+    void build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices);
+    // 射线在 (0, tMax) 内是否被任意三角形遮挡
+    bool occluded(const glm::vec3& origin, const glm::vec3& dir, float tMax) const;
+    size_t nodeCount() const { return nodes.size(); }
+
+private:
+    struct Node {
+        glm::vec3 bmin;
+        glm::vec3 bmax;
+        unsigned int leftOrFirst; // 内部节点：右孩子下标（左孩子恒为下一个节点）；叶节点：首个三角形下标
+        unsigned int count;       // 叶节点三角形数量，0 表示内部节点
+    };
+    struct Triangle {
+        glm::vec3 v0, e1, e2;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Triangle> tris;
+    std::vector<unsigned int> triIndex;
+
+    unsigned int buildRecursive(std::vector<glm::vec3>& centroids, unsigned int first, unsigned int count);
+};
+
+// ===================== 烘焙入口 =====================
+// positions/normals/indices 为所有网格拼接后的模型空间数据
+uint64_t computeBakeKey(const LightSetup& setup, const BakeOptions& options,
+                        const std::vector<glm::vec3>& positions,
+                        const std::vector<glm::vec3>& normals,
+                        const std::vector<unsigned int>& indices);
+
+std::vector<BakedVertex> bakeVertexLighting(const LightSetup& setup, const BakeOptions& options,
+                                            const std::vector<glm::vec3>& positions,
+                                            const std::vector<glm::vec3>& normals,
+                                            const std::vector<unsigned int>& indices,
+                                            float sceneRadius);
+
+// 磁盘缓存：key 不匹配（光源或几何发生变化）时返回 false，调用方应重新烘焙
+bool loadBakeCache(const std::string& path, uint64_t key, size_t vertexCount, std::vector<BakedVertex>& out);
+bool saveBakeCache(const std::string& path, uint64_t key, const std::vector<BakedVertex>& data);
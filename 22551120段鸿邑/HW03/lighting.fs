@@ -4,6 +4,9 @@ out vec4 FragColor;
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+in vec3 BakedDiffuse;
+in vec3 BakedLightDir;
+in vec3 BakedSpecular;
 
 // ʽṹ
 struct Material {
@@ -34,13 +37,30 @@ struct PointLight {
     float linear;
     float quadratic;
 };
-#define MAX_POINT_LIGHTS 4
-uniform PointLight pointLights[MAX_POINT_LIGHTS];
-uniform int pointLightCount;
+// Դɳ #define ע루һ£ѭΪڳȫչ
+#ifndef POINT_LIGHT_COUNT
+#define POINT_LIGHT_COUNT 4
+#endif
+#if POINT_LIGHT_COUNT > 0
+uniform PointLight pointLights[POINT_LIGHT_COUNT];
+#endif
 
+#ifdef STREAM_UNIFORMS
+// ӵλ決һ FrameBlock У lighting.vs һ£
+layout(std140) uniform FrameBlock {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+    bool useBakedLighting;
+};
+#else
 // ӵλ
 uniform vec3 viewPos;
 
+// Ƿʹú決
+uniform bool useBakedLighting;
+#endif
+
 // ƽй
 vec3 calcDirLight(DirLight light, vec3 normal, vec3 viewDir) {
     vec3 lightDir = normalize(-light.direction);
@@ -82,13 +102,23 @@ void main() {
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
 
+    // 決ģʽֱӲֻһӽصĸ߹
+    if (useBakedLighting) {
+        vec3 reflectDir = reflect(-normalize(BakedLightDir), norm);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+        FragColor = vec4(BakedDiffuse + BakedSpecular * spec, 1.0);
+        return;
+    }
+
     // 1. ƽй⹱
     vec3 result = calcDirLight(dirLight, norm, viewDir);
 
     // 2. ԴףѭеԴ
-    for(int i = 0; i < pointLightCount; i++) {
+#if POINT_LIGHT_COUNT > 0
+    for(int i = 0; i < POINT_LIGHT_COUNT; i++) {
         result += calcPointLight(pointLights[i], norm, FragPos, viewDir);
     }
+#endif
 
     // ɫ
     FragColor = vec4(result, 1.0);
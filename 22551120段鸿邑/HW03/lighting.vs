@@ -2,22 +2,69 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// 決գģͿռ䣩
+layout (location = 3) in vec3 aBakedDiffuse;
+layout (location = 4) in vec3 aBakedLightDir;
+layout (location = 5) in vec3 aBakedSpecular;
+#ifdef SKINNED
+// 4 ±꣨ԣ 4 һ 8 λȨ
+layout (location = 6) in uvec4 aBoneIds;
+layout (location = 7) in vec4 aBoneWeights;
+#endif
 
 // Ƭɫ
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+out vec3 BakedDiffuse;
+out vec3 BakedLightDir;
+out vec3 BakedSpecular;
 
-// ͳһ
+// ͳһSTREAM_UNIFORMS  std140 uniform ʽλ尴ƫư
+// FrameBlock  lighting.fs еһ£Ա˳ HW03.cpp  FrameConstants һ£
+#ifdef STREAM_UNIFORMS
+layout(std140) uniform FrameBlock {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+    bool useBakedLighting;
+};
+// SKINNED ģ;֮ʵĹ Animator ľһ£
+layout(std140) uniform DrawBlock {
+    mat4 model;
+    mat4 normalMatrix;
+#ifdef SKINNED
+    mat4 bones[BONE_COUNT];
+#endif
+};
+#else
 uniform mat4 model;
+uniform mat4 normalMatrix;
+#ifdef SKINNED
+uniform mat4 bones[BONE_COUNT];
+#endif
 uniform mat4 view;
 uniform mat4 projection;
+#endif
 
 void main() {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    // ߾ŶԷߵӰ
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+#ifdef SKINNED
+    // Ƥռ䵽ģͿռ䣬ȨػϺٽģ;
+    mat4 skin = bones[aBoneIds.x] * aBoneWeights.x + bones[aBoneIds.y] * aBoneWeights.y
+              + bones[aBoneIds.z] * aBoneWeights.z + bones[aBoneIds.w] * aBoneWeights.w;
+    vec4 localPos = skin * vec4(aPos, 1.0);
+    vec3 localNormal = mat3(skin) * aNormal;
+#else
+    vec4 localPos = vec4(aPos, 1.0);
+    vec3 localNormal = aNormal;
+#endif
+    FragPos = vec3(model * localPos);
+    // ߾model  33 תãŶԷߵӰ죩 CPU ͼڵԤã𶥵
+    Normal = mat3(normalMatrix) * localNormal;
     TexCoords = aTexCoords;
+    BakedDiffuse = aBakedDiffuse;
+    BakedLightDir = mat3(model) * aBakedLightDir;
+    BakedSpecular = aBakedSpecular;
     // նλ
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
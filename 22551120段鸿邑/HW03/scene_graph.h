@@ -0,0 +1,63 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ===================== 场景图 =====================
+// 节点存放在扁平数组中，每个属性一个数组（SoA），并且父节点总排在子节点之前。
+// 因此 update() 只需顺序遍历一遍：父节点被重算的节点在同一遍里跟着重算，不需要递归。
+// 每个节点保存：
+//   - 局部矩阵与世界矩阵
+//   - 法线矩阵：世界矩阵左上 3×3 的逆转置，在 CPU 上每个节点算一次，不再由顶点着色器逐顶点求逆
+//   - 包围盒：节点自身网格的 AABB（局部空间）及其世界空间外包盒，用于视锥剔除
+// setLocal 只标记该节点，update 把标记传播到整棵子树；没有变化的子树不做任何矩阵运算。
+class SceneGraph {
+public:
+    static constexpr int NO_PARENT = -1;
+
+    // parent 为已存在的节点或 NO_PARENT，返回新节点的下标
+    int addNode(const std::string& name, int parent, const glm::mat4& local);
+    // 把 source 的全部节点按原顺序复制到 parent 之下（source 的根节点挂到 parent），
+    // 返回起始下标：source 的节点 i 复制后的下标为 返回值 + i
+    int instantiate(const SceneGraph& source, int parent);
+    // 与当前值相同时不标记
+    void setLocal(int node, const glm::mat4& local);
+    // 合并到节点已有的局部包围盒
+    void addLocalBounds(int node, const glm::vec3& minPos, const glm::vec3& maxPos);
+    // 重算被标记的节点及其子树，返回本次重算的节点数
+    int update();
+
+    int size() const { return (int)parents.size(); }
+    int parent(int node) const { return parents[node]; }
+    const std::string& name(int node) const { return names[node]; }
+    const glm::mat4& local(int node) const { return locals[node]; }
+    const glm::mat4& world(int node) const { return worlds[node]; }
+    const glm::mat3& normalMatrix(int node) const { return normals[node]; }
+    // 没有网格的节点没有包围盒
+    bool hasBounds(int node) const { return localMin[node].x <= localMax[node].x; }
+    const glm::vec3& worldBoundsMin(int node) const { return worldMin[node]; }
+    const glm::vec3& worldBoundsMax(int node) const { return worldMax[node]; }
+
+private:
+    std::vector<std::string> names;
+    std::vector<int> parents;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<glm::mat3> normals;
+    std::vector<glm::vec3> localMin;
+    std::vector<glm::vec3> localMax;
+    std::vector<glm::vec3> worldMin;
+    std::vector<glm::vec3> worldMax;
+    std::vector<uint8_t> dirty;
+};
+
+// ===================== 视锥 =====================
+// 从 projection × view 提取 6 个平面（Gribb-Hartmann 方法，平面法线朝内），
+// AABB 完全位于任一平面外侧时不可见。保守测试：少数实际不可见的包围盒仍会通过
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4& clip);
+    bool intersects(const glm::vec3& minPos, const glm::vec3& maxPos) const;
+};
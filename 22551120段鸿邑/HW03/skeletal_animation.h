@@ -0,0 +1,130 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class SceneGraph;
+
+// ===================== 骨骼动画 =====================
+// 导入（HW03.cpp 的 Model 从 Assimp 读取）：
+//   - 骨骼：aiMesh::mBones，每根骨骼对应模型节点层级中的同名节点，offset 把网格空间变到骨骼空间
+//   - 片段：aiAnimation 的每个通道驱动一个节点的平移 / 旋转 / 缩放关键帧，时间换算成秒
+//   - 顶点：每个顶点保留权重最大的 4 个影响，骨骼下标与权重各占 4 个字节打包进顶点流
+// MAX_BONES 受两处限制：下标为 8 位；矩阵块（HEADER + 骨骼数）个 mat4 不超过 uniform 块保证的最小上限 16 KB
+// 有动画的模型里，没有骨骼影响的顶点挂到所属节点的"刚体骨骼"上（offset 为单位阵，权重 1），
+// 所有网格走同一条蒙皮路径，只有节点动画的部件也能动。
+// 求值（Animator）：每个实例有自己的播放时间与关键帧游标，由工作线程并行计算：
+//   节点局部矩阵取绑定姿态，再由动画通道覆盖 → 按父节点在前的顺序求模型空间矩阵 → 骨骼矩阵 = 全局 × offset
+// 关键帧游标记住上次所在的区间，时间单调前进时查找是 O(1)，循环回到开头时才重置。
+// 蒙皮在顶点着色器里完成（lighting.vs 的 SKINNED 变体），CPU 每帧只算 实例数 × 节点数 个矩阵，
+// 骨骼矩阵与模型矩阵连成一块，整块写入 DrawBlock。
+struct Skeleton {
+    static constexpr int MAX_BONES = 254;
+
+    std::vector<std::string> names;
+    std::vector<int> nodes;                 // 骨骼 → 模型节点下标，-1 表示尚未按名字对应
+    std::vector<glm::mat4> offsets;
+
+    // 按名字查找骨骼，不存在时添加；超过 MAX_BONES 时返回 -1
+    int findOrAdd(const std::string& name, const glm::mat4& offset);
+    // 节点自身的刚体骨骼（每个节点至多一根）
+    int addRigid(int node);
+    // 按名字把骨骼对应到节点；有找不到节点的骨骼时返回 false（这些骨骼保持绑定姿态）
+    bool resolve(const SceneGraph& graph);
+    int size() const { return (int)names.size(); }
+};
+
+struct AnimationChannel {
+    int node = -1;
+    std::vector<float> positionTimes;
+    std::vector<glm::vec3> positions;
+    std::vector<float> rotationTimes;
+    std::vector<glm::quat> rotations;
+    std::vector<float> scaleTimes;
+    std::vector<glm::vec3> scales;
+};
+
+struct AnimationClip {
+    std::string name;
+    float duration = 0.0f;   // 秒
+    std::vector<AnimationChannel> channels;
+};
+
+struct AnimatorStats {
+    uint64_t frames = 0;
+    double waitMs = 0.0;         // 主线程在 wait() 里的时间（自己也领取实例计算），即动画在关键路径上的开销
+    double evaluateMs = 0.0;     // 所有线程求值的 CPU 时间之和
+    uint64_t keySamples = 0;     // 关键帧查找次数
+    uint64_t keySearches = 0;    // 其中游标缓存未命中、需要向后搜索的次数
+};
+
+class Animator {
+public:
+    static constexpr int HEADER = 2;   // 每个实例的矩阵块前预留的 mat4 个数，由调用方填入模型矩阵与法线矩阵
+    static constexpr int BATCH = 4;    // 线程每次领取的实例数
+
+    // graph 为模型自身的节点层级（父节点在前），播放 clips[0]（没有片段时保持绑定姿态）；
+    // threads 为 0 时使用硬件线程数 - 1（至少 1 个）
+    bool init(const SceneGraph& graph, const Skeleton& skeleton, const std::vector<AnimationClip>& clips,
+              int instances, unsigned threads = 0);
+    void shutdown();
+
+    // 推进播放时间并唤醒工作线程，立即返回；主线程可以先做别的（更新场景图等）
+    void beginUpdate(float dt);
+    // 主线程也参与领取实例，全部完成后返回
+    void wait();
+
+    // 实例的矩阵块：HEADER 个 mat4 + boneCount 个骨骼矩阵，wait() 之后有效
+    glm::mat4* block(int instance) { return &blocks[(size_t)instance * stride()]; }
+    size_t blockBytes() const { return stride() * sizeof(glm::mat4); }
+    int boneCount() const { return (int)boneNodes.size(); }
+    int instanceCount() const { return (int)times.size(); }
+    unsigned threadCount() const { return (unsigned)workers.size(); }
+    void printStats(const char* app) const;
+
+    AnimatorStats stats;
+    float speed = 1.0f;
+
+private:
+    struct Scratch {
+        std::vector<glm::mat4> locals;
+        std::vector<glm::mat4> globals;
+        uint64_t samples = 0;
+        uint64_t searches = 0;
+    };
+
+    std::vector<int> parents;
+    std::vector<glm::mat4> bindLocals;
+    std::vector<int> boneNodes;
+    std::vector<glm::mat4> offsets;
+    AnimationClip clip;
+
+    std::vector<float> times;          // 每个实例的播放时间
+    std::vector<int> cursors;          // 每个实例 × 通道 × 3（平移 / 旋转 / 缩放）的关键帧游标
+    std::vector<glm::mat4> blocks;
+    float frameDt = 0.0f;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation = 0;
+    bool quit = false;
+    std::atomic<int> next{ 0 };
+    std::atomic<int> remaining{ 0 };
+    std::atomic<uint64_t> evaluateNs{ 0 };
+    std::atomic<uint64_t> samples{ 0 };
+    std::atomic<uint64_t> searches{ 0 };
+    Scratch mainScratch;
+
+    size_t stride() const { return (size_t)HEADER + boneNodes.size(); }
+    void workerMain();
+    void runBatches(Scratch& scratch);
+    void evaluate(int instance, Scratch& scratch);
+};